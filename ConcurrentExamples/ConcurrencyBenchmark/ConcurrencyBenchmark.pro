@@ -0,0 +1,52 @@
+#---------------------------------------------------------------------------------------
+# @功能：       Qt各种并发方式的性能对比测试
+# @编译器：     Desktop Qt 5.12.5 MSVC2017 64bit（也支持其它编译器）
+# @Qt IDE：    D:/Qt/Qt5.12.5/Tools/QtCreator/share/qtcreator
+#
+# @开发者     mhf
+# @邮箱       1603291350@qq.com
+# @时间       2025-03-15 10:20:00
+# @备注       1、同一批任务分别使用QThread子类、moveToThread工作对象、QThreadPool、QtConcurrent::run/map/mappedReduced
+#              和ScanFile中的工作窃取线程池执行；
+#            2、任务包括CPU密集、内存密集、阻塞IO三种，扫描任务粒度和线程数；
+#            3、输出吞吐量、每个任务的调度开销和任务延迟（p50/p99/最大值），可保存为csv。
+#            需要使用Release模式编译运行。
+#---------------------------------------------------------------------------------------
+requires(qtHaveModule(concurrent))
+
+QT -= gui
+QT += concurrent
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+    benchmark.cpp \
+    main.cpp
+
+HEADERS += \
+    benchmark.h
+
+# 使用ScanFile中的线程池（只有头文件）
+INCLUDEPATH += $$PWD/../../FunctionalModule/ScanFile/ScanFileLib
+
+#  定义程序版本号
+VERSION = 1.0.0
+DEFINES += APP_VERSION=\\\"$$VERSION\\\"
+
+contains(QT_ARCH, i386){        # 使用32位编译器
+DESTDIR = $$PWD/../bin          # 程序输出路径
+}else{
+DESTDIR = $$PWD/../bin64        # 使用64位编译器
+}
+
+# msvc >= 2017  编译器使用utf-8编码
+msvc {
+    greaterThan(QMAKE_MSC_VER, 1900){       # msvc编译器版本大于2015
+        QMAKE_CFLAGS += /utf-8
+        QMAKE_CXXFLAGS += /utf-8
+    }else{
+    # msvc2015及以下版本在代码中使用【pragma execution_character_set("utf-8")】指定编码
+    }
+}
@@ -0,0 +1,447 @@
+#include "benchmark.h"
+
+#include "ThreadPool.h"   // ScanFile中的工作窃取线程池
+#include <QFuture>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace {
+
+Benchmark* g_bench = nullptr;   // QtConcurrent的map/reduce函数只能是普通函数，通过全局指针访问当前测试
+
+/**
+ * @brief 内存密集任务使用的64MB数组，远大于CPU缓存，随机读取基本都会缓存未命中
+ */
+const std::vector<quint64>& memoryBuffer()
+{
+    static std::vector<quint64> buffer = []()
+    {
+        std::vector<quint64> data(8 * 1024 * 1024);
+        quint64 x = 88172645463325252ULL;
+        for (quint64& value : data)
+        {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            value = x;
+        }
+        return data;
+    }();
+    return buffer;
+}
+
+void runIndex(quint32 index)
+{
+    g_bench->execute(index);
+}
+
+void mapIndex(quint32& index)
+{
+    runIndex(index);
+}
+
+quint64 mappedIndex(const quint32& index)
+{
+    runIndex(index);
+    return g_bench->result(index);
+}
+
+void reduceChecksum(quint64& sum, const quint64& value)
+{
+    sum += value;   // mappedReduced保证同一时刻只有一个线程调用
+}
+
+// QThread子类：每个线程处理连续的一段任务
+class BenchThread : public QThread
+{
+public:
+    BenchThread(Benchmark* bench, quint32 begin, quint32 end)
+        : m_bench(bench)
+        , m_begin(begin)
+        , m_end(end)
+    {
+    }
+
+protected:
+    void run() override
+    {
+        for (quint32 i = m_begin; i < m_end; ++i)
+        {
+            m_bench->execute(i);
+        }
+    }
+
+private:
+    Benchmark* m_bench;
+    quint32 m_begin;
+    quint32 m_end;
+};
+
+// QThreadPool任务：每个任务一个QRunnable对象
+class IndexTask : public QRunnable
+{
+public:
+    IndexTask(Benchmark* bench, quint32 index)
+        : m_bench(bench)
+        , m_index(index)
+    {
+    }
+
+    void run() override { m_bench->execute(m_index); }
+
+private:
+    Benchmark* m_bench;
+    quint32 m_index;
+};
+
+}   // namespace
+
+QString workloadName(Workload workload)
+{
+    switch (workload)
+    {
+    case Workload::Cpu:
+        return "cpu";
+    case Workload::Memory:
+        return "memory";
+    case Workload::Io:
+        return "io";
+    }
+    return QString();
+}
+
+Benchmark::Benchmark(Workload workload, int grain, int tasks, int threads)
+    : m_workload(workload)
+    , m_grain(grain)
+    , m_tasks(tasks)
+    , m_threads(threads)
+    , m_submit(size_t(tasks))
+    , m_done(size_t(tasks))
+    , m_results(size_t(tasks))
+{
+    if (workload == Workload::Memory)
+    {
+        memoryBuffer();   // 提前初始化，不计入测试时间
+    }
+}
+
+quint64 Benchmark::compute(quint32 index) const
+{
+    quint64 x = quint64(index) * 2654435761ULL + 1;
+    switch (m_workload)
+    {
+    case Workload::Cpu:
+        for (int i = 0; i < m_grain; ++i)
+        {
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            x ^= x >> 29;
+        }
+        return x;
+    case Workload::Memory:
+    {
+        const std::vector<quint64>& buffer = memoryBuffer();
+        const size_t mask = buffer.size() - 1;
+        quint64 sum = 0;
+        for (int i = 0; i < m_grain; ++i)
+        {
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            sum += buffer[size_t(x >> 33) & mask];
+        }
+        return sum;
+    }
+    case Workload::Io:
+        QThread::usleep(ulong(m_grain));
+        return index;
+    }
+    return 0;
+}
+
+void Benchmark::execute(quint32 index)
+{
+    m_results[index] = compute(index);
+    m_done[index] = now();
+}
+
+quint64 Benchmark::checksum() const
+{
+    quint64 sum = 0;
+    for (quint64 value : m_results)
+    {
+        sum += value;
+    }
+    return sum;
+}
+
+void Benchmark::reset()
+{
+    std::fill(m_submit.begin(), m_submit.end(), 0);
+    std::fill(m_done.begin(), m_done.end(), 0);
+    std::fill(m_results.begin(), m_results.end(), 0);
+    m_start = 0;
+    m_start = now();
+}
+
+void Benchmark::submitted(quint32 index)
+{
+    m_submit[index] = now();
+}
+
+qint64 Benchmark::now() const
+{
+    const auto time = std::chrono::steady_clock::now().time_since_epoch();
+    return qint64(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count()) - m_start;
+}
+
+double Benchmark::runSerial()
+{
+    reset();
+    for (int i = 0; i < m_tasks; ++i)
+    {
+        execute(quint32(i));
+    }
+    m_serialMs = double(now()) / 1e6;
+    m_expected = checksum();
+    return m_serialMs;
+}
+
+/**
+ * @brief 计算吞吐量、调度开销和延迟分布
+ */
+BenchResult Benchmark::finish(const QString& mechanism, qint64 wallNs, quint64 checksum)
+{
+    BenchResult result;
+    result.mechanism = mechanism;
+    result.wallMs = double(wallNs) / 1e6;
+    result.throughput = double(m_tasks) / (double(wallNs) / 1e9);
+    result.overheadUs = (result.wallMs * m_threads - m_serialMs) * 1000.0 / m_tasks;
+    result.valid = checksum == m_expected;
+
+    std::vector<qint64> latency(size_t(m_tasks));
+    for (size_t i = 0; i < latency.size(); ++i)
+    {
+        latency[i] = m_done[i] - m_submit[i];
+    }
+    auto percentile = [&latency](double p)
+    {
+        const size_t n = std::min(latency.size() - 1, size_t(p * double(latency.size())));
+        std::nth_element(latency.begin(), latency.begin() + std::ptrdiff_t(n), latency.end());
+        return double(latency[n]) / 1000.0;
+    };
+    result.p50Us = percentile(0.5);
+    result.p99Us = percentile(0.99);
+    result.maxUs = double(*std::max_element(latency.begin(), latency.end())) / 1000.0;
+    return result;
+}
+
+QVector<BenchResult> Benchmark::runAll()
+{
+    g_bench = this;
+    if (m_serialMs == 0)
+    {
+        runSerial();
+    }
+
+    QVector<BenchResult> results;
+    results << runQThread() << runWorkerObject() << runQThreadPool();
+
+    // QtConcurrent使用全局线程池，测试期间修改全局线程池的线程数
+    QThreadPool* global = QThreadPool::globalInstance();
+    const int maxThreadCount = global->maxThreadCount();
+    global->setMaxThreadCount(m_threads);
+    results << runConcurrentRun() << runConcurrentMap() << runConcurrentMappedReduced();
+    global->setMaxThreadCount(maxThreadCount);
+
+    results << runScanFilePool();
+    g_bench = nullptr;
+    return results;
+}
+
+/**
+ * @brief QThread子类，任务按线程数静态分段，没有调度开销但无法负载均衡
+ */
+BenchResult Benchmark::runQThread()
+{
+    QVector<BenchThread*> threads;
+    const quint32 chunk = quint32((m_tasks + m_threads - 1) / m_threads);
+    reset();
+    for (int t = 0; t < m_threads; ++t)
+    {
+        const quint32 begin = std::min(quint32(m_tasks), quint32(t) * chunk);
+        threads.append(new BenchThread(this, begin, std::min(quint32(m_tasks), begin + chunk)));
+        threads.last()->start();
+    }
+    for (BenchThread* thread : threads)
+    {
+        thread->wait();
+    }
+    const qint64 wall = now();
+    qDeleteAll(threads);
+
+    return finish("QThread subclass", wall, checksum());
+}
+
+/**
+ * @brief moveToThread工作对象，每个任务通过QueuedConnection投递到工作线程的事件循环
+ */
+BenchResult Benchmark::runWorkerObject()
+{
+    QVector<QThread*> threads;
+    QVector<QObject*> workers;
+    for (int t = 0; t < m_threads; ++t)
+    {
+        QThread* thread = new QThread;
+        QObject* worker = new QObject;
+        worker->moveToThread(thread);
+        thread->start();
+        threads.append(thread);
+        workers.append(worker);
+    }
+
+    std::atomic<int> remaining(m_tasks);
+    QSemaphore done;
+    reset();
+    for (int i = 0; i < m_tasks; ++i)
+    {
+        const quint32 index = quint32(i);
+        submitted(index);
+        QMetaObject::invokeMethod(
+            workers[i % m_threads],
+            [this, index, &remaining, &done]()
+            {
+                execute(index);
+                if (--remaining == 0)
+                {
+                    done.release();
+                }
+            },
+            Qt::QueuedConnection);
+    }
+    done.acquire();
+    const qint64 wall = now();
+
+    for (int t = 0; t < m_threads; ++t)
+    {
+        threads[t]->quit();
+        threads[t]->wait();
+        delete workers[t];
+        delete threads[t];
+    }
+
+    return finish("moveToThread worker", wall, checksum());
+}
+
+/**
+ * @brief QThreadPool + QRunnable，每个任务new一个对象
+ */
+BenchResult Benchmark::runQThreadPool()
+{
+    QThreadPool pool;
+    pool.setMaxThreadCount(m_threads);
+    pool.setExpiryTimeout(-1);
+    for (int t = 0; t < m_threads; ++t)   // 预先创建线程，不计入测试时间
+    {
+        pool.start(new IndexTask(this, 0));
+    }
+    pool.waitForDone();
+
+    reset();
+    for (int i = 0; i < m_tasks; ++i)
+    {
+        submitted(quint32(i));
+        pool.start(new IndexTask(this, quint32(i)));
+    }
+    pool.waitForDone();
+    const qint64 wall = now();
+
+    return finish("QThreadPool+QRunnable", wall, checksum());
+}
+
+/**
+ * @brief QtConcurrent::run，每个任务一个QFuture
+ */
+BenchResult Benchmark::runConcurrentRun()
+{
+    QVector<QFuture<void>> futures;
+    futures.reserve(m_tasks);
+    reset();
+    for (int i = 0; i < m_tasks; ++i)
+    {
+        submitted(quint32(i));
+        futures.append(QtConcurrent::run(runIndex, quint32(i)));
+    }
+    for (QFuture<void>& future : futures)
+    {
+        future.waitForFinished();
+    }
+    const qint64 wall = now();
+
+    return finish("QtConcurrent::run", wall, checksum());
+}
+
+/**
+ * @brief QtConcurrent::blockingMap，内部自动分批
+ */
+BenchResult Benchmark::runConcurrentMap()
+{
+    QVector<quint32> indices(m_tasks);
+    for (int i = 0; i < m_tasks; ++i)
+    {
+        indices[i] = quint32(i);
+    }
+    reset();
+    QtConcurrent::blockingMap(indices, mapIndex);
+    const qint64 wall = now();
+
+    return finish("QtConcurrent::map", wall, checksum());
+}
+
+/**
+ * @brief QtConcurrent::blockingMappedReduced，归约函数串行执行
+ */
+BenchResult Benchmark::runConcurrentMappedReduced()
+{
+    QVector<quint32> indices(m_tasks);
+    for (int i = 0; i < m_tasks; ++i)
+    {
+        indices[i] = quint32(i);
+    }
+    reset();
+    const quint64 checksum = QtConcurrent::blockingMappedReduced(indices, mappedIndex, reduceChecksum);
+    const qint64 wall = now();
+    return finish("QtConcurrent::mappedReduced", wall, checksum);
+}
+
+/**
+ * @brief ScanFile的工作窃取线程池，post不创建future
+ */
+BenchResult Benchmark::runScanFilePool()
+{
+    std::atomic<int> remaining(m_tasks);   // 在线程池之前构造，保证工作线程退出后才析构
+    QSemaphore done;
+    ThreadPool pool(size_t(m_threads));
+    reset();
+    for (int i = 0; i < m_tasks; ++i)
+    {
+        const quint32 index = quint32(i);
+        submitted(index);
+        pool.post(
+            [this, index, &remaining, &done]()
+            {
+                execute(index);
+                if (--remaining == 0)
+                {
+                    done.release();
+                }
+            });
+    }
+    done.acquire();
+    const qint64 wall = now();
+
+    return finish("ScanFile ThreadPool", wall, checksum());
+}
@@ -0,0 +1,77 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QString>
+#include <QVector>
+#include <vector>
+
+// 任务类型
+enum class Workload
+{
+    Cpu,      // CPU密集：grain次整数运算
+    Memory,   // 内存密集：grain次随机读取64MB数组（超过缓存）
+    Io        // 阻塞IO：阻塞grain微秒（模拟同步读写文件、串口、网络）
+};
+
+QString workloadName(Workload workload);
+
+// 一种并发方式的测试结果
+struct BenchResult
+{
+    QString mechanism;
+    double wallMs = 0;        // 总耗时
+    double throughput = 0;    // 每秒完成的任务数
+    double overheadUs = 0;    // 每个任务的调度开销 = (耗时 * 线程数 - 单线程串行耗时) / 任务数
+    double p50Us = 0;         // 任务从提交到完成的延迟
+    double p99Us = 0;
+    double maxUs = 0;
+    bool valid = true;        // 校验和是否与串行执行一致
+};
+
+/**
+ * @brief 用不同的并发方式执行同一批任务
+ *
+ * 每个任务完成时记录完成时间和计算结果（每个任务写自己的位置，不引入额外的竞争），
+ * 按任务提交时间计算延迟；一次性提交整批任务的方式（QThread子类、map）提交时间都为开始时间。
+ */
+class Benchmark
+{
+public:
+    Benchmark(Workload workload, int grain, int tasks, int threads);
+
+    double runSerial();             // 单线程串行执行，作为计算调度开销的基准，返回耗时（毫秒）
+    QVector<BenchResult> runAll();  // 依次测试所有并发方式
+
+    void execute(quint32 index);    // 执行一个任务并记录完成时间（由各个并发方式调用）
+    quint64 compute(quint32 index) const;   // 任务本身的计算
+    quint64 result(quint32 index) const { return m_results[index]; }
+
+private:
+    BenchResult runQThread();
+    BenchResult runWorkerObject();
+    BenchResult runQThreadPool();
+    BenchResult runConcurrentRun();
+    BenchResult runConcurrentMap();
+    BenchResult runConcurrentMappedReduced();
+    BenchResult runScanFilePool();
+
+    void reset();                        // 清空记录并开始计时
+    void submitted(quint32 index);       // 记录任务提交时间
+    qint64 now() const;                  // 从开始计时到现在的纳秒数
+    quint64 checksum() const;            // 所有任务计算结果之和
+    BenchResult finish(const QString& mechanism, qint64 wallNs, quint64 checksum);
+
+private:
+    Workload m_workload;
+    int m_grain;
+    int m_tasks;
+    int m_threads;
+    double m_serialMs = 0;
+    quint64 m_expected = 0;               // 串行执行的校验和
+    qint64 m_start = 0;
+    std::vector<qint64> m_submit;         // 每个任务的提交时间
+    std::vector<qint64> m_done;           // 每个任务的完成时间
+    std::vector<quint64> m_results;       // 每个任务的计算结果
+};
+
+#endif   // BENCHMARK_H
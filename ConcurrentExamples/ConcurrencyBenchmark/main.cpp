@@ -0,0 +1,161 @@
+/**
+ * 并发方式性能对比：同一批任务分别用QThread子类、moveToThread工作对象、QThreadPool、QtConcurrent::run/map/mappedReduced
+ * 以及ScanFile的工作窃取线程池执行，对比耗时、吞吐量、每个任务的调度开销和任务延迟。
+ *
+ * 用法：ConcurrencyBenchmark [-w cpu,memory,io] [-t 1,2,4,8] [-g 100,1000] [-n 任务数] [-o result.csv]
+ * 需要Release编译，Debug下任务本身的耗时被放大，调度开销的占比不准确。
+ */
+#include "benchmark.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+#include <cstdio>
+
+namespace {
+
+QList<int> parseList(const QString& text)
+{
+    QList<int> values;
+    const QStringList items = text.split(',');
+    for (const QString& item : items)
+    {
+        bool ok = false;
+        const int value = item.trimmed().toInt(&ok);
+        if (ok && value > 0)
+        {
+            values.append(value);
+        }
+    }
+    return values;
+}
+
+// 默认线程数：1、2、4...直到CPU核心数，再加上CPU核心数本身
+QList<int> defaultThreads()
+{
+    const int ideal = qMax(1, QThread::idealThreadCount());
+    QList<int> threads;
+    for (int count = 1; count < ideal; count *= 2)
+    {
+        threads.append(count);
+    }
+    threads.append(ideal);
+    return threads;
+}
+
+// 默认粒度：cpu为运算次数，memory为随机读取次数，io为阻塞的微秒数
+QList<int> defaultGrains(Workload workload)
+{
+    switch (workload)
+    {
+    case Workload::Cpu:
+        return {100, 1000, 10000, 100000};
+    case Workload::Memory:
+        return {16, 256, 4096};
+    case Workload::Io:
+        return {100, 1000};
+    }
+    return {};
+}
+
+/**
+ * @brief 自动确定任务数：使串行执行总耗时约200ms，任务太小时调度开销才能显现，任务太多时测试时间太长
+ */
+int autoTasks(Workload workload, int grain)
+{
+    if (workload == Workload::Io)
+    {
+        return 400;
+    }
+    const int probe = 200;
+    Benchmark bench(workload, grain, probe, 1);
+    const double ms = qMax(bench.runSerial(), 0.001);
+    return qBound(200, int(200.0 / ms * probe), 200000);
+}
+
+}   // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("ConcurrencyBenchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compare Qt threading mechanisms and the ScanFile work-stealing ThreadPool");
+    parser.addHelpOption();
+    QCommandLineOption workloadOption({"w", "workload"}, "Workloads: cpu,memory,io", "list", "cpu,memory,io");
+    QCommandLineOption threadsOption({"t", "threads"}, "Thread counts, e.g. 1,2,4,8", "list");
+    QCommandLineOption grainOption({"g", "grain"}, "Task grain (cpu: iterations, memory: random reads, io: microseconds)", "list");
+    QCommandLineOption tasksOption({"n", "tasks"}, "Tasks per run (default: serial run takes about 200ms)", "count");
+    QCommandLineOption csvOption({"o", "csv"}, "Write results to a csv file", "file");
+    parser.addOptions({workloadOption, threadsOption, grainOption, tasksOption, csvOption});
+    parser.process(a);
+
+    QList<Workload> workloads;
+    const QStringList names = parser.value(workloadOption).split(',');
+    for (const QString& name : names)
+    {
+        for (Workload workload : {Workload::Cpu, Workload::Memory, Workload::Io})
+        {
+            if (name.trimmed() == workloadName(workload))
+            {
+                workloads.append(workload);
+            }
+        }
+    }
+    const QList<int> threadList = parser.isSet(threadsOption) ? parseList(parser.value(threadsOption)) : defaultThreads();
+    const int fixedTasks = parser.value(tasksOption).toInt();
+
+    QFile csvFile(parser.value(csvOption));
+    QTextStream csv(&csvFile);
+    if (parser.isSet(csvOption))
+    {
+        if (!csvFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        {
+            fprintf(stderr, "cannot open %s\n", qPrintable(csvFile.fileName()));
+            return 1;
+        }
+        csv << "workload,grain,threads,mechanism,tasks,wall_ms,tasks_per_s,overhead_us,p50_us,p99_us,max_us,valid\n";
+    }
+
+    printf("cpus=%d\n", QThread::idealThreadCount());
+    printf("%-8s %7s %4s %-28s %7s %10s %12s %12s %10s %10s %10s  %s\n", "workload", "grain", "thr", "mechanism", "tasks", "wall ms", "tasks/s",
+           "overhead us", "p50 us", "p99 us", "max us", "check");
+
+    QElapsedTimer total;
+    total.start();
+    for (Workload workload : workloads)
+    {
+        const QList<int> grains = parser.isSet(grainOption) ? parseList(parser.value(grainOption)) : defaultGrains(workload);
+        for (int grain : grains)
+        {
+            const int tasks = fixedTasks > 0 ? fixedTasks : autoTasks(workload, grain);
+            for (int threads : threadList)
+            {
+                Benchmark bench(workload, grain, tasks, threads);
+                const double serialMs = bench.runSerial();
+                printf("%-8s %7d %4d %-28s %7d %10.2f\n", qPrintable(workloadName(workload)), grain, threads, "serial", tasks, serialMs);
+
+                const QVector<BenchResult> results = bench.runAll();
+                for (const BenchResult& result : results)
+                {
+                    printf("%-8s %7d %4d %-28s %7d %10.2f %12.0f %12.3f %10.1f %10.1f %10.1f  %s\n", qPrintable(workloadName(workload)), grain,
+                           threads, qPrintable(result.mechanism), tasks, result.wallMs, result.throughput, result.overheadUs, result.p50Us,
+                           result.p99Us, result.maxUs, result.valid ? "ok" : "MISMATCH");
+                    if (csvFile.isOpen())
+                    {
+                        csv << workloadName(workload) << ',' << grain << ',' << threads << ',' << result.mechanism << ',' << tasks << ','
+                            << result.wallMs << ',' << result.throughput << ',' << result.overheadUs << ',' << result.p50Us << ','
+                            << result.p99Us << ',' << result.maxUs << ',' << (result.valid ? "ok" : "mismatch") << '\n';
+                    }
+                }
+                fflush(stdout);
+            }
+        }
+    }
+    printf("total %.1f s\n", double(total.elapsed()) / 1000.0);
+    return 0;
+}
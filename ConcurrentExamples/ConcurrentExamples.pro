@@ -15,3 +15,5 @@ SUBDIRS += UseQThread2        # Qt通过子类化，继承QThread，重写run实
 SUBDIRS += UseQThreadPool     # Qt使用线程池QThreadPool示例
 SUBDIRS += UseConcurrent      # Qt Concurent API使用示例
 SUBDIRS += IOThread           # 在QT子线程中操作IO对象，包括QAbstractSocket、QFile、QSerialPort等
+SUBDIRS += CoroutineIO        # 使用C++20协程进行异步IO，大量TCP连接共享少量事件循环线程（需要C++20编译器）
+SUBDIRS += ConcurrencyBenchmark  # 各种并发方式（QThread、线程池、QtConcurrent、工作窃取线程池）性能对比测试
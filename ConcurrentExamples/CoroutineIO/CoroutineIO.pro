@@ -0,0 +1,50 @@
+#---------------------------------------------------------------------------------------
+# @功能：       使用C++20协程进行异步IO，大量TCP连接共享少量事件循环线程
+# @编译器：     Desktop Qt 5.15.2 MSVC2019 64bit（需要支持C++20协程的编译器：MSVC2019 16.8+、GCC10+、Clang14+）
+# @Qt IDE：    D:/Qt/Qt5.15.2/Tools/QtCreator/share/qtcreator
+#
+# @开发者     mhf
+# @邮箱       1603291350@qq.com
+# @时间       2025-03-29 16:08:45
+# @备注       1、IOThread中每个socket一个线程，每个操作都通过信号转发，每条消息一次事件和一次数据复制；
+#            2、这里封装了可co_await的connect/read/write/sleepFor，协程在socket信号中直接恢复，不需要切换线程；
+#            3、EventLoopGroup提供少量事件循环线程，上千个设备连接共享这些线程，协议代码按顺序书写。
+#---------------------------------------------------------------------------------------
+QT -= gui
+QT += network
+
+CONFIG += c++2a console
+CONFIG -= app_bundle
+DEFINES += QT_DEPRECATED_WARNINGS
+
+*-g++*: QMAKE_CXXFLAGS += -fcoroutines     # GCC10需要显式开启协程
+
+SOURCES += \
+    asynctcpsocket.cpp \
+    eventloopgroup.cpp \
+    main.cpp
+
+HEADERS += \
+    asynctcpsocket.h \
+    eventloopgroup.h \
+    task.h
+
+#  定义程序版本号
+VERSION = 1.0.0
+DEFINES += APP_VERSION=\\\"$$VERSION\\\"
+
+contains(QT_ARCH, i386){        # 使用32位编译器
+DESTDIR = $$PWD/../bin          # 程序输出路径
+}else{
+DESTDIR = $$PWD/../bin64        # 使用64位编译器
+}
+
+# msvc >= 2017  编译器使用utf-8编码
+msvc {
+    greaterThan(QMAKE_MSC_VER, 1900){       # msvc编译器版本大于2015
+        QMAKE_CFLAGS += /utf-8
+        QMAKE_CXXFLAGS += /utf-8
+    }else{
+        # msvc2015及以下版本在代码中使用【pragma execution_character_set("utf-8")】指定编码
+    }
+}
@@ -0,0 +1,244 @@
+#include "asynctcpsocket.h"
+
+#include <QTcpServer>
+#include <QTimer>
+#include <functional>
+#include <utility>
+
+/**
+ * @brief 只取出新连接的描述符，由其它线程创建QTcpSocket（QTcpSocket不能跨线程使用）
+ */
+class DescriptorServer : public QTcpServer
+{
+public:
+    std::function<void(qintptr)> onIncoming;
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override { onIncoming(socketDescriptor); }
+};
+
+AsyncTcpSocket::AsyncTcpSocket()
+{
+    init();
+}
+
+AsyncTcpSocket::AsyncTcpSocket(qintptr socketDescriptor)
+{
+    init();
+    m_socket->setSocketDescriptor(socketDescriptor);
+}
+
+AsyncTcpSocket::~AsyncTcpSocket()
+{
+    m_socket->disconnect();   // 不再调用到已经释放的this
+    m_reader.timer->disconnect();
+    m_writer.timer->disconnect();
+    m_socket->abort();
+    m_socket->deleteLater();   // 可能正处于socket的信号中（协程在信号中恢复后结束），不能直接delete，定时器是socket的子对象
+}
+
+void AsyncTcpSocket::init()
+{
+    m_socket = new QTcpSocket();
+    m_reader.timer = new QTimer(m_socket);
+    m_writer.timer = new QTimer(m_socket);
+    m_reader.timer->setSingleShot(true);
+    m_writer.timer->setSingleShot(true);
+
+    QObject::connect(m_socket, &QTcpSocket::readyRead, m_socket, [this]() { onReadyRead(); });
+    QObject::connect(m_socket, &QTcpSocket::bytesWritten, m_socket, [this]() { onBytesWritten(); });
+    QObject::connect(m_socket, &QTcpSocket::connected, m_socket, [this]() { onConnected(); });
+    QObject::connect(m_socket, &QTcpSocket::disconnected, m_socket, [this]() { onClosed(); });
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    QObject::connect(m_socket, &QTcpSocket::errorOccurred, m_socket, [this]() { onClosed(); });
+#else
+    QObject::connect(m_socket, QOverload<QAbstractSocket::SocketError>::of(&QTcpSocket::error), m_socket, [this]() { onClosed(); });
+#endif
+    QObject::connect(m_reader.timer, &QTimer::timeout, m_socket, [this]() { onTimeout(m_reader); });
+    QObject::connect(m_writer.timer, &QTimer::timeout, m_socket, [this]() { onTimeout(m_writer); });
+}
+
+AsyncTcpSocket::ConnectAwaiter AsyncTcpSocket::connect(const QString& host, quint16 port, int timeoutMs)
+{
+    return ConnectAwaiter(this, host, port, timeoutMs);
+}
+
+AsyncTcpSocket::ReadAwaiter AsyncTcpSocket::read(qint64 size, int timeoutMs)
+{
+    return ReadAwaiter(this, qMax<qint64>(size, 0), timeoutMs);
+}
+
+AsyncTcpSocket::ReadAwaiter AsyncTcpSocket::readSome(int timeoutMs)
+{
+    return ReadAwaiter(this, 0, timeoutMs);
+}
+
+AsyncTcpSocket::WriteAwaiter AsyncTcpSocket::write(const QByteArray& data, int timeoutMs)
+{
+    const bool ok = isConnected() && m_socket->write(data) == data.size();
+    return WriteAwaiter(this, ok, timeoutMs);
+}
+
+void AsyncTcpSocket::close()
+{
+    m_socket->close();
+}
+
+/**
+ * @brief 记录挂起的协程，并启动超时定时器
+ */
+void AsyncTcpSocket::suspend(Waiter& waiter, std::coroutine_handle<> handle, int timeoutMs)
+{
+    waiter.handle = handle;
+    waiter.timedOut = false;
+    if (timeoutMs >= 0)
+    {
+        waiter.timer->start(timeoutMs);
+    }
+}
+
+/**
+ * @brief 恢复挂起的协程；协程可能在恢复后释放AsyncTcpSocket，调用之后不能再访问this
+ */
+void AsyncTcpSocket::resume(Waiter& waiter)
+{
+    std::coroutine_handle<> handle = std::exchange(waiter.handle, nullptr);
+    waiter.timer->stop();
+    handle.resume();
+}
+
+bool AsyncTcpSocket::readReady() const
+{
+    const qint64 available = m_socket->bytesAvailable();
+    return m_readWant == 0 ? available > 0 : available >= m_readWant;
+}
+
+bool AsyncTcpSocket::writeReady() const
+{
+    return m_socket->bytesToWrite() <= m_writeBufferLimit;
+}
+
+void AsyncTcpSocket::onReadyRead()
+{
+    if (m_reader.handle && m_socket->state() == QAbstractSocket::ConnectedState && readReady())
+    {
+        resume(m_reader);
+    }
+}
+
+void AsyncTcpSocket::onBytesWritten()
+{
+    if (m_writer.handle && writeReady())
+    {
+        resume(m_writer);
+    }
+}
+
+void AsyncTcpSocket::onConnected()
+{
+    if (m_reader.handle)
+    {
+        resume(m_reader);
+    }
+}
+
+/**
+ * @brief 连接断开或出错，恢复所有等待的协程，由它们检查结果
+ */
+void AsyncTcpSocket::onClosed()
+{
+    const bool hasReader = bool(m_reader.handle);
+    std::coroutine_handle<> writer = std::exchange(m_writer.handle, nullptr);
+    m_writer.timer->stop();
+    if (hasReader)
+    {
+        resume(m_reader);
+    }
+    if (writer)
+    {
+        writer.resume();   // 读写是两个不同的协程，读协程不应在写协程等待时释放socket
+    }
+}
+
+void AsyncTcpSocket::onTimeout(Waiter& waiter)
+{
+    if (waiter.handle)
+    {
+        waiter.timedOut = true;
+        resume(waiter);
+    }
+}
+
+void AsyncTcpSocket::ConnectAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    m_socket->suspend(m_socket->m_reader, handle, m_timeoutMs);
+    m_socket->m_socket->connectToHost(m_host, m_port);
+}
+
+bool AsyncTcpSocket::ConnectAwaiter::await_resume() const
+{
+    if (m_socket->m_reader.timedOut)
+    {
+        m_socket->m_socket->abort();
+    }
+    return m_socket->isConnected();
+}
+
+bool AsyncTcpSocket::ReadAwaiter::await_ready() const
+{
+    m_socket->m_readWant = m_size;
+    return m_socket->readReady() || !m_socket->isConnected();   // 数据已经足够时不挂起
+}
+
+void AsyncTcpSocket::ReadAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    m_socket->suspend(m_socket->m_reader, handle, m_timeoutMs);
+}
+
+QByteArray AsyncTcpSocket::ReadAwaiter::await_resume() const
+{
+    return m_size == 0 ? m_socket->m_socket->readAll() : m_socket->m_socket->read(m_size);
+}
+
+AsyncTcpServer::AsyncTcpServer()
+    : m_server(new DescriptorServer())
+{
+    m_server->onIncoming = [this](qintptr socketDescriptor) { onIncoming(socketDescriptor); };
+}
+
+AsyncTcpServer::~AsyncTcpServer()
+{
+    m_server->close();
+    delete m_server;
+}
+
+bool AsyncTcpServer::listen(const QHostAddress& address, quint16 port)
+{
+    return m_server->listen(address, port);
+}
+
+quint16 AsyncTcpServer::serverPort() const
+{
+    return m_server->serverPort();
+}
+
+/**
+ * @brief 停止监听，等待accept的协程得到-1
+ */
+void AsyncTcpServer::close()
+{
+    m_server->close();
+    if (m_waiting)
+    {
+        std::exchange(m_waiting, nullptr).resume();
+    }
+}
+
+void AsyncTcpServer::onIncoming(qintptr socketDescriptor)
+{
+    m_pending.enqueue(socketDescriptor);
+    if (m_waiting)
+    {
+        std::exchange(m_waiting, nullptr).resume();
+    }
+}
@@ -0,0 +1,176 @@
+#ifndef ASYNCTCPSOCKET_H
+#define ASYNCTCPSOCKET_H
+
+#include <QByteArray>
+#include <QHostAddress>
+#include <QQueue>
+#include <QTcpSocket>
+#include <coroutine>
+
+class QTimer;
+class DescriptorServer;
+
+/**
+ * @brief 可co_await的QTcpSocket封装
+ *
+ * 协程挂起时记录句柄，socket的信号到达时在同一个线程中直接恢复协程，不需要为每条消息发信号、切换线程和复制数据；
+ * 数据已经足够（read）或发送缓冲区没有超过上限（write）时不挂起。
+ * 必须在协程所在线程中创建和使用；同一时刻最多一个读操作（含connect）和一个写操作在等待。
+ * 析构时socket使用deleteLater释放，因此可以在恢复的协程中直接结束socket的生命周期。
+ */
+class AsyncTcpSocket
+{
+public:
+    AsyncTcpSocket();
+    explicit AsyncTcpSocket(qintptr socketDescriptor);   // 使用AsyncTcpServer::accept()返回的描述符
+    ~AsyncTcpSocket();
+
+    AsyncTcpSocket(const AsyncTcpSocket&) = delete;
+    AsyncTcpSocket& operator=(const AsyncTcpSocket&) = delete;
+
+    class ConnectAwaiter;
+    class ReadAwaiter;
+    class WriteAwaiter;
+
+    ConnectAwaiter connect(const QString& host, quint16 port, int timeoutMs = 30000);   // 返回是否连接成功
+    ReadAwaiter read(qint64 size, int timeoutMs = -1);   // 读取size个字节，超时或断开时返回的数据不足size
+    ReadAwaiter readSome(int timeoutMs = -1);            // 读取当前所有数据（至少1个字节）
+    WriteAwaiter write(const QByteArray& data, int timeoutMs = -1);   // 写入发送缓冲区，缓冲区超过上限时等待发送，返回是否成功
+    void close();
+
+    bool isConnected() const { return m_socket->state() == QAbstractSocket::ConnectedState; }
+    QString errorString() const { return m_socket->errorString(); }
+    QTcpSocket* socket() const { return m_socket; }
+    void setWriteBufferLimit(qint64 bytes) { m_writeBufferLimit = bytes; }
+
+private:
+    // 一个挂起的操作
+    struct Waiter
+    {
+        std::coroutine_handle<> handle;
+        QTimer* timer = nullptr;
+        bool timedOut = false;
+    };
+
+    void init();
+    void suspend(Waiter& waiter, std::coroutine_handle<> handle, int timeoutMs);
+    static void resume(Waiter& waiter);
+    bool readReady() const;
+    bool writeReady() const;
+    void onReadyRead();
+    void onBytesWritten();
+    void onConnected();
+    void onClosed();
+    void onTimeout(Waiter& waiter);
+
+private:
+    QTcpSocket* m_socket = nullptr;
+    Waiter m_reader;                       // 等待connect或read
+    Waiter m_writer;                       // 等待write
+    qint64 m_readWant = 0;                 // 等待的字节数，0为任意数据
+    qint64 m_writeBufferLimit = 64 * 1024;   // 发送缓冲区上限，超过时write挂起直到数据发出
+};
+
+class AsyncTcpSocket::ConnectAwaiter
+{
+public:
+    ConnectAwaiter(AsyncTcpSocket* socket, const QString& host, quint16 port, int timeoutMs)
+        : m_socket(socket)
+        , m_host(host)
+        , m_port(port)
+        , m_timeoutMs(timeoutMs)
+    {
+    }
+
+    bool await_ready() const { return m_socket->isConnected(); }
+    void await_suspend(std::coroutine_handle<> handle);
+    bool await_resume() const;
+
+private:
+    AsyncTcpSocket* m_socket;
+    QString m_host;
+    quint16 m_port;
+    int m_timeoutMs;
+};
+
+class AsyncTcpSocket::ReadAwaiter
+{
+public:
+    ReadAwaiter(AsyncTcpSocket* socket, qint64 size, int timeoutMs)
+        : m_socket(socket)
+        , m_size(size)
+        , m_timeoutMs(timeoutMs)
+    {
+    }
+
+    bool await_ready() const;
+    void await_suspend(std::coroutine_handle<> handle);
+    QByteArray await_resume() const;
+
+private:
+    AsyncTcpSocket* m_socket;
+    qint64 m_size;   // 0为readSome
+    int m_timeoutMs;
+};
+
+class AsyncTcpSocket::WriteAwaiter
+{
+public:
+    WriteAwaiter(AsyncTcpSocket* socket, bool ok, int timeoutMs)
+        : m_socket(socket)
+        , m_ok(ok)
+        , m_timeoutMs(timeoutMs)
+    {
+    }
+
+    bool await_ready() const { return !m_ok || m_socket->writeReady(); }
+    void await_suspend(std::coroutine_handle<> handle) { m_socket->suspend(m_socket->m_writer, handle, m_timeoutMs); }
+    bool await_resume() const { return m_ok && !m_socket->m_writer.timedOut && m_socket->isConnected(); }
+
+private:
+    AsyncTcpSocket* m_socket;
+    bool m_ok;   // 数据是否成功写入发送缓冲区
+    int m_timeoutMs;
+};
+
+/**
+ * @brief 可co_await的TCP服务端，accept()返回新连接的描述符，在其它线程中用它构造AsyncTcpSocket
+ */
+class AsyncTcpServer
+{
+public:
+    AsyncTcpServer();
+    ~AsyncTcpServer();
+
+    bool listen(const QHostAddress& address = QHostAddress::Any, quint16 port = 0);
+    quint16 serverPort() const;
+    void close();
+
+    class AcceptAwaiter
+    {
+    public:
+        explicit AcceptAwaiter(AsyncTcpServer* server)
+            : m_server(server)
+        {
+        }
+
+        bool await_ready() const { return !m_server->m_pending.isEmpty(); }
+        void await_suspend(std::coroutine_handle<> handle) { m_server->m_waiting = handle; }
+        qintptr await_resume() const { return m_server->m_pending.isEmpty() ? -1 : m_server->m_pending.dequeue(); }   // 服务端关闭时返回-1
+
+    private:
+        AsyncTcpServer* m_server;
+    };
+
+    AcceptAwaiter accept() { return AcceptAwaiter(this); }
+
+private:
+    void onIncoming(qintptr socketDescriptor);
+
+private:
+    DescriptorServer* m_server = nullptr;
+    QQueue<qintptr> m_pending;
+    std::coroutine_handle<> m_waiting;
+};
+
+#endif   // ASYNCTCPSOCKET_H
@@ -0,0 +1,68 @@
+#include "eventloopgroup.h"
+
+#include <QTimer>
+
+EventLoopGroup::EventLoopGroup(int threads)
+{
+    threads = qMax(1, threads);
+    for (int i = 0; i < threads; ++i)
+    {
+        QThread* thread = new QThread();
+        thread->setObjectName(QString("EventLoop%1").arg(i));
+        QObject* context = new QObject();
+        context->moveToThread(thread);
+        thread->start();
+        m_threads.append(thread);
+        m_contexts.append(context);
+    }
+}
+
+EventLoopGroup::~EventLoopGroup()
+{
+    for (QThread* thread : m_threads)
+    {
+        thread->quit();
+    }
+    for (int i = 0; i < m_threads.size(); ++i)
+    {
+        m_threads[i]->wait();
+        delete m_contexts[i];   // 线程已退出，可以在当前线程中释放
+        delete m_threads[i];
+    }
+}
+
+QObject* EventLoopGroup::next()
+{
+    return m_contexts.at(int(m_next.fetch_add(1, std::memory_order_relaxed) % unsigned(m_contexts.size())));
+}
+
+void EventLoopGroup::spawn(Task<void> task)
+{
+    spawn(next(), std::move(task));
+}
+
+namespace {
+
+Task<void> runOn(QObject* context, Task<void> task)
+{
+    co_await resumeOn(context);
+    co_await std::move(task);
+}
+
+}   // namespace
+
+void EventLoopGroup::spawn(QObject* context, Task<void> task)
+{
+    ::spawn(runOn(context, std::move(task)));
+}
+
+void ResumeOn::await_suspend(std::coroutine_handle<> handle) const
+{
+    QMetaObject::invokeMethod(
+        m_context, [handle]() { handle.resume(); }, Qt::QueuedConnection);
+}
+
+void SleepFor::await_suspend(std::coroutine_handle<> handle) const
+{
+    QTimer::singleShot(m_msec, [handle]() { handle.resume(); });   // 在调用线程的事件循环中触发
+}
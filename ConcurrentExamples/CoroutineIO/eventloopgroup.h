@@ -0,0 +1,83 @@
+#ifndef EVENTLOOPGROUP_H
+#define EVENTLOOPGROUP_H
+
+#include "task.h"
+#include <QObject>
+#include <QThread>
+#include <QVector>
+#include <atomic>
+
+/**
+ * @brief 一组运行事件循环的线程，协程在这些线程中执行，大量连接共享少量线程
+ *
+ * 每个线程有一个上下文对象，向它投递调用即可在该线程中执行；协程通过co_await resumeOn(context)切换线程。
+ * 析构时退出所有线程，此时仍挂起的协程不会再被恢复。
+ */
+class EventLoopGroup
+{
+public:
+    explicit EventLoopGroup(int threads = QThread::idealThreadCount());
+    ~EventLoopGroup();
+
+    int size() const { return m_contexts.size(); }
+    QObject* context(int index) const { return m_contexts.at(index); }
+    QObject* next();   // 轮流选择一个线程
+
+    void spawn(Task<void> task);                      // 在下一个线程中启动协程
+    static void spawn(QObject* context, Task<void> task);   // 在context所在线程中启动协程
+
+private:
+    QVector<QThread*> m_threads;
+    QVector<QObject*> m_contexts;
+    std::atomic<unsigned> m_next{0};
+};
+
+/**
+ * @brief co_await resumeOn(context)：切换到context所在的线程继续执行，已经在该线程时不切换
+ */
+class ResumeOn
+{
+public:
+    explicit ResumeOn(QObject* context)
+        : m_context(context)
+    {
+    }
+
+    bool await_ready() const noexcept { return m_context->thread() == QThread::currentThread(); }
+    void await_suspend(std::coroutine_handle<> handle) const;
+    void await_resume() const noexcept {}
+
+private:
+    QObject* m_context;
+};
+
+inline ResumeOn resumeOn(QObject* context)
+{
+    return ResumeOn(context);
+}
+
+/**
+ * @brief co_await sleepFor(ms)：在当前线程的事件循环中等待一段时间，不阻塞线程
+ */
+class SleepFor
+{
+public:
+    explicit SleepFor(int msec)
+        : m_msec(msec)
+    {
+    }
+
+    bool await_ready() const noexcept { return m_msec <= 0; }
+    void await_suspend(std::coroutine_handle<> handle) const;
+    void await_resume() const noexcept {}
+
+private:
+    int m_msec;
+};
+
+inline SleepFor sleepFor(int msec)
+{
+    return SleepFor(msec);
+}
+
+#endif   // EVENTLOOPGROUP_H
@@ -0,0 +1,167 @@
+/**
+ * 使用C++20协程进行异步IO：大量设备连接共享少量事件循环线程，协议代码按顺序书写，不需要为每条消息发信号。
+ *
+ * 程序在本机启动一个回显服务端，再模拟多个设备连接，每个设备按【4字节长度 + 数据】的帧格式发送消息并校验回显。
+ * 用法：CoroutineIO [设备数，默认500] [每个设备的消息数，默认100] [事件循环线程数，默认CPU核心数] [消息间隔ms，默认10]
+ * Linux下设备数较多时需要先调大文件描述符上限（ulimit -n），每个设备占用客户端、服务端两个描述符。
+ */
+#include "asynctcpsocket.h"
+#include "eventloopgroup.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QtEndian>
+#include <atomic>
+
+namespace {
+
+// 所有设备共享的统计
+struct Report
+{
+    std::atomic<int> remaining{0};
+    std::atomic<int> succeeded{0};
+    std::atomic<int> failed{0};
+    std::atomic<qint64> messages{0};
+};
+
+QByteArray frame(const QByteArray& payload)
+{
+    const quint32 length = qToBigEndian(quint32(payload.size()));
+    return QByteArray(reinterpret_cast<const char*>(&length), 4) + payload;
+}
+
+/**
+ * @brief 读取一帧，连接断开或超时时返回false
+ */
+Task<bool> readFrame(AsyncTcpSocket& socket, QByteArray& payload, int timeoutMs)
+{
+    const QByteArray header = co_await socket.read(4, timeoutMs);
+    if (header.size() != 4)
+    {
+        co_return false;
+    }
+    const quint32 length = qFromBigEndian<quint32>(header.constData());
+    payload = co_await socket.read(length, timeoutMs);
+    co_return payload.size() == int(length);
+}
+
+/**
+ * @brief 服务端的一个会话：在分配到的事件循环线程中创建socket，回显收到的每一帧直到连接断开
+ */
+Task<void> session(qintptr socketDescriptor)
+{
+    AsyncTcpSocket socket(socketDescriptor);
+    QByteArray payload;
+    while (co_await readFrame(socket, payload, -1))
+    {
+        if (!co_await socket.write(frame(payload)))
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 接受新连接，轮流分配给各个事件循环线程
+ */
+Task<void> acceptLoop(AsyncTcpServer& server, EventLoopGroup& group)
+{
+    while (true)
+    {
+        const qintptr socketDescriptor = co_await server.accept();
+        if (socketDescriptor < 0)
+        {
+            break;
+        }
+        group.spawn(session(socketDescriptor));
+    }
+}
+
+void finish(Report& report, bool ok)
+{
+    (ok ? report.succeeded : report.failed)++;
+    if (--report.remaining == 0)
+    {
+        QMetaObject::invokeMethod(
+            qApp, []() { QCoreApplication::quit(); }, Qt::QueuedConnection);
+    }
+}
+
+/**
+ * @brief 模拟一个设备：连接、收发若干条消息、断开，整个协议流程是顺序的代码
+ */
+Task<void> device(int id, quint16 port, int messages, int intervalMs, Report& report)
+{
+    AsyncTcpSocket socket;
+    if (!co_await socket.connect("127.0.0.1", port, 5000))
+    {
+        qWarning() << "设备" << id << "连接失败：" << socket.errorString();
+        finish(report, false);
+        co_return;
+    }
+
+    for (int i = 0; i < messages; ++i)
+    {
+        const QByteArray payload = QString("device %1 message %2").arg(id).arg(i).toUtf8();
+        co_await socket.write(frame(payload));
+
+        QByteArray echo;
+        if (!co_await readFrame(socket, echo, 5000) || echo != payload)
+        {
+            qWarning() << "设备" << id << "第" << i << "条消息回显错误：" << socket.errorString();
+            finish(report, false);
+            co_return;
+        }
+        report.messages++;
+        co_await sleepFor(intervalMs);   // 定时上报，等待期间线程去处理其它设备
+    }
+    finish(report, true);
+}
+
+}   // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication a(argc, argv);
+    const QStringList args = a.arguments();
+    const int devices = args.size() > 1 ? args[1].toInt() : 500;
+    const int messages = args.size() > 2 ? args[2].toInt() : 100;
+    const int threads = args.size() > 3 ? args[3].toInt() : QThread::idealThreadCount();
+    const int intervalMs = args.size() > 4 ? args[4].toInt() : 10;
+
+    EventLoopGroup group(threads);
+    AsyncTcpServer server;   // 在主线程中接受连接
+    if (!server.listen(QHostAddress::LocalHost, 0))
+    {
+        qWarning() << "监听失败";
+        return 1;
+    }
+    spawn(acceptLoop(server, group));
+
+    Report report;
+    report.remaining = devices;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < devices; ++i)
+    {
+        group.spawn(device(i, server.serverPort(), messages, intervalMs, report));
+    }
+    if (devices > 0)
+    {
+        a.exec();
+    }
+
+    const double seconds = double(timer.elapsed()) / 1000.0;
+    qDebug() << QString("设备：%1（成功%2，失败%3） 事件循环线程：%4 消息：%5 耗时：%6s 吞吐量：%7条/s")
+                    .arg(devices)
+                    .arg(report.succeeded.load())
+                    .arg(report.failed.load())
+                    .arg(group.size())
+                    .arg(report.messages.load())
+                    .arg(seconds, 0, 'f', 2)
+                    .arg(double(report.messages.load()) / seconds, 0, 'f', 0);
+
+    server.close();
+    return report.failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,187 @@
+#ifndef TASK_H
+#define TASK_H
+
+/**
+ * C++20协程的最小实现：
+ *   Task<T>   惰性启动的协程，co_await时才开始执行，执行完成后直接恢复等待它的协程（不经过事件循环）
+ *   spawn()   启动一个Task并且不等待它完成（协程帧在结束时自动释放）
+ */
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+template<typename T = void>
+class Task;
+
+namespace TaskPrivate {
+
+/**
+ * 协程结束时，如果等待者已经挂起则恢复它；如果子协程是同步完成的（等待者还在await_suspend中），
+ * 由等待者直接继续执行。不依赖对称转移，Debug编译（没有尾调用优化）时循环中co_await同步完成的Task也不会栈溢出。
+ */
+struct FinalAwaiter
+{
+    bool await_ready() const noexcept { return false; }
+
+    template<typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> handle) noexcept
+    {
+        Promise& promise = handle.promise();
+        if (promise.ready.exchange(true, std::memory_order_acq_rel))
+        {
+            promise.continuation.resume();
+        }
+    }
+
+    void await_resume() const noexcept {}
+};
+
+struct PromiseBase
+{
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+    std::atomic<bool> ready{false};   // 等待者挂起和协程结束，后发生的一方负责恢复等待者
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() { error = std::current_exception(); }
+
+    void rethrow() const
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+template<typename T>
+struct Promise : PromiseBase
+{
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+    void return_value(T result) { value.emplace(std::move(result)); }
+
+    T take()
+    {
+        rethrow();
+        return std::move(*value);
+    }
+};
+
+template<>
+struct Promise<void> : PromiseBase
+{
+    Task<void> get_return_object();
+    void return_void() {}
+    void take() const { rethrow(); }
+};
+
+}   // namespace TaskPrivate
+
+template<typename T>
+class Task
+{
+public:
+    using promise_type = TaskPrivate::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    explicit Task(Handle handle)
+        : m_handle(handle)
+    {
+    }
+
+    Task(Task&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr))
+    {
+    }
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (m_handle)
+            {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~Task()
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    // co_await task：记录等待者后切换到task执行
+    auto operator co_await() && noexcept { return Awaiter{m_handle}; }
+    auto operator co_await() & noexcept { return Awaiter{m_handle}; }
+
+private:
+    struct Awaiter
+    {
+        Handle handle;
+
+        bool await_ready() const noexcept { return !handle || handle.done(); }
+
+        bool await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            handle.promise().continuation = awaiting;
+            handle.resume();
+            return !handle.promise().ready.exchange(true, std::memory_order_acq_rel);   // 返回false时已同步完成，不挂起
+        }
+
+        T await_resume() { return handle.promise().take(); }
+    };
+
+private:
+    Handle m_handle;
+};
+
+namespace TaskPrivate {
+
+template<typename T>
+Task<T> Promise<T>::get_return_object()
+{
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object()
+{
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+// spawn()返回的协程：立即开始执行，结束时自动释放
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }   // 分离的协程没有地方传递异常
+    };
+};
+
+}   // namespace TaskPrivate
+
+/**
+ * @brief 在当前线程开始执行task，直到它第一次挂起时返回
+ */
+inline TaskPrivate::Detached spawn(Task<void> task)
+{
+    co_await std::move(task);
+}
+
+#endif   // TASK_H
@@ -0,0 +1,42 @@
+#---------------------------------------------------------------------------------------
+# @功能：       并行归约示例，QtConcurrent::mappedReduced的替代实现
+# @编译器：     Desktop Qt 5.12.5 MSVC2017 64bit（也支持其它编译器）
+# @Qt IDE：    D:/Qt/Qt5.12.5/Tools/QtCreator/share/qtcreator
+#
+# @开发者     mhf
+# @邮箱       1603291350@qq.com
+# @时间       2025-03-22 14:36:12
+# @备注       1、mappedReduced的reduce函数同一时刻只有一个线程调用，map结果很廉价时归约是串行瓶颈；
+#            2、parallelreduce.h中每个线程使用自己的累加器，最后树形合并，支持有序模式和自动分块；
+#            3、以传感器数据的直方图、统计量、超限事件为例，对比mappedReduced并测试不同线程数的加速比。
+#---------------------------------------------------------------------------------------
+QT -= gui
+QT += concurrent
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += main.cpp
+
+HEADERS += parallelreduce.h
+
+#  定义程序版本号
+VERSION = 1.0.0
+DEFINES += APP_VERSION=\\\"$$VERSION\\\"
+
+contains(QT_ARCH, i386){        # 使用32位编译器
+DESTDIR = $$PWD/../bin          # 程序输出路径
+}else{
+DESTDIR = $$PWD/../bin64        # 使用64位编译器
+}
+
+# msvc >= 2017  编译器使用utf-8编码
+msvc {
+    greaterThan(QMAKE_MSC_VER, 1900){       # msvc编译器版本大于2015
+        QMAKE_CFLAGS += /utf-8
+        QMAKE_CXXFLAGS += /utf-8
+    }else{
+    # msvc2015及以下版本在代码中使用【pragma execution_character_set("utf-8")】指定编码
+    }
+}
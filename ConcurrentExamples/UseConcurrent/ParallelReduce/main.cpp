@@ -0,0 +1,204 @@
+#include "parallelreduce.h"
+
+#include <qtconcurrentmap.h>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QVector>
+#include <cmath>
+#include <limits>
+
+// 一个传感器采样点
+struct Sample
+{
+    qint64 time;   // 采样时间（微秒）
+    float value;   // 温度
+};
+
+const int BINS = 1024;
+const float LOW = -50.0F;
+const float HIGH = 150.0F;
+const float ALARM = 120.0F;   // 超过该温度记为超限事件
+
+typedef QVector<quint64> Histogram;
+
+int binOf(float value)
+{
+    const int bin = int((value - LOW) * (BINS / (HIGH - LOW)));
+    return qBound(0, bin, BINS - 1);
+}
+
+/**
+ * @brief 统计量，merge使用Chan的并行算法合并两组数据的均值和方差
+ */
+struct Stats
+{
+    quint64 count = 0;
+    double mean = 0;
+    double m2 = 0;   // 与均值之差的平方和
+    float min = std::numeric_limits<float>::max();
+    float max = std::numeric_limits<float>::lowest();
+
+    void add(float value)
+    {
+        ++count;
+        const double delta = value - mean;
+        mean += delta / double(count);
+        m2 += delta * (value - mean);
+        min = qMin(min, value);
+        max = qMax(max, value);
+    }
+
+    void merge(const Stats& other)
+    {
+        if (other.count == 0)
+        {
+            return;
+        }
+        const double total = double(count + other.count);
+        const double delta = other.mean - mean;
+        mean += delta * double(other.count) / total;
+        m2 += other.m2 + delta * delta * double(count) * double(other.count) / total;
+        count += other.count;
+        min = qMin(min, other.min);
+        max = qMax(max, other.max);
+    }
+
+    double stddev() const { return count > 1 ? std::sqrt(m2 / double(count - 1)) : 0; }
+};
+
+/**
+ * @brief 生成模拟的温度数据：缓慢变化的基准 + 噪声 + 偶尔的尖峰
+ */
+QVector<Sample> makeSamples(int count)
+{
+    QVector<Sample> samples(count);
+    quint32 seed = 12345;
+    for (int i = 0; i < count; ++i)
+    {
+        seed = seed * 1664525U + 1013904223U;
+        const float noise = float(seed >> 8) / float(1 << 24) - 0.5F;
+        const float spike = (seed & 0xFFFF) == 0 ? 80.0F : 0.0F;
+        samples[i].time = qint64(i) * 100;
+        samples[i].value = 40.0F + 30.0F * std::sin(float(i) * 1e-6F) + noise * 10.0F + spike;
+    }
+    return samples;
+}
+
+// QtConcurrent::mappedReduced使用的map、reduce函数：reduce每个元素调用一次，且只能单线程执行
+int mapBin(const Sample& sample)
+{
+    return binOf(sample.value);
+}
+
+void reduceBin(Histogram& histogram, const int& bin)
+{
+    if (histogram.isEmpty())
+    {
+        histogram.resize(BINS);
+    }
+    ++histogram[bin];
+}
+
+Histogram histogramOf(const QVector<Sample>& samples, const ReduceOptions& options)
+{
+    return parallelReduce(
+        samples, Histogram(BINS), [](Histogram& histogram, const Sample& sample) { ++histogram[binOf(sample.value)]; },
+        [](Histogram& left, const Histogram& right)
+        {
+            for (int i = 0; i < BINS; ++i)
+            {
+                left[i] += right[i];
+            }
+        },
+        options);
+}
+
+Stats statsOf(const QVector<Sample>& samples, const ReduceOptions& options)
+{
+    return parallelReduce(
+        samples, Stats(), [](Stats& stats, const Sample& sample) { stats.add(sample.value); },
+        [](Stats& left, const Stats& right) { left.merge(right); }, options);
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    const int count = 20000000;
+    const QVector<Sample> samples = makeSamples(count);
+    qDebug() << "采样点数：" << count << "CPU核心数：" << QThread::idealThreadCount();
+
+    QElapsedTimer timer;
+
+    // 1、直方图：mappedReduced与并行归约对比
+    timer.start();
+    const Histogram reference = QtConcurrent::blockingMappedReduced(samples, mapBin, reduceBin);
+    qDebug() << "QtConcurrent::mappedReduced直方图耗时：" << timer.elapsed() << "ms";
+
+    timer.start();
+    const Histogram histogram = histogramOf(samples, ReduceOptions());
+    qDebug() << "parallelReduce直方图耗时：" << timer.elapsed() << "ms" << (histogram == reference ? "结果一致" : "结果不一致");
+
+    // 2、不同线程数下的加速比
+    double baseHistogram = 0;
+    double baseStats = 0;
+    for (int threads = 1; threads <= QThread::idealThreadCount(); threads *= 2)
+    {
+        ReduceOptions options;
+        options.threads = threads;
+
+        timer.start();
+        histogramOf(samples, options);
+        const double histogramMs = double(timer.nsecsElapsed()) / 1e6;
+
+        timer.start();
+        const Stats stats = statsOf(samples, options);
+        const double statsMs = double(timer.nsecsElapsed()) / 1e6;
+
+        if (threads == 1)
+        {
+            baseHistogram = histogramMs;
+            baseStats = statsMs;
+            qDebug() << QString("均值：%1 标准差：%2 最小：%3 最大：%4").arg(stats.mean).arg(stats.stddev()).arg(stats.min).arg(stats.max);
+        }
+        qDebug() << QString("线程数：%1  直方图：%2ms（%3倍）  统计量：%4ms（%5倍）")
+                        .arg(threads)
+                        .arg(histogramMs, 0, 'f', 1)
+                        .arg(baseHistogram / histogramMs, 0, 'f', 2)
+                        .arg(statsMs, 0, 'f', 1)
+                        .arg(baseStats / statsMs, 0, 'f', 2);
+    }
+
+    // 3、有序模式：按时间顺序收集超限事件，相邻数据块的结果按顺序拼接
+    ReduceOptions ordered;
+    ordered.order = ReduceOrder::Ordered;
+    timer.start();
+    const QVector<Sample> alarms = parallelReduce(
+        samples, QVector<Sample>(),
+        [](QVector<Sample>& events, const Sample& sample)
+        {
+            if (sample.value > ALARM)
+            {
+                events.append(sample);
+            }
+        },
+        [](QVector<Sample>& left, const QVector<Sample>& right) { left += right; }, ordered);
+    const qint64 alarmMs = timer.elapsed();
+
+    bool sorted = true;
+    for (int i = 1; i < alarms.size(); ++i)
+    {
+        sorted = sorted && alarms[i - 1].time < alarms[i].time;
+    }
+    qDebug() << "超限事件：" << alarms.size() << "个，耗时" << alarmMs << "ms" << (sorted ? "按时间顺序" : "顺序错误");
+
+    // 4、Span：只处理后一半数据，不复制
+    const Stats tail = parallelReduce(
+        makeSpan(samples.constData() + count / 2, size_t(count - count / 2)), Stats(),
+        [](Stats& stats, const Sample& sample) { stats.add(sample.value); }, [](Stats& left, const Stats& right) { left.merge(right); });
+    qDebug() << "后一半数据均值：" << tail.mean << "采样点数：" << tail.count;
+
+    return 0;
+}
@@ -0,0 +1,223 @@
+#ifndef PARALLELREDUCE_H
+#define PARALLELREDUCE_H
+
+/**
+ * 并行归约：QtConcurrent::mappedReduced的替代实现。
+ *
+ * mappedReduced中reduce函数同一时刻只有一个线程调用，map结果很廉价时（如直方图、统计量）归约成为串行瓶颈。
+ * 这里每个工作线程（无序模式）或每个数据块（有序模式）有自己的累加器，元素直接累加到自己的累加器中，不需要加锁；
+ * 全部累加完成后再将累加器两两合并（树形合并，每一轮的合并也并行执行），合并次数只与线程数/块数有关。
+ *
+ *   accumulate(T& acc, const Value& value)   将一个元素累加到累加器（相当于map + reduce）
+ *   merge(T& left, const T& right)           将right合并到left，必须满足结合律；无序模式还要求满足交换律
+ *
+ * 有序模式下每个连续的数据块有一个累加器，只合并相邻的块，结果与串行从前到后计算一致（如按顺序拼接结果）。
+ * 支持随机访问迭代器，因此可用于QVector、QList、std::vector、数组以及Span/std::span/QSpan。
+ * 使用QThreadPool::tryStart启动辅助线程，线程池已满时由调用线程完成剩余工作，在线程池的任务中调用也不会死锁。
+ */
+#include <QSemaphore>
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+enum class ReduceOrder
+{
+    Unordered,   // 每个线程一个累加器，合并顺序不确定，适合满足交换律的归约（求和、直方图、最大最小值）
+    Ordered      // 每个连续数据块一个累加器，按原始顺序合并
+};
+
+struct ReduceOptions
+{
+    ReduceOrder order = ReduceOrder::Unordered;
+    int threads = 0;           // 最多使用的线程数（包括调用线程），0为线程池的最大线程数
+    int chunkSize = 0;         // 每次领取的元素个数，0为自动（每个线程约4块，便于负载均衡）
+    int minChunkSize = 1024;   // 自动分块时每块的最少元素个数，元素很少时直接在调用线程中串行计算
+    QThreadPool* pool = nullptr;   // 为空时使用全局线程池
+};
+
+/**
+ * @brief 连续内存的视图，便于直接处理数组或容器的一部分而不用复制（C++20可直接使用std::span）
+ */
+template<typename T>
+class Span
+{
+public:
+    Span(T* data, size_t size)
+        : m_data(data)
+        , m_size(size)
+    {
+    }
+
+    T* begin() const { return m_data; }
+    T* end() const { return m_data + m_size; }
+    T* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+    Span subspan(size_t offset, size_t count) const { return Span(m_data + offset, std::min(count, m_size - offset)); }
+
+private:
+    T* m_data;
+    size_t m_size;
+};
+
+template<typename T>
+Span<T> makeSpan(T* data, size_t size)
+{
+    return Span<T>(data, size);
+}
+
+namespace ParallelReducePrivate {
+
+// 累加器后面填充一个缓存行，避免相邻累加器频繁写入时的伪共享
+template<typename T>
+struct Slot
+{
+    explicit Slot(const T& identity)
+        : value(identity)
+    {
+    }
+    T value;
+    char pad[64];
+};
+
+class HelperTask : public QRunnable
+{
+public:
+    HelperTask(const std::function<void()>* body, QSemaphore* finished)
+        : m_body(body)
+        , m_finished(finished)
+    {
+    }
+
+    void run() override
+    {
+        (*m_body)();
+        m_finished->release();
+    }
+
+private:
+    const std::function<void()>* m_body;
+    QSemaphore* m_finished;
+};
+
+/**
+ * @brief 在最多workers个线程中执行body（调用线程也执行），body内部通过原子计数领取工作，所有线程都返回后才返回
+ */
+inline void runParallel(QThreadPool* pool, int workers, const std::function<void()>& body)
+{
+    QSemaphore finished;
+    int started = 0;
+    for (int i = 1; i < workers; ++i)
+    {
+        HelperTask* task = new HelperTask(&body, &finished);
+        if (!pool->tryStart(task))   // 线程池没有空闲线程，剩下的工作由已启动的线程完成
+        {
+            delete task;
+            break;
+        }
+        ++started;
+    }
+    body();
+    finished.acquire(started);
+}
+
+/**
+ * @brief 树形合并slots[0..count)，结果在slots[0]；每一轮合并距离为stride的相邻两个，保持先后顺序
+ */
+template<typename T, typename Merge>
+void treeMerge(QThreadPool* pool, int workers, std::vector<Slot<T>>& slots, Merge& merge)
+{
+    const size_t count = slots.size();
+    for (size_t stride = 1; stride < count; stride *= 2)
+    {
+        const size_t pairs = (count - stride + 2 * stride - 1) / (2 * stride);
+        std::atomic<size_t> next(0);
+        runParallel(pool, int(std::min(size_t(workers), pairs)),
+                    [&]()
+                    {
+                        for (size_t pair = next++; pair < pairs; pair = next++)
+                        {
+                            const size_t left = pair * 2 * stride;
+                            merge(slots[left].value, slots[left + stride].value);
+                        }
+                    });
+    }
+}
+
+}   // namespace ParallelReducePrivate
+
+/**
+ * @brief           并行归约区间[first, last)
+ * @param identity  累加器的初始值（单位元，如0、空直方图），每个累加器都从它复制
+ * @param accumulate void(T& acc, const Value& value)
+ * @param merge     void(T& left, const T& right)
+ * @return          所有元素的归约结果
+ */
+template<typename Iterator, typename T, typename Accumulate, typename Merge>
+T parallelReduceRange(Iterator first, Iterator last, const T& identity, Accumulate accumulate, Merge merge,
+                      const ReduceOptions& options = ReduceOptions())
+{
+    using namespace ParallelReducePrivate;
+
+    QThreadPool* pool = options.pool ? options.pool : QThreadPool::globalInstance();
+    const size_t size = size_t(std::distance(first, last));
+    const int workers = std::max(1, options.threads > 0 ? options.threads : pool->maxThreadCount());
+
+    size_t chunkSize = size_t(options.chunkSize);
+    if (chunkSize == 0)
+    {
+        chunkSize = std::max(size_t(std::max(options.minChunkSize, 1)), size / (size_t(workers) * 4));
+    }
+    const size_t chunks = size == 0 ? 0 : (size + chunkSize - 1) / chunkSize;
+
+    if (chunks <= 1 || workers == 1)   // 不值得并行
+    {
+        T result = identity;
+        for (Iterator it = first; it != last; ++it)
+        {
+            accumulate(result, *it);
+        }
+        return result;
+    }
+
+    const bool ordered = options.order == ReduceOrder::Ordered;
+    const int threads = int(std::min(size_t(workers), chunks));
+    std::vector<Slot<T>> slots(ordered ? chunks : size_t(threads), Slot<T>(identity));
+    std::atomic<size_t> nextChunk(0);
+    std::atomic<size_t> nextSlot(0);
+
+    runParallel(pool, threads,
+                [&]()
+                {
+                    T* local = ordered ? nullptr : &slots[nextSlot++].value;   // 无序模式：本线程的累加器
+                    for (size_t chunk = nextChunk++; chunk < chunks; chunk = nextChunk++)
+                    {
+                        T& acc = ordered ? slots[chunk].value : *local;
+                        const size_t begin = chunk * chunkSize;
+                        const size_t end = std::min(size, begin + chunkSize);
+                        Iterator it = first;
+                        std::advance(it, begin);
+                        for (size_t i = begin; i < end; ++i, ++it)
+                        {
+                            accumulate(acc, *it);
+                        }
+                    }
+                });
+
+    treeMerge(pool, threads, slots, merge);
+    return std::move(slots[0].value);
+}
+
+/**
+ * @brief 并行归约整个容器或Span，参数同parallelReduceRange
+ */
+template<typename Sequence, typename T, typename Accumulate, typename Merge>
+T parallelReduce(const Sequence& sequence, const T& identity, Accumulate accumulate, Merge merge, const ReduceOptions& options = ReduceOptions())
+{
+    return parallelReduceRange(std::begin(sequence), std::end(sequence), identity, accumulate, merge, options);
+}
+
+#endif   // PARALLELREDUCE_H
@@ -9,6 +9,7 @@
 #---------------------------------------------------------------------
 DEFINES += QT_MESSAGELOGCONTEXT        # release模式下输出日志
 DEFINES += OUT_TERMINAL                # 日志输出到终端terminal
+#DEFINES += QLOG_MIN_LEVEL=2           # 编译期移除低于该级别的日志宏（0:debug 1:info 2:warning 3:critical），默认release移除debug
 
 FORMS += \
     $$PWD/logwidgettext.ui
@@ -16,6 +17,8 @@ FORMS += \
 HEADERS += \
     $$PWD/logconfig.h \
     $$PWD/loginput.h \
+    $$PWD/logmacro.h \
+    $$PWD/logrecord.h \
     $$PWD/logsavebase.h \
     $$PWD/logsavetxt.h \
     $$PWD/logwidgetbase.h \
@@ -24,6 +27,7 @@ HEADERS += \
 SOURCES += \
     $$PWD/logconfig.cpp \
     $$PWD/loginput.cpp \
+    $$PWD/logrecord.cpp \
     $$PWD/logsavebase.cpp \
     $$PWD/logsavetxt.cpp \
     $$PWD/logwidgetbase.cpp \
@@ -7,6 +7,7 @@ LogInput::LogInput(QObject* parent)
 {
     LogConfig::init();
     qRegisterMetaType<QtMsgType>("QtMsgType");
+    qRegisterMetaType<LogRecord>("LogRecord");
 
     messageHandle = qInstallMessageHandler(LogInput::myMessageOutput);   // 安装日志处理函数(这里需要使用非成员函数或者静态成员函数)
 }
@@ -17,6 +18,7 @@ LogInput::~LogInput()
 }
 
 LogInput* LogInput::m_log = nullptr;
+std::atomic<int> LogInput::m_level(0);
 
 LogInput* LogInput::getInstance()
 {
@@ -32,23 +34,49 @@ LogInput* LogInput::getInstance()
     return m_log;
 }
 
-void LogInput::myMessageOutput(QtMsgType type, const QMessageLogContext& context, const QString& msg)
+/**
+ * @brief        设置运行期最低日志级别，低于该级别的qDebug/日志宏都会被丢弃
+ * @param type
+ */
+void LogInput::setLevel(QtMsgType type)
+{
+    m_level.store(severity(type), std::memory_order_relaxed);
+}
+
+QtMsgType LogInput::level()
 {
-    QByteArray localMsg = msg.toLocal8Bit();
-    switch (type)
+    switch (m_level.load(std::memory_order_relaxed))
     {
-    case QtDebugMsg:
-        break;
-    case QtInfoMsg:
-        break;
-    case QtWarningMsg:
-        break;
-    case QtCriticalMsg:
-        break;
-    case QtFatalMsg:
-        break;
+    case 0:
+        return QtDebugMsg;
+    case 1:
+        return QtInfoMsg;
+    case 2:
+        return QtWarningMsg;
+    case 3:
+        return QtCriticalMsg;
+    default:
+        return QtFatalMsg;
     }
-    if (!msg.isEmpty())
+}
+
+/**
+ * @brief 定义了OUT_TERMINAL时，日志宏产生的日志与qDebug走同一个输出路径（安装前的消息处理函数）
+ *        输出到控制台需要完整的字符串，因此在调用线程中格式化
+ */
+void LogInput::outputTerminal(const LogRecord& record)
+{
+    getInstance();   // 确保已经安装消息处理函数，messageHandle指向原来的处理函数
+    if (messageHandle)
+    {
+        const QMessageLogContext context(record.file, record.line, record.function, "default");
+        messageHandle(record.type, context, record.message());
+    }
+}
+
+void LogInput::myMessageOutput(QtMsgType type, const QMessageLogContext& context, const QString& msg)
+{
+    if (isEnabled(type) && !msg.isEmpty())   // 低于运行期级别的日志不保存、不显示，但仍然输出到控制台
     {
         const char* file = context.file ? context.file : "";
         const char* function = context.function ? context.function : "";
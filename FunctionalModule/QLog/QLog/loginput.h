@@ -11,9 +11,11 @@
 #define LOGINPUT_H
 
 #include "logconfig.h"
+#include "logrecord.h"
 #include "logsavetxt.h"
 #include <QObject>
 #include <QTime>
+#include <atomic>
 
 class LogInput : public QObject
 {
@@ -22,9 +24,53 @@ public:
     static LogInput* getInstance();   // 获取单例对象
     static void myMessageOutput(QtMsgType type, const QMessageLogContext& context, const QString& msg);
 
+    static void setLevel(QtMsgType type);   // 设置运行期最低日志级别
+    static QtMsgType level();
+    static bool isEnabled(QtMsgType type)   // 判断该级别日志是否需要输出（日志宏在求值参数前调用）
+    {
+        return severity(type) >= m_level.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief           日志宏入口，只保存格式串和原始参数，不在调用线程中格式化
+     * @param format    格式串（字符串字面量，只保存指针），使用%1、%2...作为占位符
+     */
+    template<size_t N, typename... Args>
+    static void write(QtMsgType type, const char* file, const char* function, int line, const char (&format)[N], const Args&... args)
+    {
+        LogRecord record(type, file, function, line, format);
+        record.args.reserve(int(sizeof...(Args)));
+        int expand[] = {0, (record.addArg(args), 0)...};
+        Q_UNUSED(expand)
+#ifdef OUT_TERMINAL
+        outputTerminal(record);
+#endif
+        emit getInstance()->logRecord(record);
+    }
+
 private:
     explicit LogInput(QObject* parent = nullptr);
     ~LogInput();
+    static void outputTerminal(const LogRecord& record);   // 日志宏与qDebug一样交给原来的处理函数输出到控制台
+
+    // QtMsgType的枚举值不是按严重程度排列的，这里转换为递增的级别
+    static int severity(QtMsgType type)
+    {
+        switch (type)
+        {
+        case QtDebugMsg:
+            return 0;
+        case QtInfoMsg:
+            return 1;
+        case QtWarningMsg:
+            return 2;
+        case QtCriticalMsg:
+            return 3;
+        case QtFatalMsg:
+            return 4;
+        }
+        return 0;
+    }
 
 signals:
     /**
@@ -38,8 +84,15 @@ signals:
      */
     void logData(QtMsgType type, QString time, QString file, QString function, int line, QString msg);
 
+    /**
+     * @brief           日志宏产生的未格式化日志
+     * @param record    日志记录，格式化由接收方在自己的线程中完成
+     */
+    void logRecord(const LogRecord& record);
+
 private:
     static LogInput* m_log;
+    static std::atomic<int> m_level;   // 运行期最低日志级别（severity）
 };
 
 #endif   // LOGINPUT_H
@@ -0,0 +1,74 @@
+﻿/******************************************************************************
+* @文件名     logmacro.h
+* @功能      日志宏：
+*            1、编译期级别过滤：低于QLOG_MIN_LEVEL的日志宏展开为空语句，参数不会被求值；
+*            2、运行期级别过滤：先判断LogInput当前级别，满足条件才会求值参数；
+*            3、参数原样保存到LogRecord中，格式化在日志保存线程中完成。
+*
+*            使用示例：LOG_DEBUG("解码帧：%1 pts：%2", frameIndex, pts);
+*            格式串只保存指针，必须是字符串字面量，传入qPrintable()等临时字符串时编译报错；
+*            需要动态内容时作为参数传入：LOG_INFO("%1", str);
+*
+* @开发者     mhf
+* @邮箱      1603291350@qq.com
+* @时间      2024/06/20
+* @备注      QLOG_MIN_LEVEL 可在pro/pri中通过 DEFINES += QLOG_MIN_LEVEL=2 指定，
+*            未指定时debug模式保留全部日志，release模式移除debug日志。
+*****************************************************************************/
+#ifndef LOGMACRO_H
+#define LOGMACRO_H
+
+#include "loginput.h"
+
+#define QLOG_LEVEL_DEBUG    0
+#define QLOG_LEVEL_INFO     1
+#define QLOG_LEVEL_WARNING  2
+#define QLOG_LEVEL_CRITICAL 3
+
+#ifndef QLOG_MIN_LEVEL
+#ifdef QT_NO_DEBUG
+#define QLOG_MIN_LEVEL QLOG_LEVEL_INFO
+#else
+#define QLOG_MIN_LEVEL QLOG_LEVEL_DEBUG
+#endif
+#endif
+
+#define QLOG_WRITE(type, ...)                                                 \
+    do                                                                        \
+    {                                                                         \
+        if (LogInput::isEnabled(type))                                        \
+        {                                                                     \
+            LogInput::write(type, __FILE__, Q_FUNC_INFO, __LINE__, "" __VA_ARGS__); \
+        }                                                                     \
+    } while (0)
+
+#define QLOG_DISCARD(...) \
+    do                    \
+    {                     \
+    } while (0)
+
+#if QLOG_MIN_LEVEL <= QLOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) QLOG_WRITE(QtDebugMsg, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) QLOG_DISCARD(__VA_ARGS__)
+#endif
+
+#if QLOG_MIN_LEVEL <= QLOG_LEVEL_INFO
+#define LOG_INFO(...) QLOG_WRITE(QtInfoMsg, __VA_ARGS__)
+#else
+#define LOG_INFO(...) QLOG_DISCARD(__VA_ARGS__)
+#endif
+
+#if QLOG_MIN_LEVEL <= QLOG_LEVEL_WARNING
+#define LOG_WARNING(...) QLOG_WRITE(QtWarningMsg, __VA_ARGS__)
+#else
+#define LOG_WARNING(...) QLOG_DISCARD(__VA_ARGS__)
+#endif
+
+#if QLOG_MIN_LEVEL <= QLOG_LEVEL_CRITICAL
+#define LOG_CRITICAL(...) QLOG_WRITE(QtCriticalMsg, __VA_ARGS__)
+#else
+#define LOG_CRITICAL(...) QLOG_DISCARD(__VA_ARGS__)
+#endif
+
+#endif   // LOGMACRO_H
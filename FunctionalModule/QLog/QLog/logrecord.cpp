@@ -0,0 +1,64 @@
+﻿#include "logrecord.h"
+
+#include <QTime>
+#include <QVector>
+
+LogRecord::LogRecord(QtMsgType type, const char* file, const char* function, int line, const char* format)
+    : type(type)
+    , file(file ? file : "")
+    , function(function ? function : "")
+    , format(format ? format : "")
+    , line(line)
+    , msecs(QTime::currentTime().msecsSinceStartOfDay())
+{
+}
+
+QString LogRecord::time() const
+{
+    return QTime::fromMSecsSinceStartOfDay(msecs).toString("HH:mm:ss");
+}
+
+/**
+ * @brief   生成日志信息
+ * @return  一次扫描格式串，%1~%99替换为对应的参数，参数中的%不再被替换；
+ *          没有对应参数的占位符、单独的%原样保留，没有被引用的参数追加到末尾
+ */
+QString LogRecord::message() const
+{
+    const QString strFormat = QString::fromUtf8(format);
+    QString strMsg;
+    strMsg.reserve(strFormat.size());
+    QVector<bool> used(args.count(), false);   // 参数是否被引用
+    for (int i = 0; i < strFormat.size(); i++)
+    {
+        const QChar ch = strFormat.at(i);
+        if (ch != '%' || i + 1 >= strFormat.size() || !strFormat.at(i + 1).isDigit() || strFormat.at(i + 1) == '0')
+        {
+            strMsg.append(ch);
+            continue;
+        }
+        int index = strFormat.at(i + 1).digitValue();
+        int length = 2;
+        if (i + 2 < strFormat.size() && strFormat.at(i + 2).isDigit())
+        {
+            index = index * 10 + strFormat.at(i + 2).digitValue();
+            length = 3;
+        }
+        if (index > args.count())
+        {
+            strMsg.append(strFormat.mid(i, length));
+        }
+        else
+        {
+            strMsg.append(args.at(index - 1).toString());
+            used[index - 1] = true;
+        }
+        i += length - 1;
+    }
+    for (int i = 0; i < args.count(); i++)
+    {
+        if (!used.at(i))
+            strMsg.append(' ').append(args.at(i).toString());
+    }
+    return strMsg;
+}
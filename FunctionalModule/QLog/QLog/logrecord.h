@@ -0,0 +1,48 @@
+﻿/******************************************************************************
+* @文件名     logrecord.h
+* @功能      延迟格式化的日志记录，调用处只保存格式串和原始参数，
+*            真正的字符串拼接在日志保存线程/显示线程中完成
+*
+* @开发者     mhf
+* @邮箱      1603291350@qq.com
+* @时间      2024/06/20
+* @备注
+*****************************************************************************/
+#ifndef LOGRECORD_H
+#define LOGRECORD_H
+
+#include <QMetaType>
+#include <QString>
+#include <QVariant>
+
+class LogRecord
+{
+public:
+    LogRecord() = default;
+    LogRecord(QtMsgType type, const char* file, const char* function, int line, const char* format);
+
+    QString time() const;      // 日志时间（HH:mm:ss）
+    QString message() const;   // 按格式串和参数生成日志信息
+
+    /**
+     * @brief      保存一个原始参数，字符串字面量转为QString，其它类型直接装入QVariant
+     */
+    template<typename T>
+    void addArg(const T& value)
+    {
+        args.append(QVariant::fromValue(value));
+    }
+    void addArg(const char* value) { args.append(QString::fromUtf8(value)); }
+
+public:
+    QtMsgType type = QtDebugMsg;
+    const char* file = "";       // __FILE__ 等字面量，生命周期为整个程序，无需拷贝
+    const char* function = "";
+    const char* format = "";     // 格式串（%1 %2 ...），日志宏保证是字符串字面量，同样只保存指针
+    int line = 0;
+    int msecs = 0;               // 记录产生时刻（当天毫秒数），格式化推迟到写入时
+    QVariantList args;           // 原始参数
+};
+Q_DECLARE_METATYPE(LogRecord)
+
+#endif   // LOGRECORD_H
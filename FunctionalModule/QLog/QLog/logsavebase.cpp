@@ -19,6 +19,7 @@ LogSaveBase::LogSaveBase(QObject* parent)
         dir.mkpath(LOG_PATH);
     }
     connect(LogInput::getInstance(), &LogInput::logData, this, &LogSaveBase::on_logData, Qt::QueuedConnection);
+    connect(LogInput::getInstance(), &LogInput::logRecord, this, &LogSaveBase::on_logRecord, Qt::QueuedConnection);
 }
 
 LogSaveBase::~LogSaveBase()
@@ -26,6 +27,22 @@ LogSaveBase::~LogSaveBase()
     m_thread->quit();
     m_thread->wait();
     disconnect(LogInput::getInstance(), &LogInput::logData, this, &LogSaveBase::on_logData);
+    disconnect(LogInput::getInstance(), &LogInput::logRecord, this, &LogSaveBase::on_logRecord);
+}
+
+void LogSaveBase::on_logRecord(const LogRecord& record)
+{
+    if (!acceptLevel(record.type))
+    {
+        return;
+    }
+    on_logData(record.type, record.time(), record.file, record.function, record.line, record.message());
+}
+
+bool LogSaveBase::acceptLevel(QtMsgType type) const
+{
+    Q_UNUSED(type)
+    return true;
 }
 
 LogSaveBase* LogSaveBase::m_logSave = nullptr;
@@ -8,6 +8,7 @@
 #ifndef LOGSAVEBASE_H
 #define LOGSAVEBASE_H
 
+#include "logrecord.h"
 #include <qapplication.h>
 #include <QMutex>
 #include <QObject>
@@ -35,6 +36,18 @@ protected:
      */
     virtual void on_logData(QtMsgType type, QString time, QString file, QString function, int line, QString msg) = 0;
 
+    /**
+     * @brief           保存日志宏产生的日志，在保存线程中判断级别后再格式化
+     * @param record    未格式化的日志记录
+     */
+    void on_logRecord(const LogRecord& record);
+
+    /**
+     * @brief           该级别的日志是否需要保存，不需要保存的日志不会被格式化
+     * @param type      日志级别
+     */
+    virtual bool acceptLevel(QtMsgType type) const;
+
     /**
      * @brief   打开新文件
      * @return  true：打开成功 false：打开失败
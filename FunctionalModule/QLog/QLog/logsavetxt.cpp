@@ -61,14 +61,29 @@ void LogSaveTxt::setFileType(FileType type)
     m_file.close();
 }
 
+/**
+ * @brief         debug日志不保存到文件中
+ * @param type
+ * @return
+ */
+bool LogSaveTxt::acceptLevel(QtMsgType type) const
+{
+    return type != QtDebugMsg;
+}
+
 void LogSaveTxt::on_logData(QtMsgType type, QString time, QString file, QString function, int line, QString msg)
 {
-    QString strData = "debug";
+    if (!acceptLevel(type))
+    {
+        return;
+    }
+
+    QString strData;
     switch (type)
     {
     case QtDebugMsg:
         strData = "debug";
-        return;
+        break;
     case QtInfoMsg:
         strData = "info";
         break;
@@ -89,7 +104,8 @@ void LogSaveTxt::on_logData(QtMsgType type, QString time, QString file, QString
         return;
     }
 
-    m_out << m_strLogFormat.arg(time).arg(strData).arg(file).arg(function).arg(line).arg(msg) << "\n";
+    // 多参数arg只扫描一次格式串，避免链式arg()产生多个临时字符串
+    m_out << m_strLogFormat.arg(time, strData, file, function, QString::number(line), msg) << "\n";
     m_out.flush();
 }
 
@@ -35,6 +35,7 @@ public:
 
 protected:
     void on_logData(QtMsgType type, QString time, QString file, QString function, int line, QString msg) override;
+    bool acceptLevel(QtMsgType type) const override;
     bool openNewFile() override;
     bool relyTime();
     bool relySize();
@@ -5,4 +5,10 @@ LogWidgetBase::LogWidgetBase(QWidget *parent) : QWidget(parent)
 {
     LogSaveTxt::initLog();   // 初始化日志保存功能
     connect(LogInput::getInstance(), &LogInput::logData, this, &LogWidgetBase::on_logData, Qt::QueuedConnection);
+    connect(LogInput::getInstance(), &LogInput::logRecord, this, &LogWidgetBase::on_logRecord, Qt::QueuedConnection);
+}
+
+void LogWidgetBase::on_logRecord(const LogRecord& record)
+{
+    on_logData(record.type, record.time(), record.file, record.function, record.line, record.message());
 }
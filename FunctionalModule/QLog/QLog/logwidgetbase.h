@@ -8,6 +8,7 @@
 #ifndef LOGWIDGETBASE_H
 #define LOGWIDGETBASE_H
 
+#include "logrecord.h"
 #include <qdatetime.h>
 #include <qtimer.h>
 #include <QWidget>
@@ -20,6 +21,7 @@ public:
 
 protected:
     virtual void on_logData(QtMsgType type, QString time, QString file, QString function, int line, QString msg) = 0;
+    void on_logRecord(const LogRecord& record);   // 显示日志宏产生的日志
     /**
      * @brief            设置日志最多显示行数
      * @param maximum
@@ -56,7 +56,7 @@ void LogWidgetText::on_logData(QtMsgType type, QString time, QString file, QStri
     }
 
     QMutexLocker locker(&m_mutex);
-    m_strBuf.append(m_logStyle.arg(strColor).arg(time).arg(msg));
+    m_strBuf.append(m_logStyle.arg(strColor, time, msg));
 }
 
 /**
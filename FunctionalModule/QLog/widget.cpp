@@ -1,5 +1,6 @@
 ﻿#include "widget.h"
 #include "ui_widget.h"
+#include <logmacro.h>
 #include <logsavetxt.h>
 #include <qthread.h>
 #include <QDebug>
@@ -31,6 +32,12 @@ void Widget::on_timer()
     qInfo() << "Info信息";
     qWarning() << "Warning信息";
     qCritical() << "critical信息";
+
+    // 使用日志宏：参数在保存线程中格式化，release模式下debug日志在编译期被移除
+    static int count = 0;
+    LOG_DEBUG("日志宏debug信息：%1", count);
+    LOG_INFO("日志宏Info信息：%1 %2", count, "次");
+    count++;
 }
 
 void Widget::on_com_FileType_activated(int index)
@@ -7,7 +7,7 @@
 # @邮箱       1603291350@qq.com
 # @时间       2025-02-28 20:27:41
 # @备注      需要先将ScanFile\ScanFileLib文件夹中工程编程生成动态库，然后ScanFile才可以编译
-#           由于使用的是windows api，所以只支持windows
+#           windows下使用windows api，Linux下使用POSIX接口和inotify
 #---------------------------------------------------------------------------------------
 
 QT       += core gui
@@ -20,9 +20,14 @@ CONFIG += c++17
 
 SOURCES += \
     main.cpp \
+    searchmodel.cpp \
+    treemapwidget.cpp \
     widget.cpp
 
 HEADERS += \
+    ThreadPool.h \
+    searchmodel.h \
+    treemapwidget.h \
     widget.h
 
 FORMS += \
@@ -33,3 +38,4 @@ INCLUDEPATH += $$PWD/include
 DEPENDPATH += $$PWD/include
 win32:CONFIG(release, debug|release): LIBS += -L$$PWD/lib/ -lScanFile
 else:win32:CONFIG(debug, debug|release): LIBS += -L$$PWD/lib/ -lScanFiled
+else:unix: LIBS += -L$$PWD/lib/ -lScanFile
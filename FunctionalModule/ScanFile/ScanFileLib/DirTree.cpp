@@ -0,0 +1,149 @@
+﻿#include "DirTree.h"
+
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace {
+
+const uint32_t PARALLEL_MIN_NODES = 4096;   // 每层节点数少于该值时单线程汇总
+
+}   // namespace
+
+/**
+ * @brief 根据扫描快照建立目录树
+ *
+ * 1、从根目录开始广度优先遍历，为每个目录分配新下标，使子目录、同层目录连续存放；
+ * 2、从最深一层开始逐层向上汇总，每层内部多线程并行。
+ *
+ * @param snapshot 扫描快照（需要已调用buildChildren）
+ * @param threads  每层汇总分成的任务数，为0时等于共用线程池的线程数
+ */
+void DirTree::build(const ScanSnapshot& snapshot, size_t threads)
+{
+    clear();
+    const std::vector<DirRecord>& dirs = snapshot.dirs();
+    const DirRecord* rootDir = snapshot.find(snapshot.root());
+    if (!rootDir)
+    {
+        return;
+    }
+
+    std::vector<uint32_t> order;   // 新下标 -> 快照下标
+    order.reserve(dirs.size());
+    order.push_back(uint32_t(rootDir - dirs.data()));
+    m_nodes.reserve(dirs.size());
+    m_nodes.push_back(DirNode());
+    m_nodes[0].parent = 0;
+    m_nodes[0].depth = 0;
+    m_levels.push_back(0);
+
+    for (uint32_t i = 0; i < order.size(); ++i)
+    {
+        const DirRecord& dir = dirs[order[i]];
+        DirNode& node = m_nodes[i];   // m_nodes已预留空间，添加子节点不会使引用失效
+        const uint32_t depth = node.depth;
+
+        // 目录名只保存最后一级，根目录保存完整路径
+        std::string name = dir.path;
+        if (i != 0)
+        {
+            size_t pos = name.find_last_of('/');
+            name = name.substr(pos + 1);
+        }
+        node.nameOffset = uint32_t(m_names.size());
+        node.nameLength = uint32_t(name.size());
+        m_names += name;
+
+        node.size = dir.totalSize();
+        node.fileCount = dir.files.size();
+        node.firstChild = uint32_t(order.size());
+        node.childCount = 0;
+        for (uint32_t child : dir.children)
+        {
+            if (dirs[child].removed)
+            {
+                continue;
+            }
+            if (m_levels.size() <= depth + 1)
+            {
+                m_levels.push_back(uint32_t(order.size()));   // 新一层的第一个节点
+            }
+            DirNode childNode = DirNode();
+            childNode.parent = i;
+            childNode.depth = depth + 1;
+            order.push_back(child);
+            m_nodes.push_back(childNode);
+            ++node.childCount;
+        }
+    }
+    m_levels.push_back(uint32_t(m_nodes.size()));
+
+    if (threads == 0)
+    {
+        threads = ThreadPool::shared().size();
+    }
+
+    // 从最深一层开始逐层向上汇总
+    for (size_t level = m_levels.size() - 1; level-- > 0;)
+    {
+        const uint32_t begin = m_levels[level];
+        const uint32_t end = m_levels[level + 1];
+        const uint32_t count = end - begin;
+        if (count < PARALLEL_MIN_NODES || threads == 1)
+        {
+            reduceLevel(begin, end);
+            continue;
+        }
+
+        const uint32_t chunk = (count + uint32_t(threads) - 1) / uint32_t(threads);
+        TaskGroup group(ThreadPool::shared());
+        for (uint32_t first = begin; first < end; first += chunk)
+        {
+            const uint32_t last = std::min(end, first + chunk);
+            group.run(std::bind(&DirTree::reduceLevel, this, first, last));
+        }
+        group.wait();
+    }
+}
+
+void DirTree::reduceLevel(uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        DirNode& node = m_nodes[i];
+        uint64_t totalSize = node.size;
+        uint64_t totalFiles = node.fileCount;
+        for (uint32_t c = node.firstChild; c < node.firstChild + node.childCount; ++c)
+        {
+            totalSize += m_nodes[c].totalSize;
+            totalFiles += m_nodes[c].totalFiles;
+        }
+        node.totalSize = totalSize;
+        node.totalFiles = totalFiles;
+    }
+}
+
+void DirTree::clear()
+{
+    m_nodes.clear();
+    m_levels.clear();
+    m_names.clear();
+}
+
+std::string DirTree::name(uint32_t index) const
+{
+    const DirNode& node = m_nodes[index];
+    return m_names.substr(node.nameOffset, node.nameLength);
+}
+
+std::string DirTree::path(uint32_t index) const
+{
+    std::string result = name(index);
+    while (index != 0)
+    {
+        index = m_nodes[index].parent;
+        std::string parent = name(index);
+        result = (parent.empty() || parent.back() != '/') ? parent + "/" + result : parent + result;
+    }
+    return result;
+}
@@ -0,0 +1,53 @@
+﻿#ifndef DIRTREE_H
+#define DIRTREE_H
+
+/**
+ * 紧凑的目录树，统计每个目录（包含所有子目录）的总大小和文件数，用于目录占用分析（类似du/ncdu）。
+ *
+ * 只为目录建立节点，文件只统计到所属目录上，千万级文件的目录树也只占用很少的内存；
+ * 节点按广度优先顺序存储，同一目录的子目录连续存放，同一深度的目录也连续存放，
+ * 因此可以从最深一层开始逐层向上并行汇总：每个节点只写自己的数据、只读下一层已完成的子节点，无需加锁。
+ */
+#include "ScanFile.h"
+#include "ScanSnapshot.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct DirNode
+{
+    uint32_t parent;       // 父目录下标（根目录为自身）
+    uint32_t firstChild;   // 第一个子目录下标
+    uint32_t childCount;   // 子目录数量
+    uint32_t nameOffset;   // 目录名在名称区中的偏移
+    uint32_t nameLength;
+    uint32_t depth;
+    uint64_t size;         // 目录下文件（不含子目录）的大小
+    uint64_t fileCount;
+    uint64_t totalSize;    // 包含所有子目录的大小
+    uint64_t totalFiles;
+};
+
+class SCANFILE_API DirTree
+{
+public:
+    void build(const ScanSnapshot& snapshot, size_t threads = 0);   // 根据扫描快照建立目录树并汇总大小
+    void clear();
+
+    bool isEmpty() const { return m_nodes.empty(); }
+    size_t size() const { return m_nodes.size(); }
+    uint32_t root() const { return 0; }
+    const DirNode& node(uint32_t index) const { return m_nodes[index]; }
+    std::string name(uint32_t index) const;   // 目录名（根目录为完整路径）
+    std::string path(uint32_t index) const;   // 完整路径
+
+private:
+    void reduceLevel(uint32_t begin, uint32_t end);   // 汇总[begin, end)区间内节点的子目录数据
+
+private:
+    std::vector<DirNode> m_nodes;
+    std::vector<uint32_t> m_levels;   // 每一层第一个节点的下标，最后一个元素为节点总数
+    std::string m_names;
+};
+
+#endif   // DIRTREE_H
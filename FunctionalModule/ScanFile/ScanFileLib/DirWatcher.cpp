@@ -0,0 +1,222 @@
+﻿#include "DirWatcher.h"
+
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+DirWatcher::DirWatcher()
+    : m_running(false)
+{
+}
+
+DirWatcher::~DirWatcher()
+{
+    stop();
+}
+
+/**
+ * @brief 启动监听线程
+ * @param callback 目录变化回调，在监听线程中调用
+ * @return 启动成功返回true，不支持的平台返回false
+ */
+bool DirWatcher::start(WatchCall callback)
+{
+#ifdef __linux__
+    std::lock_guard<std::mutex> state(m_stateMutex);
+    if (m_running)
+    {
+        return true;
+    }
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_fd < 0 || m_wakeFd < 0)
+    {
+        std::cerr << "inotify init failed" << std::endl;
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+            m_fd = -1;
+        }
+        if (m_wakeFd >= 0)
+        {
+            close(m_wakeFd);
+            m_wakeFd = -1;
+        }
+        return false;
+    }
+    m_callback = callback;
+    m_running = true;
+    m_thread = std::thread(&DirWatcher::run, this);
+    return true;
+#else
+    (void) callback;
+    return false;
+#endif
+}
+
+/**
+ * @brief 停止监听，不能在回调函数中调用（需要等待监听线程退出）
+ */
+void DirWatcher::stop()
+{
+    std::lock_guard<std::mutex> state(m_stateMutex);
+#ifdef __linux__
+    if (m_running)
+    {
+        m_running = false;
+        uint64_t value = 1;
+        ssize_t ret = write(m_wakeFd, &value, sizeof(value));   // 唤醒poll
+        (void) ret;
+    }
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+    if (m_fd >= 0)
+    {
+        close(m_fd);   // 关闭描述符时内核自动移除所有watch
+        m_fd = -1;
+    }
+    if (m_wakeFd >= 0)
+    {
+        close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+#endif
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_wdToDir.clear();
+    m_dirToWd.clear();
+}
+
+bool DirWatcher::addWatch(const std::string& dir)
+{
+#ifdef __linux__
+    std::lock_guard<std::mutex> state(m_stateMutex);
+    if (m_fd < 0)
+    {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_dirToWd.count(dir))
+        {
+            return true;
+        }
+    }
+    const uint32_t mask = IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR;
+    int wd = inotify_add_watch(m_fd, dir.c_str(), mask);
+    if (wd < 0)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_wdToDir[wd] = dir;
+    m_dirToWd[dir] = wd;
+    return true;
+#else
+    (void) dir;
+    return false;
+#endif
+}
+
+/**
+ * @brief 移除监听，不获取m_stateMutex，可以在回调中调用；m_fd只在监听线程退出后才关闭
+ */
+void DirWatcher::removeWatch(const std::string& dir)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::string prefix = dir + "/";
+    for (auto it = m_dirToWd.begin(); it != m_dirToWd.end();)
+    {
+        if (it->first == dir || it->first.compare(0, prefix.size(), prefix) == 0)
+        {
+#ifdef __linux__
+            inotify_rm_watch(m_fd, it->second);
+#endif
+            m_wdToDir.erase(it->second);
+            it = m_dirToWd.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+/**
+ * @brief 监听线程函数，批量读取inotify事件并转换为WatchEvent
+ */
+void DirWatcher::run()
+{
+#ifdef __linux__
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    pollfd fds[2] = {{m_fd, POLLIN, 0}, {m_wakeFd, POLLIN, 0}};
+    while (m_running)
+    {
+        if (poll(fds, 2, -1) <= 0 || (fds[1].revents & POLLIN))
+        {
+            continue;   // 被信号打断或被要求退出
+        }
+        ssize_t len;
+        while ((len = read(m_fd, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* ptr = buffer; ptr < buffer + len;)
+            {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+                ptr += sizeof(inotify_event) + event->len;
+
+                WatchEvent watchEvent;
+                watchEvent.isDir = (event->mask & IN_ISDIR) != 0;
+                if (event->mask & IN_Q_OVERFLOW)
+                {
+                    watchEvent.type = WatchEvent::Overflow;
+                    m_callback(watchEvent);
+                    continue;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    auto it = m_wdToDir.find(event->wd);
+                    if (it == m_wdToDir.end())
+                    {
+                        continue;
+                    }
+                    watchEvent.dir = it->second;
+                    if (event->mask & (IN_DELETE_SELF | IN_IGNORED))
+                    {
+                        m_dirToWd.erase(it->second);
+                        m_wdToDir.erase(it);
+                        continue;   // 目录本身的删除由父目录的IN_DELETE事件处理
+                    }
+                }
+                if (event->len > 0)
+                {
+                    watchEvent.name = event->name;
+                }
+
+                if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                {
+                    watchEvent.type = WatchEvent::Created;
+                }
+                else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+                {
+                    watchEvent.type = WatchEvent::Removed;
+                }
+                else if (event->mask & (IN_CLOSE_WRITE | IN_ATTRIB))
+                {
+                    watchEvent.type = WatchEvent::Modified;
+                }
+                else
+                {
+                    continue;
+                }
+                m_callback(watchEvent);
+            }
+        }
+    }
+#endif
+}
@@ -0,0 +1,512 @@
+﻿#include "DuplicateFinder.h"
+
+#include "XXHash64.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t PARTIAL_SIZE = 64 * 1024;        // 第2步读取文件头、尾的大小
+const size_t BUFFER_SIZE = 1024 * 1024;       // 每次读取的大小
+const size_t BUFFER_ALIGN = 4096;             // 缓冲区按页对齐
+const size_t TASK_BUFFER_SIZE = 2 * BUFFER_SIZE;   // 每个任务的缓冲区，逐字节比较时前后两半各读一个文件
+const size_t DEFAULT_READERS = 4;             // 默认同时读取的文件数，读取受限于磁盘，线程再多也不会更快
+
+char* allocAligned(size_t size)
+{
+#ifdef _WIN32
+    return static_cast<char*>(_aligned_malloc(size, BUFFER_ALIGN));
+#else
+    void* ptr = nullptr;
+    return posix_memalign(&ptr, BUFFER_ALIGN, size) == 0 ? static_cast<char*>(ptr) : nullptr;
+#endif
+}
+
+void freeAligned(char* ptr)
+{
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+/**
+ * @brief 只读文件，按偏移读取（不移动文件指针，多线程下无需加锁）
+ */
+class FileReader
+{
+public:
+    ~FileReader()
+    {
+#ifdef _WIN32
+        if (m_file != INVALID_HANDLE_VALUE)
+            CloseHandle(m_file);
+#else
+        if (m_fd >= 0)
+            close(m_fd);
+#endif
+    }
+
+    bool open(const std::string& path, bool sequential)
+    {
+#ifdef _WIN32
+        int len = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+        std::wstring wpath(len, 0);
+        MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wpath[0], len);
+        m_file = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                             sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+        return m_file != INVALID_HANDLE_VALUE;
+#else
+        m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (m_fd < 0)
+            return false;
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise(m_fd, 0, 0, sequential ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_RANDOM);   // 提示内核预读策略
+#endif
+        return true;
+#endif
+    }
+
+    /**
+     * @brief 从offset处读取length字节
+     * @return 实际读取的字节数，出错返回-1
+     */
+    long long readAt(unsigned long long offset, char* buffer, size_t length)
+    {
+        size_t total = 0;
+        while (total < length)
+        {
+#ifdef _WIN32
+            OVERLAPPED overlapped = {};
+            unsigned long long pos = offset + total;
+            overlapped.Offset = DWORD(pos & 0xFFFFFFFF);
+            overlapped.OffsetHigh = DWORD(pos >> 32);
+            DWORD read = 0;
+            if (!ReadFile(m_file, buffer + total, DWORD(length - total), &read, &overlapped))
+            {
+                return GetLastError() == ERROR_HANDLE_EOF ? (long long) total : -1;
+            }
+#else
+            ssize_t read = pread(m_fd, buffer + total, length - total, off_t(offset + total));
+            if (read < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return -1;
+            }
+#endif
+            if (read == 0)
+            {
+                break;   // 文件结尾
+            }
+            total += size_t(read);
+        }
+        return (long long) total;
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+#else
+    int m_fd = -1;
+#endif
+};
+
+}   // namespace
+
+DuplicateFinder::DuplicateFinder(size_t threads)
+    : m_threads(threads)
+    , m_quit(false)
+    , m_bytesRead(0)
+    , m_filesHashed(0)
+{
+    if (m_threads == 0)
+    {
+        m_threads = DEFAULT_READERS;
+    }
+    m_pool.reset(new ThreadPool(m_threads));
+}
+
+DuplicateFinder::~DuplicateFinder()
+{
+    stop();
+}
+
+void DuplicateFinder::setCallback(DuplicateCall callback)
+{
+    m_callback = callback;
+}
+
+void DuplicateFinder::setFinishedCallback(FinishedCall callback)
+{
+    m_finishedCallback = callback;
+}
+
+void DuplicateFinder::setMinSize(unsigned long long size)
+{
+    m_minSize = size;
+}
+
+/**
+ * @brief 哈希相同的文件是否再逐字节比较确认
+ *
+ * 64位哈希存在极小概率的碰撞，结果用于删除文件时应保持开启；关闭后少读取一遍重复文件。
+ * @param verify
+ */
+void DuplicateFinder::setVerify(bool verify)
+{
+    m_verify = verify;
+}
+
+/**
+ * @brief 异步查找重复文件
+ * @param files 待比较的文件（一般为ScanFile::files()的结果）
+ */
+void DuplicateFinder::find(std::vector<FileInfo> files)
+{
+    stop();
+    m_quit = false;
+    m_bytesRead = 0;
+    m_filesHashed = 0;
+    m_thread = std::thread(&DuplicateFinder::run, this, std::move(files));
+}
+
+void DuplicateFinder::stop()
+{
+    m_quit = true;
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+/**
+ * @brief 在读取线程池中用m_threads个任务处理[0, count)区间的工作
+ *
+ * 每个任务持有一个独立的对齐缓冲区，通过原子下标领取工作，任务之间没有锁竞争；
+ * 等待期间调度线程也帮助执行读取线程池中的任务。
+ *
+ * @param count 工作数量
+ * @param fun   工作函数，参数为工作下标和该任务的缓冲区（TASK_BUFFER_SIZE字节）
+ */
+void DuplicateFinder::parallelFor(size_t count, const std::function<void(size_t, char*)>& fun)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    std::atomic<size_t> next(0);
+    const size_t tasks = std::min(m_threads, count);
+    TaskGroup group(*m_pool);
+    for (size_t i = 0; i < tasks; ++i)
+    {
+        group.run(
+            [&]()
+            {
+                std::unique_ptr<char, void (*)(char*)> buffer(allocAligned(TASK_BUFFER_SIZE), freeAligned);
+                if (!buffer)
+                {
+                    return;
+                }
+                size_t index;
+                while (!m_quit && (index = next.fetch_add(1, std::memory_order_relaxed)) < count)
+                {
+                    fun(index, buffer.get());
+                }
+            });
+    }
+    group.wait();
+}
+
+/**
+ * @brief 计算文件头尾各64KB的哈希，不超过128KB的文件直接计算完整哈希
+ */
+bool DuplicateFinder::hashPartial(Candidate& candidate, char* buffer)
+{
+    const unsigned long long size = candidate.file->size;
+    FileReader reader;
+    if (!reader.open(candidate.file->fileName, false))
+    {
+        return false;
+    }
+
+    XXHash64 hasher(size);
+    if (size <= 2 * PARTIAL_SIZE)
+    {
+        if (reader.readAt(0, buffer, size_t(size)) != (long long) size)
+        {
+            return false;
+        }
+        hasher.update(buffer, size_t(size));
+        candidate.complete = true;
+        m_bytesRead += size;
+    }
+    else
+    {
+        if (reader.readAt(0, buffer, PARTIAL_SIZE) != (long long) PARTIAL_SIZE ||
+            reader.readAt(size - PARTIAL_SIZE, buffer + PARTIAL_SIZE, PARTIAL_SIZE) != (long long) PARTIAL_SIZE)
+        {
+            return false;
+        }
+        hasher.update(buffer, 2 * PARTIAL_SIZE);
+        candidate.complete = false;
+        m_bytesRead += 2 * PARTIAL_SIZE;
+    }
+    candidate.hash = hasher.digest();
+    return true;
+}
+
+/**
+ * @brief 按1MB对齐块顺序读取整个文件并计算哈希
+ */
+bool DuplicateFinder::hashFull(Candidate& candidate, char* buffer)
+{
+    const unsigned long long size = candidate.file->size;
+    FileReader reader;
+    if (!reader.open(candidate.file->fileName, true))
+    {
+        return false;
+    }
+
+    XXHash64 hasher(size);
+    unsigned long long offset = 0;
+    while (offset < size)
+    {
+        if (m_quit)
+        {
+            return false;
+        }
+        size_t length = size_t(std::min<unsigned long long>(BUFFER_SIZE, size - offset));
+        if (reader.readAt(offset, buffer, length) != (long long) length)
+        {
+            return false;   // 文件在扫描后被修改或无法读取
+        }
+        hasher.update(buffer, length);
+        offset += length;
+        m_bytesRead += length;
+    }
+    candidate.hash = hasher.digest();
+    return true;
+}
+
+/**
+ * @brief 逐字节比较两个大小相同的文件
+ * @param buffer TASK_BUFFER_SIZE字节，前后两半分别读取两个文件
+ * @return 内容完全相同返回true，读取失败或停止查找时返回false
+ */
+bool DuplicateFinder::sameContent(const std::string& a, const std::string& b, unsigned long long size, char* buffer)
+{
+    FileReader readerA;
+    FileReader readerB;
+    if (!readerA.open(a, true) || !readerB.open(b, true))
+    {
+        return false;
+    }
+    char* bufferB = buffer + BUFFER_SIZE;
+    for (unsigned long long offset = 0; offset < size;)
+    {
+        if (m_quit)
+        {
+            return false;
+        }
+        size_t length = size_t(std::min<unsigned long long>(BUFFER_SIZE, size - offset));
+        if (readerA.readAt(offset, buffer, length) != (long long) length || readerB.readAt(offset, bufferB, length) != (long long) length ||
+            memcmp(buffer, bufferB, length) != 0)
+        {
+            return false;
+        }
+        offset += length;
+        m_bytesRead += 2 * length;
+    }
+    return true;
+}
+
+/**
+ * @brief 对[begin, end)区间内同一分组的文件按哈希排序，哈希相同的文件逐字节比较确认后作为一组重复文件输出
+ *
+ * 确认时每个文件与已确认的各组的第一个文件比较，相同则加入该组，否则单独成组；
+ * 哈希碰撞的文件因此会分到不同的组，只有一个文件的组不输出。
+ */
+void DuplicateFinder::emitGroups(std::vector<Candidate>& candidates, size_t begin, size_t end, char* buffer)
+{
+    if (!m_callback)
+    {
+        return;
+    }
+    end = size_t(std::partition(candidates.begin() + begin, candidates.begin() + end, [](const Candidate& c) { return c.valid; }) - candidates.begin());
+    std::sort(candidates.begin() + begin, candidates.begin() + end, [](const Candidate& a, const Candidate& b) { return a.hash < b.hash; });
+    for (size_t i = begin; i < end;)
+    {
+        size_t j = i + 1;
+        while (j < end && candidates[j].hash == candidates[i].hash)
+        {
+            ++j;
+        }
+        if (j - i > 1)
+        {
+            std::vector<DuplicateGroup> groups;
+            for (size_t k = i; k < j && !m_quit; ++k)
+            {
+                const std::string& fileName = candidates[k].file->fileName;
+                bool found = false;
+                for (size_t g = 0; g < groups.size() && !found; ++g)
+                {
+                    // 不确认时哈希相同即为重复，只有一组
+                    found = !m_verify || sameContent(groups[g].files.front(), fileName, candidates[k].file->size, buffer);
+                    if (found)
+                    {
+                        groups[g].files.push_back(fileName);
+                    }
+                }
+                if (!found)
+                {
+                    groups.push_back({candidates[k].file->size, {fileName}});
+                }
+            }
+            for (const DuplicateGroup& group : groups)
+            {
+                if (group.files.size() > 1 && !m_quit)
+                {
+                    m_callback(group);
+                }
+            }
+        }
+        i = j;
+    }
+}
+
+void DuplicateFinder::run(std::vector<FileInfo> files)
+{
+    // 1、按大小分组，只保留大小相同的文件
+    std::vector<const FileInfo*> sorted;
+    sorted.reserve(files.size());
+    for (const FileInfo& file : files)
+    {
+        if (file.size >= m_minSize)
+        {
+            sorted.push_back(&file);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const FileInfo* a, const FileInfo* b) { return a->size < b->size; });
+
+    std::vector<Candidate> candidates;
+    for (size_t i = 0; i < sorted.size();)
+    {
+        size_t j = i + 1;
+        while (j < sorted.size() && sorted[j]->size == sorted[i]->size)
+        {
+            ++j;
+        }
+        if (j - i > 1)
+        {
+            for (size_t k = i; k < j; ++k)
+            {
+                candidates.push_back({sorted[k], 0, 0, false, true});
+            }
+        }
+        i = j;
+    }
+    sorted = std::vector<const FileInfo*>();
+
+    // 2、计算头尾哈希，读取失败的文件标记为无效
+    parallelFor(candidates.size(),
+                [&](size_t index, char* buffer)
+                {
+                    candidates[index].valid = hashPartial(candidates[index], buffer);
+                    ++m_filesHashed;
+                });
+
+    // 按（大小，头尾哈希）分组；已完整读取的小文件直接确认、输出，其余进入第3步
+    std::vector<Candidate> remaining;
+    {
+        std::vector<Candidate> partial;
+        partial.reserve(candidates.size());
+        for (const Candidate& candidate : candidates)
+        {
+            if (candidate.valid)
+            {
+                partial.push_back(candidate);
+            }
+        }
+        candidates = std::vector<Candidate>();
+        std::sort(partial.begin(), partial.end(),
+                  [](const Candidate& a, const Candidate& b)
+                  { return a.file->size != b.file->size ? a.file->size < b.file->size : a.hash < b.hash; });
+
+        uint32_t group = 0;
+        std::vector<std::pair<size_t, size_t>> completeGroups;   // 已完整读取的小文件分组在partial中的区间
+        for (size_t i = 0; i < partial.size() && !m_quit;)
+        {
+            size_t j = i + 1;
+            while (j < partial.size() && partial[j].file->size == partial[i].file->size && partial[j].hash == partial[i].hash)
+            {
+                ++j;
+            }
+            if (j - i > 1)
+            {
+                if (partial[i].complete)
+                {
+                    completeGroups.push_back(std::make_pair(i, j));
+                }
+                else
+                {
+                    for (size_t k = i; k < j; ++k)
+                    {
+                        partial[k].group = group;
+                        remaining.push_back(partial[k]);
+                    }
+                    ++group;
+                }
+            }
+            i = j;
+        }
+        parallelFor(completeGroups.size(),
+                    [&](size_t index, char* buffer) { emitGroups(partial, completeGroups[index].first, completeGroups[index].second, buffer); });
+    }
+
+    // 3、完整哈希；每组记录剩余未计算的文件数，最后完成该组的线程负责输出结果
+    std::vector<size_t> groupBegin;
+    for (size_t i = 0; i < remaining.size(); ++i)
+    {
+        if (i == 0 || remaining[i].group != remaining[i - 1].group)
+        {
+            groupBegin.push_back(i);
+        }
+    }
+    groupBegin.push_back(remaining.size());
+    const size_t groupCount = groupBegin.size() - 1;
+    std::unique_ptr<std::atomic<uint32_t>[]> pending(new std::atomic<uint32_t>[groupCount]);
+    for (size_t g = 0; g < groupCount; ++g)
+    {
+        pending[g] = uint32_t(groupBegin[g + 1] - groupBegin[g]);
+    }
+
+    parallelFor(remaining.size(),
+                [&](size_t index, char* buffer)
+                {
+                    Candidate& candidate = remaining[index];
+                    candidate.valid = hashFull(candidate, buffer);
+                    ++m_filesHashed;
+                    const uint32_t group = candidate.group;
+                    if (pending[group].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    {
+                        emitGroups(remaining, groupBegin[group], groupBegin[group + 1], buffer);
+                    }
+                });
+
+    if (!m_quit && m_finishedCallback)
+    {
+        m_finishedCallback();
+    }
+}
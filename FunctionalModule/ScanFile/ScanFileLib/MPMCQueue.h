@@ -0,0 +1,313 @@
+﻿#ifndef MPMCQUEUE_H
+#define MPMCQUEUE_H
+
+/**
+ * 有界多生产者多消费者无锁队列（Dmitry Vyukov的环形缓冲区算法）。
+ *
+ * 每个槽位带一个序号：序号等于写位置时可写，等于读位置+1时可读，生产者和消费者各自只用一次CAS抢占位置，
+ * 不同位置的读写互不影响；读写位置分别放在独立的缓存行，避免伪共享。
+ * tryPush/tryPop不阻塞；push/pop在队列满/空时先短暂自旋，再在一个32位计数上休眠（Linux为futex，
+ * windows为WaitOnAddress），只有存在等待线程时才需要系统调用唤醒。
+ * 支持只能移动的元素类型；元素的移动构造不应抛出异常。
+ */
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "Synchronization.lib")
+#endif
+#endif
+
+namespace mpmc {
+
+const size_t CACHE_LINE = 64;
+
+/**
+ * @brief word的值等于expected时休眠，直到被wake()唤醒（可能虚假唤醒）
+ */
+inline void wait(std::atomic<uint32_t>& word, uint32_t expected)
+{
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#elif defined(_WIN32)
+    WaitOnAddress(&word, &expected, sizeof(expected), INFINITE);
+#else
+    // 没有futex的平台让出CPU后重新检查
+    if (word.load(std::memory_order_acquire) == expected)
+    {
+        std::this_thread::yield();
+    }
+#endif
+}
+
+inline void wake(std::atomic<uint32_t>& word, bool all)
+{
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, all ? INT32_MAX : 1, nullptr, nullptr, 0);
+#elif defined(_WIN32)
+    if (all)
+        WakeByAddressAll(&word);
+    else
+        WakeByAddressSingle(&word);
+#else
+    (void)word;
+    (void)all;
+#endif
+}
+
+/**
+ * @brief 一个等待点：等待方先登记再检查条件，通知方改变条件后只在有等待方时才系统调用
+ */
+class WaitPoint
+{
+public:
+    WaitPoint()
+        : m_sequence(0)
+        , m_waiters(0)
+    {
+    }
+
+    // 等待ready()返回true
+    template<class Ready>
+    void waitUntil(Ready ready)
+    {
+        while (true)
+        {
+            m_waiters.fetch_add(1, std::memory_order_seq_cst);
+            const uint32_t sequence = m_sequence.load(std::memory_order_seq_cst);
+            if (ready())
+            {
+                m_waiters.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+            mpmc::wait(m_sequence, sequence);
+            m_waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // 条件可能已经满足，唤醒等待方
+    void notify(bool all)
+    {
+        // 与等待方登记形成先后关系，保证不会丢失唤醒（ThreadSanitizer不支持fence，改用读-改-写）
+#if defined(__SANITIZE_THREAD__)
+        if (m_waiters.fetch_add(0, std::memory_order_seq_cst) == 0)
+#else
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_waiters.load(std::memory_order_relaxed) == 0)
+#endif
+        {
+            return;
+        }
+        m_sequence.fetch_add(1, std::memory_order_seq_cst);
+        mpmc::wake(m_sequence, all);
+    }
+
+private:
+    std::atomic<uint32_t> m_sequence;   // 每次通知加1，休眠前读取的值与当前值不同说明错过了通知，不会休眠
+    std::atomic<uint32_t> m_waiters;
+};
+
+}   // namespace mpmc
+
+template<typename T>
+class MPMCQueue
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param capacity 队列容量，向上取整为2的幂（至少为2）
+     */
+    explicit MPMCQueue(size_t capacity)
+        : m_enqueuePos(0)
+        , m_dequeuePos(0)
+    {
+        size_t size = 2;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        m_mask = size - 1;
+        m_buffer = static_cast<Cell*>(::operator new(sizeof(Cell) * size));
+        for (size_t i = 0; i < size; ++i)
+        {
+            new (&m_buffer[i].sequence) std::atomic<size_t>(i);
+        }
+    }
+
+    ~MPMCQueue()
+    {
+        // 析构剩余元素（此时不应再有并发访问）
+        const size_t end = m_enqueuePos.load(std::memory_order_relaxed);
+        for (size_t pos = m_dequeuePos.load(std::memory_order_relaxed); pos != end; ++pos)
+        {
+            m_buffer[pos & m_mask].data()->~T();
+        }
+        ::operator delete(m_buffer);
+    }
+
+    MPMCQueue(const MPMCQueue&) = delete;
+    MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+    // 在队尾直接构造元素，队列满时返回false
+    template<class... Args>
+    bool tryEmplace(Args&&... args)
+    {
+        Cell* cell;
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            cell = &m_buffer[pos & m_mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+            if (diff == 0)
+            {
+                // 槽位可写，抢占写位置
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;   // 槽位中的元素还没有被读取，队列已满
+            }
+            else
+            {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);   // 其它生产者已抢占该位置
+            }
+        }
+        new (cell->data()) T(std::forward<Args>(args)...);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        m_notEmpty.notify(false);
+        return true;
+    }
+
+    bool tryPush(const T& value) { return tryEmplace(value); }
+    bool tryPush(T&& value) { return tryEmplace(std::move(value)); }
+
+    // 取出队头元素，队列空时返回false
+    bool tryPop(T& value)
+    {
+        Cell* cell;
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            cell = &m_buffer[pos & m_mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(sequence) - intptr_t(pos + 1);
+            if (diff == 0)
+            {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;   // 槽位还没有写入，队列为空
+            }
+            else
+            {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        T* data = cell->data();
+        value = std::move(*data);
+        data->~T();
+        cell->sequence.store(pos + m_mask + 1, std::memory_order_release);   // 下一轮写位置
+        m_notFull.notify(false);
+        return true;
+    }
+
+    // 入队，队列满时阻塞
+    void push(const T& value)
+    {
+        T copy(value);
+        push(std::move(copy));
+    }
+
+    void push(T&& value)
+    {
+        if (spin([&]() { return tryPush(std::move(value)); }))
+        {
+            return;
+        }
+        m_notFull.waitUntil([&]() { return tryPush(std::move(value)); });
+    }
+
+    // 出队，队列空时阻塞
+    void pop(T& value)
+    {
+        if (spin([&]() { return tryPop(value); }))
+        {
+            return;
+        }
+        m_notEmpty.waitUntil([&]() { return tryPop(value); });
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+    // 元素数量（并发修改时只是近似值）
+    size_t size() const
+    {
+        const size_t enqueuePos = m_enqueuePos.load(std::memory_order_relaxed);
+        const size_t dequeuePos = m_dequeuePos.load(std::memory_order_relaxed);
+        return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+        T* data() { return reinterpret_cast<T*>(&storage); }
+    };
+
+    // 休眠前短暂自旋，队列很快可用时避免系统调用
+    template<class Try>
+    static bool spin(Try tryOnce)
+    {
+        for (int i = 0; i < 64; ++i)
+        {
+            if (tryOnce())
+            {
+                return true;
+            }
+            if (i >= 32)
+            {
+                std::this_thread::yield();
+            }
+        }
+        return false;
+    }
+
+private:
+    char m_pad0[mpmc::CACHE_LINE];
+    Cell* m_buffer;
+    size_t m_mask;
+    char m_pad1[mpmc::CACHE_LINE - sizeof(Cell*) - sizeof(size_t)];
+    std::atomic<size_t> m_enqueuePos;   // 写位置
+    char m_pad2[mpmc::CACHE_LINE - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> m_dequeuePos;   // 读位置
+    char m_pad3[mpmc::CACHE_LINE - sizeof(std::atomic<size_t>)];
+    mpmc::WaitPoint m_notEmpty;         // 等待入队的消费者
+    char m_pad4[mpmc::CACHE_LINE - sizeof(mpmc::WaitPoint)];
+    mpmc::WaitPoint m_notFull;          // 等待出队的生产者
+    char m_pad5[mpmc::CACHE_LINE - sizeof(mpmc::WaitPoint)];
+};
+
+#endif   // MPMCQUEUE_H
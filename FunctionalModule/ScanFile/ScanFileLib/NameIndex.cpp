@@ -0,0 +1,588 @@
+﻿#include "NameIndex.h"
+
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace {
+
+const char INDEX_MAGIC[8] = {'Q', 'M', 'N', 'A', 'M', 'E', '0', '1'};
+const uint32_t INDEX_VERSION = 1;
+
+const uint32_t BUCKET_BITS = 20;                    // trigram散列到2^20个倒排表，冲突只会多出候选，校验时过滤
+const uint32_t BUCKET_COUNT = 1u << BUCKET_BITS;
+const size_t MAX_BUILD_THREADS = 8;                 // 建立索引时每个线程需要一份计数表（4MB）
+const size_t PARALLEL_MIN_ENTRIES = 1u << 16;       // 文件数少于该值时单线程处理
+
+struct DiskHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t entryCount;
+    uint64_t nameBytes;
+    uint64_t dirCount;
+    uint64_t dirBytes;
+    uint64_t bucketCount;
+    uint64_t postingCount;
+};
+
+/**
+ * @brief 文件长度，失败返回-1
+ */
+int64_t fileSize(FILE* fp)
+{
+#ifdef _WIN32
+    if (_fseeki64(fp, 0, SEEK_END) != 0)
+    {
+        return -1;
+    }
+    const int64_t size = _ftelli64(fp);
+    return _fseeki64(fp, 0, SEEK_SET) == 0 ? size : -1;
+#else
+    if (fseeko(fp, 0, SEEK_END) != 0)
+    {
+        return -1;
+    }
+    const int64_t size = ftello(fp);
+    return fseeko(fp, 0, SEEK_SET) == 0 ? size : -1;
+#endif
+}
+
+/**
+ * @brief 文件头中的各项数量与文件长度一致，并且不超过32位下标的范围，分配内存前检查，避免损坏的文件导致分配失败
+ */
+bool checkHeader(const DiskHeader& header, int64_t size)
+{
+    if (memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) != 0 || header.version != INDEX_VERSION)
+    {
+        return false;
+    }
+    if (header.bucketCount != BUCKET_COUNT + 1 && !(header.bucketCount == 0 && header.entryCount == 0))
+    {
+        return false;   // 有文件时必须有完整的倒排表起始位置
+    }
+    const uint64_t limit = UINT32_MAX;
+    if (size < int64_t(sizeof(DiskHeader)) || header.entryCount > limit || header.nameBytes > limit || header.dirCount > limit
+        || header.dirBytes > limit || header.postingCount > limit)
+    {
+        return false;
+    }
+    const uint64_t expected = sizeof(DiskHeader) + header.entryCount * sizeof(NameEntry) + header.nameBytes + header.dirBytes
+                              + (header.dirCount + header.bucketCount + header.postingCount) * sizeof(uint32_t);
+    return expected == uint64_t(size);
+}
+
+inline unsigned char fold(unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+inline uint32_t trigramBucket(const char* p)
+{
+    const uint32_t key = (uint32_t(fold(p[0])) << 16) | (uint32_t(fold(p[1])) << 8) | fold(p[2]);
+    return (key * 2654435761u) >> (32 - BUCKET_BITS);
+}
+
+/**
+ * @brief 获取字符串中所有trigram所在的倒排表（去重）
+ */
+void trigramBuckets(const char* str, size_t length, std::vector<uint32_t>& buckets)
+{
+    buckets.clear();
+    for (size_t i = 0; i + 3 <= length; ++i)
+    {
+        buckets.push_back(trigramBucket(str + i));
+    }
+    std::sort(buckets.begin(), buckets.end());
+    buckets.erase(std::unique(buckets.begin(), buckets.end()), buckets.end());
+}
+
+/**
+ * @brief 不区分大小写的子串查找，pattern需要已转为小写
+ */
+bool containsFolded(const char* str, size_t length, const std::string& pattern)
+{
+    const size_t m = pattern.size();
+    if (m > length)
+    {
+        return false;
+    }
+    for (size_t i = 0; i + m <= length; ++i)
+    {
+        size_t j = 0;
+        while (j < m && fold(str[i + j]) == static_cast<unsigned char>(pattern[j]))
+        {
+            ++j;
+        }
+        if (j == m)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 不区分大小写的通配符匹配，*匹配任意个字符，?匹配一个字符，pattern需要已转为小写
+ */
+bool globFolded(const char* str, size_t length, const std::string& pattern)
+{
+    size_t s = 0;
+    size_t p = 0;
+    size_t starPattern = std::string::npos;   // 最近一个*的位置，匹配失败时从这里回溯
+    size_t starString = 0;
+    while (s < length)
+    {
+        if (p < pattern.size() && (pattern[p] == '?' || static_cast<unsigned char>(pattern[p]) == fold(str[s])))
+        {
+            ++s;
+            ++p;
+        }
+        else if (p < pattern.size() && pattern[p] == '*')
+        {
+            starPattern = p++;
+            starString = s;
+        }
+        else if (starPattern != std::string::npos)
+        {
+            p = starPattern + 1;
+            s = ++starString;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*')
+    {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+/**
+ * @brief 将[0, count)分成若干段在共用线程池中执行，只有一段时在当前线程执行
+ */
+void runSegments(size_t count, size_t segments, const std::function<void(size_t, size_t, size_t)>& fun)
+{
+    const size_t chunk = (count + segments - 1) / segments;
+    if (segments <= 1)
+    {
+        fun(0, 0, count);
+        return;
+    }
+    TaskGroup group(ThreadPool::shared());
+    for (size_t s = 0; s < segments; ++s)
+    {
+        const size_t begin = std::min(count, s * chunk);
+        const size_t end = std::min(count, begin + chunk);
+        group.run(std::bind(fun, s, begin, end));
+    }
+    group.wait();
+}
+
+}   // namespace
+
+/**
+ * @brief 根据扫描快照建立索引
+ *
+ * 1、将所有文件名复制到连续的字符串区；
+ * 2、按文件下标分段，多线程统计每段每个trigram出现的文件数；
+ * 3、按（trigram，段）顺序累加得到每段的写入位置；
+ * 4、多线程将文件下标写入倒排表。
+ *
+ * @param snapshot 扫描快照
+ * @param threads  线程数，为0时等于CPU核心数
+ */
+void NameIndex::build(const ScanSnapshot& snapshot, size_t threads)
+{
+    clear();
+    size_t fileCount = 0;
+    size_t nameBytes = 0;
+    for (const DirRecord& dir : snapshot.dirs())
+    {
+        if (!dir.removed)
+        {
+            fileCount += dir.files.size();
+            nameBytes += dir.names.size();
+        }
+    }
+    m_entries.reserve(fileCount);
+    m_names.reserve(nameBytes);
+
+    for (const DirRecord& dir : snapshot.dirs())
+    {
+        if (dir.removed || dir.files.empty())
+        {
+            continue;
+        }
+        const uint32_t dirIndex = uint32_t(m_dirOffsets.size());
+        m_dirOffsets.push_back(uint32_t(m_dirNames.size()));
+        m_dirNames += dir.path;
+        for (const FileRecord& file : dir.files)
+        {
+            NameEntry entry;
+            entry.dir = dirIndex;
+            entry.nameOffset = uint32_t(m_names.size());
+            entry.nameLength = file.nameLength;
+            entry.reserved = 0;
+            entry.size = file.size;
+            m_entries.push_back(entry);
+            m_names.append(dir.names, file.nameOffset, file.nameLength);
+        }
+    }
+    m_dirOffsets.push_back(uint32_t(m_dirNames.size()));
+
+    const size_t count = m_entries.size();
+    if (threads == 0)
+    {
+        threads = ThreadPool::shared().size();
+    }
+    const size_t segments = count < PARALLEL_MIN_ENTRIES ? 1 : std::min(threads, MAX_BUILD_THREADS);
+
+    // 每段一份计数表，统计完成后原地改为该段在每个倒排表中的写入位置
+    std::vector<uint32_t> cursors(segments * BUCKET_COUNT, 0);
+    runSegments(count, segments,
+                [this, &cursors](size_t segment, size_t begin, size_t end)
+                {
+                    uint32_t* counts = cursors.data() + segment * BUCKET_COUNT;
+                    std::vector<uint32_t> buckets;
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        trigramBuckets(m_names.data() + m_entries[i].nameOffset, m_entries[i].nameLength, buckets);
+                        for (uint32_t bucket : buckets)
+                        {
+                            ++counts[bucket];
+                        }
+                    }
+                });
+
+    m_buckets.resize(BUCKET_COUNT + 1);
+    uint32_t total = 0;
+    for (uint32_t bucket = 0; bucket < BUCKET_COUNT; ++bucket)
+    {
+        m_buckets[bucket] = total;
+        for (size_t s = 0; s < segments; ++s)
+        {
+            const uint32_t n = cursors[s * BUCKET_COUNT + bucket];
+            cursors[s * BUCKET_COUNT + bucket] = total;
+            total += n;
+        }
+    }
+    m_buckets[BUCKET_COUNT] = total;
+    m_postings.resize(total);
+
+    runSegments(count, segments,
+                [this, &cursors](size_t segment, size_t begin, size_t end)
+                {
+                    uint32_t* positions = cursors.data() + segment * BUCKET_COUNT;
+                    std::vector<uint32_t> buckets;
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        trigramBuckets(m_names.data() + m_entries[i].nameOffset, m_entries[i].nameLength, buckets);
+                        for (uint32_t bucket : buckets)
+                        {
+                            m_postings[positions[bucket]++] = uint32_t(i);
+                        }
+                    }
+                });
+}
+
+void NameIndex::clear()
+{
+    m_entries.clear();
+    m_names.clear();
+    m_dirNames.clear();
+    m_dirOffsets.clear();
+    m_buckets.clear();
+    m_postings.clear();
+}
+
+std::vector<uint32_t> NameIndex::search(const std::string& pattern, size_t limit) const
+{
+    std::vector<uint32_t> result;
+    if (m_entries.empty())
+    {
+        return result;
+    }
+    std::string folded(pattern);
+    for (char& c : folded)
+    {
+        c = char(fold(static_cast<unsigned char>(c)));
+    }
+    const bool glob = folded.find_first_of("*?") != std::string::npos;
+
+    // 通配符查询只使用不含通配符的片段中的trigram
+    std::vector<uint32_t> buckets;
+    std::vector<uint32_t> segment;
+    size_t start = 0;
+    while (start < folded.size())
+    {
+        size_t end = glob ? folded.find_first_of("*?", start) : std::string::npos;
+        if (end == std::string::npos)
+        {
+            end = folded.size();
+        }
+        trigramBuckets(folded.data() + start, end - start, segment);
+        buckets.insert(buckets.end(), segment.begin(), segment.end());
+        start = end + 1;
+    }
+    if (buckets.empty())
+    {
+        scan(folded, glob, limit, result);
+        return result;
+    }
+    std::sort(buckets.begin(), buckets.end());
+    buckets.erase(std::unique(buckets.begin(), buckets.end()), buckets.end());
+
+    // 从最短的倒排表开始，逐个在其它倒排表中二分查找，所有倒排表都包含的文件才需要校验
+    struct List
+    {
+        const uint32_t* begin;
+        const uint32_t* end;
+    };
+    std::vector<List> lists;
+    for (uint32_t bucket : buckets)
+    {
+        lists.push_back({m_postings.data() + m_buckets[bucket], m_postings.data() + m_buckets[bucket + 1]});
+    }
+    std::sort(lists.begin(), lists.end(), [](const List& a, const List& b) { return (a.end - a.begin) < (b.end - b.begin); });
+
+    for (const uint32_t* it = lists[0].begin; it != lists[0].end; ++it)
+    {
+        const uint32_t id = *it;
+        bool found = true;
+        for (size_t i = 1; i < lists.size(); ++i)
+        {
+            lists[i].begin = std::lower_bound(lists[i].begin, lists[i].end, id);
+            if (lists[i].begin == lists[i].end)
+            {
+                return result;   // 后面的文件下标更大，不可能再匹配
+            }
+            if (*lists[i].begin != id)
+            {
+                found = false;
+                break;
+            }
+        }
+        if (found && match(m_entries[id], folded, glob))
+        {
+            result.push_back(id);
+            if (limit != 0 && result.size() >= limit)
+            {
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+bool NameIndex::match(const NameEntry& entry, const std::string& pattern, bool glob) const
+{
+    const char* name = m_names.data() + entry.nameOffset;
+    return glob ? globFolded(name, entry.nameLength, pattern) : containsFolded(name, entry.nameLength, pattern);
+}
+
+/**
+ * @brief 查询串没有可用的trigram（少于3个字符）时顺序匹配所有文件
+ *
+ * 限制了结果数时在当前线程从头匹配，找到足够的结果即可返回（短查询通常很快满足）；
+ * 不限制结果数并且文件较多时才分段在共用线程池中匹配。
+ */
+void NameIndex::scan(const std::string& pattern, bool glob, size_t limit, std::vector<uint32_t>& result) const
+{
+    const size_t count = m_entries.size();
+    size_t segments = 1;
+    if (limit == 0 && count >= PARALLEL_MIN_ENTRIES)
+    {
+        segments = ThreadPool::shared().size();
+    }
+    std::vector<std::vector<uint32_t>> parts(segments);
+    runSegments(count, segments,
+                [&](size_t segment, size_t begin, size_t end)
+                {
+                    std::vector<uint32_t>& part = parts[segment];
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        if (pattern.empty() || match(m_entries[i], pattern, glob))
+                        {
+                            part.push_back(uint32_t(i));
+                            if (limit != 0 && part.size() >= limit)
+                            {
+                                break;
+                            }
+                        }
+                    }
+                });
+
+    for (const std::vector<uint32_t>& part : parts)
+    {
+        result.insert(result.end(), part.begin(), part.end());
+    }
+    if (limit != 0 && result.size() > limit)
+    {
+        result.resize(limit);
+    }
+}
+
+/**
+ * @brief 检查读取的索引是否自洽：文件名、目录路径在字符串区内，目录下标有效，倒排表起始位置递增，倒排表中的文件下标有效且递增
+ */
+bool NameIndex::validate() const
+{
+    if (!m_entries.empty() && m_dirOffsets.size() < 2)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < m_dirOffsets.size(); ++i)
+    {
+        if (m_dirOffsets[i] > m_dirNames.size() || (i > 0 && m_dirOffsets[i] < m_dirOffsets[i - 1]))
+        {
+            return false;
+        }
+    }
+    for (const NameEntry& entry : m_entries)
+    {
+        if (uint64_t(entry.dir) + 1 >= m_dirOffsets.size() || uint64_t(entry.nameOffset) + entry.nameLength > m_names.size())
+        {
+            return false;
+        }
+    }
+    if (m_buckets.empty())
+    {
+        return m_postings.empty();
+    }
+    if (m_buckets.front() != 0 || m_buckets.back() != m_postings.size())
+    {
+        return false;
+    }
+    for (size_t bucket = 0; bucket + 1 < m_buckets.size(); ++bucket)
+    {
+        const uint32_t begin = m_buckets[bucket];
+        const uint32_t end = m_buckets[bucket + 1];
+        if (end < begin)
+        {
+            return false;
+        }
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            if (m_postings[i] >= m_entries.size() || (i > begin && m_postings[i] <= m_postings[i - 1]))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+std::string NameIndex::name(uint32_t index) const
+{
+    const NameEntry& entry = m_entries[index];
+    return m_names.substr(entry.nameOffset, entry.nameLength);
+}
+
+std::string NameIndex::dir(uint32_t index) const
+{
+    const uint32_t dir = m_entries[index].dir;
+    return m_dirNames.substr(m_dirOffsets[dir], m_dirOffsets[dir + 1] - m_dirOffsets[dir]);
+}
+
+std::string NameIndex::path(uint32_t index) const
+{
+    std::string result = dir(index);
+    if (result.empty() || result.back() != '/')
+    {
+        result += '/';
+    }
+    return result + name(index);
+}
+
+/**
+ * @brief 保存索引文件
+ *
+ * 文件格式：DiskHeader | NameEntry[] | 文件名区 | 目录路径区 | 目录偏移[] | 倒排表起始位置[] | 倒排表[]
+ */
+bool NameIndex::save(const std::string& fileName) const
+{
+    DiskHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.version = INDEX_VERSION;
+    header.entryCount = m_entries.size();
+    header.nameBytes = m_names.size();
+    header.dirCount = m_dirOffsets.size();
+    header.dirBytes = m_dirNames.size();
+    header.bucketCount = m_buckets.size();
+    header.postingCount = m_postings.size();
+
+    std::string tempName = fileName + ".tmp";
+    FILE* fp = fopen(tempName.c_str(), "wb");
+    if (!fp)
+    {
+        return false;
+    }
+    auto write = [fp](const void* data, size_t size, size_t count) { return count == 0 || fwrite(data, size, count, fp) == count; };
+    bool ok = write(&header, sizeof(header), 1);
+    ok = ok && write(m_entries.data(), sizeof(NameEntry), m_entries.size());
+    ok = ok && write(m_names.data(), 1, m_names.size());
+    ok = ok && write(m_dirNames.data(), 1, m_dirNames.size());
+    ok = ok && write(m_dirOffsets.data(), sizeof(uint32_t), m_dirOffsets.size());
+    ok = ok && write(m_buckets.data(), sizeof(uint32_t), m_buckets.size());
+    ok = ok && write(m_postings.data(), sizeof(uint32_t), m_postings.size());
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok)
+    {
+        std::remove(tempName.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    return MoveFileExA(tempName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(tempName.c_str(), fileName.c_str()) == 0;
+#endif
+}
+
+/**
+ * @brief 读取索引文件，每个数组一次读取到内存中，无需重新建立倒排表
+ */
+bool NameIndex::load(const std::string& fileName)
+{
+    clear();
+    FILE* fp = fopen(fileName.c_str(), "rb");
+    if (!fp)
+    {
+        return false;
+    }
+    DiskHeader header;
+    const int64_t size = fileSize(fp);
+    bool ok = fread(&header, sizeof(header), 1, fp) == 1 && checkHeader(header, size);
+    if (ok)
+    {
+        m_entries.resize(header.entryCount);
+        m_names.resize(header.nameBytes);
+        m_dirNames.resize(header.dirBytes);
+        m_dirOffsets.resize(header.dirCount);
+        m_buckets.resize(header.bucketCount);
+        m_postings.resize(header.postingCount);
+        auto read = [fp](void* data, size_t size, size_t count) { return count == 0 || fread(data, size, count, fp) == count; };
+        ok = read(m_entries.data(), sizeof(NameEntry), m_entries.size());
+        ok = ok && read(&m_names[0], 1, m_names.size());
+        ok = ok && read(&m_dirNames[0], 1, m_dirNames.size());
+        ok = ok && read(m_dirOffsets.data(), sizeof(uint32_t), m_dirOffsets.size());
+        ok = ok && read(m_buckets.data(), sizeof(uint32_t), m_buckets.size());
+        ok = ok && read(m_postings.data(), sizeof(uint32_t), m_postings.size());
+        ok = ok && validate();
+    }
+    fclose(fp);
+    if (!ok)
+    {
+        clear();
+    }
+    return ok;
+}
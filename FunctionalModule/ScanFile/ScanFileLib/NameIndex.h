@@ -0,0 +1,65 @@
+﻿#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+/**
+ * 文件名索引，实现类似Everything的即时搜索，支持子串查询和通配符（* ?）查询，不区分大小写（ASCII）。
+ *
+ * 文件名连续存放在一个字符串区中，每个文件只保存所属目录下标、文件名偏移和大小；
+ * 对文件名的每个三字符组（trigram）建立倒排表，查询时取查询串中所有trigram的倒排表求交集得到候选文件，
+ * 再逐个校验，查询耗时只与候选数量有关，与文件总数无关；少于3个字符的查询退化为顺序匹配。
+ * 倒排表按文件下标分段多线程建立：先统计每段每个trigram的数量，再按（trigram，段）顺序计算写入位置，
+ * 各线程写入互不重叠的区间，无需加锁，且每个倒排表天然有序。
+ */
+#include "ScanFile.h"
+#include "ScanSnapshot.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct NameEntry
+{
+    uint32_t dir;          // 所属目录下标
+    uint32_t nameOffset;   // 文件名在名称区中的偏移
+    uint32_t nameLength;
+    uint32_t reserved;
+    uint64_t size;
+};
+
+class SCANFILE_API NameIndex
+{
+public:
+    void build(const ScanSnapshot& snapshot, size_t threads = 0);   // 根据扫描快照建立索引
+    bool load(const std::string& fileName);                         // 读取索引文件，文件损坏时返回false，需要重新建立
+    bool save(const std::string& fileName) const;                   // 保存索引文件（先写临时文件再替换）
+    void clear();
+
+    /**
+     * @brief 查询文件名
+     * @param pattern 查询串，包含*或?时按通配符匹配整个文件名，否则按子串匹配；为空时匹配所有文件
+     * @param limit   最多返回的结果数，为0时不限制
+     * @return        匹配的文件下标，从小到大排列
+     */
+    std::vector<uint32_t> search(const std::string& pattern, size_t limit = 0) const;
+
+    bool isEmpty() const { return m_entries.empty(); }
+    size_t size() const { return m_entries.size(); }
+    const NameEntry& entry(uint32_t index) const { return m_entries[index]; }
+    std::string name(uint32_t index) const;   // 文件名
+    std::string dir(uint32_t index) const;    // 所属目录
+    std::string path(uint32_t index) const;   // 完整路径
+
+private:
+    bool match(const NameEntry& entry, const std::string& pattern, bool glob) const;   // 校验候选文件
+    void scan(const std::string& pattern, bool glob, size_t limit, std::vector<uint32_t>& result) const;   // 顺序匹配所有文件
+    bool validate() const;   // 检查读取的索引中所有偏移、下标是否在范围内
+
+private:
+    std::vector<NameEntry> m_entries;
+    std::string m_names;                  // 文件名字符串区
+    std::string m_dirNames;               // 目录路径字符串区
+    std::vector<uint32_t> m_dirOffsets;   // 每个目录路径的偏移，最后一个元素为总长度
+    std::vector<uint32_t> m_buckets;      // 每个trigram倒排表的起始位置，最后一个元素为总数
+    std::vector<uint32_t> m_postings;     // 所有倒排表，每个表内文件下标从小到大
+};
+
+#endif   // NAMEINDEX_H
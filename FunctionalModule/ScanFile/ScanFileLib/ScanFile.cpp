@@ -0,0 +1,816 @@
+﻿#include "ScanFile.h"
+
+#include "DirTree.h"
+#include "NameIndex.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+/**
+ * @brief 拼接路径，避免根目录"/"拼接出"//"
+ */
+std::string joinPath(const std::string& dir, const std::string& name)
+{
+    if (!dir.empty() && dir.back() == '/')
+    {
+        return dir + name;
+    }
+    return dir + "/" + name;
+}
+
+#ifdef _WIN32
+/**
+ * @brief        LPCWSTR转string
+ * @param wstr
+ * @return
+ */
+std::string LPCWSTRToString(const LPCWSTR wstr)
+{
+    int len = WideCharToMultiByte(CP_UTF8, 0, wstr, -1, nullptr, 0, nullptr, nullptr);
+    char* str = new char[len];
+    WideCharToMultiByte(CP_UTF8, 0, wstr, -1, str, len, nullptr, nullptr);
+    std::string result(str);
+    delete[] str;
+    return result;
+}
+
+/**
+ * @brief 将 std::string 类型的字符串转换为 std::wstring 类型的宽字符字符串
+ *
+ * 将输入的 std::string 类型的字符串转换为 UTF-16 编码的 std::wstring 类型的宽字符字符串。
+ *
+ * @param str 要转换的 std::string 类型的字符串
+ * @return 转换后的 std::wstring 类型的宽字符字符串
+ */
+std::wstring stringToLPCWSTR(const std::string& str)
+{
+    if (str.empty()) return std::wstring();
+
+    int len = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, nullptr, 0); // 获取宽字符数组的长度
+    std::wstring wstrTo(len, 0); // 创建宽字符数组
+    MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), &wstrTo[0], len); // 转换字符串到宽字符数组
+    return wstrTo;
+}
+
+int64_t fileTimeToInt(const FILETIME& time)
+{
+    ULARGE_INTEGER value;
+    value.LowPart = time.dwLowDateTime;
+    value.HighPart = time.dwHighDateTime;
+    return int64_t(value.QuadPart);
+}
+#endif
+
+/**
+ * @brief 获取目录的修改时间和inode，用于判断目录内容是否发生变化
+ * @return 获取成功返回true
+ */
+bool statDir(const std::string& path, int64_t& mtime, uint64_t& inode)
+{
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExW(stringToLPCWSTR(path).c_str(), GetFileExInfoStandard, &data))
+    {
+        return false;
+    }
+    mtime = fileTimeToInt(data.ftLastWriteTime);
+    inode = 0;
+    return true;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+    {
+        return false;
+    }
+    mtime = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    inode = st.st_ino;
+    return true;
+#endif
+}
+
+/**
+ * @brief 获取文件信息（不跟随符号链接）
+ * @return 是普通文件且获取成功返回true
+ */
+bool statFile(const std::string& path, FileRecord& record)
+{
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExW(stringToLPCWSTR(path).c_str(), GetFileExInfoStandard, &data) || (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        return false;
+    }
+    ULARGE_INTEGER fileSize;
+    fileSize.LowPart = data.nFileSizeLow;
+    fileSize.HighPart = data.nFileSizeHigh;
+    record.size = fileSize.QuadPart;
+    record.mtime = fileTimeToInt(data.ftLastWriteTime);
+    record.inode = 0;
+    return true;
+#else
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0 || S_ISDIR(st.st_mode))
+    {
+        return false;
+    }
+    record.size = uint64_t(st.st_size);
+    record.mtime = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    record.inode = st.st_ino;
+    return true;
+#endif
+}
+
+/**
+ * @brief 正在执行的扫描任务计数，离开作用域时减1
+ */
+class ActiveGuard
+{
+public:
+    explicit ActiveGuard(std::atomic<int>& count)
+        : m_count(count)
+    {
+        ++m_count;
+    }
+    ~ActiveGuard() { --m_count; }
+
+private:
+    std::atomic<int>& m_count;
+};
+
+void appendFile(DirRecord& dir, const std::string& name, const FileRecord& info)
+{
+    FileRecord record = info;
+    record.nameOffset = uint32_t(dir.names.size());
+    record.nameLength = uint32_t(name.size());
+    dir.names += name;
+    dir.files.push_back(record);
+}
+
+}   // namespace
+
+ScanFile::ScanFile()
+    : m_quit(false)
+    , m_scanning(false)
+    , m_pending(0)
+    , m_generation(0)
+    , m_active(0)
+    , m_totalSize(0)
+{
+    m_threadPool = new ThreadPool();
+}
+
+ScanFile::~ScanFile()
+{
+    m_quit = true;
+    m_watcher.stop();
+    if (m_threadPool)
+    {
+        m_threadPool->quit();
+        delete m_threadPool;
+        m_threadPool = nullptr;
+    }
+    if (m_watchEnabled)
+    {
+        saveSnapshot();   // 监听期间的变化在退出时写回快照
+    }
+
+    // 清理回调函数指针
+    m_callback = nullptr;
+}
+
+/**
+ * @brief 设置回调函数
+ *
+ * 将回调函数赋值给成员变量 m_callback，以便在需要时调用。
+ *
+ * @param callback 回调函数，类型为 MessageCall
+ */
+void ScanFile::setCallback(MessageCall callback)
+{
+    m_callback = callback;
+}
+
+/**
+ * @brief 设置扫描完成回调函数，在线程池线程中调用
+ * @param callback
+ */
+void ScanFile::setFinishedCallback(FinishedCall callback)
+{
+    m_finishedCallback = callback;
+}
+
+/**
+ * @brief 设置快照文件
+ *
+ * 设置后每次扫描都会先读取上一次的快照，修改时间和inode都没有变化的目录直接复用快照中的文件列表，
+ * 只对子目录做一次stat，不再遍历目录内容；扫描完成后将结果写回快照。
+ * 注意：修改文件内容不会改变目录的修改时间，这类变化依赖setWatchEnabled开启的目录监听来更新。
+ *
+ * @param fileName 快照文件路径，为空时关闭快照功能
+ */
+void ScanFile::setSnapshotFile(const std::string& fileName)
+{
+    m_snapshotFile = fileName;
+}
+
+/**
+ * @brief 是否监听目录变化（目前只支持Linux inotify），在下一次scan()开始时启动
+ *
+ * 每个目录在遍历之前添加监听；扫描期间发生变化的目录在扫描完成后重新遍历，
+ * 事件队列溢出时重新遍历所有目录。
+ * @param enabled
+ */
+void ScanFile::setWatchEnabled(bool enabled)
+{
+    m_watchEnabled = enabled;
+    if (!enabled)
+    {
+        m_watcher.stop();
+    }
+}
+
+/**
+ * @brief 扫描文件
+ *
+ * 根据提供的文件路径调用回调函数，传递文件路径和文件大小作为参数。
+ * 上一次扫描未完成时先停止，等待正在执行的任务结束后再重置扫描状态，因此不能在回调函数中调用。
+ *
+ * @param root 要扫描的文件路径
+ */
+void ScanFile::scan(const std::string& root)
+{
+    if (!m_callback)
+        return;   // 如果回调函数未设置，则直接返回
+
+    stop();
+    const unsigned generation = ++m_generation;   // 先更新代数再读取m_active，之后开始执行的旧任务都会直接返回
+    while (m_active != 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    const std::string path = ScanSnapshot::normalizePath(root);   // 快照中的路径不带末尾的'/'，根目录除外
+    m_quit = false;
+    m_scanning = true;
+    m_totalSize = 0;
+    m_pending = 1;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_dirty.clear();
+        m_overflowed = false;
+    }
+    if (m_watchEnabled)
+    {
+        // 扫描开始前启动监听，每个目录在遍历之前添加watch，遍历之后的变化都会产生事件
+        m_watcher.start(std::bind(&ScanFile::onWatchEvent, this, std::placeholders::_1));
+    }
+    m_threadPool->post(
+        [this, path, generation]()
+        {
+            ActiveGuard active(m_active);
+            if (generation != m_generation)
+            {
+                return;
+            }
+            {
+                // 快照在线程池中读取，避免大快照阻塞调用线程
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_previous.clear();
+                if (!m_snapshotFile.empty() && m_previous.load(m_snapshotFile) && m_previous.root() != path)
+                {
+                    m_previous.clear();   // 快照不是同一个根目录，按首次扫描处理
+                }
+                m_snapshot.clear();
+                m_snapshot.setRoot(path);
+            }
+            scanPath(path, generation);
+        });
+}
+
+/**
+ * @brief 遍历目录，获取目录下所有文件的信息和子目录
+ * @param path    目录路径
+ * @param dir     保存文件信息
+ * @param subdirs 保存子目录路径
+ */
+void ScanFile::listPath(const std::string& path, DirRecord& dir, std::vector<std::string>& subdirs)
+{
+#ifdef _WIN32
+    std::string searchPath = path + "/*";   // 构建搜索路径，包括子目录的通配符
+    WIN32_FIND_DATAW findFileData;          // 用于存储文件信息的结构体
+    std::wstring wstr = stringToLPCWSTR(searchPath); // 将路径转换为宽字符串形式，以便与WIN32 API兼容
+    HANDLE hFind = FindFirstFileW(wstr.c_str(), &findFileData);   // 开始搜索文件
+
+    if (hFind == INVALID_HANDLE_VALUE)   // 如果查找失败，则退出函数
+    {
+        std::cerr << "FindFirstFile failed (" << GetLastError() << ")" << searchPath.c_str() << std::endl;
+        return;
+    }
+
+    do
+    {
+        std::string name = LPCWSTRToString(findFileData.cFileName);
+        // 跳过当前目录(.)和上级目录(..)
+        if ((strcmp(name.c_str(), ".") != 0) && (strcmp(name.c_str(), "..") != 0))
+        {
+            // dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY 判断是否为目录，此处用的是WIN32 API的标志位。
+            if (findFileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            {
+                subdirs.push_back(joinPath(path, name));
+            }
+            else
+            {
+                // 计算文件大小
+                ULARGE_INTEGER fileSize;
+                fileSize.LowPart = findFileData.nFileSizeLow;
+                fileSize.HighPart = findFileData.nFileSizeHigh;
+
+                FileRecord record;
+                record.size = fileSize.QuadPart;
+                record.mtime = fileTimeToInt(findFileData.ftLastWriteTime);
+                record.inode = 0;
+                appendFile(dir, name, record);
+            }
+        }
+
+    } while (FindNextFileW(hFind, &findFileData));   // 如果有下一个文件，则继续循环
+
+    // 检查FindNextFile是否失败
+    if (GetLastError() != ERROR_NO_MORE_FILES)
+    {
+        std::cerr << "FindNextFile failed (" << GetLastError() << ")" << std::endl;
+    }
+
+    // 关闭查找句柄
+    FindClose(hFind);
+#else
+    DIR* handle = opendir(path.c_str());
+    if (!handle)
+    {
+        std::cerr << "opendir failed (" << errno << ")" << path << std::endl;
+        return;
+    }
+
+    int fd = dirfd(handle);
+    struct dirent* entry;
+    while ((entry = readdir(handle)) != nullptr)
+    {
+        const char* name = entry->d_name;
+        // 跳过当前目录(.)和上级目录(..)
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+        {
+            continue;
+        }
+
+        if (entry->d_type == DT_DIR)
+        {
+            subdirs.push_back(joinPath(path, name));
+            continue;
+        }
+
+        // 相对目录描述符stat，避免内核重复解析完整路径
+        struct stat st;
+        if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+        {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode))   // d_type为DT_UNKNOWN的文件系统
+        {
+            subdirs.push_back(joinPath(path, name));
+            continue;
+        }
+        FileRecord record;
+        record.size = uint64_t(st.st_size);
+        record.mtime = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        record.inode = st.st_ino;
+        appendFile(dir, name, record);
+    }
+    closedir(handle);
+#endif
+}
+
+/**
+ * @brief 扫描指定路径下的所有文件和目录
+ *
+ * 如果快照中记录的目录修改时间、inode与当前一致，说明目录下没有增删条目，直接复用快照中的文件列表；
+ * 否则重新遍历该目录。子目录总是放入线程池继续判断。
+ *
+ * @param path       要扫描的路径
+ * @param generation 提交任务时的扫描代数，已经开始新的扫描时直接返回，不再访问m_pending、m_previous
+ */
+void ScanFile::scanPath(string path, unsigned generation)
+{
+    ActiveGuard active(m_active);
+    if (generation != m_generation)
+    {
+        return;
+    }
+    if (m_quit)   // 如果需要退出，则直接返回
+    {
+        finishPath(generation);
+        return;
+    }
+    if (m_watcher.isRunning())
+    {
+        m_watcher.addWatch(path);   // 先监听再遍历，避免遗漏遍历和添加监听之间的变化
+    }
+
+    DirRecord dir;
+    dir.path = path;
+    std::vector<std::string> subdirs;
+    bool reused = false;
+    if (statDir(path, dir.mtime, dir.inode))
+    {
+        // m_previous在扫描期间只读，不需要加锁
+        const DirRecord* old = m_previous.find(path);
+        if (old && old->mtime == dir.mtime && old->inode == dir.inode)
+        {
+            dir.files = old->files;
+            dir.names = old->names;
+            for (uint32_t child : old->children)
+            {
+                subdirs.push_back(m_previous.dirs()[child].path);
+            }
+            reused = true;
+        }
+    }
+    if (!reused)
+    {
+        listPath(path, dir, subdirs);
+    }
+
+    // 在线程池执行子目录扫描任务
+    for (const std::string& subdir : subdirs)
+    {
+        if (m_quit)
+        {
+            break;
+        }
+        enqueuePath(subdir, generation);
+    }
+
+    if (m_callback)
+    {
+        for (const FileRecord& file : dir.files)
+        {
+            m_callback({joinPath(path, dir.fileName(file)), file.size});
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (const DirRecord* old = m_snapshot.find(path))
+        {
+            m_totalSize -= old->totalSize();   // 监听期间同一个目录可能被重复扫描
+        }
+        m_totalSize += dir.totalSize();
+        m_snapshot.upsert(std::move(dir));
+    }
+    finishPath(generation);
+}
+
+void ScanFile::enqueuePath(const std::string& path, unsigned generation)
+{
+    ++m_pending;
+    try
+    {
+        m_threadPool->post(std::bind(&ScanFile::scanPath, this, path, generation));   // 不需要返回值，不创建future
+    }
+    catch (const std::exception&)
+    {
+        --m_pending;   // 线程池已停止
+    }
+}
+
+/**
+ * @brief 重新遍历快照中已有的目录，替换文件列表，扫描新增的子目录，删除已经不存在的子目录
+ *
+ * 目录修改时间在遍历之前获取，只有真正遍历过的目录才更新修改时间；
+ * 遍历期间发生的变化会使下一次比较不一致，不会被误认为已经同步。
+ */
+void ScanFile::refreshPath(std::string path, unsigned generation)
+{
+    ActiveGuard active(m_active);
+    if (generation != m_generation)
+    {
+        return;
+    }
+    if (m_quit)
+    {
+        finishPath(generation);
+        return;
+    }
+    if (m_watcher.isRunning())
+    {
+        m_watcher.addWatch(path);
+    }
+
+    DirRecord dir;
+    dir.path = path;
+    std::vector<std::string> subdirs;
+    std::vector<std::string> added;
+    if (statDir(path, dir.mtime, dir.inode))   // 目录已经删除时由父目录的事件处理
+    {
+        listPath(path, dir, subdirs);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (DirRecord* old = m_snapshot.find(path))
+        {
+            const std::unordered_set<std::string> current(subdirs.begin(), subdirs.end());
+            std::vector<std::string> removed;
+            for (uint32_t child : old->children)
+            {
+                const DirRecord& record = m_snapshot.dirs()[child];
+                if (!record.removed && !current.count(record.path))
+                {
+                    removed.push_back(record.path);
+                }
+            }
+            for (const std::string& subdir : removed)
+            {
+                m_totalSize -= m_snapshot.remove(subdir);   // 只做标记，old仍然有效；删除目录的watch由内核自动移除
+            }
+            for (const std::string& subdir : subdirs)
+            {
+                if (!m_snapshot.find(subdir))
+                {
+                    added.push_back(subdir);
+                }
+            }
+            m_totalSize -= old->totalSize();
+            m_totalSize += dir.totalSize();
+            m_snapshot.upsert(std::move(dir));
+        }
+    }
+    for (const std::string& subdir : added)
+    {
+        enqueuePath(subdir, generation);
+    }
+    finishPath(generation);
+}
+
+void ScanFile::enqueueRefresh(const std::string& path, unsigned generation)
+{
+    ++m_pending;
+    try
+    {
+        m_threadPool->post(std::bind(&ScanFile::refreshPath, this, path, generation));
+    }
+    catch (const std::exception&)
+    {
+        --m_pending;   // 线程池已停止
+    }
+}
+
+/**
+ * @brief 监听事件溢出后不知道哪些目录发生了变化，将所有目录标记为已修改并重新遍历
+ *
+ * 修改时间清零后，即使重新遍历被中断，下一次扫描也不会复用这些目录的快照。
+ */
+void ScanFile::refreshAll(unsigned generation)
+{
+    std::vector<std::string> paths;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (DirRecord& dir : m_snapshot.dirs())
+        {
+            if (!dir.removed)
+            {
+                dir.mtime = 0;
+                paths.push_back(dir.path);
+            }
+        }
+    }
+    for (const std::string& path : paths)
+    {
+        enqueueRefresh(path, generation);
+    }
+}
+
+/**
+ * @brief 一个目录扫描完成
+ *
+ * 所有目录都扫描完成后保存快照，重新遍历扫描期间发生变化的目录，最后通知调用方。
+ * 监听期间新建目录触发的扫描只更新父子关系，快照在退出时保存。
+ */
+void ScanFile::finishPath(unsigned generation)
+{
+    if (--m_pending != 0)
+    {
+        return;
+    }
+    if (!m_scanning)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_snapshot.buildChildren();
+        return;
+    }
+
+    std::vector<std::string> dirty;
+    bool overflowed = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_scanning = false;   // 与onWatchEvent中的判断在同一把锁内，之后的事件直接更新快照
+        if (!m_quit)
+        {
+            m_snapshot.buildChildren();
+            m_previous.clear();   // 释放上一次快照占用的内存
+        }
+        dirty.assign(m_dirty.begin(), m_dirty.end());
+        m_dirty.clear();
+        overflowed = m_overflowed;
+        m_overflowed = false;
+    }
+    if (!m_quit)
+    {
+        saveSnapshot();
+        if (overflowed)
+        {
+            refreshAll(generation);
+        }
+        else
+        {
+            for (const std::string& path : dirty)
+            {
+                enqueueRefresh(path, generation);
+            }
+        }
+    }
+    if (m_finishedCallback)
+    {
+        m_finishedCallback();
+    }
+}
+
+/**
+ * @brief 将当前结果保存到快照文件
+ * @return 保存成功返回true，未设置快照文件或扫描未完成返回false
+ */
+bool ScanFile::saveSnapshot()
+{
+    if (m_snapshotFile.empty() || m_pending != 0)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_snapshot.save(m_snapshotFile);
+}
+
+std::vector<FileInfo> ScanFile::files()
+{
+    std::vector<FileInfo> result;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const DirRecord& dir : m_snapshot.dirs())
+    {
+        if (dir.removed)
+        {
+            continue;
+        }
+        for (const FileRecord& file : dir.files)
+        {
+            result.push_back({joinPath(dir.path, dir.fileName(file)), file.size});
+        }
+    }
+    return result;
+}
+
+void ScanFile::buildTree(DirTree& tree)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    tree.build(m_snapshot);
+}
+
+void ScanFile::buildIndex(NameIndex& index)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    index.build(m_snapshot);
+}
+
+/**
+ * @brief 处理目录变化，保持快照和总大小实时更新（在监听线程中调用）
+ * @param event 目录变化事件
+ */
+void ScanFile::onWatchEvent(const WatchEvent& event)
+{
+    if (m_quit)
+    {
+        return;
+    }
+    const unsigned generation = m_generation;   // scan()在更新代数之前已经停止了监听线程
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_scanning)
+        {
+            // 目录可能还没有遍历或结果还没有写入快照，先记录下来，扫描完成后重新遍历
+            if (event.type == WatchEvent::Overflow)
+            {
+                m_overflowed = true;
+            }
+            else
+            {
+                m_dirty.insert(event.dir);
+            }
+            return;
+        }
+    }
+    if (event.type == WatchEvent::Overflow)
+    {
+        refreshAll(generation);   // 内核丢弃了事件，重新遍历所有目录
+        return;
+    }
+    if (event.name.empty())
+    {
+        return;
+    }
+    const std::string path = joinPath(event.dir, event.name);
+
+    if (event.isDir)
+    {
+        if (event.type == WatchEvent::Created)
+        {
+            enqueuePath(path, generation);   // 新目录（包括移入的目录树）直接扫描，遍历前自动添加监听
+        }
+        else if (event.type == WatchEvent::Removed)
+        {
+            m_watcher.removeWatch(path);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_totalSize -= m_snapshot.remove(path);
+        }
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        DirRecord* dir = m_snapshot.find(event.dir);
+        if (!dir)
+        {
+            return;
+        }
+
+        auto it = dir->files.begin();
+        for (; it != dir->files.end(); ++it)
+        {
+            if (it->nameLength == event.name.size() && dir->names.compare(it->nameOffset, it->nameLength, event.name) == 0)
+            {
+                break;
+            }
+        }
+
+        FileRecord record;
+        if (event.type != WatchEvent::Removed && statFile(path, record))
+        {
+            if (it != dir->files.end())
+            {
+                m_totalSize -= it->size;
+                it->size = record.size;
+                it->mtime = record.mtime;
+                it->inode = record.inode;
+            }
+            else
+            {
+                appendFile(*dir, event.name, record);
+            }
+            m_totalSize += record.size;
+        }
+        else if (it != dir->files.end())
+        {
+            m_totalSize -= it->size;
+            dir->files.erase(it);   // names中的旧文件名在保存快照时清理
+        }
+        // 不更新目录修改时间：只有重新遍历过的目录才记录新的修改时间，
+        // 下一次扫描时这个目录会重新遍历，不会因为漏掉事件而一直使用错误的文件列表
+    }
+}
+
+/**
+ * @brief 停止扫描文件操作
+ *
+ * 该函数用于停止当前正在进行的文件扫描操作。
+ *
+ * 首先，将成员变量 m_quit 设置为 true，表示需要停止扫描。
+ * 然后，如果成员变量 m_threadPool 不为空，则调用其 quit 方法停止线程池。
+ */
+void ScanFile::stop()
+{
+    m_quit = true;
+    m_scanning = false;
+    m_watcher.stop();
+    if (m_threadPool)
+    {
+        m_threadPool->quit();
+    }
+}
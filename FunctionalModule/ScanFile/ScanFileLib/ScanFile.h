@@ -1,25 +1,41 @@
 ﻿#ifndef SCANFILE_H
 #define SCANFILE_H
 
+#ifdef _WIN32
 #ifdef SCANFILE_EXPORTS
 #define SCANFILE_API __declspec(dllexport)   // 使用DLL导出符号
 #else
 #define SCANFILE_API __declspec(dllimport)   // 使用DLL导入符号
 #endif
+#else
+#define SCANFILE_API __attribute__((visibility("default")))
+#endif
 
+#include "DirWatcher.h"
+#include "MPMCQueue.h"
+#include "ScanSnapshot.h"
 #include "ThreadPool.h"
-#include "ThreadsafeQueue.h"
+#include "ThreadSafeQueue.h"
+#include <atomic>
 #include <functional>
+#include <mutex>
 #include <string>
+#include <unordered_set>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 struct FileInfo
 {
     std::string fileName;
-    ULONGLONG size;
+    unsigned long long size;
 };
 
+class DirTree;
+class NameIndex;
+
 using MessageCall = std::function<void(const FileInfo&)>;   // 定义回调函数类型
+using FinishedCall = std::function<void()>;                 // 扫描完成回调函数类型
 
 class SCANFILE_API ScanFile
 {
@@ -27,22 +43,46 @@ public:
     ScanFile();
     ~ScanFile();
     void setCallback(MessageCall callback);   // 设置回调函数
+    void setFinishedCallback(FinishedCall callback);   // 设置扫描完成回调函数
+    void setSnapshotFile(const std::string& fileName); // 设置快照文件，设置后扫描会复用上一次结果，只遍历修改过的目录
+    void setWatchEnabled(bool enabled);       // 是否监听目录变化（扫描开始时启动），保持快照和总大小实时更新
     void scan(const std::string& path);       // 执行扫描操作
     void stop();                              // 停止扫描操作
+    unsigned long long totalSize() const { return m_totalSize; }   // 当前扫描到的文件总大小（监听时实时更新）
+    bool saveSnapshot();                      // 将当前结果保存到快照文件
+    std::vector<FileInfo> files();            // 获取扫描到的所有文件（扫描完成后调用）
+    void buildTree(DirTree& tree);            // 建立目录树，汇总每个目录的总大小（扫描完成后调用）
+    void buildIndex(NameIndex& index);        // 建立文件名索引（扫描完成后调用）
 
 private:
-    LONGLONG getFileSize(const std::string& path);   // 获取文件大小
-    bool isDirectory(const std::string& path);       // 判断是否为目录
-
-    void scanPath(std::string path);   // 扫描路径
-    std::string LPCWSTRToString(const LPCWSTR wstr); // LPCWSTR转字符串
-    std::wstring stringToLPCWSTR(const std::string& str); // 字符串转wstring
-
+    void scanPath(std::string path, unsigned generation);   // 扫描路径
+    void listPath(const std::string& path, DirRecord& dir, std::vector<std::string>& subdirs);   // 遍历目录，获取文件信息和子目录
+    void enqueuePath(const std::string& path, unsigned generation);   // 在线程池中扫描路径
+    void refreshPath(std::string path, unsigned generation);   // 重新遍历快照中已有的目录
+    void enqueueRefresh(const std::string& path, unsigned generation);   // 在线程池中重新遍历目录
+    void refreshAll(unsigned generation);   // 监听事件丢失时重新遍历所有目录
+    void finishPath(unsigned generation);   // 一个目录扫描完成，所有目录完成后保存快照
+    void onWatchEvent(const WatchEvent& event);   // 处理目录变化
 
 private:
     MessageCall m_callback;   // 回调函数类型定义
+    FinishedCall m_finishedCallback;
     ThreadPool* m_threadPool = nullptr;
-    bool m_quit = false;
+    std::atomic<bool> m_quit;
+    std::atomic<bool> m_scanning;                   // 正在执行scan()发起的完整扫描
+    std::atomic<int> m_pending;                     // 未完成的目录扫描任务数
+    std::atomic<unsigned> m_generation;             // 每次scan()加1，之前扫描中尚未执行的任务直接返回
+    std::atomic<int> m_active;                      // 正在执行的扫描任务数
+    std::atomic<unsigned long long> m_totalSize;
+
+    std::string m_snapshotFile;   // 快照文件路径，为空时不使用快照
+    bool m_watchEnabled = false;
+    std::mutex m_mutex;           // 保护m_snapshot、m_dirty、m_overflowed，以及m_scanning的切换
+    ScanSnapshot m_previous;      // 上一次扫描的快照（只读）
+    ScanSnapshot m_snapshot;      // 本次扫描结果，监听目录变化时实时更新
+    DirWatcher m_watcher;
+    std::unordered_set<std::string> m_dirty;   // 扫描期间发生变化的目录，扫描完成后重新遍历
+    bool m_overflowed = false;                  // 扫描期间监听事件溢出，扫描完成后重新遍历所有目录
 };
 
 #endif   // SCANFILE_H
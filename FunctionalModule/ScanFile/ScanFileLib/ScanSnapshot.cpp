@@ -0,0 +1,451 @@
+﻿#include "ScanSnapshot.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = {'Q', 'M', 'S', 'C', 'A', 'N', '0', '1'};
+const uint32_t SNAPSHOT_VERSION = 1;
+
+struct DiskHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t rootLength;
+    uint64_t rootOffset;   // 根路径在字符串区中的偏移
+    uint64_t dirCount;
+    uint64_t fileCount;
+    uint64_t nameBytes;
+    uint64_t totalSize;
+};
+
+struct DiskDir
+{
+    uint64_t pathOffset;
+    uint64_t firstFile;    // 第一个文件在DiskFile数组中的下标
+    uint64_t nameOffset;   // 该目录文件名在字符串区中的起始偏移
+    uint64_t inode;
+    int64_t mtime;
+    uint32_t pathLength;
+    uint32_t fileCount;
+    uint32_t nameBytes;
+    uint32_t reserved;
+};
+
+struct DiskFile
+{
+    uint64_t size;
+    uint64_t inode;
+    int64_t mtime;
+    uint32_t nameOffset;   // 相对所属目录nameOffset的偏移
+    uint32_t nameLength;
+};
+
+/**
+ * @brief 只读内存映射文件
+ */
+class MappedFile
+{
+public:
+    ~MappedFile() { close(); }
+
+    bool open(const std::string& fileName)
+    {
+#ifdef _WIN32
+        m_file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+            return false;
+        m_size = size.QuadPart;
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m_mapping)
+            return false;
+        m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        return m_data != nullptr;
+#else
+        m_fd = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+        if (m_fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(m_fd, &st) != 0 || st.st_size == 0)
+            return false;
+        m_size = st.st_size;
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+        if (data == MAP_FAILED)
+            return false;
+        m_data = static_cast<const char*>(data);
+        return true;
+#endif
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (m_data)
+            UnmapViewOfFile(m_data);
+        if (m_mapping)
+            CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE)
+            CloseHandle(m_file);
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+#else
+        if (m_data)
+            munmap(const_cast<char*>(m_data), m_size);
+        if (m_fd >= 0)
+            ::close(m_fd);
+        m_fd = -1;
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    const char* data() const { return m_data; }
+    uint64_t size() const { return m_size; }
+
+private:
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+    const char* m_data = nullptr;
+    uint64_t m_size = 0;
+};
+
+}   // namespace
+
+uint64_t DirRecord::totalSize() const
+{
+    uint64_t size = 0;
+    for (const FileRecord& file : files)
+    {
+        size += file.size;
+    }
+    return size;
+}
+
+/**
+ * @brief 加载快照文件
+ *
+ * 文件内容通过内存映射直接按结构体访问，不做任何文本解析；
+ * 格式不匹配或文件损坏时返回false，调用方按首次扫描处理。
+ *
+ * @param fileName 快照文件路径
+ * @return 加载成功返回true
+ */
+bool ScanSnapshot::load(const std::string& fileName)
+{
+    clear();
+
+    MappedFile file;
+    if (!file.open(fileName) || file.size() < sizeof(DiskHeader))
+    {
+        return false;
+    }
+
+    const char* data = file.data();
+    DiskHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 || header.version != SNAPSHOT_VERSION)
+    {
+        return false;
+    }
+
+    const uint64_t dirBytes = header.dirCount * sizeof(DiskDir);
+    const uint64_t fileBytes = header.fileCount * sizeof(DiskFile);
+    if (file.size() != sizeof(DiskHeader) + dirBytes + fileBytes + header.nameBytes)
+    {
+        return false;
+    }
+
+    const DiskDir* diskDirs = reinterpret_cast<const DiskDir*>(data + sizeof(DiskHeader));
+    const DiskFile* diskFiles = reinterpret_cast<const DiskFile*>(data + sizeof(DiskHeader) + dirBytes);
+    const char* names = data + sizeof(DiskHeader) + dirBytes + fileBytes;
+
+    if (header.rootOffset + header.rootLength > header.nameBytes)
+    {
+        return false;
+    }
+    m_root.assign(names + header.rootOffset, header.rootLength);
+
+    m_dirs.resize(header.dirCount);
+    m_index.reserve(header.dirCount);
+    for (uint64_t i = 0; i < header.dirCount; ++i)
+    {
+        const DiskDir& diskDir = diskDirs[i];
+        if (diskDir.pathOffset + diskDir.pathLength > header.nameBytes || diskDir.nameOffset + diskDir.nameBytes > header.nameBytes ||
+            diskDir.firstFile + diskDir.fileCount > header.fileCount)
+        {
+            clear();
+            return false;
+        }
+
+        DirRecord& dir = m_dirs[i];
+        dir.path.assign(names + diskDir.pathOffset, diskDir.pathLength);
+        dir.mtime = diskDir.mtime;
+        dir.inode = diskDir.inode;
+        dir.names.assign(names + diskDir.nameOffset, diskDir.nameBytes);   // 同一目录的文件名连续存放，一次拷贝
+        dir.files.resize(diskDir.fileCount);
+        for (uint32_t j = 0; j < diskDir.fileCount; ++j)
+        {
+            const DiskFile& diskFile = diskFiles[diskDir.firstFile + j];
+            if (uint64_t(diskFile.nameOffset) + diskFile.nameLength > diskDir.nameBytes)
+            {
+                clear();
+                return false;
+            }
+            FileRecord& record = dir.files[j];
+            record.nameOffset = diskFile.nameOffset;
+            record.nameLength = diskFile.nameLength;
+            record.size = diskFile.size;
+            record.mtime = diskFile.mtime;
+            record.inode = diskFile.inode;
+        }
+        m_index.emplace(dir.path, uint32_t(i));
+    }
+    buildChildren();
+    return true;
+}
+
+/**
+ * @brief 保存快照文件
+ *
+ * 先写入临时文件，写入成功后再替换旧快照，避免中途退出损坏上一次的结果。
+ * 已删除的目录、目录names中已失效的文件名在保存时被清理。
+ *
+ * @param fileName 快照文件路径
+ * @return 保存成功返回true
+ */
+bool ScanSnapshot::save(const std::string& fileName)
+{
+    std::vector<DiskDir> diskDirs;
+    std::vector<DiskFile> diskFiles;
+    std::string names;
+    diskDirs.reserve(m_dirs.size());
+
+    uint64_t totalSize = 0;
+    for (const DirRecord& dir : m_dirs)
+    {
+        if (dir.removed)
+        {
+            continue;
+        }
+        DiskDir diskDir;
+        memset(&diskDir, 0, sizeof(diskDir));
+        diskDir.pathOffset = names.size();
+        diskDir.pathLength = uint32_t(dir.path.size());
+        names += dir.path;
+
+        diskDir.firstFile = diskFiles.size();
+        diskDir.fileCount = uint32_t(dir.files.size());
+        diskDir.nameOffset = names.size();
+        diskDir.inode = dir.inode;
+        diskDir.mtime = dir.mtime;
+        for (const FileRecord& file : dir.files)
+        {
+            DiskFile diskFile;
+            diskFile.size = file.size;
+            diskFile.inode = file.inode;
+            diskFile.mtime = file.mtime;
+            diskFile.nameOffset = uint32_t(names.size() - diskDir.nameOffset);
+            diskFile.nameLength = file.nameLength;
+            names.append(dir.names, file.nameOffset, file.nameLength);
+            diskFiles.push_back(diskFile);
+            totalSize += file.size;
+        }
+        diskDir.nameBytes = uint32_t(names.size() - diskDir.nameOffset);
+        diskDirs.push_back(diskDir);
+    }
+
+    DiskHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.rootOffset = names.size();
+    header.rootLength = uint32_t(m_root.size());
+    names += m_root;
+    header.dirCount = diskDirs.size();
+    header.fileCount = diskFiles.size();
+    header.nameBytes = names.size();
+    header.totalSize = totalSize;
+
+    std::string tempName = fileName + ".tmp";
+    FILE* fp = fopen(tempName.c_str(), "wb");
+    if (!fp)
+    {
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    ok = ok && (diskDirs.empty() || fwrite(diskDirs.data(), sizeof(DiskDir), diskDirs.size(), fp) == diskDirs.size());
+    ok = ok && (diskFiles.empty() || fwrite(diskFiles.data(), sizeof(DiskFile), diskFiles.size(), fp) == diskFiles.size());
+    ok = ok && (names.empty() || fwrite(names.data(), 1, names.size(), fp) == names.size());
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok)
+    {
+        std::remove(tempName.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    return MoveFileExA(tempName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(tempName.c_str(), fileName.c_str()) == 0;
+#endif
+}
+
+void ScanSnapshot::clear()
+{
+    m_root.clear();
+    m_dirs.clear();
+    m_index.clear();
+}
+
+DirRecord* ScanSnapshot::find(const std::string& path)
+{
+    auto it = m_index.find(path);
+    return it == m_index.end() ? nullptr : &m_dirs[it->second];
+}
+
+const DirRecord* ScanSnapshot::find(const std::string& path) const
+{
+    auto it = m_index.find(path);
+    return it == m_index.end() ? nullptr : &m_dirs[it->second];
+}
+
+DirRecord& ScanSnapshot::upsert(DirRecord&& dir)
+{
+    auto it = m_index.find(dir.path);
+    if (it != m_index.end())
+    {
+        DirRecord& old = m_dirs[it->second];
+        std::vector<uint32_t> children = std::move(old.children);
+        old = std::move(dir);
+        old.children = std::move(children);
+        return old;
+    }
+    m_index.emplace(dir.path, uint32_t(m_dirs.size()));
+    m_dirs.push_back(std::move(dir));
+    return m_dirs.back();
+}
+
+/**
+ * @brief 删除目录及其所有子目录（只做标记，保存时清理）
+ * @param path 目录路径
+ * @return 被删除文件的总大小
+ */
+uint64_t ScanSnapshot::remove(const std::string& path)
+{
+    uint64_t size = 0;
+    const std::string prefix = (!path.empty() && path.back() == '/') ? path : path + "/";
+    for (DirRecord& dir : m_dirs)
+    {
+        if (!dir.removed && (dir.path == path || dir.path.compare(0, prefix.size(), prefix) == 0))
+        {
+            dir.removed = true;
+            size += dir.totalSize();
+            dir.files.clear();
+            dir.names.clear();
+            m_index.erase(dir.path);
+        }
+    }
+    return size;
+}
+
+void ScanSnapshot::buildChildren()
+{
+    for (DirRecord& dir : m_dirs)
+    {
+        dir.children.clear();
+    }
+    for (uint32_t i = 0; i < m_dirs.size(); ++i)
+    {
+        const DirRecord& dir = m_dirs[i];
+        if (dir.removed)
+        {
+            continue;
+        }
+        const std::string parentDir = parentPath(dir.path);
+        if (parentDir.empty())
+        {
+            continue;
+        }
+        DirRecord* parent = find(parentDir);
+        if (parent && parent != &dir)
+        {
+            parent->children.push_back(i);
+        }
+    }
+}
+
+/**
+ * @brief 规范化目录路径，快照中的路径都是这种形式，父子关系才能通过路径查找
+ *
+ * windows下'\\'替换为'/'；去掉末尾的'/'，根目录"/"、"C:/"保留。
+ */
+std::string ScanSnapshot::normalizePath(const std::string& path)
+{
+    std::string result = path;
+#ifdef _WIN32
+    for (char& c : result)
+    {
+        if (c == '\\')
+        {
+            c = '/';
+        }
+    }
+    if (result.size() == 2 && result[1] == ':')
+    {
+        result += '/';   // "C:" -> "C:/"
+    }
+#endif
+    const size_t rootLength = (result.size() >= 3 && result[1] == ':' && result[2] == '/') ? 3 : 1;
+    while (result.size() > rootLength && result.back() == '/')
+    {
+        result.pop_back();
+    }
+    return result;
+}
+
+/**
+ * @brief 父目录路径："/a" -> "/"，"C:/a" -> "C:/"，"/a/b" -> "/a"；根目录和相对路径返回空
+ */
+std::string ScanSnapshot::parentPath(const std::string& path)
+{
+    const size_t pos = path.find_last_of('/');
+    if (pos == std::string::npos || pos + 1 == path.size())
+    {
+        return std::string();   // 没有'/'，或者是根目录
+    }
+    if (pos == 0)
+    {
+        return "/";
+    }
+    if (pos == 2 && path[1] == ':')
+    {
+        return path.substr(0, 3);
+    }
+    return path.substr(0, pos);
+}
+
+uint64_t ScanSnapshot::totalSize() const
+{
+    uint64_t size = 0;
+    for (const DirRecord& dir : m_dirs)
+    {
+        size += dir.totalSize();
+    }
+    return size;
+}
@@ -0,0 +1,68 @@
+﻿#ifndef SCANSNAPSHOT_H
+#define SCANSNAPSHOT_H
+
+/**
+ * 扫描结果快照：保存上一次扫描得到的目录、文件名、大小、修改时间、inode。
+ *
+ * 磁盘格式为定长结构体数组 + 字符串区，可直接内存映射读取：
+ *   DiskHeader | DiskDir[dirCount] | DiskFile[fileCount] | 字符串区
+ * 同一目录下的文件及其文件名在文件中连续存放，加载时每个目录只需一次拷贝。
+ */
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct FileRecord
+{
+    uint32_t nameOffset;   // 文件名在所属目录names中的偏移
+    uint32_t nameLength;
+    uint64_t size;
+    int64_t mtime;         // 修改时间（POSIX为纳秒，windows为FILETIME）
+    uint64_t inode;        // inode编号（windows下为0）
+};
+
+struct DirRecord
+{
+    std::string path;                // 目录完整路径
+    int64_t mtime = 0;               // 目录修改时间，目录下增删、重命名条目时会改变
+    uint64_t inode = 0;
+    std::vector<FileRecord> files;   // 目录下的文件（不含子目录）
+    std::string names;               // 文件名字符串区
+    std::vector<uint32_t> children;  // 子目录在快照中的下标（load时生成）
+    bool removed = false;            // 已删除的目录，保存时跳过
+
+    std::string fileName(const FileRecord& file) const { return names.substr(file.nameOffset, file.nameLength); }
+    uint64_t totalSize() const;
+};
+
+class ScanSnapshot
+{
+public:
+    bool load(const std::string& fileName);   // 以内存映射方式读取快照
+    bool save(const std::string& fileName);   // 保存快照（先写临时文件再替换）
+    void clear();
+
+    const std::string& root() const { return m_root; }
+    void setRoot(const std::string& root) { m_root = root; }
+
+    DirRecord* find(const std::string& path);
+    const DirRecord* find(const std::string& path) const;
+    DirRecord& upsert(DirRecord&& dir);   // 添加目录，已存在则替换
+    uint64_t remove(const std::string& path);   // 删除目录及其所有子目录，返回被删除文件的总大小
+    void buildChildren();                   // 根据路径重建父子关系
+
+    static std::string normalizePath(const std::string& path);   // 去掉末尾的'/'（根目录"/"、"C:/"除外）
+    static std::string parentPath(const std::string& path);      // 父目录路径，根目录返回空
+
+    std::vector<DirRecord>& dirs() { return m_dirs; }
+    const std::vector<DirRecord>& dirs() const { return m_dirs; }
+    uint64_t totalSize() const;
+
+private:
+    std::string m_root;
+    std::vector<DirRecord> m_dirs;
+    std::unordered_map<std::string, uint32_t> m_index;   // 路径 -> m_dirs下标
+};
+
+#endif   // SCANSNAPSHOT_H
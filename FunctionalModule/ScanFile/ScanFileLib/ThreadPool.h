@@ -1,19 +1,62 @@
 ﻿#ifndef THREADPOOL_H
 #define THREADPOOL_H
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
 #include <functional>
 #include <future>
-#include <iostream>
+#include <iterator>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <stdexcept>
 #include <thread>
 #include <vector>
-#include <windows.h>
+
+/**
+ * @brief 协作式取消标记
+ *
+ * 拷贝后共享同一个状态；线程池在任务开始执行前检查，已开始的任务需要自己调用isCancelled()提前返回。
+ */
+class CancellationToken
+{
+public:
+    CancellationToken()
+        : m_state(std::make_shared<std::atomic<bool>>(false))
+    {
+    }
+
+    void cancel() { m_state->store(true, std::memory_order_release); }
+    bool isCancelled() const { return m_state->load(std::memory_order_acquire); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_state;
+};
 
 // 线程池
+/**
+ * 每个工作线程有自己的任务队列：工作线程提交的任务放入自己队列的尾部，并从尾部取出（后进先出，缓存友好）；
+ * 外部线程提交的任务轮流放入各个队列；自己的队列为空时从其它队列头部窃取任务。
+ * 只有存在休眠的工作线程时才需要加锁唤醒，提交任务的开销只有一次队列加锁。
+ */
 class ThreadPool
 {
 public:
+    using Task = std::function<void()>;
+    using ExceptionHandler = std::function<void(std::exception_ptr)>;
+
+    struct Stats
+    {
+        size_t workers;              // 工作线程数
+        size_t queued;               // 等待执行的任务数
+        uint64_t executed;           // 已执行的任务数
+        uint64_t steals;             // 从其它线程队列窃取的任务数
+        uint64_t idleMicroseconds;   // 所有工作线程累计空闲时间
+        uint64_t exceptions;         // 抛出异常的任务数
+    };
+
     /**
      * @brief 线程池构造函数
      *
@@ -23,22 +66,34 @@ public:
      */
     ThreadPool(size_t threads = 0)
         : stop(false)
+        , pending(0)
+        , sleeping(0)
+        , next(0)
+        , executed(0)
+        , steals(0)
+        , idleMicroseconds(0)
+        , exceptions(0)
     {
         if (threads == 0)   // 设置默认线程数
         {
-            SYSTEM_INFO sysInfo;
-            GetSystemInfo(&sysInfo);
-            threads = sysInfo.dwNumberOfProcessors; // 默认线程数等于CPU核心数
+            threads = std::thread::hardware_concurrency(); // 默认线程数等于CPU核心数
+            if (threads == 0)
+            {
+                threads = 1;
+            }
+        }
+        for (size_t i = 0; i < threads; ++i)
+        {
+            queues.emplace_back(new WorkerQueue);
         }
         // 创建工作线程并启动它们
         for (size_t i = 0; i < threads; ++i)
         {
-            workers.emplace_back(std::bind(&ThreadPool::workFun, this));
+            workers.emplace_back(std::bind(&ThreadPool::workFun, this, i));
         }
-            
     }
 
-    // 添加任务到线程池
+    // 添加任务到线程池，返回任务的future
     template<class F, class... Args>
     auto enqueue(F&& f, Args&&... args) -> std::future<typename std::result_of<F(Args...)>::type>
     {
@@ -47,42 +102,175 @@ public:
         auto task = std::make_shared<std::packaged_task<return_type()>>(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
 
         std::future<return_type> res = task->get_future(); // 创建任务并获取其未来结果
+        post([task]() { (*task)(); });
+        return res; // 返回任务的未来结果
+    }
+
+    /**
+     * @brief 添加不需要返回值的任务，不创建packaged_task和future
+     *
+     * 线程池已停止时抛出std::runtime_error。
+     * 任务抛出的异常由执行它的线程捕获，计入Stats::exceptions并交给setExceptionHandler()设置的回调，不会终止程序。
+     */
+    template<class F>
+    void post(F&& f)
+    {
+        post(std::forward<F>(f), Task());
+    }
+
+    /**
+     * @brief 添加任务，任务未开始执行就被quit()丢弃时，在调用quit()的线程中执行onDiscard
+     *
+     * 用于需要统计完成数的调用方（如TaskGroup），被丢弃的任务也能计为完成。
+     */
+    template<class F>
+    void post(F&& f, Task onDiscard)
+    {
+        if (stop)
         {
-            std::unique_lock<std::mutex> lock(queue_mutex);
+            throw std::runtime_error("enqueue on stopped ThreadPool");
+        }
+        const int self = currentWorker();
+        WorkerQueue& queue = *queues[self >= 0 ? size_t(self) : next++ % queues.size()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.emplace_back(Task(std::forward<F>(f)), std::move(onDiscard));
+            ++pending;
+        }
+        wakeup(false);
+    }
+
+    /**
+     * @brief 添加可取消的任务，开始执行前已取消则直接丢弃
+     */
+    template<class F>
+    void post(F&& f, const CancellationToken& token)
+    {
+        typename std::decay<F>::type task(std::forward<F>(f));
+        post([task, token]() mutable
+             {
+                 if (!token.isCancelled())
+                 {
+                     task();
+                 }
+             });
+    }
 
-            // 如果线程池已经停止，则抛出异常
-            if (stop)
+    /**
+     * @brief 批量添加任务
+     *
+     * 将[first, last)按连续区间平均分配到各个队列，每个队列只加锁一次，最后统一唤醒工作线程。
+     * 元素需要可以转换为std::function<void()>。
+     */
+    template<class Iterator>
+    void postBulk(Iterator first, Iterator last)
+    {
+        if (stop)
+        {
+            throw std::runtime_error("enqueue on stopped ThreadPool");
+        }
+        const size_t count = size_t(std::distance(first, last));
+        if (count == 0)
+        {
+            return;
+        }
+        const size_t chunk = (count + queues.size() - 1) / queues.size();
+        const size_t start = next.fetch_add(queues.size());
+        for (size_t i = 0; first != last; ++i)
+        {
+            WorkerQueue& queue = *queues[(start + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            for (size_t n = 0; n < chunk && first != last; ++n, ++first)
             {
-                throw std::runtime_error("enqueue on stopped ThreadPool");
+                queue.tasks.emplace_back(Task(*first), Task());
+                ++pending;
             }
-            tasks.emplace([task]() { (*task)(); }); // 将任务封装到std::function中，并推入队列中
         }
-        condition.notify_one(); // 唤醒一个等待的线程
-        return res; // 返回任务的未来结果
+        wakeup(true);
+    }
 
+    /**
+     * @brief 在当前线程执行一个等待中的任务
+     *
+     * 用于等待任务完成的线程帮助执行任务，避免工作线程内等待子任务时所有线程都阻塞。
+     * @return 没有可执行的任务时返回false
+     */
+    bool runPending()
+    {
+        const int self = currentWorker();
+        Task task;
+        if (!takeTask(self >= 0 ? size_t(self) : next++ % queues.size(), task))
+        {
+            return false;
+        }
+        execute(task);
+        return true;
     }
 
     /**
      * @brief 退出函数，清空任务队列
      *
-     * 该函数用于在程序退出时清空任务队列，确保所有任务都被处理完毕。
-     * 使用std::unique_lock锁定队列互斥锁，以确保线程安全。
-     * 在锁定期间，循环检查任务队列是否为空，如果不为空，则弹出队列中的任务。
+     * 丢弃所有尚未开始的任务，并执行这些任务的onDiscard（TaskGroup的任务因此计为完成，wait()不会一直等待）；
+     * 正在执行的任务需要通过CancellationToken协作退出。
      */
     void quit()
     {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        while (!tasks.empty())
+        std::vector<Task> discarded;
+        for (auto& queue : queues)
         {
-            tasks.pop();
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            for (Item& item : queue->tasks)
+            {
+                if (item.onDiscard)
+                {
+                    discarded.push_back(std::move(item.onDiscard));
+                }
+            }
+            pending -= queue->tasks.size();
+            queue->tasks.clear();
+        }
+        for (Task& onDiscard : discarded)   // 不持有队列锁，onDiscard中可以再提交任务
+        {
+            onDiscard();
         }
     }
 
+    /**
+     * @brief 设置任务抛出异常时的回调，在抛出异常的线程中调用；需要在提交任务前设置
+     */
+    void setExceptionHandler(ExceptionHandler handler) { exceptionHandler = std::move(handler); }
+
+    size_t size() const { return workers.size(); }
+
+    /**
+     * @brief 共用的线程池（线程数等于CPU核心数），第一次调用时创建，程序退出时销毁
+     *
+     * 库内一次性的并行计算（重复文件查找、目录汇总、文件名索引）都使用它，不再每次调用都创建、销毁线程；
+     * 其它模块也在使用，不要对它调用quit()，需要取消时使用TaskGroup::cancel()。
+     */
+    static ThreadPool& shared()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    Stats stats() const
+    {
+        Stats result;
+        result.workers = workers.size();
+        result.queued = pending;
+        result.executed = executed;
+        result.steals = steals;
+        result.idleMicroseconds = idleMicroseconds;
+        result.exceptions = exceptions;
+        return result;
+    }
+
     ~ThreadPool()
     {
         {
             // 标记线程池为停止状态，并唤醒所有等待的线程
-            std::unique_lock<std::mutex> lock(queue_mutex);
+            std::unique_lock<std::mutex> lock(sleepMutex);
             stop = true;
         }
         condition.notify_all();  // 唤醒所有等待的线程
@@ -94,42 +282,277 @@ public:
     }
 
 private:
+    struct Item
+    {
+        Item(Task&& task, Task&& onDiscard)
+            : task(std::move(task))
+            , onDiscard(std::move(onDiscard))
+        {
+        }
+
+        Task task;
+        Task onDiscard;   // 被quit()丢弃时执行，可以为空
+    };
+
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<Item> tasks;
+        char padding[64];   // 避免相邻队列的锁位于同一缓存行
+    };
+
+    /**
+     * @brief 当前线程在本线程池中的工作线程下标，不是本线程池的工作线程时返回-1
+     */
+    int currentWorker() const
+    {
+        const WorkerId& id = workerId();
+        return id.pool == this ? id.index : -1;
+    }
+
+    struct WorkerId
+    {
+        const ThreadPool* pool;
+        int index;
+    };
+
+    static WorkerId& workerId()
+    {
+        static thread_local WorkerId id = {nullptr, -1};
+        return id;
+    }
+
+    /**
+     * @brief 取出一个任务：先从自己队列尾部取，再从其它队列头部窃取
+     */
+    bool takeTask(size_t index, Task& task)
+    {
+        {
+            WorkerQueue& queue = *queues[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.back().task);
+                queue.tasks.pop_back();
+                --pending;
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); ++i)
+        {
+            WorkerQueue& queue = *queues[(index + i) % queues.size()];
+            std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);   // 其它线程正在操作该队列时跳过
+            if (lock.owns_lock() && !queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.front().task);
+                queue.tasks.pop_front();
+                --pending;
+                ++steals;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief 执行一个任务，捕获任务抛出的异常，避免异常离开工作线程导致std::terminate
+     */
+    void execute(Task& task)
+    {
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+            ++exceptions;
+            if (exceptionHandler)
+            {
+                exceptionHandler(std::current_exception());
+            }
+        }
+        ++executed;
+    }
+
+    /**
+     * @brief 添加任务后唤醒休眠的工作线程
+     *
+     * 提交方先增加pending再读取sleeping，工作线程先增加sleeping再读取pending（均为顺序一致），
+     * 两者至少有一方能看到对方的修改，因此没有休眠线程时可以跳过加锁，且不会丢失唤醒。
+     */
+    void wakeup(bool all)
+    {
+        if (sleeping == 0)
+        {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        if (all)
+        {
+            condition.notify_all();
+        }
+        else
+        {
+            condition.notify_one();
+        }
+    }
+
     /**
      * @brief 工作函数，用于从任务队列中取出任务并执行
      *
-     * 该函数在一个无限循环中，不断从任务队列中取出任务并执行。如果任务队列为空且已停止工作，则退出循环。
+     * 该函数在一个无限循环中，不断从任务队列中取出任务并执行。如果所有队列为空且已停止工作，则退出循环。
      */
-    void workFun()
+    void workFun(size_t index)
     {
-        std::function<void()> task; // 任务容器
+        workerId() = {this, int(index)};
+        Task task; // 任务容器
         while (true)
         {
+            if (takeTask(index, task))
             {
-                std::unique_lock<std::mutex> lock(queue_mutex);
-                this->condition.wait(lock, [this] 
+                execute(task);  // 执行任务
+                task = nullptr;
+                continue;
+            }
+            // try_to_lock窃取可能漏掉任务，休眠前再确认一次
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            ++sleeping;
+            const auto start = std::chrono::steady_clock::now();
+            condition.wait(lock, [this]
+            {
+                // 如果线程池已停止或有等待执行的任务，则返回true
+                return stop || pending != 0;
+            });
+            --sleeping;
+            idleMicroseconds += uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+            // 如果线程池已停止且任务队列为空，则退出循环
+            if (stop && pending == 0)
+            {
+                return;
+            }
+        }
+    }
+
+private:
+    std::vector<std::thread> workers;  // 线程池中的工作线程
+    std::vector<std::unique_ptr<WorkerQueue>> queues;  // 每个工作线程的任务队列
+
+    std::mutex sleepMutex;
+    std::condition_variable condition;  // 条件变量，用于阻塞和唤醒线程
+    std::atomic<bool> stop;  // 线程池是否停止的标志
+    std::atomic<size_t> pending;  // 等待执行的任务数
+    std::atomic<size_t> sleeping;  // 休眠的工作线程数
+    std::atomic<size_t> next;  // 外部线程提交任务时轮流选择队列
+    std::atomic<uint64_t> executed;
+    std::atomic<uint64_t> steals;
+    std::atomic<uint64_t> idleMicroseconds;
+    std::atomic<uint64_t> exceptions;
+    ExceptionHandler exceptionHandler;  // 任务抛出异常时的回调
+};
+
+/**
+ * @brief 任务组：在线程池中执行一组任务并等待全部完成，可以整体取消
+ *
+ * wait()在等待期间帮助执行线程池中的任务，因此可以在工作线程中嵌套使用。
+ * 任务被线程池quit()丢弃、或者抛出异常时同样计为完成，wait()不会一直等待；异常由线程池报告。
+ */
+class TaskGroup
+{
+public:
+    explicit TaskGroup(ThreadPool& pool)
+        : m_pool(pool)
+        , m_pending(0)
+        , m_finishing(0)
+    {
+    }
+
+    ~TaskGroup() { wait(); }
+
+    template<class F>
+    void run(F&& f)
+    {
+        typename std::decay<F>::type task(std::forward<F>(f));   // 直接捕获可调用对象，避免再包装一层std::function
+        ++m_pending;
+        try
+        {
+            m_pool.post(
+                [this, task]() mutable
                 {
-                    // 如果线程池已停止且任务队列为空，则返回true以退出循环
-                    return (this->stop || !this->tasks.empty()); 
-                });
-                // 如果线程池已停止且任务队列为空，则退出循环
-                if (this->stop && this->tasks.empty())
+                    if (!m_token.isCancelled())
+                    {
+                        try
+                        {
+                            task();
+                        }
+                        catch (...)
+                        {
+                            finish();
+                            throw;   // 由线程池捕获并报告
+                        }
+                    }
+                    finish();
+                },
+                [this]() { finish(); });
+        }
+        catch (...)
+        {
+            finish();
+            throw;
+        }
+    }
+
+    void wait()
+    {
+        while (true)
+        {
+            if (m_pending == 0)
+            {
+                while (m_finishing != 0)   // 等待最后一个任务通知完成后再返回，之后本对象可以安全析构
                 {
-                    return;
+                    std::this_thread::yield();
                 }
-                task = std::move(this->tasks.front());  // 从队列中取出任务
-                this->tasks.pop();  // 从队列中移除已执行的任务
+                return;
             }
-            task();  // 执行任务
+            if (m_pool.runPending())
+            {
+                continue;
+            }
+            // 剩余任务都在其它线程执行中，等待完成通知；定时醒来是为了继续帮助执行新提交的任务
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait_for(lock, std::chrono::milliseconds(1), [this] { return m_pending == 0; });
         }
     }
 
+    void cancel() { m_token.cancel(); }   // 未开始的任务不再执行，正在执行的任务通过token()自行检查
+    bool isCancelled() const { return m_token.isCancelled(); }
+    const CancellationToken& token() const { return m_token; }
+
 private:
-    std::vector<std::thread> workers;  // 线程池中的工作线程
-    std::queue<std::function<void()>> tasks;  // 任务队列
+    /**
+     * @brief 一个任务完成，只有最后一个任务需要加锁通知
+     *
+     * m_finishing在访问本对象期间不为0，wait()看到计数为0后还要等它归0才返回，避免通知时本对象已被销毁。
+     */
+    void finish()
+    {
+        ++m_finishing;
+        if (--m_pending == 0)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_condition.notify_all();
+        }
+        --m_finishing;
+    }
 
-    std::mutex queue_mutex;
-    std::condition_variable condition;  // 条件变量，用于阻塞和唤醒线程
-    bool stop;  // 线程池是否停止的标志
+private:
+    ThreadPool& m_pool;
+    CancellationToken m_token;
+    std::atomic<size_t> m_pending;     // 未完成的任务数
+    std::atomic<size_t> m_finishing;   // 正在执行finish()的线程数
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
 };
 
 #endif
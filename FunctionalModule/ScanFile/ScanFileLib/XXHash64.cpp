@@ -0,0 +1,160 @@
+﻿#include "XXHash64.h"
+
+#include <cstring>
+
+namespace {
+
+const uint64_t PRIME1 = 11400714785074694791ULL;
+const uint64_t PRIME2 = 14029467366897019727ULL;
+const uint64_t PRIME3 = 1609587929392839161ULL;
+const uint64_t PRIME4 = 9650029242287828579ULL;
+const uint64_t PRIME5 = 2870177450012600261ULL;
+
+inline uint64_t rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t read64(const unsigned char* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));   // 小端平台（x86/ARM）直接读取
+    return v;
+}
+
+inline uint32_t read32(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t round(uint64_t acc, uint64_t input)
+{
+    acc += input * PRIME2;
+    acc = rotl(acc, 31);
+    return acc * PRIME1;
+}
+
+inline uint64_t mergeRound(uint64_t acc, uint64_t val)
+{
+    acc ^= round(0, val);
+    return acc * PRIME1 + PRIME4;
+}
+
+}   // namespace
+
+XXHash64::XXHash64(uint64_t seed)
+{
+    reset(seed);
+}
+
+void XXHash64::reset(uint64_t seed)
+{
+    m_seed = seed;
+    m_state[0] = seed + PRIME1 + PRIME2;
+    m_state[1] = seed + PRIME2;
+    m_state[2] = seed;
+    m_state[3] = seed - PRIME1;
+    m_totalLength = 0;
+    m_bufferSize = 0;
+}
+
+void XXHash64::update(const void* data, size_t length)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + length;
+    m_totalLength += length;
+
+    if (m_bufferSize + length < 32)
+    {
+        memcpy(m_buffer + m_bufferSize, p, length);
+        m_bufferSize += length;
+        return;
+    }
+
+    if (m_bufferSize > 0)   // 先补齐上次剩余的数据
+    {
+        size_t fill = 32 - m_bufferSize;
+        memcpy(m_buffer + m_bufferSize, p, fill);
+        p += fill;
+        m_state[0] = round(m_state[0], read64(m_buffer));
+        m_state[1] = round(m_state[1], read64(m_buffer + 8));
+        m_state[2] = round(m_state[2], read64(m_buffer + 16));
+        m_state[3] = round(m_state[3], read64(m_buffer + 24));
+        m_bufferSize = 0;
+    }
+
+    uint64_t v1 = m_state[0], v2 = m_state[1], v3 = m_state[2], v4 = m_state[3];
+    while (p + 32 <= end)
+    {
+        v1 = round(v1, read64(p));
+        v2 = round(v2, read64(p + 8));
+        v3 = round(v3, read64(p + 16));
+        v4 = round(v4, read64(p + 24));
+        p += 32;
+    }
+    m_state[0] = v1;
+    m_state[1] = v2;
+    m_state[2] = v3;
+    m_state[3] = v4;
+
+    if (p < end)
+    {
+        m_bufferSize = size_t(end - p);
+        memcpy(m_buffer, p, m_bufferSize);
+    }
+}
+
+uint64_t XXHash64::digest() const
+{
+    uint64_t h;
+    if (m_totalLength >= 32)
+    {
+        h = rotl(m_state[0], 1) + rotl(m_state[1], 7) + rotl(m_state[2], 12) + rotl(m_state[3], 18);
+        h = mergeRound(h, m_state[0]);
+        h = mergeRound(h, m_state[1]);
+        h = mergeRound(h, m_state[2]);
+        h = mergeRound(h, m_state[3]);
+    }
+    else
+    {
+        h = m_seed + PRIME5;
+    }
+    h += m_totalLength;
+
+    const unsigned char* p = m_buffer;
+    const unsigned char* end = m_buffer + m_bufferSize;
+    while (p + 8 <= end)
+    {
+        h ^= round(0, read64(p));
+        h = rotl(h, 27) * PRIME1 + PRIME4;
+        p += 8;
+    }
+    if (p + 4 <= end)
+    {
+        h ^= uint64_t(read32(p)) * PRIME1;
+        h = rotl(h, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    while (p < end)
+    {
+        h ^= (*p) * PRIME5;
+        h = rotl(h, 11) * PRIME1;
+        ++p;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t XXHash64::hash(const void* data, size_t length, uint64_t seed)
+{
+    XXHash64 hasher(seed);
+    hasher.update(data, length);
+    return hasher.digest();
+}
@@ -0,0 +1,30 @@
+﻿#ifndef XXHASH64_H
+#define XXHASH64_H
+
+/**
+ * XXH64 哈希算法（https://github.com/Cyan4973/xxHash）的流式实现。
+ * 非加密哈希，单核吞吐可达内存带宽级别，用于重复文件比对时哈希计算不会成为瓶颈。
+ */
+#include <cstddef>
+#include <cstdint>
+
+class XXHash64
+{
+public:
+    explicit XXHash64(uint64_t seed = 0);
+
+    void reset(uint64_t seed = 0);
+    void update(const void* data, size_t length);   // 追加数据，可多次调用
+    uint64_t digest() const;                        // 获取当前哈希值，不影响后续update
+
+    static uint64_t hash(const void* data, size_t length, uint64_t seed = 0);
+
+private:
+    uint64_t m_state[4];
+    uint64_t m_seed;
+    uint64_t m_totalLength;
+    unsigned char m_buffer[32];   // 不足32字节的剩余数据
+    size_t m_bufferSize;
+};
+
+#endif   // XXHASH64_H
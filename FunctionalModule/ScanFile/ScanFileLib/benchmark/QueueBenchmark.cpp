@@ -0,0 +1,221 @@
+﻿/**
+ * 队列基准：生产者/消费者数量从1到64，比较自旋锁队列（ThreadSafeQueue的实现方式）、std::mutex队列和MPMCQueue。
+ *
+ * 用法：QueueBenchmark [元素总数，默认1000000] [最大线程数，默认64]
+ * 线程数超过CPU核心数时自旋锁会空转，这正是需要关注的场景。
+ */
+#include "MPMCQueue.h"
+#include "SpinLock.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+namespace {
+
+// 与ThreadSafeQueue相同的自旋锁 + std::queue；ThreadSafeQueue的front()+pop()在多个消费者时不是原子的，这里合并为tryPop
+template<typename T>
+class SpinLockQueue
+{
+public:
+    bool tryPush(T&& value)
+    {
+        std::lock_guard<SpinLock> lock(m_lock);
+        m_queue.push(std::move(value));
+        return true;
+    }
+    bool tryPop(T& value)
+    {
+        std::lock_guard<SpinLock> lock(m_lock);
+        if (m_queue.empty())
+        {
+            return false;
+        }
+        value = std::move(m_queue.front());
+        m_queue.pop();
+        return true;
+    }
+
+private:
+    std::queue<T> m_queue;
+    SpinLock m_lock;
+};
+
+// std::mutex + 条件变量的阻塞队列
+template<typename T>
+class MutexQueue
+{
+public:
+    void push(T&& value)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push(std::move(value));
+        }
+        m_condition.notify_one();
+    }
+    void pop(T& value)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this] { return !m_queue.empty(); });
+        value = std::move(m_queue.front());
+        m_queue.pop();
+    }
+
+private:
+    std::queue<T> m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+};
+
+// 只能移动的元素，验证MPMCQueue对move-only类型的支持
+using Item = std::unique_ptr<uint64_t>;
+
+const uint64_t STOP = ~uint64_t(0);   // 阻塞队列的结束标记，每个消费者一个
+
+/**
+ * @brief 运行一次生产者/消费者测试
+ * @param push 入队函数（不成功时由调用方重试）
+ * @param pop  出队函数，返回false表示暂时没有元素
+ * @return 耗时（毫秒），校验和不一致时返回负数
+ */
+template<class Push, class Pop>
+double run(size_t producers, size_t consumers, size_t count, Push push, Pop pop)
+{
+    std::atomic<uint64_t> sum(0);
+    std::atomic<size_t> finished(0);
+    const size_t perProducer = count / producers;
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p)
+    {
+        threads.emplace_back(
+            [&, p]()
+            {
+                for (size_t i = 0; i < perProducer; ++i)
+                {
+                    Item item(new uint64_t(p * perProducer + i));
+                    while (!push(item))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+                if (++finished == producers)
+                {
+                    for (size_t c = 0; c < consumers; ++c)
+                    {
+                        Item stop(new uint64_t(STOP));
+                        while (!push(stop))
+                        {
+                            std::this_thread::yield();
+                        }
+                    }
+                }
+            });
+    }
+    for (size_t c = 0; c < consumers; ++c)
+    {
+        threads.emplace_back(
+            [&]()
+            {
+                uint64_t local = 0;
+                Item item;
+                while (true)
+                {
+                    if (!pop(item))
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    if (*item == STOP)
+                    {
+                        break;
+                    }
+                    local += *item;
+                }
+                sum += local;
+            });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    const uint64_t total = uint64_t(perProducer) * producers;
+    return sum == total * (total - 1) / 2 ? ms : -ms;
+}
+
+void report(const char* name, size_t producers, size_t consumers, size_t count, double ms)
+{
+    if (ms < 0)
+    {
+        printf("%-24s %3zu/%-3zu  checksum mismatch\n", name, producers, consumers);
+        return;
+    }
+    printf("%-24s %3zu/%-3zu %10.1f ms %8.2f Mops/s\n", name, producers, consumers, ms, double(count) / ms / 1e3);
+}
+
+}   // namespace
+
+int main(int argc, char* argv[])
+{
+    const size_t count = argc > 1 ? size_t(atoll(argv[1])) : 1000000;
+    const size_t maxThreads = argc > 2 ? size_t(atoi(argv[2])) : 64;
+    printf("items=%zu cpus=%u  (producers/consumers)\n", count, std::thread::hardware_concurrency());
+
+    // 总线程数2、4、8...，生产者和消费者各占一半
+    for (size_t threads = 2; threads <= maxThreads; threads *= 2)
+    {
+        const size_t producers = threads / 2;
+        const size_t consumers = threads - producers;
+        {
+            SpinLockQueue<Item> queue;
+            double ms = run(producers, consumers, count, [&](Item& item) { return queue.tryPush(std::move(item)); },
+                            [&](Item& item) { return queue.tryPop(item); });
+            report("SpinLock + std::queue", producers, consumers, count, ms);
+        }
+        {
+            MutexQueue<Item> queue;
+            double ms = run(producers, consumers, count,
+                            [&](Item& item)
+                            {
+                                queue.push(std::move(item));
+                                return true;
+                            },
+                            [&](Item& item)
+                            {
+                                queue.pop(item);
+                                return true;
+                            });
+            report("std::mutex + condvar", producers, consumers, count, ms);
+        }
+        {
+            MPMCQueue<Item> queue(1024);
+            double ms = run(producers, consumers, count, [&](Item& item) { return queue.tryPush(std::move(item)); },
+                            [&](Item& item) { return queue.tryPop(item); });
+            report("MPMCQueue try + yield", producers, consumers, count, ms);
+        }
+        {
+            MPMCQueue<Item> queue(1024);
+            double ms = run(producers, consumers, count,
+                            [&](Item& item)
+                            {
+                                queue.push(std::move(item));
+                                return true;
+                            },
+                            [&](Item& item)
+                            {
+                                queue.pop(item);
+                                return true;
+                            });
+            report("MPMCQueue blocking", producers, consumers, count, ms);
+        }
+    }
+    return 0;
+}
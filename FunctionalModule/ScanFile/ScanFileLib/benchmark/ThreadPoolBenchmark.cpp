@@ -0,0 +1,296 @@
+﻿/**
+ * 线程池微基准：大量极小任务下比较原线程池（单队列 + packaged_task + future）与工作窃取线程池各种提交方式的开销。
+ *
+ * 用法：ThreadPoolBenchmark [任务数，默认2000000] [线程数，默认CPU核心数]
+ */
+#include "ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+
+namespace legacy {
+
+// 原线程池实现：所有任务进入同一个std::queue，每个任务都创建packaged_task和future
+class ThreadPool
+{
+public:
+    ThreadPool(size_t threads)
+        : stop(false)
+    {
+        for (size_t i = 0; i < threads; ++i)
+        {
+            workers.emplace_back(std::bind(&ThreadPool::workFun, this));
+        }
+    }
+
+    template<class F, class... Args>
+    auto enqueue(F&& f, Args&&... args) -> std::future<typename std::result_of<F(Args...)>::type>
+    {
+        using return_type = typename std::result_of<F(Args...)>::type;
+        auto task = std::make_shared<std::packaged_task<return_type()>>(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+        std::future<return_type> res = task->get_future();
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            if (stop)
+            {
+                throw std::runtime_error("enqueue on stopped ThreadPool");
+            }
+            tasks.emplace([task]() { (*task)(); });
+        }
+        condition.notify_one();
+        return res;
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            stop = true;
+        }
+        condition.notify_all();
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+private:
+    void workFun()
+    {
+        std::function<void()> task;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                condition.wait(lock, [this] { return stop || !tasks.empty(); });
+                if (stop && tasks.empty())
+                {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queue_mutex;
+    std::condition_variable condition;
+    bool stop;
+};
+
+}   // namespace legacy
+
+namespace {
+
+std::atomic<uint64_t> g_sink(0);
+
+// 极小任务：几十纳秒的计算
+void tinyTask(uint64_t value)
+{
+    uint64_t x = value;
+    for (int i = 0; i < 16; ++i)
+    {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    g_sink.fetch_add(x & 1, std::memory_order_relaxed);
+}
+
+class Timer
+{
+public:
+    Timer()
+        : m_start(std::chrono::steady_clock::now())
+    {
+    }
+    double elapsedMs() const { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count(); }
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// 计数到0时唤醒等待线程，用于等待不返回future的任务
+class Latch
+{
+public:
+    explicit Latch(size_t count)
+        : m_count(count)
+    {
+    }
+    void countDown()
+    {
+        if (--m_count == 0)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_condition.notify_all();
+        }
+    }
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this] { return m_count == 0; });
+    }
+
+private:
+    std::atomic<size_t> m_count;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+};
+
+void report(const char* name, size_t tasks, double ms)
+{
+    printf("%-36s %10.1f ms %10.1f ns/task %12.0f tasks/s\n", name, ms, ms * 1e6 / double(tasks), double(tasks) / ms * 1e3);
+}
+
+void reportStats(const ThreadPool& pool)
+{
+    ThreadPool::Stats stats = pool.stats();
+    printf("%-36s executed=%llu steals=%llu idle=%.1fms queued=%zu\n", "", (unsigned long long)stats.executed, (unsigned long long)stats.steals,
+           double(stats.idleMicroseconds) / 1000.0, stats.queued);
+}
+
+// 递归拆分区间，子任务由工作线程提交到自己的队列，空闲线程窃取
+void splitRange(TaskGroup& group, uint64_t begin, uint64_t end)
+{
+    while (end - begin > 64)
+    {
+        const uint64_t middle = begin + (end - begin) / 2;
+        group.run([&group, middle, end]() { splitRange(group, middle, end); });
+        end = middle;
+    }
+    for (uint64_t i = begin; i < end; ++i)
+    {
+        tinyTask(i);
+    }
+}
+
+}   // namespace
+
+int main(int argc, char* argv[])
+{
+    const size_t count = argc > 1 ? size_t(atoll(argv[1])) : 2000000;
+    size_t threads = argc > 2 ? size_t(atoi(argv[2])) : std::thread::hardware_concurrency();
+    if (threads == 0)
+    {
+        threads = 1;
+    }
+    printf("tasks=%zu threads=%zu\n", count, threads);
+
+    {
+        legacy::ThreadPool pool(threads);
+        Timer timer;
+        std::vector<std::future<void>> futures;
+        futures.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            futures.push_back(pool.enqueue(tinyTask, uint64_t(i)));
+        }
+        for (auto& future : futures)
+        {
+            future.wait();
+        }
+        report("legacy enqueue + future", count, timer.elapsedMs());
+    }
+
+    {
+        ThreadPool pool(threads);
+        Timer timer;
+        std::vector<std::future<void>> futures;
+        futures.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            futures.push_back(pool.enqueue(tinyTask, uint64_t(i)));
+        }
+        for (auto& future : futures)
+        {
+            future.wait();
+        }
+        report("work-stealing enqueue + future", count, timer.elapsedMs());
+        reportStats(pool);
+    }
+
+    {
+        Latch latch(count);   // 在线程池之前构造，保证工作线程退出后才析构
+        ThreadPool pool(threads);
+        Timer timer;
+        for (size_t i = 0; i < count; ++i)
+        {
+            pool.post(
+                [i, &latch]()
+                {
+                    tinyTask(i);
+                    latch.countDown();
+                });
+        }
+        latch.wait();
+        report("work-stealing post", count, timer.elapsedMs());
+        reportStats(pool);
+    }
+
+    {
+        Latch latch(count);   // 在线程池之前构造，保证工作线程退出后才析构
+        ThreadPool pool(threads);
+        Timer timer;
+        std::vector<ThreadPool::Task> tasks;
+        tasks.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            tasks.push_back(
+                [i, &latch]()
+                {
+                    tinyTask(i);
+                    latch.countDown();
+                });
+        }
+        pool.postBulk(tasks.begin(), tasks.end());
+        latch.wait();
+        report("work-stealing postBulk", count, timer.elapsedMs());
+        reportStats(pool);
+    }
+
+    {
+        ThreadPool pool(threads);
+        Timer timer;
+        TaskGroup group(pool);
+        for (size_t i = 0; i < count; ++i)
+        {
+            group.run(std::bind(tinyTask, uint64_t(i)));
+        }
+        group.wait();
+        report("work-stealing TaskGroup", count, timer.elapsedMs());
+        reportStats(pool);
+    }
+
+    {
+        ThreadPool pool(threads);
+        Timer timer;
+        TaskGroup group(pool);
+        group.run([&group, count]() { splitRange(group, 0, count); });
+        group.wait();
+        report("work-stealing recursive split", count, timer.elapsedMs());
+        reportStats(pool);
+    }
+
+    {
+        // 取消：提交后立即取消，未开始的任务直接丢弃
+        ThreadPool pool(threads);
+        Timer timer;
+        TaskGroup group(pool);
+        for (size_t i = 0; i < count; ++i)
+        {
+            group.run(std::bind(tinyTask, uint64_t(i)));
+        }
+        group.cancel();
+        group.wait();
+        report("work-stealing TaskGroup cancelled", count, timer.elapsedMs());
+        reportStats(pool);
+    }
+
+    printf("sink=%llu\n", (unsigned long long)g_sink.load());
+    return 0;
+}
@@ -0,0 +1,309 @@
+﻿/**
+ * 快照检查：根目录（"/"、"C:/"）的父子关系、带末尾'/'的路径再次扫描、损坏的快照文件、监听目录变化、损坏的索引文件。
+ *
+ * 用法：ScanSnapshotTest，全部通过时返回0
+ */
+#include "NameIndex.h"
+#include "ScanFile.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+int g_failed = 0;
+
+#define CHECK(condition)                                                 \
+    do                                                                   \
+    {                                                                    \
+        if (!(condition))                                                \
+        {                                                                \
+            printf("%s:%d 检查失败：%s\n", __FILE__, __LINE__, #condition); \
+            ++g_failed;                                                  \
+        }                                                                \
+    } while (0)
+
+DirRecord makeDir(const std::string& path, const std::string& file, uint64_t size)
+{
+    DirRecord dir;
+    dir.path = path;
+    FileRecord record = {0, uint32_t(file.size()), size, 1, 1};
+    dir.names = file;
+    dir.files.push_back(record);
+    return dir;
+}
+
+/**
+ * @brief 根目录的子目录父路径为"/"或"C:/"，需要能找到根目录
+ */
+void checkRootChildren(const std::string& root, const std::string& prefix)
+{
+    ScanSnapshot snapshot;
+    snapshot.setRoot(root);
+    snapshot.upsert(makeDir(root, "a.txt", 1));
+    snapshot.upsert(makeDir(prefix + "usr", "b.txt", 2));
+    snapshot.upsert(makeDir(prefix + "usr/lib", "c.txt", 3));
+    snapshot.upsert(makeDir(prefix + "etc", "d.txt", 4));
+    snapshot.buildChildren();
+    CHECK(snapshot.find(root)->children.size() == 2);
+    CHECK(snapshot.find(prefix + "usr")->children.size() == 1);
+
+    const std::string fileName = "ScanSnapshotTest.snapshot";
+    CHECK(snapshot.save(fileName));
+    ScanSnapshot loaded;
+    CHECK(loaded.load(fileName));
+    CHECK(loaded.root() == root);
+    CHECK(loaded.find(root) && loaded.find(root)->children.size() == 2);
+    std::remove(fileName.c_str());
+}
+
+void checkPaths()
+{
+    CHECK(ScanSnapshot::normalizePath("/") == "/");
+    CHECK(ScanSnapshot::normalizePath("/home/") == "/home");
+    CHECK(ScanSnapshot::normalizePath("/home//") == "/home");
+    CHECK(ScanSnapshot::normalizePath("C:/") == "C:/");
+    CHECK(ScanSnapshot::normalizePath("C:/data/") == "C:/data");
+    CHECK(ScanSnapshot::parentPath("/") == "");
+    CHECK(ScanSnapshot::parentPath("/home") == "/");
+    CHECK(ScanSnapshot::parentPath("/home/user") == "/home");
+    CHECK(ScanSnapshot::parentPath("C:/") == "");
+    CHECK(ScanSnapshot::parentPath("C:/data") == "C:/");
+}
+
+/**
+ * @brief 文件名超出所属目录名称区的快照应加载失败，而不是抛出异常
+ */
+void checkCorrupt()
+{
+    ScanSnapshot snapshot;
+    snapshot.setRoot("/data");
+    snapshot.upsert(makeDir("/data", "a.txt", 1));
+    const std::string fileName = "ScanSnapshotTest.snapshot";
+    CHECK(snapshot.save(fileName));
+
+    // DiskFile::nameLength位于文件头（56字节）、一个DiskDir（56字节）之后的第28字节
+    FILE* fp = fopen(fileName.c_str(), "r+b");
+    CHECK(fp != nullptr);
+    if (fp)
+    {
+        const uint32_t length = 1000;
+        fseek(fp, 56 + 56 + 28, SEEK_SET);
+        fwrite(&length, sizeof(length), 1, fp);
+        fclose(fp);
+    }
+    ScanSnapshot loaded;
+    bool ok = true;
+    try
+    {
+        ok = loaded.load(fileName);
+    }
+    catch (...)
+    {
+        CHECK(!"load抛出异常");
+    }
+    CHECK(!ok);
+    std::remove(fileName.c_str());
+}
+
+/**
+ * @brief 文件名索引保存后可以读取；截断、倒排表数量或文件名偏移错误的索引文件读取失败
+ */
+void checkNameIndex()
+{
+    ScanSnapshot snapshot;
+    snapshot.setRoot("/data");
+    snapshot.upsert(makeDir("/data", "readme.txt", 1));
+    snapshot.upsert(makeDir("/data/src", "main.cpp", 2));
+    NameIndex index;
+    index.build(snapshot);
+    const std::string fileName = "ScanSnapshotTest.index";
+    CHECK(index.save(fileName));
+    NameIndex loaded;
+    CHECK(loaded.load(fileName));
+    CHECK(loaded.search("main").size() == 1);
+
+    FILE* fp = fopen(fileName.c_str(), "rb");
+    std::string data;
+    if (fp)
+    {
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        {
+            data.append(buffer, n);
+        }
+        fclose(fp);
+    }
+    auto loadPatched = [&](const std::string& content)
+    {
+        FILE* out = fopen(fileName.c_str(), "wb");
+        fwrite(content.data(), 1, content.size(), out);
+        fclose(out);
+        NameIndex corrupt;
+        return corrupt.load(fileName);
+    };
+    CHECK(!loadPatched(data.substr(0, data.size() - 4)));   // 截断
+
+    // 文件头：magic 8 + version 4 + reserved 4 + entryCount、nameBytes、dirCount、dirBytes、bucketCount、postingCount各8字节
+    std::string patched = data;
+    memset(&patched[16 + 4 * 8], 0, 8);   // bucketCount为0，文件数不为0
+    CHECK(!loadPatched(patched));
+
+    patched = data;
+    const uint32_t offset = 1000;
+    memcpy(&patched[64 + 4], &offset, sizeof(offset));   // 第一个文件的nameOffset
+    CHECK(!loadPatched(patched));
+    std::remove(fileName.c_str());
+}
+
+#ifndef _WIN32
+void writeFile(const std::string& fileName, const char* data)
+{
+    FILE* fp = fopen(fileName.c_str(), "wb");
+    fputs(data, fp);
+    fclose(fp);
+}
+
+/**
+ * @brief 扫描并等待完成
+ */
+void scanAndWait(ScanFile& scanFile, const std::string& root)
+{
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool finished = false;
+    scanFile.setCallback([](const FileInfo&) {});
+    scanFile.setFinishedCallback(
+        [&]()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished = true;
+            condition.notify_all();
+        });
+    scanFile.scan(root);
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&] { return finished; });
+}
+
+/**
+ * @brief 监听期间的增删同步到快照；由事件更新过的目录再次扫描时重新遍历，结果与磁盘一致
+ */
+void checkWatch(const std::string& root, const std::string& snapshotFile)
+{
+    {
+        ScanFile scanFile;
+        scanFile.setSnapshotFile(snapshotFile);
+        scanFile.setWatchEnabled(true);
+        scanAndWait(scanFile, root);
+        CHECK(scanFile.totalSize() == 15);
+
+        writeFile(root + "/a/4.txt", "1234567");
+        mkdir((root + "/c").c_str(), 0755);
+        writeFile(root + "/c/5.txt", "123");
+        std::remove((root + "/1.txt").c_str());
+        for (int i = 0; i < 200 && (scanFile.totalSize() != 20 || scanFile.files().size() != 4); ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        CHECK(scanFile.totalSize() == 20);
+        CHECK(scanFile.files().size() == 4);
+    }   // 析构时保存快照
+
+    ScanFile scanFile;
+    scanFile.setSnapshotFile(snapshotFile);
+    scanAndWait(scanFile, root);
+    CHECK(scanFile.totalSize() == 20);
+    CHECK(scanFile.files().size() == 4);
+}
+
+/**
+ * @brief 路径带末尾'/'时再次扫描，第二次扫描复用快照，结果与第一次相同
+ */
+void checkRescan()
+{
+    char base[] = "/tmp/ScanSnapshotTestXXXXXX";
+    if (!mkdtemp(base))
+    {
+        CHECK(!"mkdtemp失败");
+        return;
+    }
+    const std::string root = base;
+    mkdir((root + "/a").c_str(), 0755);
+    mkdir((root + "/a/b").c_str(), 0755);
+    for (const char* name : {"/1.txt", "/a/2.txt", "/a/b/3.txt"})
+    {
+        FILE* fp = fopen((root + name).c_str(), "wb");
+        fputs("12345", fp);
+        fclose(fp);
+    }
+
+    const std::string snapshotFile = root + ".snapshot";
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool finished = false;
+    ScanFile scanFile;
+    scanFile.setSnapshotFile(snapshotFile);
+    scanFile.setCallback([](const FileInfo&) {});
+    scanFile.setFinishedCallback(
+        [&]()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished = true;
+            condition.notify_all();
+        });
+    for (int i = 0; i < 2; ++i)
+    {
+        finished = false;
+        scanFile.scan(root + "/");
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [&] { return finished; });
+        lock.unlock();
+        CHECK(scanFile.files().size() == 3);
+        CHECK(scanFile.totalSize() == 15);
+    }
+
+    checkWatch(root, snapshotFile);
+
+    std::remove((root + "/a/b/3.txt").c_str());
+    std::remove((root + "/a/2.txt").c_str());
+    std::remove((root + "/a/4.txt").c_str());
+    std::remove((root + "/c/5.txt").c_str());
+    rmdir((root + "/c").c_str());
+    rmdir((root + "/a/b").c_str());
+    rmdir((root + "/a").c_str());
+    rmdir(root.c_str());
+    std::remove(snapshotFile.c_str());
+}
+#endif
+
+}   // namespace
+
+int main()
+{
+    checkPaths();
+    checkRootChildren("/", "/");
+    checkRootChildren("C:/", "C:/");
+    checkCorrupt();
+    checkNameIndex();
+#ifndef _WIN32
+    checkRescan();
+#endif
+    if (g_failed != 0)
+    {
+        printf("%d项检查失败\n", g_failed);
+        return 1;
+    }
+    printf("全部通过\n");
+    return 0;
+}
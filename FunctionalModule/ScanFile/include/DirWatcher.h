@@ -0,0 +1,65 @@
+﻿#ifndef DIRWATCHER_H
+#define DIRWATCHER_H
+
+/**
+ * 目录变化监听器，Linux下基于inotify实现，每个目录一个watch。
+ * 在独立线程中读取事件，并通过回调通知目录下条目的变化。
+ * start、stop、addWatch可以在不同线程中调用；removeWatch可以在回调中调用。
+ *
+ * 注意：inotify的watch数量受 /proc/sys/fs/inotify/max_user_watches 限制，
+ * 监听千万级文件的目录树时需要先调大该值；超出限制的目录只是不再实时更新，
+ * 下次扫描时依然会通过目录修改时间发现变化。
+ * windows下暂未实现（start返回false），只使用快照增量扫描。
+ */
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+struct WatchEvent
+{
+    enum Type
+    {
+        Created,    // 新建或移入
+        Modified,   // 内容写入完成或属性变化
+        Removed,    // 删除或移出
+        Overflow    // 内核事件队列溢出，需要重新扫描
+    };
+    Type type;
+    std::string dir;    // 事件所在目录
+    std::string name;   // 条目名称
+    bool isDir;
+};
+
+using WatchCall = std::function<void(const WatchEvent&)>;
+
+class DirWatcher
+{
+public:
+    DirWatcher();
+    ~DirWatcher();
+
+    bool start(WatchCall callback);        // 启动监听线程
+    void stop();                           // 停止监听并移除所有watch
+    bool addWatch(const std::string& dir); // 监听目录（不递归），已监听的目录直接返回
+    void removeWatch(const std::string& dir);   // 移除目录及其所有子目录的监听
+    bool isRunning() const { return m_running; }
+
+private:
+    void run();
+
+private:
+    WatchCall m_callback;
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    std::mutex m_stateMutex;   // 串行化start、stop、addWatch，保护m_fd、m_wakeFd的创建和关闭
+    std::mutex m_mutex;
+    std::unordered_map<int, std::string> m_wdToDir;   // watch描述符 -> 目录
+    std::unordered_map<std::string, int> m_dirToWd;
+    int m_fd = -1;       // inotify描述符
+    int m_wakeFd = -1;   // 用于唤醒监听线程退出
+};
+
+#endif   // DIRWATCHER_H
@@ -0,0 +1,78 @@
+﻿#ifndef DUPLICATEFINDER_H
+#define DUPLICATEFINDER_H
+
+/**
+ * 重复文件查找，分三步逐步缩小需要读取的数据量：
+ *   1、按文件大小分组，大小唯一的文件直接排除（不读取文件）；
+ *   2、读取文件头尾各64KB计算哈希，再次分组排除；
+ *   3、剩余候选文件完整读取计算XXH64哈希，哈希相同的文件为候选重复文件；
+ *   4、逐字节比较确认（默认开启，可以通过setVerify关闭），只有内容完全相同的文件才作为重复文件输出，
+ *      结果可以放心用于删除文件。
+ * 第2、3、4步在独立的读取线程池中并行读取（阻塞读文件不占用共用线程池，不影响扫描、索引等任务），
+ * 每个任务使用独立的大块对齐缓冲区，任务之间只通过原子计数分配工作；
+ * 同一大小的候选文件全部计算完成后立即通过回调输出该组结果，无需等待全部完成。
+ */
+#include "ScanFile.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct DuplicateGroup
+{
+    unsigned long long size;          // 单个文件大小
+    std::vector<std::string> files;   // 内容相同的文件
+};
+
+using DuplicateCall = std::function<void(const DuplicateGroup&)>;   // 重复文件回调函数类型（在工作线程中调用）
+
+class SCANFILE_API DuplicateFinder
+{
+public:
+    explicit DuplicateFinder(size_t threads = 0);   // 同时读取的文件数（读取线程数），为0时使用默认值4
+    ~DuplicateFinder();
+
+    void setCallback(DuplicateCall callback);          // 设置重复文件回调函数
+    void setFinishedCallback(FinishedCall callback);   // 设置查找完成回调函数
+    void setMinSize(unsigned long long size);          // 忽略小于该大小的文件，默认1字节（忽略空文件）
+    void setVerify(bool verify);                       // 哈希相同后是否逐字节比较确认，默认开启
+    void find(std::vector<FileInfo> files);            // 异步查找重复文件
+    void stop();                                       // 停止查找并等待线程退出
+
+    unsigned long long bytesRead() const { return m_bytesRead; }     // 已读取字节数
+    unsigned long long filesHashed() const { return m_filesHashed; } // 已计算哈希的文件数
+
+private:
+    struct Candidate
+    {
+        const FileInfo* file;
+        uint64_t hash;        // 第2步为头尾哈希，第3步为完整哈希
+        uint32_t group;       // 所属分组下标
+        bool complete;        // 头尾读取已覆盖整个文件，哈希即为完整哈希
+        bool valid;           // 读取失败的文件不参与比较
+    };
+
+    void run(std::vector<FileInfo> files);
+    void parallelFor(size_t count, const std::function<void(size_t, char*)>& fun);   // 多线程处理[0, count)
+    bool hashPartial(Candidate& candidate, char* buffer);
+    bool hashFull(Candidate& candidate, char* buffer);
+    bool sameContent(const std::string& a, const std::string& b, unsigned long long size, char* buffer);   // 逐字节比较
+    void emitGroups(std::vector<Candidate>& candidates, size_t begin, size_t end, char* buffer);   // 按哈希分组，确认后输出
+
+private:
+    DuplicateCall m_callback;
+    FinishedCall m_finishedCallback;
+    size_t m_threads;
+    std::unique_ptr<ThreadPool> m_pool;   // 读取线程池，只执行本对象的读取任务
+    unsigned long long m_minSize = 1;
+    bool m_verify = true;
+    std::thread m_thread;   // 调度线程
+    std::atomic<bool> m_quit;
+    std::atomic<unsigned long long> m_bytesRead;
+    std::atomic<unsigned long long> m_filesHashed;
+};
+
+#endif   // DUPLICATEFINDER_H
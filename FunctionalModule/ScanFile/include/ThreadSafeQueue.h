@@ -7,6 +7,7 @@
 #include <stdexcept>
 
 // 线程安全的队列实现，使用自旋锁代替互斥锁来提高性能。
+// 注意：自旋锁在线程数超过CPU核心数时会空转，front()+pop()也不是原子操作，多个消费者时请使用MPMCQueue。
 template<typename T>
 class ThreadSafeQueue {
 public:
@@ -0,0 +1,50 @@
+﻿#include "searchmodel.h"
+
+#include "NameIndex.h"
+
+SearchModel::SearchModel(QObject* parent)
+    : QAbstractListModel(parent)
+{
+}
+
+void SearchModel::setIndex(const NameIndex* index)
+{
+    beginResetModel();
+    m_index = index;
+    m_results.clear();
+    endResetModel();
+}
+
+void SearchModel::setResults(std::vector<uint32_t>&& results)
+{
+    beginResetModel();
+    m_results = std::move(results);
+    endResetModel();
+}
+
+int SearchModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid() || !m_index)
+    {
+        return 0;
+    }
+    return int(m_results.size());
+}
+
+QVariant SearchModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || !m_index || size_t(index.row()) >= m_results.size())
+    {
+        return QVariant();
+    }
+    const uint32_t id = m_results[size_t(index.row())];
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        return QString::fromStdString(m_index->path(id));
+    case Qt::ToolTipRole:
+        return QString("%1字节").arg(m_index->entry(id).size);
+    default:
+        return QVariant();
+    }
+}
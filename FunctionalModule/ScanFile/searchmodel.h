@@ -0,0 +1,36 @@
+﻿/******************************************************************************
+ * @文件名     searchmodel.h
+ * @功能       文件名搜索结果模型，配合QListView实现虚拟列表
+ *
+ * @开发者     mhf
+ * @邮箱       1603291350@qq.com
+ * @时间       2025/03/10
+ * @备注       只保存匹配文件在索引中的下标，显示时才拼接路径，千万级结果也只占用很少内存，
+ *            视图只请求可见行的数据，不需要像QPlainTextEdit一样把所有文本追加进去。
+ *****************************************************************************/
+#ifndef SEARCHMODEL_H
+#define SEARCHMODEL_H
+
+#include <QAbstractListModel>
+#include <vector>
+
+class NameIndex;
+
+class SearchModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    explicit SearchModel(QObject* parent = nullptr);
+
+    void setIndex(const NameIndex* index);               // 设置文件名索引（由调用者持有）
+    void setResults(std::vector<uint32_t>&& results);   // 设置查询结果（文件在索引中的下标）
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+private:
+    const NameIndex* m_index = nullptr;
+    std::vector<uint32_t> m_results;
+};
+
+#endif   // SEARCHMODEL_H
@@ -0,0 +1,276 @@
+﻿#include "treemapwidget.h"
+
+#include "DirTree.h"
+#include <QCursor>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QToolTip>
+#include <algorithm>
+
+namespace {
+
+const int MAX_DEPTH = 3;          // 最多向下显示的目录层级
+const double MIN_TILE = 3.0;      // 小于该像素的矩形不再显示
+const double HEADER = 14.0;       // 目录名标题栏高度
+const double MIN_NESTED = 40.0;   // 矩形宽高都大于该值时才继续显示子目录
+
+/**
+ * @brief 计算一行矩形中最差的长宽比（squarified算法）
+ * @param sum   该行面积之和
+ * @param minV  该行最小面积
+ * @param maxV  该行最大面积
+ * @param side  行所在的边长
+ */
+double worstRatio(double sum, double minV, double maxV, double side)
+{
+    const double s2 = sum * sum;
+    const double w2 = side * side;
+    return std::max(w2 * maxV / s2, s2 / (w2 * minV));
+}
+
+QString sizeText(quint64 size)
+{
+    const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+    double value = double(size);
+    int unit = 0;
+    while (value >= 1024.0 && unit < 4)
+    {
+        value /= 1024.0;
+        ++unit;
+    }
+    return QString("%1%2").arg(value, 0, 'f', unit == 0 ? 0 : 1).arg(units[unit]);
+}
+
+}   // namespace
+
+TreemapWidget::TreemapWidget(QWidget* parent)
+    : QWidget(parent)
+{
+    setMouseTracking(true);
+}
+
+void TreemapWidget::setTree(const DirTree* tree)
+{
+    m_tree = tree;
+    setRoot(0);
+}
+
+void TreemapWidget::setRoot(quint32 index)
+{
+    if (!m_tree || index >= m_tree->size())
+    {
+        m_tiles.clear();
+        update();
+        return;
+    }
+    m_root = index;
+    m_dirty = true;
+    update();
+    emit rootChanged(QString::fromStdString(m_tree->path(index)));
+}
+
+void TreemapWidget::updateLayout()
+{
+    if (!m_dirty)
+    {
+        return;
+    }
+    m_dirty = false;
+    m_tiles.clear();
+    if (!m_tree || m_tree->isEmpty())
+    {
+        return;
+    }
+    layoutNode(m_root, QRectF(rect()), 0);
+}
+
+/**
+ * @brief 布局一个目录：先占据整个矩形，再把子目录和自身文件按大小排入内部区域
+ */
+void TreemapWidget::layoutNode(quint32 node, const QRectF& rect, int depth)
+{
+    m_tiles.append({rect, node, false, depth});
+
+    QRectF inner = rect.adjusted(1, HEADER, -1, -1);
+    if (depth >= MAX_DEPTH || inner.width() < MIN_NESTED || inner.height() < MIN_NESTED)
+    {
+        return;
+    }
+
+    const DirNode& dirNode = m_tree->node(node);
+    QVector<Item> items;
+    items.reserve(int(dirNode.childCount) + 1);
+    for (quint32 c = dirNode.firstChild; c < dirNode.firstChild + dirNode.childCount; ++c)
+    {
+        if (m_tree->node(c).totalSize > 0)
+        {
+            items.append({c, false, double(m_tree->node(c).totalSize)});
+        }
+    }
+    if (dirNode.size > 0)
+    {
+        items.append({node, true, double(dirNode.size)});
+    }
+    if (items.isEmpty())
+    {
+        return;
+    }
+    std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) { return a.value > b.value; });
+
+    // 将大小换算为面积，过小的矩形直接丢弃（剩余面积留空）
+    const double scale = inner.width() * inner.height() / double(dirNode.totalSize);
+    const double minArea = MIN_TILE * MIN_TILE;
+    int count = 0;
+    for (Item& item : items)
+    {
+        item.value *= scale;
+        if (item.value < minArea)
+        {
+            break;
+        }
+        ++count;
+    }
+    items.resize(count);
+    squarify(items, inner, depth + 1);
+}
+
+/**
+ * @brief squarified treemap布局（Bruls, Huizing, van Wijk）
+ *
+ * 沿矩形短边逐行放置矩形，只要加入下一个矩形不会使该行最差长宽比变差就继续加入，
+ * 否则固定该行并在剩余区域中开始新的一行。
+ *
+ * @param items 按面积从大到小排序，value为面积
+ * @param rect  布局区域
+ * @param depth 层级
+ */
+void TreemapWidget::squarify(QVector<Item>& items, QRectF rect, int depth)
+{
+    int start = 0;
+    while (start < items.size() && rect.width() > 0 && rect.height() > 0)
+    {
+        const double side = std::min(rect.width(), rect.height());
+        double sum = items[start].value;
+        double maxV = items[start].value;
+        double minV = items[start].value;
+        int end = start + 1;
+        while (end < items.size())
+        {
+            const double v = items[end].value;
+            if (worstRatio(sum + v, std::min(minV, v), maxV, side) > worstRatio(sum, minV, maxV, side))
+            {
+                break;
+            }
+            sum += v;
+            minV = std::min(minV, v);
+            ++end;
+        }
+
+        // 固定这一行：行厚度 = 面积和 / 边长
+        const double thickness = sum / side;
+        const bool horizontal = rect.width() >= rect.height();   // 宽大于高时沿左侧竖直排列
+        double offset = 0;
+        for (int i = start; i < end; ++i)
+        {
+            const double length = items[i].value / thickness;
+            QRectF tile = horizontal ? QRectF(rect.left(), rect.top() + offset, thickness, length)
+                                     : QRectF(rect.left() + offset, rect.top(), length, thickness);
+            offset += length;
+            if (items[i].files)
+            {
+                m_tiles.append({tile, items[i].node, true, depth});
+            }
+            else
+            {
+                layoutNode(items[i].node, tile, depth);
+            }
+        }
+        rect = horizontal ? rect.adjusted(thickness, 0, 0, 0) : rect.adjusted(0, thickness, 0, 0);
+        start = end;
+    }
+}
+
+const TreemapWidget::Tile* TreemapWidget::tileAt(const QPointF& pos) const
+{
+    // 内层矩形在后面，倒序查找第一个包含该点的矩形
+    for (int i = m_tiles.size() - 1; i >= 0; --i)
+    {
+        if (m_tiles[i].rect.contains(pos))
+        {
+            return &m_tiles[i];
+        }
+    }
+    return nullptr;
+}
+
+void TreemapWidget::paintEvent(QPaintEvent* event)
+{
+    Q_UNUSED(event)
+    updateLayout();
+
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().window());
+    for (const Tile& tile : m_tiles)
+    {
+        // 不同目录使用不同色相，层级越深颜色越浅
+        const int hue = int((tile.node * 47) % 360);
+        QColor color = tile.files ? QColor(200, 200, 200) : QColor::fromHsv(hue, 120, 230 - tile.depth * 20);
+        painter.setPen(QColor(60, 60, 60));
+        painter.setBrush(color);
+        painter.drawRect(tile.rect);
+
+        if (tile.rect.width() > 30 && tile.rect.height() > HEADER)
+        {
+            const DirNode& node = m_tree->node(tile.node);
+            QString text = tile.files ? QString("[文件] %1").arg(sizeText(node.size))
+                                      : QString("%1 %2").arg(QString::fromStdString(m_tree->name(tile.node)), sizeText(node.totalSize));
+            QRectF textRect(tile.rect.left() + 2, tile.rect.top(), tile.rect.width() - 4, HEADER);
+            painter.drawText(textRect, Qt::AlignLeft | Qt::AlignVCenter, painter.fontMetrics().elidedText(text, Qt::ElideRight, int(textRect.width())));
+        }
+    }
+}
+
+void TreemapWidget::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+    m_dirty = true;
+}
+
+void TreemapWidget::mousePressEvent(QMouseEvent* event)
+{
+    if (!m_tree || m_tree->isEmpty())
+    {
+        return;
+    }
+    if (event->button() == Qt::RightButton)   // 返回上一级
+    {
+        setRoot(m_tree->node(m_root).parent);
+        return;
+    }
+    const Tile* tile = tileAt(event->pos());
+    if (!tile || tile->node == m_root)
+    {
+        return;
+    }
+    // 进入当前根目录下被点击的那一级子目录
+    quint32 node = tile->node;
+    while (m_tree->node(node).parent != m_root && node != 0)
+    {
+        node = m_tree->node(node).parent;
+    }
+    setRoot(node);
+}
+
+void TreemapWidget::mouseMoveEvent(QMouseEvent* event)
+{
+    const Tile* tile = tileAt(event->pos());
+    if (!tile)
+    {
+        QToolTip::hideText();
+        return;
+    }
+    const DirNode& node = m_tree->node(tile->node);
+    QString text = tile->files ? QString("%1\n文件：%2个  %3").arg(QString::fromStdString(m_tree->path(tile->node))).arg(node.fileCount).arg(sizeText(node.size))
+                               : QString("%1\n文件：%2个  %3").arg(QString::fromStdString(m_tree->path(tile->node))).arg(node.totalFiles).arg(sizeText(node.totalSize));
+    QToolTip::showText(QCursor::pos(), text, this);
+}
@@ -0,0 +1,64 @@
+﻿/******************************************************************************
+ * @文件名     treemapwidget.h
+ * @功能       使用squarified treemap算法显示目录占用，矩形面积与目录大小成正比
+ *
+ * @开发者     mhf
+ * @邮箱       1603291350@qq.com
+ * @时间       2025/03/08
+ * @备注       只计算当前显示根目录下有限层级、且大于最小像素的矩形，矩形数量与窗口大小有关，
+ *            与目录树的规模无关；左键进入目录，右键返回上一级。
+ *****************************************************************************/
+#ifndef TREEMAPWIDGET_H
+#define TREEMAPWIDGET_H
+
+#include <QVector>
+#include <QWidget>
+
+class DirTree;
+
+class TreemapWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit TreemapWidget(QWidget* parent = nullptr);
+
+    void setTree(const DirTree* tree);   // 设置目录树（由调用者持有）
+    void setRoot(quint32 index);         // 设置当前显示的根目录
+
+signals:
+    void rootChanged(const QString& path);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+
+private:
+    struct Item
+    {
+        quint32 node;    // 目录下标
+        bool files;      // 目录自身文件（不含子目录）
+        double value;    // 大小
+    };
+    struct Tile
+    {
+        QRectF rect;
+        quint32 node;
+        bool files;
+        int depth;
+    };
+
+    void updateLayout();   // 需要时重新计算矩形
+    void layoutNode(quint32 node, const QRectF& rect, int depth);
+    void squarify(QVector<Item>& items, QRectF rect, int depth);
+    const Tile* tileAt(const QPointF& pos) const;   // 鼠标位置所在的最内层矩形
+
+private:
+    const DirTree* m_tree = nullptr;
+    quint32 m_root = 0;
+    bool m_dirty = true;
+    QVector<Tile> m_tiles;   // 按绘制顺序保存，外层在前
+};
+
+#endif   // TREEMAPWIDGET_H
@@ -1,32 +1,85 @@
 ﻿#include "widget.h"
 #include "ui_widget.h"
+#include <QApplication>
 #include <QDebug>
+#include <QFile>
 #include <QFileDialog>
 
 Widget::Widget(QWidget* parent)
     : QWidget(parent)
     , ui(new Ui::Widget)
+    , m_fileCount(0)
 {
     ui->setupUi(this);
     m_scanFile.setCallback(std::bind(&Widget::fun, this, std::placeholders::_1));
+    // 扫描完成回调在线程池中执行，转到界面线程处理
+    m_scanFile.setFinishedCallback([this]() { QMetaObject::invokeMethod(this, &Widget::on_finished, Qt::QueuedConnection); });
+    // 保存上一次扫描结果，再次扫描时只遍历修改过的目录；扫描完成后监听目录变化，总大小实时更新
+    m_scanFile.setSnapshotFile(QString(qApp->applicationDirPath() + "/scanfile.snapshot").toStdString());
+    m_scanFile.setWatchEnabled(true);
+
+    m_duplicateFinder.setCallback(std::bind(&Widget::duplicate, this, std::placeholders::_1));
+    m_duplicateFinder.setFinishedCallback(
+        [this]()
+        {
+            QMetaObject::invokeMethod(
+                this, [this]() { qInfo() << QString("重复文件查找完成，读取：%1字节，耗时：%2ms").arg(m_duplicateFinder.bytesRead()).arg(m_elapsed.elapsed()); },
+                Qt::QueuedConnection);
+        });
     connect(&m_timer, &QTimer::timeout, this, &Widget::on_timeout);
+    connect(ui->treemap, &TreemapWidget::rootChanged, ui->label_path, &QLabel::setText);
+
+    // 读取上一次保存的文件名索引，启动后不需要扫描就可以搜索
+    m_searchModel.setIndex(&m_nameIndex);
+    ui->listView->setModel(&m_searchModel);
+    const QString indexFile = qApp->applicationDirPath() + "/scanfile.index";
+    if (m_nameIndex.load(indexFile.toStdString()))
+    {
+        on_lineEdit_search_textChanged(QString());
+    }
+    else if (QFile::exists(indexFile))
+    {
+        qWarning() << "文件名索引损坏，扫描完成后重新建立";
+        QFile::remove(indexFile);
+    }
 }
 
 Widget::~Widget()
 {
     m_timer.stop();
+    m_duplicateFinder.stop();
+    m_cancelBuild = true;   // 当前步骤完成后退出，还未交给界面的结果由m_builtTree、m_builtIndex释放
+    if (m_buildThread.joinable())
+    {
+        m_buildThread.join();
+    }
     delete ui;
 }
 
+/**
+ * @brief 扫描回调只计数，文件列表在扫描完成后通过文件名索引和虚拟列表显示
+ */
 void Widget::fun(const FileInfo& fileInfo)
 {
+    Q_UNUSED(fileInfo)
+    ++m_fileCount;
+}
+
+void Widget::duplicate(const DuplicateGroup& group)
+{
+    QString strGroup = QString("重复文件 [%1字节 x %2]\n").arg(group.size).arg(group.files.size());
+    for (const std::string& file : group.files)
+    {
+        strGroup += QString("    %1\n").arg(file.c_str());
+    }
     std::lock_guard<SpinLock> lock(m_spinLock);
-    m_strFileInfo += QString("%1  [%2字节]\n").arg(fileInfo.fileName.c_str()).arg(fileInfo.size);
-    m_size += fileInfo.size;
+    m_strFileInfo += strGroup;
 }
 
 void Widget::on_timeout()
 {
+    ui->label_size->setText(QString("文件数：%1  总大小：%2字节").arg(m_fileCount.load()).arg(m_scanFile.totalSize()));   // 监听目录变化时总大小实时更新
+
     std::lock_guard<SpinLock> lock(m_spinLock);
     if (m_strFileInfo.isEmpty())
     {
@@ -34,7 +87,88 @@ void Widget::on_timeout()
     }
     ui->plainTextEdit->appendPlainText(m_strFileInfo);
     m_strFileInfo.clear();
-    ui->label_size->setText(QString("总大小：%1字节").arg(m_size));
+}
+
+/**
+ * @brief 扫描完成，在后台线程中汇总目录大小、建立文件名索引，完成后再交给界面显示
+ *
+ * 千万级文件时建立需要较长时间，并且期间持有扫描结果的锁，不能在界面线程中执行。
+ */
+void Widget::on_finished()
+{
+    qInfo() << QString("扫描完成，耗时：%1ms").arg(m_elapsed.elapsed());
+    startBuild();
+}
+
+/**
+ * @brief 上一次建立还未完成时不在界面线程中等待，只做标记，在on_built中再建立一次
+ */
+void Widget::startBuild()
+{
+    if (m_building)
+    {
+        m_buildPending = true;
+        return;
+    }
+    if (m_buildThread.joinable())
+    {
+        m_buildThread.join();   // 线程已经完成建立，马上退出
+    }
+    m_building = true;
+    const std::string indexFile = QString(qApp->applicationDirPath() + "/scanfile.index").toStdString();
+    m_buildThread = std::thread(
+        [this, indexFile]()
+        {
+            QElapsedTimer timer;
+            timer.start();
+            std::unique_ptr<DirTree> tree(new DirTree);
+            m_scanFile.buildTree(*tree);   // 汇总每个目录的大小，显示目录占用
+            qInfo() << QString("目录汇总完成，目录数：%1，耗时：%2ms").arg(tree->size()).arg(timer.elapsed());
+
+            std::unique_ptr<NameIndex> index;
+            if (!m_cancelBuild)
+            {
+                timer.restart();
+                index.reset(new NameIndex);
+                m_scanFile.buildIndex(*index);
+                index->save(indexFile);
+                qInfo() << QString("文件名索引建立完成，文件数：%1，耗时：%2ms").arg(index->size()).arg(timer.elapsed());
+            }
+            if (!m_cancelBuild)
+            {
+                std::lock_guard<std::mutex> lock(m_builtMutex);
+                m_builtTree = std::move(tree);   // 结果归窗口所有，窗口在交给界面前销毁时由析构释放
+                m_builtIndex = std::move(index);
+            }
+            m_building = false;
+            QMetaObject::invokeMethod(this, &Widget::on_built, Qt::QueuedConnection);   // 窗口已销毁时不会调用
+        });
+}
+
+/**
+ * @brief 在界面线程中替换目录树和文件名索引，treemap和搜索列表只在界面线程中访问它们
+ */
+void Widget::on_built()
+{
+    std::unique_ptr<DirTree> tree;
+    std::unique_ptr<NameIndex> index;
+    {
+        std::lock_guard<std::mutex> lock(m_builtMutex);
+        tree = std::move(m_builtTree);
+        index = std::move(m_builtIndex);
+    }
+    if (tree && index)
+    {
+        m_tree = std::move(*tree);
+        m_nameIndex = std::move(*index);
+        ui->treemap->setTree(&m_tree);
+        on_lineEdit_search_textChanged(ui->lineEdit_search->text());
+    }
+    if (m_buildPending)
+    {
+        m_buildPending = false;
+        startBuild();
+    }
 }
 
 void Widget::on_pushButton_clicked(bool checked)
@@ -46,9 +180,10 @@ void Widget::on_pushButton_clicked(bool checked)
         {
             return;
         }
-        m_size = 0;
-        m_strFileInfo.clear();
+        m_fileCount = 0;
+        ui->treemap->setTree(nullptr);   // 重新扫描前先断开，避免显示正在重建的目录树
         ui->lineEdit->setText(path);
+        m_elapsed.start();
         m_scanFile.scan(path.toStdString());
         m_timer.start(50);
     }
@@ -58,3 +193,36 @@ void Widget::on_pushButton_clicked(bool checked)
         m_timer.stop();
     }
 }
+
+/**
+ * @brief 在上一次扫描结果中查找重复文件
+ */
+void Widget::on_but_duplicate_clicked()
+{
+    std::vector<FileInfo> files = m_scanFile.files();
+    if (files.empty())
+    {
+        return;
+    }
+    {
+        std::lock_guard<SpinLock> lock(m_spinLock);
+        m_strFileInfo.clear();
+    }
+    ui->plainTextEdit->clear();
+    ui->tabWidget->setCurrentWidget(ui->tab_duplicate);
+    m_elapsed.start();
+    m_duplicateFinder.find(std::move(files));
+    m_timer.start(50);
+}
+
+/**
+ * @brief 输入时即时搜索文件名，为空时显示所有文件
+ */
+void Widget::on_lineEdit_search_textChanged(const QString& text)
+{
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<uint32_t> results = m_nameIndex.search(text.toStdString());
+    ui->label_search->setText(QString("找到%1个文件，耗时：%2ms").arg(results.size()).arg(timer.elapsed()));
+    m_searchModel.setResults(std::move(results));
+}
@@ -1,9 +1,18 @@
 ﻿#ifndef WIDGET_H
 #define WIDGET_H
 
+#include "DirTree.h"
+#include "DuplicateFinder.h"
+#include "NameIndex.h"
 #include "ScanFile.h"
+#include "searchmodel.h"
+#include <QElapsedTimer>
 #include <QTimer>
 #include <QWidget>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 QT_BEGIN_NAMESPACE
 
@@ -22,18 +31,36 @@ public:
     ~Widget();
 
     void fun(const FileInfo& fileInfo);
+    void duplicate(const DuplicateGroup& group);
 private slots:
     void on_pushButton_clicked(bool checked);
+    void on_but_duplicate_clicked();
+    void on_lineEdit_search_textChanged(const QString& text);
 
 private:
     void on_timeout();
+    void on_finished();
+    void startBuild();   // 在后台线程中建立目录树、文件名索引
+    void on_built();     // 目录树、文件名索引在后台线程建立完成
 
 private:
     Ui::Widget* ui;
     ScanFile m_scanFile;
-    quint64 m_size = 0;
+    DuplicateFinder m_duplicateFinder;
+    DirTree m_tree;            // 目录占用统计
+    NameIndex m_nameIndex;     // 文件名索引
+    std::thread m_buildThread; // 扫描完成后建立目录树、文件名索引，不阻塞界面
+    std::atomic<bool> m_building{false};      // 后台线程正在建立
+    std::atomic<bool> m_cancelBuild{false};   // 窗口关闭时放弃建立
+    bool m_buildPending = false;              // 建立期间又扫描完成了一次，建立完成后再建立一次
+    std::mutex m_builtMutex;
+    std::unique_ptr<DirTree> m_builtTree;     // 建立完成、还未交给界面的结果，由m_builtMutex保护
+    std::unique_ptr<NameIndex> m_builtIndex;
+    SearchModel m_searchModel;
+    std::atomic<qulonglong> m_fileCount;   // 扫描到的文件数
     SpinLock m_spinLock;
     QString m_strFileInfo;
     QTimer m_timer;
+    QElapsedTimer m_elapsed;   // 扫描耗时
 };
 #endif   // WIDGET_H
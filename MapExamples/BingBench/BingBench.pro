@@ -0,0 +1,49 @@
+#---------------------------------------------------------------------------------------
+# @功能：      Bing坐标批量转换的精度检查和性能对比：逐点调用 与 bingbatch批量转换
+# @编译器：     Desktop Qt 5.14.2 MSVC2017 64bit（也支持其它编译器）
+# @Qt IDE：    D:/Qt/Qt5.14.2/Tools/QtCreator/share/qtcreator
+#
+# @开发者     mhf
+# @邮箱       1603291350@qq.com
+# @时间       2025-04-27 21:30:12
+# @备注       1、随机生成全球范围和国内范围的经纬度，每个级别分别用标量版本和批量版本计算；
+#            2、输出浮点像素坐标的最大误差、取整后不同的点数、瓦片编号不同的点数，误差超过bingbatch.h中说明的范围时返回1；
+#            3、输出单线程（每次少于65536个点）和多线程的耗时；
+#            4、命令行参数：BingBench [点数 默认4000000]。
+#---------------------------------------------------------------------------------------
+
+QT       += core concurrent
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+SOURCES += \
+    main.cpp \
+    $$PWD/../MapView3/MapView/bingbatch.cpp \
+    $$PWD/../MapView3/MapView/bingformula.cpp
+
+HEADERS += \
+    $$PWD/../MapView3/MapView/bingbatch.h \
+    $$PWD/../MapView3/MapView/bingformula.h
+
+INCLUDEPATH += $$PWD/../MapView3/MapView
+
+#  定义程序版本号
+VERSION = 1.0.0
+DEFINES += APP_VERSION=\\\"$$VERSION\\\"
+
+contains(QT_ARCH, i386){        # 使用32位编译器
+DESTDIR = $$PWD/../bin          # 程序输出路径
+}else{
+DESTDIR = $$PWD/../bin64        # 使用64位编译器
+}
+
+# msvc >= 2017  编译器使用utf-8编码
+msvc {
+    greaterThan(QMAKE_MSC_VER, 1900){       # msvc编译器版本大于2015
+        QMAKE_CFLAGS += /utf-8
+        QMAKE_CXXFLAGS += /utf-8
+    }else{
+#        message(msvc2015及以下版本在代码中使用【pragma execution_character_set("utf-8")】指定编码)
+    }
+}
@@ -0,0 +1,172 @@
+﻿/********************************************************************
+ * 文件名： main.cpp
+ * 时间：   2025-04-27 21:30:12
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   Bing坐标批量转换的精度检查和性能对比
+ * ******************************************************************/
+#include "bingbatch.h"
+#include "bingformula.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QPointF>
+#include <QRandomGenerator>
+#include <QThread>
+#include <QVector>
+#include <QtMath>
+
+static const int g_levels[] = {1, 5, 10, 15, 18, 23};
+static const double g_maxError = 5e-5;   // 23级浮点像素坐标的最大误差，与bingbatch.h中的说明相同
+static const int g_block = 60000;        // 单线程测试时每次转换的点数，小于并行计算的阈值
+
+/**
+ * @brief   与Bing::latLongToPixelXY()取整前相同的计算，作为浮点像素坐标的参考值
+ */
+static QPointF pixelXY(double lon, double lat, int level)
+{
+    lon = Bing::clipLon(lon);
+    lat = Bing::clipLat(lat);
+    const double size = Bing::mapSize(level);
+    const double sinLat = qSin(lat * M_PI / 180);
+    const double x = Bing::clip((lon + 180) / 360 * size + 0.5, 0, size - 1);
+    const double y = Bing::clip((0.5 - qLn((1 + sinLat) / (1 - sinLat)) / (4 * M_PI)) * size + 0.5, 0, size - 1);
+    return QPointF(x, y);
+}
+
+/**
+ * @brief       每次最多转换g_block个点，不会触发并行计算
+ */
+template <typename Func>
+static void singleThread(int count, Func func)
+{
+    for (int i = 0; i < count; i += g_block)
+    {
+        func(i, qMin(g_block, count - i));
+    }
+}
+
+static void print(const QString& name, qint64 ns, int count, qint64 base)
+{
+    qInfo().noquote() << QString("%1：%2 ms，%3 ns/点，%4 倍")
+                             .arg(name, -28)
+                             .arg(ns / 1000000.0, 0, 'f', 1)
+                             .arg(double(ns) / count, 0, 'f', 2)
+                             .arg(ns > 0 ? double(base) / ns : 0, 0, 'f', 2);
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication a(argc, argv);
+    const int count = argc > 1 ? QString(argv[1]).toInt() : 4000000;
+    if (count < 8)
+        return 0;
+
+    // 一半全球范围（包括超出范围需要裁剪的值），一半国内范围，固定种子便于比较
+    QRandomGenerator random(1);
+    QVector<double> lon(count);
+    QVector<double> lat(count);
+    for (int i = 0; i < count; i++)
+    {
+        if (i % 2)
+        {
+            lon[i] = 73 + random.generateDouble() * 62;
+            lat[i] = 18 + random.generateDouble() * 35;
+        }
+        else
+        {
+            lon[i] = -200 + random.generateDouble() * 400;
+            lat[i] = -90 + random.generateDouble() * 180;
+        }
+    }
+    lon[0] = 0;   // 边界值
+    lat[0] = 0;
+    lat[2] = 85.05112878;
+    lat[4] = -85.05112878;
+    qInfo().noquote() << QString("点数：%1，线程数：%2").arg(count).arg(QThread::idealThreadCount());
+
+    // 1、精度：与标量版本比较
+    bool ok = true;
+    QVector<double> dx(count);
+    QVector<double> dy(count);
+    QVector<int> ix(count);
+    QVector<int> iy(count);
+    QVector<int> tx(count);
+    QVector<int> ty(count);
+    QVector<double> outLon(count);
+    QVector<double> outLat(count);
+    for (int level : g_levels)
+    {
+        Bing::latLongToPixelXY(lon.constData(), lat.constData(), count, level, dx.data(), dy.data());
+        Bing::latLongToPixelXY(lon.constData(), lat.constData(), count, level, ix.data(), iy.data());
+        Bing::latLongToTileXY(lon.constData(), lat.constData(), count, level, tx.data(), ty.data());
+        Bing::pixelXYToLatLong(ix.constData(), iy.constData(), count, level, outLon.data(), outLat.data());
+
+        double error = 0;
+        int pixelDiff = 0;
+        int tileDiff = 0;
+        int latLongDiff = 0;
+        for (int i = 0; i < count; i++)
+        {
+            const QPointF ref = pixelXY(lon[i], lat[i], level);
+            error = qMax(error, qMax(qAbs(ref.x() - dx[i]), qAbs(ref.y() - dy[i])));
+            if (Bing::latLongToPixelXY(lon[i], lat[i], level) != QPoint(ix[i], iy[i]))
+                pixelDiff++;
+            if (Bing::latLongToTileXY(lon[i], lat[i], level) != QPoint(tx[i], ty[i]))
+                tileDiff++;
+            double l = 0;
+            double b = 0;
+            Bing::pixelXYToLatLong(QPoint(ix[i], iy[i]), level, l, b);
+            if (l != outLon[i] || b != outLat[i])
+                latLongDiff++;
+        }
+        ok = ok && error <= g_maxError && latLongDiff == 0;
+        qInfo().noquote() << QString("%1级：像素最大误差 %2，取整不同 %3，瓦片编号不同 %4，经纬度不同 %5")
+                                 .arg(level, 2)
+                                 .arg(error, 0, 'g', 3)
+                                 .arg(pixelDiff)
+                                 .arg(tileDiff)
+                                 .arg(latLongDiff);
+    }
+
+    // 2、性能：18级
+    const int level = 18;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < count; i++)
+    {
+        const QPoint pos = Bing::latLongToPixelXY(lon[i], lat[i], level);
+        ix[i] = pos.x();
+        iy[i] = pos.y();
+    }
+    const qint64 scalar = timer.nsecsElapsed();
+    print("latLongToPixelXY 逐点", scalar, count, scalar);
+
+    timer.start();
+    singleThread(count, [&](int begin, int n) {
+        Bing::latLongToPixelXY(lon.constData() + begin, lat.constData() + begin, n, level, ix.data() + begin, iy.data() + begin);
+    });
+    print("latLongToPixelXY 批量单线程", timer.nsecsElapsed(), count, scalar);
+
+    timer.start();
+    Bing::latLongToPixelXY(lon.constData(), lat.constData(), count, level, ix.data(), iy.data());
+    print("latLongToPixelXY 批量多线程", timer.nsecsElapsed(), count, scalar);
+
+    timer.start();
+    for (int i = 0; i < count; i++)
+    {
+        Bing::pixelXYToLatLong(QPoint(ix[i], iy[i]), level, outLon[i], outLat[i]);
+    }
+    const qint64 inverse = timer.nsecsElapsed();
+    print("pixelXYToLatLong 逐点", inverse, count, inverse);
+
+    timer.start();
+    Bing::pixelXYToLatLong(ix.constData(), iy.constData(), count, level, outLon.data(), outLat.data());
+    print("pixelXYToLatLong 批量多线程", timer.nsecsElapsed(), count, inverse);
+
+    if (!ok)
+    {
+        qWarning() << "误差超出范围";
+    }
+    return ok ? 0 : 1;
+}
@@ -6,10 +6,12 @@
 # @开发者      mhf
 # @邮箱       1603291350@qq.com
 # @时间       2024-03-29 14:46:01
-# @备注       1、支持单线程、多线程下载瓦片地图。
+# @备注       1、支持单线程下载、多线程批量下载瓦片地图，批量下载中断后可以继续。
 #            2、支持下载多样式arcGis瓦片地图；
 #            3、支持下载多样式高德瓦片地图；
-#            4、支持Bing地图下载。
+#            4、支持Bing地图下载；
+#            5、下载的瓦片保存到打包的瓦片库中，已存在的瓦片不再下载；
+#            6、支持用最高层级的瓦片离线生成低层级瓦片（金字塔），只重新生成有变化的区域。
 #---------------------------------------------------------------------------------------
 
 QT       += core gui network concurrent
@@ -19,17 +21,18 @@ CONFIG += c++11
 DEFINES += QT_DEPRECATED_WARNINGS
 SOURCES += \
     bingformula.cpp \
+    downloadjob.cpp \
     downloadthread.cpp \
-    downloadthreads.cpp \
     formula.cpp \
     main.cpp \
     mapinput.cpp \
+    pyramidbuilder.cpp \
     widget.cpp
 
 HEADERS += \
     bingformula.h \          # 来自bing的(通用)坐标转换算法、计算公式
+    downloadjob.h \          # 批量下载任务（多线程、可续传）
     downloadthread.h \       # 单线程下载
-    downloadthreads.h \      # 多线程下载
     formula.h \              # 坐标转换算法、计算公式
     mapStruct.h \            # 处理瓦片地图的结构体
     mapinput.h \             # 瓦片地图下载url拼接
@@ -39,6 +42,9 @@ FORMS += \
     mapinput.ui \
     widget.ui
 
+include($$PWD/../TileStore/TileStore.pri)   # 瓦片打包存储（共用）
+include($$PWD/../TileFetcher/TileFetcher.pri)   # 异步瓦片下载（共用）
+
 #  定义程序版本号
 VERSION = 1.0.0
 DEFINES += APP_VERSION=\\\"$$VERSION\\\"
@@ -0,0 +1,392 @@
+﻿/********************************************************************
+ * 文件名： downloadjob.cpp
+ * 时间：   2025-04-26 15:42:10
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   批量下载任务
+ * ******************************************************************/
+#include "downloadjob.h"
+#include "bingformula.h"
+#include "formula.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QThread>
+#include <QTimer>
+#include <climits>
+
+static const quint32 JobMagic = 0x4A544D51;   // "QMTJ"
+static const quint32 JobVersion = 1;
+
+DownloadJob::DownloadJob(QObject* parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<DownloadJob::Progress>("DownloadJob::Progress");
+
+    TileFetcher::Options options;
+    options.decode = false;   // 原始数据直接写入瓦片库，不需要解码
+    m_fetcher = new TileFetcher(options, this);   // 在moveToThread之前创建，和this一起移动到线程中
+    connect(m_fetcher, &TileFetcher::finished, this, &DownloadJob::on_fetched);   // 在网络线程发出，排队到任务线程处理
+
+    m_timer = new QTimer(this);
+    m_timer->setInterval(100);
+    connect(m_timer, &QTimer::timeout, this, &DownloadJob::on_tick);
+
+    m_thread = new QThread;   // 写入瓦片库、更新位图都在任务线程中，不占用ui线程
+    this->moveToThread(m_thread);
+    m_thread->start();
+}
+
+DownloadJob::~DownloadJob()
+{
+    QMetaObject::invokeMethod(this, [this]() { doStop(); }, Qt::BlockingQueuedConnection);   // 保存进度
+    m_thread->quit();
+    m_thread->wait();
+    delete m_thread;
+}
+
+/**
+ * @brief       开始下载，同一个任务（地址、范围、层级相同）之前保存过进度时继续下载
+ * @param job
+ * @param store 可以写入的瓦片库
+ */
+void DownloadJob::start(const JobInfo& job, const QSharedPointer<TileStore>& store)
+{
+    QMetaObject::invokeMethod(this, [this, job, store]() { doStart(job, store); }, Qt::QueuedConnection);
+}
+
+void DownloadJob::stop()
+{
+    QMetaObject::invokeMethod(this, [this]() { doStop(); }, Qt::QueuedConnection);
+}
+
+void DownloadJob::setRateLimit(int tilesPerSecond)
+{
+    QMetaObject::invokeMethod(this, [this, tilesPerSecond]() {
+        m_rate = qMax(0, tilesPerSecond);
+        m_tokens = 0;
+    }, Qt::QueuedConnection);
+}
+
+void DownloadJob::setWindow(int window)
+{
+    QMetaObject::invokeMethod(this, [this, window]() { m_window = qMax(1, window); }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief     替换地址模板中的瓦片编号
+ * @param url
+ * @return
+ */
+QString DownloadJob::tileUrl(const QString& url, int x, int y, int z)
+{
+    QString str = url;
+    str.replace("{x}", QString::number(x));
+    str.replace("{y}", QString::number(y));
+    str.replace("{z}", QString::number(z));
+    if (str.contains("{q}"))
+    {
+        str.replace("{q}", Bing::tileXYToQuadKey(QPoint(x, y), z));
+    }
+    return str;
+}
+
+/**
+ * @brief   任务进度文件：瓦片库路径/jobs/任务参数的哈希.job
+ */
+QString DownloadJob::jobPath() const
+{
+    QByteArray key = m_job.url.toUtf8();
+    key += QString("|%1,%2|%3,%4|%5-%6")
+               .arg(m_job.lt.x(), 0, 'f', 7)
+               .arg(m_job.lt.y(), 0, 'f', 7)
+               .arg(m_job.rd.x(), 0, 'f', 7)
+               .arg(m_job.rd.y(), 0, 'f', 7)
+               .arg(m_job.minZ)
+               .arg(m_job.maxZ)
+               .toUtf8();
+    QString name = QCryptographicHash::hash(key, QCryptographicHash::Md5).toHex().left(16);
+    return m_store->path() + "/jobs/" + name + ".job";
+}
+
+/**
+ * @brief   读取之前保存的完成位图，任务参数、瓦片范围都相同时才使用
+ * @return
+ */
+bool DownloadJob::load()
+{
+    QFile file(jobPath());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    JobInfo job;
+    int count = 0;
+    in >> magic >> version;
+    if (magic != JobMagic || version != JobVersion)
+        return false;
+    in >> job.url >> job.lt >> job.rd >> job.minZ >> job.maxZ >> count;
+    if (job.url != m_job.url || job.lt != m_job.lt || job.rd != m_job.rd || job.minZ != m_job.minZ
+        || job.maxZ != m_job.maxZ || count != m_levels.count())
+        return false;
+
+    QVector<QBitArray> bits(count);
+    for (int i = 0; i < count; i++)
+    {
+        QRect tiles;
+        in >> tiles >> bits[i];
+        if (tiles != m_levels.at(i).tiles || bits.at(i).size() != m_levels.at(i).done.size())
+            return false;
+    }
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    for (int i = 0; i < count; i++)
+    {
+        m_levels[i].done = bits.at(i);
+        m_progress.done += bits.at(i).count(true);
+    }
+    return true;
+}
+
+/**
+ * @brief   保存完成位图，先写入临时文件再替换，中途退出不会损坏之前的进度
+ * @return
+ */
+bool DownloadJob::save()
+{
+    if (!m_store || m_levels.isEmpty())
+        return false;
+
+    QDir().mkpath(m_store->path() + "/jobs");
+    QSaveFile file(jobPath());
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream out(&file);
+    out << JobMagic << JobVersion;
+    out << m_job.url << m_job.lt << m_job.rd << m_job.minZ << m_job.maxZ << m_levels.count();
+    for (const Level& level : m_levels)
+    {
+        out << level.tiles << level.done;   // 每个瓦片1位，百万张瓦片约125KB
+    }
+    m_lastSave = m_elapsed.elapsed();
+    return file.commit();
+}
+
+void DownloadJob::doStart(const JobInfo& job, const QSharedPointer<TileStore>& store)
+{
+    doStop();
+    if (!store || !store->isWritable() || job.url.isEmpty() || job.minZ > job.maxZ)
+    {
+        emit message("下载任务参数错误");
+        return;
+    }
+
+    m_job = job;
+    m_store = store;
+    m_levels.clear();
+    m_progress = Progress();
+    for (int z = job.minZ; z <= job.maxZ; z++)
+    {
+        const int max = (1 << z) - 1;
+        Level level;
+        level.z = z;
+        level.tiles.setLeft(qBound(0, lonTotile(job.lt.x(), z), max));
+        level.tiles.setTop(qBound(0, latTotile(job.lt.y(), z), max));
+        level.tiles.setRight(qBound(0, lonTotile(job.rd.x(), z), max));
+        level.tiles.setBottom(qBound(0, latTotile(job.rd.y(), z), max));
+        const qint64 count = qint64(level.tiles.width()) * level.tiles.height();
+        if (level.tiles.isEmpty() || count > INT_MAX)   // QBitArray最多int个位
+        {
+            emit message(QString("第%1级瓦片范围错误").arg(z));
+            m_levels.clear();
+            return;
+        }
+        level.done.resize(int(count));
+        m_progress.total += count;
+        m_levels.append(level);
+    }
+
+    m_elapsed.start();
+    if (load())
+    {
+        emit message(QString("继续下载：已完成%1/%2").arg(m_progress.done).arg(m_progress.total));
+    }
+    m_progress.skipped = m_progress.done;
+    m_levelIndex = 0;
+    m_tileIndex = 0;
+    m_pending.clear();
+    m_tokens = 0;
+    m_lastTime = 0;
+    m_lastDownloaded = 0;
+    m_lastBytes = 0;
+    m_lastSave = 0;
+    m_running = true;
+    m_timer->start();
+    fill();
+}
+
+void DownloadJob::doStop()
+{
+    if (!m_running)
+        return;
+    m_running = false;
+    m_timer->stop();
+    m_fetcher->cancel();
+    m_pending.clear();
+    save();
+    report();
+}
+
+/**
+ * @brief 按层级、x、y顺序生成下一批瓦片，跳过位图中已完成和瓦片库中已经存在的瓦片
+ */
+void DownloadJob::fill()
+{
+    QVector<TileFetcher::Request> requests;
+    TileFetcher::Request request;
+    while (m_running && m_pending.count() + requests.count() < m_window && m_levelIndex < m_levels.count())
+    {
+        if (m_rate > 0 && m_tokens < 1)   // 限速
+            break;
+
+        Level& level = m_levels[m_levelIndex];
+        if (m_tileIndex >= level.done.size())
+        {
+            m_levelIndex++;
+            m_tileIndex = 0;
+            continue;
+        }
+        const int index = int(m_tileIndex++);
+        if (level.done.testBit(index))
+            continue;
+
+        const int x = level.tiles.left() + index / level.tiles.height();
+        const int y = level.tiles.top() + index % level.tiles.height();
+        if (m_store->contains(level.z, x, y))   // 以前用其它方式下载的瓦片
+        {
+            level.done.setBit(index);
+            m_progress.done++;
+            m_progress.skipped++;
+            continue;
+        }
+
+        request.x = x;
+        request.y = y;
+        request.z = level.z;
+        request.url = tileUrl(m_job.url, x, y, level.z);
+        request.id = m_levelIndex;
+        requests.append(request);
+        m_pending.insert(TileStore::key(level.z, x, y));
+        if (m_rate > 0)
+        {
+            m_tokens -= 1;
+        }
+    }
+    if (!requests.isEmpty())
+    {
+        m_fetcher->fetch(requests);
+    }
+
+    if (m_running && m_pending.isEmpty() && m_levelIndex >= m_levels.count())   // 所有瓦片都已经处理
+    {
+        m_running = false;
+        m_timer->stop();
+        save();
+        m_progress.finished = true;
+        report();
+        emit message(QString("下载完成：%1张，失败%2张").arg(m_progress.done - m_progress.skipped).arg(m_progress.failed));
+    }
+}
+
+/**
+ * @brief        下载完成，原始数据写入瓦片库并标记完成；失败的瓦片不标记，下次开始时重新下载
+ * @param result
+ */
+void DownloadJob::on_fetched(const TileFetcher::Result& result)
+{
+    const TileFetcher::Request& request = result.request;
+    if (!m_running || !m_pending.remove(TileStore::key(request.z, request.x, request.y)))   // 停止前已经发出的结果
+        return;
+    if (request.id < 0 || request.id >= m_levels.count())
+        return;
+
+    Level& level = m_levels[request.id];
+    const int index = (request.x - level.tiles.left()) * level.tiles.height() + (request.y - level.tiles.top());
+    if (result.isOk() && !result.data.isEmpty())
+    {
+        TileMeta meta;
+        meta.etag = result.etag;
+        meta.fetched = QDateTime::currentSecsSinceEpoch();
+        meta.expires = result.expires;
+        if (m_store->insert(request.z, request.x, request.y, result.data, meta))
+        {
+            level.done.setBit(index);
+            m_progress.done++;
+            m_progress.bytes += quint64(result.data.size());
+        }
+        else
+        {
+            m_progress.failed++;
+            emit message("保存失败：" + m_store->errorString());
+        }
+    }
+    else
+    {
+        m_progress.failed++;
+        emit message("下载失败：" + request.url + " " + result.error);
+    }
+    fill();
+}
+
+/**
+ * @brief 每100ms补充限速令牌，每秒发出进度，每10秒保存一次位图
+ */
+void DownloadJob::on_tick()
+{
+    if (m_rate > 0)
+    {
+        m_tokens = qMin(m_tokens + m_rate / 10.0, qMax(1.0, m_rate / 10.0));   // 不累积，避免限速后瞬间大量请求
+    }
+    fill();
+
+    const qint64 now = m_elapsed.elapsed();
+    if (now - m_lastTime >= 1000)
+    {
+        report();
+    }
+    if (m_running && now - m_lastSave >= 10000)
+    {
+        save();
+    }
+}
+
+/**
+ * @brief 计算速度（指数平滑）和剩余时间，发出进度
+ */
+void DownloadJob::report()
+{
+    const qint64 now = m_elapsed.elapsed();
+    const qint64 interval = now - m_lastTime;
+    if (interval > 0)
+    {
+        const qint64 downloaded = m_progress.done - m_progress.skipped;   // 跳过的瓦片不计入速度
+        const double tiles = (downloaded - m_lastDownloaded) * 1000.0 / interval;
+        const double bytes = (m_progress.bytes - m_lastBytes) * 1000.0 / interval;
+        const bool first = m_lastTime == 0;
+        m_progress.tilesPerSecond = first ? tiles : m_progress.tilesPerSecond * 0.7 + tiles * 0.3;
+        m_progress.bytesPerSecond = first ? bytes : m_progress.bytesPerSecond * 0.7 + bytes * 0.3;
+        m_lastTime = now;
+        m_lastDownloaded = downloaded;
+        m_lastBytes = m_progress.bytes;
+    }
+    const qint64 remaining = m_progress.total - m_progress.done - m_progress.failed;
+    m_progress.eta = m_progress.tilesPerSecond > 0.01 ? qint64(remaining / m_progress.tilesPerSecond) : -1;
+    emit progress(m_progress);
+}
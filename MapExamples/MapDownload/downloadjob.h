@@ -0,0 +1,102 @@
+﻿#ifndef DOWNLOADJOB_H
+#define DOWNLOADJOB_H
+/********************************************************************
+ * 文件名： downloadjob.h
+ * 时间：   2025-04-26 15:42:10
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   批量下载任务，用于省、市范围几十万到几百万张瓦片的下载
+ *          1、不预先生成所有瓦片的列表，按层级、x、y顺序逐个生成瓦片编号，同时下载的瓦片数有上限；
+ *          2、每个层级一个完成位图（每个瓦片1位），定时保存到瓦片库的jobs文件夹中，中断后再次开始时跳过已完成的瓦片；
+ *          3、下载的原始数据直接写入瓦片库，不解码、不重新编码；
+ *          4、支持限制每秒下载的瓦片数，每秒发出一次进度（速度、剩余时间）。
+ * ******************************************************************/
+
+#include "mapStruct.h"
+#include "tilefetcher.h"
+#include "tilestore.h"
+#include <QBitArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QRect>
+#include <QSet>
+#include <QVector>
+
+class QThread;
+class QTimer;
+
+class DownloadJob : public QObject
+{
+    Q_OBJECT
+public:
+    struct Progress
+    {
+        qint64 total = 0;       // 瓦片总数
+        qint64 done = 0;        // 已完成（包括之前完成和瓦片库中已经存在的）
+        qint64 skipped = 0;     // 本次开始时已经完成的瓦片
+        qint64 failed = 0;      // 多次重试后失败的瓦片，下次开始时重新下载
+        quint64 bytes = 0;      // 本次下载的字节数
+        double tilesPerSecond = 0;
+        double bytesPerSecond = 0;
+        qint64 eta = -1;        // 预计剩余时间（秒），-1表示未知
+        bool finished = false;
+    };
+
+    explicit DownloadJob(QObject* parent = nullptr);
+    ~DownloadJob() override;
+
+    void start(const JobInfo& job, const QSharedPointer<TileStore>& store);   // 开始或继续下载
+    void stop();                      // 停止下载并保存进度
+    void setRateLimit(int tilesPerSecond);   // 每秒最多下载的瓦片数，0表示不限制
+    void setWindow(int window);       // 同时下载的最多瓦片数
+
+signals:
+    void progress(const DownloadJob::Progress& progress);   // 每秒一次，完成时再发出一次
+    void message(const QString& text);
+
+private:
+    struct Level
+    {
+        int z = 0;
+        QRect tiles;          // 瓦片编号范围
+        QBitArray done;       // 完成位图，按x、y顺序
+    };
+
+    static QString tileUrl(const QString& url, int x, int y, int z);
+    QString jobPath() const;
+    bool load();
+    bool save();
+    void doStart(const JobInfo& job, const QSharedPointer<TileStore>& store);
+    void doStop();
+    void fill();                 // 补充下载中的瓦片
+    void on_fetched(const TileFetcher::Result& result);
+    void on_tick();              // 限速令牌、进度统计
+    void report();
+
+private:
+    QThread* m_thread = nullptr;
+    TileFetcher* m_fetcher = nullptr;
+    QTimer* m_timer = nullptr;
+    JobInfo m_job;
+    QSharedPointer<TileStore> m_store;
+    QVector<Level> m_levels;
+    bool m_running = false;
+
+    int m_levelIndex = 0;       // 下一个瓦片：层级序号、层级中的序号
+    qint64 m_tileIndex = 0;
+    QSet<quint64> m_pending;    // 下载中的瓦片
+    int m_window = 256;
+    int m_rate = 0;             // 每秒最多瓦片数
+    double m_tokens = 0;        // 限速时可以开始下载的瓦片数
+
+    Progress m_progress;
+    QElapsedTimer m_elapsed;    // 计算速度
+    qint64 m_lastTime = 0;
+    qint64 m_lastDownloaded = 0;
+    quint64 m_lastBytes = 0;
+    qint64 m_lastSave = 0;
+};
+
+Q_DECLARE_METATYPE(DownloadJob::Progress)
+
+#endif   // DOWNLOADJOB_H
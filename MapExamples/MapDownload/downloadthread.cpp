@@ -79,7 +79,8 @@ void DownloadThread::on_finished(QNetworkReply *reply)
     ImageInfo& info = m_infos.first();
     if(reply->error() == QNetworkReply::NoError)
     {
-         info.img.loadFromData(reply->readAll());
+         info.data = reply->readAll();
+         info.img.loadFromData(info.data);
          emit finished(info);
          m_infos.removeFirst();    // 下载后移除第一项
          get();
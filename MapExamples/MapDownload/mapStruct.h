@@ -21,7 +21,18 @@ struct ImageInfo
     QString url;          // 下载瓦片的地址
     QString format;       // 图片格式
     QImage img;           // 保存下载后的瓦片
+    QByteArray data;      // 下载的原始数据，直接写入瓦片库，不重新编码
     short count = 0;      // 失败下载次数，初始为0，下载失败一次+1
 };
 
+// 批量下载任务：一个经纬度范围内多个层级的所有瓦片
+struct JobInfo
+{
+    QString url;          // 瓦片地址模板，{x}、{y}、{z}替换为瓦片编号，{q}替换为Bing的quadKey
+    QPointF lt;           // 左上角经纬度
+    QPointF rd;           // 右下角经纬度
+    int minZ = 0;         // 下载的层级范围
+    int maxZ = 0;
+};
+
 #endif // MAPSTRUCT_H
@@ -324,3 +324,73 @@ void MapInput::getBingMapInfo()
         }
     }
 }
+
+/**
+ * @brief   获取批量下载任务：瓦片地址模板、经纬度范围、层级范围，瓦片编号在下载时逐个生成，
+ *          地址与getArcGisMapInfo()、getAMapInfo()、getBingMapInfo()中的相同
+ * @return  输入错误时url为空
+ */
+JobInfo MapInput::getJob() const
+{
+    JobInfo job;
+    QStringList lt = ui->line_LTGps->text().trimmed().split(',');   // 左上角经纬度
+    QStringList rd = ui->line_RDGps->text().trimmed().split(',');   // 右下角经纬度
+    if (lt.count() != 2 || rd.count() != 2)
+        return job;   // 判断输入是否正确
+    job.lt = QPointF(lt.at(0).toDouble(), lt.at(1).toDouble());
+    job.rd = QPointF(rd.at(0).toDouble(), rd.at(1).toDouble());
+
+    switch (ui->tabWidget->currentIndex())   // 判断是什么类型的地图源
+    {
+    case 0:   // ArcGis
+        {
+            job.maxZ = ui->com_z->currentData().toInt();
+            job.url = QString("https://server.arcgisonline.com/arcgis/rest/services/%1/MapServer/tile/{z}/{y}/{x}.%2")
+                          .arg(ui->com_type->currentText())
+                          .arg(ui->com_format->currentText());
+            break;
+        }
+    case 1:   // 高德
+        {
+            job.maxZ = ui->com_amapZ->currentData().toInt();
+            int style = ui->com_amapStyle->currentData().toInt();
+            if (style == 9)
+            {
+                style = 6;   // 卫星图和路网图的瓦片编号相同，在同一个瓦片库中会互相覆盖，批量下载只下载卫星图
+            }
+            job.url = QString("https://%1.is.autonavi.com/appmaptile?").arg(ui->com_amapPrefix->currentText());
+            job.url += QString("&style=%1").arg(style);
+            job.url += QString("&lang=%1").arg(ui->com_amapLang->currentData().toString());
+            job.url += QString("&scl=%1").arg(ui->com_amapScl->currentData().toInt());
+            job.url += QString("&ltype=%1").arg(ui->spin_amapLtype->value());
+            job.url += "&x={x}&y={y}&z={z}";
+            break;
+        }
+    case 2:   // Bing
+        {
+            job.maxZ = ui->com_bingZ->currentText().toInt();
+            int prefix = ui->com_bingPrefix->currentIndex();
+            QString format = ui->com_bingFormat->currentText();
+            QString lang = ui->com_bingLang->currentData().toString();   // 语言
+            QString type = ui->com_bingType->currentData().toString();   // 类型
+#if (USE_URL == 0)
+            job.url = QString("https://r%1.tiles.ditu.live.com/tiles/%2{q}.%3?g=1001&mkt=%4").arg(prefix).arg(type).arg(format).arg(lang);
+#elif (USE_URL == 1)
+            QString cstl = ui->com_bingCstl->currentData().toString();   // 样式
+            job.url = QString("http://dynamic.t%1.tiles.ditu.live.com/comp/ch/%2{q}.%3?it=G,OS,L&mkt=%4&cstl=%5&ur=cn")
+                          .arg(prefix)
+                          .arg(type)
+                          .arg(format)
+                          .arg(lang)
+                          .arg(cstl);
+#endif
+            break;
+        }
+    default:
+        break;
+    }
+
+    const int minZ = ui->spin_minZ->value();   // -1表示只下载选择的等级
+    job.minZ = minZ < 0 ? job.maxZ : qMin(minZ, job.maxZ);
+    return job;
+}
@@ -17,6 +17,7 @@ public:
     ~MapInput();
 
     const QList<ImageInfo> &getInputInfo();       // 获取下载地图所需的输入信息
+    JobInfo getJob() const;                       // 获取批量下载任务（不生成瓦片列表）
 
 private:
     // ArcGis
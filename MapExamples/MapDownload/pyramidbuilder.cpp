@@ -0,0 +1,261 @@
+﻿/********************************************************************
+ * 文件名： pyramidbuilder.cpp
+ * 时间：   2025-04-29 21:05:48
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   离线生成瓦片金字塔
+ * ******************************************************************/
+#include "pyramidbuilder.h"
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QSet>
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PYRAMID_SSE2
+#include <emmintrin.h>
+#endif
+
+static const int TileSize = 256;
+static const int BatchSize = 512;   // 每批并行生成的瓦片数，每批完成后检查是否停止
+
+/**
+ * @brief        2×2均值缩小一行：out[i]的每个通道 = (r0[2i] + r0[2i+1] + r1[2i] + r1[2i+1] + 2) / 4
+ * @param r0     上一行，32位像素
+ * @param r1     下一行
+ * @param out    输出width / 2个像素
+ * @param width  输入的像素数，偶数
+ */
+static void downsampleRow(const uchar* r0, const uchar* r1, uchar* out, int width)
+{
+    int i = 0;
+#ifdef PYRAMID_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    for (; i + 8 <= width; i += 8)   // 每次8个输入像素，4个输出像素
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r0 + i * 4));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r0 + i * 4 + 16));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1 + i * 4));
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1 + i * 4 + 16));
+        // 展开为16位后上下两行相加，每个寄存器为相邻的2个像素
+        const __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(c, zero));   // 像素0、1
+        const __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(c, zero));   // 像素2、3
+        const __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(d, zero));   // 像素4、5
+        const __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(d, zero));   // 像素6、7
+        // 左右两个像素相加：高64位加到低64位
+        const __m128i h0 = _mm_add_epi16(s0, _mm_srli_si128(s0, 8));
+        const __m128i h1 = _mm_add_epi16(s1, _mm_srli_si128(s1, 8));
+        const __m128i h2 = _mm_add_epi16(s2, _mm_srli_si128(s2, 8));
+        const __m128i h3 = _mm_add_epi16(s3, _mm_srli_si128(s3, 8));
+        const __m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(h0, h1), two), 2);
+        const __m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(h2, h3), two), 2);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i + 2 <= width; i += 2)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            out[i * 2 + c] = uchar((r0[i * 4 + c] + r0[i * 4 + 4 + c] + r1[i * 4 + c] + r1[i * 4 + 4 + c] + 2) >> 2);
+        }
+    }
+}
+
+/**
+ * @brief        瓦片缩小一半后绘制到上级瓦片的一个象限中
+ * @param src    256×256，Format_ARGB32_Premultiplied（预乘透明度后均值才正确）
+ * @param dst    256×256，Format_ARGB32_Premultiplied
+ * @param left   象限左上角
+ * @param top
+ */
+static void downsample(const QImage& src, QImage& dst, int left, int top)
+{
+    for (int y = 0; y < TileSize / 2; y++)
+    {
+        downsampleRow(src.constScanLine(y * 2), src.constScanLine(y * 2 + 1), dst.scanLine(top + y) + left * 4, TileSize);
+    }
+}
+
+PyramidBuilder::PyramidBuilder(QObject* parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<PyramidBuilder::Progress>("PyramidBuilder::Progress");
+
+    m_thread = new QThread;   // 生成时阻塞等待线程池，不占用ui线程
+    this->moveToThread(m_thread);
+    m_thread->start();
+}
+
+PyramidBuilder::~PyramidBuilder()
+{
+    m_stop = true;   // 当前一批完成后doBuild()返回
+    m_thread->quit();
+    m_thread->wait();
+    delete m_thread;
+}
+
+/**
+ * @brief        开始生成
+ * @param store  可以写入的瓦片库
+ * @param minZ   生成的最低层级
+ * @param maxZ   下载的最高层级
+ */
+void PyramidBuilder::start(const QSharedPointer<TileStore>& store, int minZ, int maxZ)
+{
+    if (m_running.exchange(true))
+        return;
+    m_stop = false;
+    QMetaObject::invokeMethod(this, [this, store, minZ, maxZ]() { doBuild(store, minZ, maxZ); }, Qt::QueuedConnection);
+}
+
+void PyramidBuilder::stop()
+{
+    m_stop = true;
+}
+
+/**
+ * @brief  从maxZ - 1级到minZ级逐级生成，一个层级全部完成后才生成上一级
+ */
+void PyramidBuilder::doBuild(const QSharedPointer<TileStore>& store, int minZ, int maxZ)
+{
+    Progress state;
+    const QVector<int> levels = store ? store->levels() : QVector<int>();
+    if (maxZ < 0 && !levels.isEmpty())
+    {
+        maxZ = levels.last();
+    }
+    if (!store || !store->isWritable() || minZ < 0 || minZ >= maxZ)
+    {
+        emit message("生成金字塔参数错误：瓦片库不可写入或层级范围为空");
+        state.finished = true;
+        emit progress(state);
+        m_running = false;
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int z = maxZ - 1; z >= minZ && !m_stop; z--)
+    {
+        // 下级瓦片（包括刚生成的）所在的上级瓦片
+        QSet<quint64> keys;
+        for (const QPoint& tile : store->tiles(z + 1))
+        {
+            keys.insert(TileStore::key(z, tile.x() / 2, tile.y() / 2));
+        }
+        QVector<QPair<quint64, int>> parents;   // 瓦片、生成结果
+        parents.reserve(keys.count());
+        for (quint64 key : keys)
+        {
+            parents.append(qMakePair(key, int(Failed)));
+        }
+        std::sort(parents.begin(), parents.end());   // 按x、y顺序，相邻的瓦片一起读取
+
+        state.z = z;
+        state.total = parents.count();
+        state.done = 0;
+        qint64 last = 0;
+        for (int i = 0; i < parents.count() && !m_stop; i += BatchSize)
+        {
+            QVector<QPair<quint64, int>> batch = parents.mid(i, BatchSize);
+            QtConcurrent::blockingMap(batch, [this, &store, z](QPair<quint64, int>& tile) {
+                tile.second = buildTile(store.data(), z, int((tile.first >> 24) & 0xFFFFFF), int(tile.first & 0xFFFFFF));
+            });
+            for (const auto& tile : batch)
+            {
+                const int result = tile.second;
+                if (result == Built)
+                    state.built++;
+                else if (result == Skipped)
+                    state.skipped++;
+                else
+                    state.failed++;
+            }
+            state.done += batch.count();
+            if (timer.elapsed() - last >= 500 || state.done == state.total)   // 最多每0.5秒一次
+            {
+                last = timer.elapsed();
+                emit progress(state);
+            }
+        }
+    }
+
+    emit message(QString("%1：生成%2张，未变化%3张，失败%4张，耗时%5 s")
+                     .arg(m_stop ? "已停止" : "金字塔生成完成")
+                     .arg(state.built)
+                     .arg(state.skipped)
+                     .arg(state.failed)
+                     .arg(timer.elapsed() / 1000.0, 0, 'f', 1));
+    state.finished = true;
+    emit progress(state);
+    m_running = false;
+}
+
+/**
+ * @brief        用4个下级瓦片生成一个瓦片，在线程池中调用
+ * @param store
+ * @param z      生成的瓦片层级
+ * @param x
+ * @param y
+ * @return
+ */
+PyramidBuilder::Result PyramidBuilder::buildTile(TileStore* store, int z, int x, int y) const
+{
+    // 下级瓦片最新的下载时间，已有的瓦片不比它旧时说明这个区域没有变化
+    TileMeta childMeta;
+    qint64 fetched = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (store->meta(z + 1, x * 2 + (i & 1), y * 2 + (i >> 1), &childMeta))
+        {
+            fetched = qMax(fetched, childMeta.fetched);
+        }
+    }
+    TileMeta meta;
+    if (store->meta(z, x, y, &meta) && meta.fetched >= fetched)
+        return Skipped;
+
+    QImage image(TileSize, TileSize, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    int count = 0;
+    bool opaque = true;
+    for (int i = 0; i < 4; i++)
+    {
+        QImage child;
+        if (!child.loadFromData(store->tile(z + 1, x * 2 + (i & 1), y * 2 + (i >> 1))))
+            continue;
+        opaque = opaque && !child.hasAlphaChannel();
+        if (child.size() != QSize(TileSize, TileSize))
+        {
+            child = child.scaled(TileSize, TileSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        }
+        child = child.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        downsample(child, image, (i & 1) * TileSize / 2, (i >> 1) * TileSize / 2);
+        count++;
+    }
+    if (count == 0)
+        return Failed;
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    bool ok = false;
+    if (opaque && count == 4)
+    {
+        ok = image.convertToFormat(QImage::Format_RGB32).save(&buffer, "JPG", 90);
+    }
+    else
+    {
+        ok = image.save(&buffer, "PNG");
+    }
+
+    TileMeta tileMeta;
+    tileMeta.fetched = fetched;
+    if (!ok || !store->insert(z, x, y, data, tileMeta))
+        return Failed;
+    return Built;
+}
@@ -0,0 +1,67 @@
+﻿#ifndef PYRAMIDBUILDER_H
+#define PYRAMIDBUILDER_H
+/********************************************************************
+ * 文件名： pyramidbuilder.h
+ * 时间：   2025-04-29 21:05:48
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   离线生成瓦片金字塔：用瓦片库中最高层级的瓦片生成所有低层级的瓦片，不需要再从网络下载
+ *          1、从高到低逐级生成，每个上级瓦片由4个下级瓦片各缩小一半拼成，同一层级的瓦片在线程池中并行生成；
+ *          2、缩小使用2×2均值（box）滤波，x86下使用SSE2一次计算4个像素；
+ *          3、生成的瓦片下载时间记为4个下级瓦片中最新的下载时间，瓦片库中已有的瓦片不比下级瓦片旧时跳过，
+ *             再次生成时只重新生成下载过新瓦片的区域；
+ *          4、4个下级瓦片都存在且不透明时保存为jpg，否则保存为png。
+ * ******************************************************************/
+
+#include "tilestore.h"
+#include <QObject>
+#include <QSharedPointer>
+#include <atomic>
+
+class QThread;
+
+class PyramidBuilder : public QObject
+{
+    Q_OBJECT
+public:
+    struct Progress
+    {
+        int z = 0;              // 正在生成的层级
+        qint64 total = 0;       // 这一层级需要检查的瓦片数
+        qint64 done = 0;        // 这一层级已经检查的瓦片数
+        qint64 built = 0;       // 生成的瓦片数（所有层级）
+        qint64 skipped = 0;     // 没有变化跳过的瓦片数（所有层级）
+        qint64 failed = 0;      // 下级瓦片无法解码、保存失败的瓦片数（所有层级）
+        bool finished = false;
+    };
+
+    explicit PyramidBuilder(QObject* parent = nullptr);
+    ~PyramidBuilder() override;
+
+    void start(const QSharedPointer<TileStore>& store, int minZ, int maxZ = -1);   // 用maxZ级生成minZ到maxZ-1级，maxZ为-1时使用瓦片库中最高的层级
+    void stop();                                                                  // 生成完当前一批瓦片后停止
+
+signals:
+    void progress(const PyramidBuilder::Progress& progress);
+    void message(const QString& text);
+
+private:
+    enum Result
+    {
+        Built,
+        Skipped,
+        Failed
+    };
+
+    void doBuild(const QSharedPointer<TileStore>& store, int minZ, int maxZ);
+    Result buildTile(TileStore* store, int z, int x, int y) const;
+
+private:
+    QThread* m_thread = nullptr;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_stop{false};
+};
+
+Q_DECLARE_METATYPE(PyramidBuilder::Progress)
+
+#endif   // PYRAMIDBUILDER_H
@@ -2,6 +2,7 @@
 #include "ui_widget.h"
 
 #include <QDateTime>
+#include <QTime>
 #include <QFileDialog>
 
 Widget::Widget(QWidget *parent)
@@ -14,9 +15,14 @@ Widget::Widget(QWidget *parent)
     this->setWindowTitle(QString("QT下载瓦片地图简单示例--V%1").arg(APP_VERSION));
 
     m_dThread = new DownloadThread();      // 不能指定父对象
-    m_dThreads = new DownloadThreads();
+    m_job = new DownloadJob();             // 在自己的线程中运行，不能指定父对象
+    m_pyramid = new PyramidBuilder();      // 在自己的线程中运行，不能指定父对象
     connect(m_dThread, &DownloadThread::finished, this, &Widget::finished);
-    connect(m_dThreads, &DownloadThreads::finished, this, &Widget::finished);
+    connect(m_job, &DownloadJob::progress, this, &Widget::on_progress);
+    connect(m_job, &DownloadJob::message, ui->textEdit, &QTextEdit::append);
+    connect(m_pyramid, &PyramidBuilder::progress, this, &Widget::on_pyramid);
+    connect(m_pyramid, &PyramidBuilder::message, ui->textEdit, &QTextEdit::append);
+    connect(ui->spin_rate, QOverload<int>::of(&QSpinBox::valueChanged), m_job, &DownloadJob::setRateLimit);
     ui->textEdit->document()->setMaximumBlockCount(100);   // 最大显示行数
     ui->textEdit->moveCursor(QTextCursor::End);            // 自动滚动到底部
 
@@ -27,7 +33,8 @@ Widget::Widget(QWidget *parent)
 Widget::~Widget()
 {
     delete m_dThread;
-    delete m_dThreads;
+    delete m_job;                          // 停止下载并保存进度
+    delete m_pyramid;                      // 生成完当前一批瓦片后停止
     delete ui;
 }
 
@@ -55,7 +62,7 @@ void Widget::on_but_thread_clicked(bool checked)
         ui->progressBar->setValue(0);
         ui->but_thread->setText("停止下载");
 
-        const QList<ImageInfo> & infos = ui->mapInput->getInputInfo();
+        const QList<ImageInfo> & infos = getInfos();
         if(infos.isEmpty())
         {
             ui->but_thread->setText("单线程下载");
@@ -74,7 +81,7 @@ void Widget::on_but_thread_clicked(bool checked)
 }
 
 /**
- * @brief          多线程下载瓦片地图
+ * @brief          批量下载瓦片地图：多线程下载，不生成瓦片列表，停止后再次开始时从保存的进度继续
  * @param checked
  */
 void Widget::on_but_threads_clicked(bool checked)
@@ -83,24 +90,99 @@ void Widget::on_but_threads_clicked(bool checked)
     {
         m_timer.start();
         ui->progressBar->setValue(0);
+        ui->progressBar->setMaximum(1000);     // 瓦片数可能超过int，按千分比显示
         ui->but_threads->setText("停止下载");
 
-        const QList<ImageInfo> & infos = ui->mapInput->getInputInfo();
-        if(infos.isEmpty())   // 如果列表为空则不下载
+        JobInfo job = ui->mapInput->getJob();
+        if(job.url.isEmpty() || !openStore())
         {
-            ui->but_threads->setText("多线程下载");
+            ui->but_threads->setText("批量下载");
             ui->but_threads->setChecked(false);
             return;
         }
-        m_dThreads->getImage(infos);       // 开始下载
-        ui->progressBar->setMaximum(infos.count());
+        m_job->setRateLimit(ui->spin_rate->value());
+        m_job->start(job, m_store);         // 开始下载
     }
     else
     {
-        ui->but_threads->setText("多线程下载");
+        ui->but_threads->setText("批量下载");
         ui->but_threads->setChecked(false);
-        m_dThreads->quit();
+        m_job->stop();                      // 停止并保存进度
+    }
+}
+
+/**
+ * @brief          用瓦片库中最高层级的瓦片生成低层级瓦片（离线金字塔），再次生成时跳过没有变化的区域
+ * @param checked
+ */
+void Widget::on_but_pyramid_clicked(bool checked)
+{
+    if(checked)
+    {
+        m_timer.start();
+        ui->progressBar->setValue(0);
+        ui->progressBar->setMaximum(1000);
+        ui->but_pyramid->setText("停止生成");
+
+        if(!openStore())
+        {
+            ui->but_pyramid->setText("生成低层级");
+            ui->but_pyramid->setChecked(false);
+            return;
+        }
+        m_pyramid->start(m_store, ui->spin_pyramidZ->value());
+    }
+    else
+    {
+        ui->but_pyramid->setText("生成低层级");
+        ui->but_pyramid->setChecked(false);
+        m_pyramid->stop();                  // 生成完当前一批瓦片后停止
+    }
+}
+
+/**
+ * @brief   打开保存路径下的瓦片库
+ * @return  瓦片库可以写入时返回true
+ */
+bool Widget::openStore()
+{
+    QString strPath = ui->line_savePath->text();
+    if(strPath.isEmpty())
+    {
+        strPath = qApp->applicationDirPath() + "/map";   // 默认保存地址
+    }
+    m_store = TileStore::shared(strPath);
+    if(!m_store->isWritable())
+    {
+        ui->textEdit->append(m_store->isOpen() ? "瓦片库正在被其它程序写入：" + strPath : m_store->errorString());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief   打开保存路径下的瓦片库，瓦片库中已经存在的瓦片不再下载（中断后可以继续下载）
+ * @return  需要下载的瓦片
+ */
+QList<ImageInfo> Widget::getInfos()
+{
+    if(!openStore())
+    {
+        return QList<ImageInfo>();
     }
+
+    QList<ImageInfo> infos = ui->mapInput->getInputInfo();
+    const int total = infos.count();
+    for(int i = infos.count() - 1; i >= 0; i--)
+    {
+        const ImageInfo& info = infos.at(i);
+        if(m_store->contains(info.z, info.x, info.y))   // 查找内存索引，不访问文件
+        {
+            infos.removeAt(i);
+        }
+    }
+    ui->textEdit->append(QString("瓦片总数：%1，已存在：%2").arg(total).arg(total - infos.count()));
+    return infos;
 }
 
 /**
@@ -111,19 +193,17 @@ void Widget::finished(ImageInfo info)
 {
     if(!info.img.isNull())   // 下载失败图片为空
     {
-        // 创建文件夹
-        QString strPath = ui->line_savePath->text();
-        if(strPath.isEmpty())
+        // 下载的数据直接追加到瓦片库，不再每个瓦片创建一个文件
+        TileMeta meta;
+        meta.fetched = QDateTime::currentSecsSinceEpoch();
+        if(m_store && m_store->insert(info.z, info.x, info.y, info.data, meta))
+        {
+            ui->textEdit->append(info.url);
+        }
+        else
         {
-            strPath = qApp->applicationDirPath() + "/map";   // 默认保存地址
+            ui->textEdit->append("保存失败：" + info.url);
         }
-        strPath += QString("/%1/%2/").arg(info.z).arg(info.x);
-        QDir dir;
-        dir.mkpath(strPath);
-        // 保存文件
-        strPath += QString("%1.%2").arg(info.y).arg(info.format);
-        info.img.save(strPath);
-        ui->textEdit->append(info.url);
     }
     else
     {
@@ -134,9 +214,60 @@ void Widget::finished(ImageInfo info)
     if(ui->progressBar->value() == ui->progressBar->maximum())
     {
         ui->but_thread->setChecked(false);
-        ui->but_threads->setChecked(false);
         ui->but_thread->setText("单线程下载");
-        ui->but_threads->setText("多线程下载");
         qDebug() << "下载时长：" << m_timer.elapsed() <<" ms";
     }
 }
+
+/**
+ * @brief           显示批量下载进度、速度和剩余时间
+ * @param progress
+ */
+void Widget::on_progress(const DownloadJob::Progress& progress)
+{
+    if(progress.total > 0)
+    {
+        ui->progressBar->setValue(int(progress.done * 1000 / progress.total));
+    }
+    QString eta = progress.eta < 0 ? "--" : QTime(0, 0).addSecs(int(qMin<qint64>(progress.eta, 86399))).toString("hh:mm:ss");
+    if(progress.eta >= 86400)
+    {
+        eta = QString("%1天").arg(progress.eta / 86400.0, 0, 'f', 1);
+    }
+    ui->textEdit->append(QString("已完成：%1/%2（跳过%3，失败%4），速度：%5张/秒 %6KB/秒，剩余：%7")
+                         .arg(progress.done).arg(progress.total)
+                         .arg(progress.skipped).arg(progress.failed)
+                         .arg(progress.tilesPerSecond, 0, 'f', 1)
+                         .arg(progress.bytesPerSecond / 1024, 0, 'f', 1)
+                         .arg(eta));
+
+    if(progress.finished)
+    {
+        ui->but_threads->setChecked(false);
+        ui->but_threads->setText("批量下载");
+        qDebug() << "下载时长：" << m_timer.elapsed() <<" ms";
+    }
+}
+
+/**
+ * @brief           生成金字塔进度，每个层级单独显示进度
+ * @param progress
+ */
+void Widget::on_pyramid(const PyramidBuilder::Progress& progress)
+{
+    if(progress.finished)
+    {
+        ui->but_pyramid->setChecked(false);
+        ui->but_pyramid->setText("生成低层级");
+        qDebug() << "生成时长：" << m_timer.elapsed() <<" ms";
+        return;
+    }
+    if(progress.total > 0)
+    {
+        ui->progressBar->setValue(int(progress.done * 1000 / progress.total));
+    }
+    ui->textEdit->append(QString("第%1级：%2/%3（生成%4，未变化%5，失败%6）")
+                         .arg(progress.z)
+                         .arg(progress.done).arg(progress.total)
+                         .arg(progress.built).arg(progress.skipped).arg(progress.failed));
+}
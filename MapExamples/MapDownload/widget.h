@@ -3,9 +3,11 @@
 
 #include <QWidget>
 #include "downloadthread.h"
-#include "downloadthreads.h"
+#include "downloadjob.h"
+#include "pyramidbuilder.h"
 #include <QElapsedTimer>
 #include "mapStruct.h"
+#include "tilestore.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class Widget; }
@@ -26,13 +28,21 @@ private slots:
 
     void on_but_threads_clicked(bool checked);
 
+    void on_but_pyramid_clicked(bool checked);
+
 private:
+    bool openStore();                          // 打开下载路径下的瓦片库
+    QList<ImageInfo> getInfos();               // 打开瓦片库，获取瓦片库中还没有的瓦片
     void finished(ImageInfo info);             // 通知下载完成的索引
+    void on_progress(const DownloadJob::Progress& progress);   // 批量下载进度
+    void on_pyramid(const PyramidBuilder::Progress& progress);   // 生成金字塔进度
 
 private:
     Ui::Widget *ui;
     DownloadThread* m_dThread = nullptr;       // 单线程下载
-    DownloadThreads* m_dThreads = nullptr;     // 多线程下载
+    DownloadJob* m_job = nullptr;              // 批量下载（可以中断后继续）
+    PyramidBuilder* m_pyramid = nullptr;       // 用最高层级的瓦片生成低层级瓦片
     QElapsedTimer m_timer;
+    QSharedPointer<TileStore> m_store;         // 保存下载的瓦片
 };
 #endif // WIDGET_H
@@ -1,6 +1,5 @@
 #include "mapgraphicsview.h"
 
-#include <QDir>
 #include <QDebug>
 #include <QGraphicsItemGroup>
 #include <QtConcurrent>
@@ -44,7 +43,19 @@ void MapGraphicsView::quit()
 void MapGraphicsView::setPath(const QString &path)
 {
     if(path.isEmpty()) return;
+    quit();
     m_path = path;
+    m_store = TileStore::shared(path, TileStore::ReadOnly);   // 只读打开，不占用写锁，MapDownload可以同时下载
+    if(m_store->count() == 0)   // 以前z/x/y.jpg方式保存的瓦片，临时获取写锁导入瓦片库，只遍历一次文件夹
+    {
+        qInfo() << "导入瓦片数：" << m_store->importDirectory(path);
+    }
+    if(!m_store->isOpen())
+    {
+        qWarning() << m_store->errorString();
+        return;
+    }
+    m_store->refresh();         // 其它程序（MapDownload）正在写入时读取新下载的瓦片
     getMapLevel();      // 获取瓦片层级
     loatImage();        // 加载第一层瓦片
 }
@@ -87,30 +98,18 @@ void MapGraphicsView::getMapLevel()
 
     clearReset();    // 加载新瓦片路径时将之前的内容清空
 
-    QDir dir(m_path);
-    dir.setFilter(QDir::Dirs | QDir::NoDotAndDotDot);    // 设置过滤类型为文件夹，且不包含隐藏文件夹
-    dir.setSorting(QDir::Name);                          // 设置按文件夹名称排序
-    QStringList dirs = dir.entryList();
-    for(auto& strDir : dirs)
+    for(int level : m_store->levels())     // 从瓦片库的内存索引中获取层级，不需要遍历文件夹
     {
-        bool ok;
-        int level = strDir.toInt(&ok);
-        if(ok)
-        {
-            if(!m_mapItemGroups.contains(level))  // 如果不包含
-            {
-                // 初始化加载所有瓦片层级到场景中，默认不显示
-                QGraphicsItemGroup* itemMap = new QGraphicsItemGroup();
-                m_scene->addItem(itemMap);
-                itemMap->setVisible(false);
-                m_mapItemGroups[level] = itemMap;
-                // 初始化加载所有瓦片层级网格到场景中，默认不显示
-                QGraphicsItemGroup* itemGrid = new QGraphicsItemGroup();
-                m_scene->addItem(itemGrid);
-                itemGrid->setVisible(false);
-                m_gridItemGroups[level] = itemGrid;
-            }
-        }
+        // 初始化加载所有瓦片层级到场景中，默认不显示
+        QGraphicsItemGroup* itemMap = new QGraphicsItemGroup();
+        m_scene->addItem(itemMap);
+        itemMap->setVisible(false);
+        m_mapItemGroups[level] = itemMap;
+        // 初始化加载所有瓦片层级网格到场景中，默认不显示
+        QGraphicsItemGroup* itemGrid = new QGraphicsItemGroup();
+        m_scene->addItem(itemGrid);
+        itemGrid->setVisible(false);
+        m_gridItemGroups[level] = itemGrid;
     }
 }
 
@@ -119,50 +118,23 @@ void MapGraphicsView::getMapLevel()
  */
 void MapGraphicsView::getTitle()
 {
-    QString path = m_path + QString("/%1").arg(getKey());    // z  第一层文件夹
-    QDir dir(path);
-    dir.setFilter(QDir::Dirs | QDir::NoDotAndDotDot);    // 设置过滤类型为文件夹，且不包含隐藏文件夹
-    dir.setSorting(QDir::Name);                          // 设置按文件夹名称排序
-    QStringList dirs = dir.entryList();
-    QPoint point;
-    for(auto& strDir : dirs)
-    {
-        bool ok;
-        int x = strDir.toInt(&ok);                         // x层级 第二层文件夹
-        if(ok)
-        {
-            point.setX(x);
-            dir.setPath(path + QString("/%1").arg(x));
-            dir.setFilter(QDir::Files | QDir::NoDotAndDotDot);    // 设置过滤类型为文件，且不包含隐藏文件
-            dir.setSorting(QDir::Name);                           // 设置按文件夹名称排序
-            QStringList files = dir.entryList();
-            for(auto& file: files)
-            {
-                int y = file.split('.').at(0).toInt(&ok);   // 去除后缀，以文件名为y
-                if(ok)
-                {
-                    point.setY(y);
-                    m_imgTitle.append(point);
-                }
-            }
-        }
-    }
+    m_imgTitle = m_store->tiles(getKey());    // 按x、y排序，第一张瓦片为左上角
 }
 
-QString g_path;   // 保存当前层级路径
+QSharedPointer<TileStore> g_store;   // 当前显示的瓦片库
+int g_level = 0;                     // 当前层级
 /**
  * @brief       在多线程中加载图片
  * @param point
  */
 void readImg(const QPoint& point)
 {
-    QString path = QString("%1/%2/%3.jpg").arg(g_path).arg(point.x()).arg(point.y());
-    QPixmap image;
-    if(image.load(path))
+    QImage image;      // QPixmap只能在ui线程中使用，子线程中解码为QImage
+    if(image.loadFromData(g_store->tile(g_level, point.x(), point.y())))   // 从内存映射中读取，格式由数据自动识别
     {
         if(g_this)
         {
-            emit g_this->addImage(image, point);   // 由于不能在子线程中访问ui，所以这里通过信号将图片传递到ui线程进行绘制
+            emit g_this->addImage(image, point);   // 由于不能在子线程中访问ui，所以这里通过信号将图片传递到ui线程转为QPixmap后绘制
         }
     }
 //    QThread::msleep(50);     // 加载时加上延时可以更加清晰的看到加载过程
@@ -186,7 +158,8 @@ void MapGraphicsView::loatImage()
     if(m_mapitemGroup->boundingRect().isEmpty())   // 如果图元为空则加载图元显示
     {
         getTitle();      // 获取新层级的所有瓦片编号
-        g_path = m_path + QString("/%1").arg(getKey());
+        g_store = m_store;
+        g_level = getKey();
         m_future = QtConcurrent::map(m_imgTitle, readImg);
     }
     m_mapitemGroup->setVisible(true);              // 显示新瓦片图层
@@ -243,7 +216,7 @@ int MapGraphicsView::getKey()
  * @param img   显示的图片
  * @param pos   图片显示的位置
  */
-void MapGraphicsView::on_addImage(QPixmap img, QPoint pos)
+void MapGraphicsView::on_addImage(QImage img, QPoint pos)
 {
     if(!m_mapitemGroup || m_imgTitle.isEmpty())
     {
@@ -255,7 +228,7 @@ void MapGraphicsView::on_addImage(QPixmap img, QPoint pos)
     int x = (pos.x() - begin.x()) * 256;
     int y = (pos.y() - begin.y()) * 256;
     // 绘制瓦片
-    QGraphicsPixmapItem* itemImg = new QGraphicsPixmapItem(img);
+    QGraphicsPixmapItem* itemImg = new QGraphicsPixmapItem(QPixmap::fromImage(img));
     itemImg->setPos(x, y);   // 以第一张瓦片为原点
     m_mapitemGroup->addToGroup(itemImg);
 
@@ -8,7 +8,7 @@
  * 说明：   包含程序中使用到的结构体
  * ******************************************************************/
 
-#include <QPixmap>
+#include <QImage>
 #include <QPointF>
 #include <QString>
 
@@ -20,7 +20,7 @@ struct ImageInfo
     int z;
     QString url;       // 下载瓦片的地址
     QString format;    // 图片格式
-    QPixmap img;       // 保存下载后的瓦片
+    QImage img;        // 保存加载的瓦片（线程池中解码为QImage，显示时再转为QPixmap）
     short count = 0;   // 失败下载次数，初始为0，下载失败一次+1
 };
 
@@ -41,7 +41,7 @@ void MapGraphicsView::setRect(QRect rect)
 void MapGraphicsView::drawImg(const ImageInfo& info)
 {
     // 绘制瓦片图
-    auto item = m_scene->addPixmap(info.img);
+    auto item = m_scene->addPixmap(QPixmap::fromImage(info.img));   // QPixmap只在ui线程中创建
     QPoint pos = Bing::tileXYToPixelXY(QPoint(info.x, info.y));
     item->setPos(pos);
     // 绘制边框
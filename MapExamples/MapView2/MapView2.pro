@@ -31,6 +31,7 @@ FORMS += \
 
 include($$PWD/MapView/MapView.pri)
 INCLUDEPATH += $$PWD/MapView/
+include($$PWD/../TileStore/TileStore.pri)   # 瓦片打包存储（共用）
 
 #  定义程序版本号
 VERSION = 1.0.0
@@ -4,12 +4,15 @@
 
 #include <qstring.h>
 #include <QDebug>
+#include <QBuffer>
 #include <QFileDialog>
+#include <QImageReader>
 #include <QStringList>
 #include <QWidgetAction>
 #include <QtConcurrent>
 
 static MapGraphicsView* g_view = nullptr;   // 当前视图
+static TileStore* g_store = nullptr;        // 当前瓦片库
 
 Widget::Widget(QWidget* parent)
     : QWidget(parent)
@@ -42,7 +45,26 @@ void Widget::on_but_open_clicked()
     ui->line_path->setText(path);
     //    ui->graphicsView->setPath(path);
 
-    m_levels = getDir(path);
+    if (m_future.isRunning())
+    {
+        m_future.cancel();
+        m_future.waitForFinished();
+    }
+    m_store = TileStore::shared(path, TileStore::ReadOnly);   // 只读打开，不占用写锁，MapDownload可以同时下载
+    g_store = m_store.data();
+    if (m_store->count() == 0)   // 以前z/x/y.格式保存的瓦片，临时获取写锁导入瓦片库，只遍历一次文件夹
+    {
+        qInfo() << "导入瓦片数：" << m_store->importDirectory(path);
+    }
+    if (!m_store->isOpen())
+    {
+        qWarning() << m_store->errorString();
+        return;
+    }
+    m_store->refresh();
+
+    ui->graphicsView->clear();
+    m_levels = m_store->levels();   // 从瓦片库的内存索引中获取，不需要遍历文件夹
     QString str;
     for (auto v : m_levels)
     {
@@ -58,81 +80,26 @@ void Widget::on_but_open_clicked()
     }
 }
 
-/**
- * @brief         传入路径，获取文件夹下所有子文件夹名称，并排序放入数组
- * @param path
- * @return
- */
-QVector<int> Widget::getDir(const QString& path)
-{
-    QVector<int> vector;
-    QDir dir(path);
-    dir.setFilter(QDir::Dirs | QDir::NoDotAndDotDot);   // 设置过滤类型为文件夹，且不包含隐藏文件夹
-    QStringList dirs = dir.entryList();
-    for (auto& strDir : dirs)
-    {
-        bool ok;
-        int v = strDir.toInt(&ok);
-        if (ok)
-        {
-            vector.append(v);
-        }
-    }
-    qSort(vector.begin(), vector.end());
-    return vector;
-}
-
-/**
- * @brief         传入路径，获取文件夹下所有文件名称，并排序放入数组
- * @param path
- * @return
- */
-QVector<int> Widget::getFile(const QString& path)
-{
-    QVector<int> vector;
-    QDir dir(path);
-    dir.setFilter(QDir::Files | QDir::NoDotAndDotDot);   // 设置过滤类型为文件，且不包含隐藏文件
-    QStringList files = dir.entryList();
-    for (auto& file : files)
-    {
-        QFileInfo info(file);
-        // 将文件名转为数字
-        bool ok;
-        int v = info.baseName().toInt(&ok);
-        if (ok)
-        {
-            vector.append(v);
-        }
-        // 获取所有存在的文件类型
-        QString suffix = info.completeSuffix();
-        if (ui->com_format->findText(suffix) < 0)
-        {
-            ui->com_format->addItem(suffix);
-        }
-    }
-    qSort(vector.begin(), vector.end());
-    return vector;
-}
-
 /**
  * @brief         获取当前层级的所有瓦片编号
  * @param level   地图层级Z
  */
 void Widget::getTitles(int level)
 {
-    QString root = ui->line_path->text() + QString("/%1/").arg(level);
-    QVector<int> titleX = getDir(root);   // 获取所有X层级
+    m_tiles = m_store->tiles(level).toList();   // 按x、y排序
+    if (m_tiles.isEmpty())
+        return;
 
-    m_tiles.clear();
-    for (auto x : titleX)
+    // 显示瓦片的图片格式
+    QByteArray data = m_store->tile(level, m_tiles.first().x(), m_tiles.first().y());
+    QBuffer buffer(&data);
+    QString format = QImageReader::imageFormat(&buffer);
+    if (ui->com_format->findText(format) < 0)
     {
-        QString path = root + QString("%1/").arg(x);
-        QVector<int> titleY = getFile(path);
-        for (auto y : titleY)
-        {
-            m_tiles.append(QPoint(x, y));
-        }
+        ui->com_format->addItem(format);
     }
+    ui->com_format->setCurrentText(format);
+
     QPoint lt = m_tiles.first();
     QPoint rd = m_tiles.last() + QPoint(1, 1);
     lt = Bing::tileXYToPixelXY(lt);
@@ -159,7 +126,7 @@ void Widget::getTitles(int level)
  */
 void getImage(ImageInfo& info)
 {
-    if (info.img.load(info.url))
+    if (info.img.loadFromData(g_store->tile(info.z, info.x, info.y)))   // 从内存映射中读取，格式由数据自动识别
     {
         emit g_view->updateImage(info);
     }
@@ -170,16 +137,12 @@ void getImage(ImageInfo& info)
  */
 void Widget::loadImages()
 {
-    QString root = ui->line_path->text() + QString("/%1/").arg(m_level);
-    QString format = ui->com_format->currentText();
-
     m_imageInfos.clear();
     ImageInfo info;
     info.z = m_level;
+    info.format = ui->com_format->currentText();
     for (auto& tile : m_tiles)
     {
-        QString path = root + QString("%1/%2.%3").arg(tile.x()).arg(tile.y()).arg(format);
-        info.url = path;
         info.x = tile.x();
         info.y = tile.y();
         m_imageInfos.append(info);
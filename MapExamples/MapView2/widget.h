@@ -2,6 +2,7 @@
 #define WIDGET_H
 
 #include "mapStruct.h"
+#include "tilestore.h"
 #include <QFuture>
 #include <QWidget>
 
@@ -25,9 +26,6 @@ private slots:
     void on_but_open_clicked();
 
 private:
-    QVector<int> getDir(const QString& path);
-    QVector<int> getFile(const QString& path);
-
     void getTitles(int level);
     void loadImages();
     void zoom(bool flag);
@@ -36,6 +34,7 @@ private:
 
 private:
     Ui::Widget* ui;
+    QSharedPointer<TileStore> m_store;   // 瓦片库
     QVector<int> m_levels;
     int m_level = 0;   // 当前瓦片层级
     int m_index = 0;   // 索引
@@ -1,12 +1,18 @@
 HEADERS += \
+    $$PWD/bingbatch.h \
     $$PWD/bingformula.h \
     $$PWD/geturl.h \
-    $$PWD/graphicsitemgroup.h \
     $$PWD/mapStruct.h \
-    $$PWD/mapgraphicsview.h
+    $$PWD/mapgraphicsview.h \
+    $$PWD/pointlayeritem.h \
+    $$PWD/tilecache.h \
+    $$PWD/tilelayeritem.h
 
 SOURCES += \
+    $$PWD/bingbatch.cpp \
     $$PWD/bingformula.cpp \
     $$PWD/geturl.cpp \
-    $$PWD/graphicsitemgroup.cpp \
-    $$PWD/mapgraphicsview.cpp
+    $$PWD/mapgraphicsview.cpp \
+    $$PWD/pointlayeritem.cpp \
+    $$PWD/tilecache.cpp \
+    $$PWD/tilelayeritem.cpp
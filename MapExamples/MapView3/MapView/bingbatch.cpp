@@ -0,0 +1,302 @@
+﻿/********************************************************************
+ * 文件名： bingbatch.cpp
+ * 时间：   2025-04-27 19:55:31
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   Bing坐标转换的批量版本
+ * ******************************************************************/
+#include "bingbatch.h"
+#include "bingformula.h"
+#include <QtConcurrent>
+#include <QtMath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BING_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+const double MaxLat = 85.05112878;   // 与Bing::clipLat()相同
+const int ParallelCount = 65536;     // 超过这个点数时并行计算
+const int BlockSize = 16384;         // 并行时每个任务计算的点数
+
+/**
+ * @brief        点数较多时分块在全局线程池中并行计算
+ * @param count
+ * @param func   func(begin, end)计算[begin, end)范围内的点
+ */
+template <typename Func>
+void parallel(int count, Func func)
+{
+    if (count <= 0)
+        return;
+    if (count < ParallelCount)
+    {
+        func(0, count);
+        return;
+    }
+    QVector<int> blocks;
+    for (int i = 0; i < count; i += BlockSize)
+    {
+        blocks.append(i);
+    }
+    QtConcurrent::blockingMap(blocks, [&func, count](int& begin) { func(begin, qMin(begin + BlockSize, count)); });
+}
+
+/**
+ * @brief  与Bing::latLongToPixelXY()取整前相同的计算
+ */
+inline void pixelXY(double lon, double lat, double size, double& x, double& y)
+{
+    lon = Bing::clipLon(lon);
+    lat = Bing::clipLat(lat);
+    const double sinLat = qSin(lat * M_PI / 180);
+    x = Bing::clip((lon + 180) / 360 * size + 0.5, 0, size - 1);
+    y = Bing::clip((0.5 - qLn((1 + sinLat) / (1 - sinLat)) / (4 * M_PI)) * size + 0.5, 0, size - 1);
+}
+
+#ifdef BING_SSE2
+// 泰勒展开的系数，按z = x²从低次到高次
+const double SinCoeffs[] = {1.0,
+                            -1.0 / 6,
+                            1.0 / 120,
+                            -1.0 / 5040,
+                            1.0 / 362880,
+                            -1.0 / 39916800,
+                            1.0 / 6227020800.0,
+                            -1.0 / 1307674368000.0,
+                            1.0 / 355687428096000.0,
+                            -1.0 / 121645100408832000.0,
+                            1.0 / 51090942171709440000.0};   // 到x^21/21!
+const double LogCoeffs[] = {1.0, 1.0 / 3, 1.0 / 5, 1.0 / 7, 1.0 / 9, 1.0 / 11, 1.0 / 13, 1.0 / 15, 1.0 / 17, 1.0 / 19};
+const double Ln2Hi = 6.93147180369123816490e-01;   // ln2的高位，与不超过2^20的整数相乘没有舍入误差
+const double Ln2Lo = 1.90821492927058770002e-10;   // ln2的低位
+
+/**
+ * @brief    秦九韶算法计算c[I] + c[I + Step]z + c[I + 2Step]z² + ...，编译时展开
+ */
+template <int I, int Step, int N>
+inline __m128d horner(__m128d z, const double (&c)[N])
+{
+    if constexpr (I + Step >= N)
+        return _mm_set1_pd(c[I]);
+    else
+        return _mm_add_pd(_mm_mul_pd(horner<I + Step, Step>(z, c), z), _mm_set1_pd(c[I]));
+}
+
+/**
+ * @brief    计算c[0] + c[1]z + c[2]z² + ...，奇数项、偶数项分成两条互不依赖的秦九韶链，依赖链长度减半
+ */
+template <int N>
+inline __m128d poly(__m128d z, const double (&c)[N])
+{
+    const __m128d z2 = _mm_mul_pd(z, z);
+    return _mm_add_pd(horner<0, 2>(z2, c), _mm_mul_pd(z, horner<1, 2>(z2, c)));
+}
+
+inline __m128d select(__m128d mask, __m128d a, __m128d b)
+{
+    return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+
+inline __m128d clip(__m128d n, double min, double max)
+{
+    return _mm_min_pd(_mm_max_pd(n, _mm_set1_pd(min)), _mm_set1_pd(max));
+}
+
+/**
+ * @brief    sin(x)，|x| <= π/2，泰勒展开到x^21，截断误差小于1e-18
+ */
+inline __m128d sin(__m128d x)
+{
+    return _mm_mul_pd(x, poly(_mm_mul_pd(x, x), SinCoeffs));
+}
+
+/**
+ * @brief    ln(x)，x为正的规格化数：x = m * 2^e，m在[√2/2, √2)，
+ *           ln(m) = 2(f + f³/3 + f⁵/5 + ...)，f = (m - 1) / (m + 1)，|f| < 0.172，截断误差小于1e-17
+ */
+inline __m128d log(__m128d x)
+{
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128i bits = _mm_castpd_si128(x);
+    __m128i e = _mm_srli_epi64(bits, 52);                   // x为正数，右移后只剩指数
+    e = _mm_shuffle_epi32(e, _MM_SHUFFLE(3, 1, 2, 0));     // 两个64位的低32位放到前两个int中
+    __m128d exponent = _mm_sub_pd(_mm_cvtepi32_pd(e), _mm_set1_pd(1023));
+    const __m128i mantissa = _mm_and_si128(bits, _mm_set1_epi64x(0x000FFFFFFFFFFFFFLL));
+    __m128d m = _mm_castsi128_pd(_mm_or_si128(mantissa, _mm_set1_epi64x(0x3FF0000000000000LL)));   // [1, 2)
+    const __m128d big = _mm_cmpgt_pd(m, _mm_set1_pd(M_SQRT2));
+    m = select(big, _mm_mul_pd(m, _mm_set1_pd(0.5)), m);
+    exponent = _mm_add_pd(exponent, _mm_and_pd(big, one));
+
+    const __m128d f = _mm_div_pd(_mm_sub_pd(m, one), _mm_add_pd(m, one));
+    const __m128d z = _mm_mul_pd(f, f);
+    const __m128d lnm = _mm_mul_pd(_mm_add_pd(f, f), poly(z, LogCoeffs));
+    const __m128d low = _mm_add_pd(_mm_mul_pd(exponent, _mm_set1_pd(Ln2Lo)), lnm);
+    return _mm_add_pd(_mm_mul_pd(exponent, _mm_set1_pd(Ln2Hi)), low);
+}
+
+/**
+ * @brief  两个点的经纬度转像素坐标，公式与Bing::latLongToPixelXY()相同，除以常数改为乘以倒数
+ */
+inline void pixelXY(__m128d lon, __m128d lat, double size, __m128d& x, __m128d& y)
+{
+    const __m128d one = _mm_set1_pd(1.0);
+    lon = clip(lon, -180, 180);
+    lat = clip(lat, -MaxLat, MaxLat);
+    const __m128d sinLat = sin(_mm_mul_pd(lat, _mm_set1_pd(M_PI / 180)));
+    const __m128d ln = log(_mm_div_pd(_mm_add_pd(one, sinLat), _mm_sub_pd(one, sinLat)));
+    const __m128d fx = _mm_mul_pd(_mm_add_pd(lon, _mm_set1_pd(180)), _mm_set1_pd(1.0 / 360));
+    const __m128d fy = _mm_sub_pd(_mm_set1_pd(0.5), _mm_mul_pd(ln, _mm_set1_pd(1 / (4 * M_PI))));
+    x = clip(_mm_add_pd(_mm_mul_pd(fx, _mm_set1_pd(size)), _mm_set1_pd(0.5)), 0, size - 1);
+    y = clip(_mm_add_pd(_mm_mul_pd(fy, _mm_set1_pd(size)), _mm_set1_pd(0.5)), 0, size - 1);
+}
+#endif
+
+/**
+ * @brief  经纬度转像素坐标，output(i, x, y)保存第i个点的结果；SSE2下每次两个点，剩下的一个点补齐后计算，保证所有点结果一致
+ */
+template <typename Output>
+void pixelXY(const double* lon, const double* lat, int begin, int end, double size, Output output)
+{
+#ifdef BING_SSE2
+    __m128d x;
+    __m128d y;
+    int i = begin;
+    for (; i + 1 < end; i += 2)
+    {
+        pixelXY(_mm_loadu_pd(lon + i), _mm_loadu_pd(lat + i), size, x, y);
+        output(i, x, y);
+    }
+    if (i < end)
+    {
+        pixelXY(_mm_set1_pd(lon[i]), _mm_set1_pd(lat[i]), size, x, y);
+        output(i, x, y);
+    }
+#else
+    for (int i = begin; i < end; i++)
+    {
+        double x = 0;
+        double y = 0;
+        pixelXY(lon[i], lat[i], size, x, y);
+        output(i, x, y);
+    }
+#endif
+}
+}   // namespace
+
+/**
+ * @brief        批量经纬度转像素坐标（不取整）
+ * @param lon    经度数组
+ * @param lat    纬度数组
+ * @param count  点数
+ * @param level  地图级别
+ * @param x      返回像素坐标
+ * @param y
+ */
+void Bing::latLongToPixelXY(const double* lon, const double* lat, int count, int level, double* x, double* y)
+{
+    const double size = mapSize(level);
+    parallel(count, [=](int begin, int end) {
+#ifdef BING_SSE2
+        pixelXY(lon, lat, begin, end, size, [=](int i, __m128d px, __m128d py) {
+            if (i + 1 < end)
+            {
+                _mm_storeu_pd(x + i, px);
+                _mm_storeu_pd(y + i, py);
+            }
+            else
+            {
+                _mm_store_sd(x + i, px);
+                _mm_store_sd(y + i, py);
+            }
+        });
+#else
+        pixelXY(lon, lat, begin, end, size, [=](int i, double px, double py) {
+            x[i] = px;
+            y[i] = py;
+        });
+#endif
+    });
+}
+
+/**
+ * @brief        批量经纬度转像素坐标，与latLongToPixelXY()相同向下取整
+ */
+void Bing::latLongToPixelXY(const double* lon, const double* lat, int count, int level, int* x, int* y)
+{
+    const double size = mapSize(level);
+    parallel(count, [=](int begin, int end) {
+#ifdef BING_SSE2
+        pixelXY(lon, lat, begin, end, size, [=](int i, __m128d px, __m128d py) {
+            const __m128i ix = _mm_cvttpd_epi32(px);   // 像素坐标不小于0，截断即向下取整
+            const __m128i iy = _mm_cvttpd_epi32(py);
+            if (i + 1 < end)
+            {
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(x + i), ix);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(y + i), iy);
+            }
+            else
+            {
+                x[i] = _mm_cvtsi128_si32(ix);
+                y[i] = _mm_cvtsi128_si32(iy);
+            }
+        });
+#else
+        pixelXY(lon, lat, begin, end, size, [=](int i, double px, double py) {
+            x[i] = int(px);
+            y[i] = int(py);
+        });
+#endif
+    });
+}
+
+/**
+ * @brief        批量像素坐标转经纬度
+ * @param x      像素坐标数组
+ * @param y
+ * @param count  点数
+ * @param level  地图级别
+ * @param lon    返回经度
+ * @param lat    返回纬度
+ */
+void Bing::pixelXYToLatLong(const int* x, const int* y, int count, int level, double* lon, double* lat)
+{
+    parallel(count, [=](int begin, int end) {
+        for (int i = begin; i < end; i++)
+        {
+            Bing::pixelXYToLatLong(QPoint(x[i], y[i]), level, lon[i], lat[i]);
+        }
+    });
+}
+
+/**
+ * @brief        批量经纬度转瓦片编号
+ */
+void Bing::latLongToTileXY(const double* lon, const double* lat, int count, int level, int* x, int* y)
+{
+    const double size = mapSize(level);
+    parallel(count, [=](int begin, int end) {
+#ifdef BING_SSE2
+        pixelXY(lon, lat, begin, end, size, [=](int i, __m128d px, __m128d py) {
+            const __m128i ix = _mm_srai_epi32(_mm_cvttpd_epi32(px), 8);   // 除以256
+            const __m128i iy = _mm_srai_epi32(_mm_cvttpd_epi32(py), 8);
+            if (i + 1 < end)
+            {
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(x + i), ix);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(y + i), iy);
+            }
+            else
+            {
+                x[i] = _mm_cvtsi128_si32(ix);
+                y[i] = _mm_cvtsi128_si32(iy);
+            }
+        });
+#else
+        pixelXY(lon, lat, begin, end, size, [=](int i, double px, double py) {
+            x[i] = int(px) / 256;
+            y[i] = int(py) / 256;
+        });
+#endif
+    });
+}
@@ -0,0 +1,27 @@
+﻿#ifndef BINGBATCH_H
+#define BINGBATCH_H
+/********************************************************************
+ * 文件名： bingbatch.h
+ * 时间：   2025-04-27 19:55:31
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   Bing坐标转换的批量版本，用于GPS轨迹等大量点的投影
+ *          1、经度、纬度分别存放在连续的数组中（SoA），结果同样分开存放；
+ *          2、经纬度转像素在x86下使用SSE2一次计算两个点，sin、ln使用多项式近似，
+ *             与latLongToPixelXY()的差小于5e-5像素（23级），取整后只有正好落在整数边界附近的点可能相差1像素；其它平台逐点计算；
+ *          3、像素转经纬度逐点调用pixelXYToLatLong()，结果相同（exp、atan的多项式近似在SSE2下不比标量版本快）；
+ *          4、点数超过65536时分块在全局线程池中并行计算。
+ * ******************************************************************/
+
+namespace Bing {
+// 经纬度转像素坐标，x、y为不取整的像素坐标（与latLongToPixelXY()取整前的值相同）
+void latLongToPixelXY(const double* lon, const double* lat, int count, int level, double* x, double* y);
+// 经纬度转像素坐标，与latLongToPixelXY()的结果相同
+void latLongToPixelXY(const double* lon, const double* lat, int count, int level, int* x, int* y);
+// 像素坐标转经纬度，与pixelXYToLatLong()的结果相同
+void pixelXYToLatLong(const int* x, const int* y, int count, int level, double* lon, double* lat);
+// 经纬度转瓦片编号，与latLongToTileXY()的结果相同
+void latLongToTileXY(const double* lon, const double* lat, int count, int level, int* x, int* y);
+}   // namespace Bing
+
+#endif   // BINGBATCH_H
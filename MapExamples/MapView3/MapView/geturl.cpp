@@ -7,15 +7,23 @@
  * ******************************************************************/
 #include "geturl.h"
 #include "bingformula.h"
-#include <qnetworkaccessmanager.h>
-#include <qnetworkreply.h>
+#include <QDateTime>
 #include <QDebug>
 #include <QSet>
 #include <QtConcurrent>
+#include <QtMath>
+
+static TileStore* g_store = nullptr;   // 当前瓦片源的缓存
+static TileCache* g_cache = nullptr;   // 内存中的瓦片缓存
 
 GetUrl::GetUrl(QObject* parent)
     : QObject{parent}
 {
+    m_fetcher = new TileFetcher(TileFetcher::Options(), this);   // 在moveToThread之前创建，和this一起移动到线程中
+    connect(m_fetcher, &TileFetcher::finished, this, &GetUrl::on_fetched);
+
+    g_cache = &m_cache;
+
     m_thread = new QThread;
     this->moveToThread(m_thread);
     m_thread->start();
@@ -23,6 +31,7 @@ GetUrl::GetUrl(QObject* parent)
     m_rect.setTopLeft(Bing::latLongToPixelXY(64.16, 56.115, m_level));
     m_rect.setBottomRight(Bing::latLongToPixelXY(148.66, 9.34, m_level));
     connect(GetUrlInterface::getInterface(), &GetUrlInterface::updateTitle, this, &GetUrl::updateTitle);
+    connect(GetUrlInterface::getInterface(), &GetUrlInterface::removeTitle, this, &GetUrl::removeTitle);
     connect(GetUrlInterface::getInterface(), &GetUrlInterface::showRect, this, &GetUrl::showRect);
     connect(GetUrlInterface::getInterface(), &GetUrlInterface::setLevel, this, &GetUrl::setLevel);
 }
@@ -31,6 +40,8 @@ GetUrl::~GetUrl()
 {
     quit();
     clear();
+    g_store = nullptr;
+    g_cache = nullptr;
 
     m_thread->quit();
     m_thread->wait();
@@ -49,54 +60,67 @@ void GetUrl::setUrl(QString url)
     quit();   // 退出下载后再清空数组，防止数据竞争
     clear();
     m_exist.clear();   // 清空已下载列表
+    m_placeholders.clear();
+    m_cache.clear();   // 内存缓存只保存当前瓦片源
     m_url = url;
+    m_store = TileStore::shared(TileStore::defaultPath(url));   // 同一个瓦片源在程序再次打开时直接从缓存加载
+    if (!m_store->isOpen())
+    {
+        qWarning() << m_store->errorString();
+    }
+    g_store = m_store->isOpen() ? m_store.data() : nullptr;
     getImg(m_rect, m_level);   // 使用默认范围、层级更新地图
 }
 
 /**
- * @brief       下载瓦片
+ * @brief       在线程池中加载瓦片：先查找内存中解码后的图片，再解码内存中的数据或者瓦片库中的数据；
+ *              需要下载的瓦片先显示低层级瓦片放大的占位图
  * @param info
- * @return
  */
-void httpGet(ImageInfo info)
+static void loadTile(ImageInfo& info)
 {
-    QNetworkAccessManager manager;
-    QSharedPointer<QNetworkReply> reply(manager.get(QNetworkRequest(QUrl(info.url))));
-    // 等待返回
-    QEventLoop loop;
-    QObject::connect(reply.data(), &QNetworkReply::finished, &loop, &QEventLoop::quit);   // 等待获取完成
-    QTimer::singleShot(5000, &loop, &QEventLoop::quit);                                   // 等待超时
-    loop.exec();
-
-    if (reply->error() == QNetworkReply::NoError)
+    if (!g_cache)
+        return;
+
+    if (info.placeholder)
     {
-        QByteArray buf = reply->readAll();
-        if (!buf.isEmpty())
+        info.img = g_cache->placeholder(info.z, info.x, info.y);
+        if (!info.img.isNull())
         {
-            info.img.loadFromData(buf);
-            if (!info.img.isNull())
-            {
-                emit GetUrlInterface::getInterface() -> update(info);
-                emit GetUrlInterface::getInterface() -> updateTitle(info.x, info.y, info.z);
-                return;
-            }
+            emit GetUrlInterface::getInterface() -> update(info);   // 不加入已显示列表，下载完成后替换
         }
-    }
-
-    info.count++;
-    if (info.count < 3)
-    {
-        httpGet(info);   // 下载失败重新下载
+        info.img = QImage();   // 图片只由缓存和视图持有
         return;
     }
-    else
+
+    info.img = g_cache->image(info.z, info.x, info.y);
+    if (info.img.isNull())
     {
-        qWarning() << "下载失败：" << reply->errorString();
+        QByteArray data = g_cache->data(info.z, info.x, info.y);
+        if (data.isEmpty() && g_store)
+        {
+            data = g_store->tile(info.z, info.x, info.y);
+        }
+        if (data.isEmpty() || !info.img.loadFromData(data))
+            return;
+        g_cache->insert(info.z, info.x, info.y, info.img);
     }
+    emit GetUrlInterface::getInterface() -> update(info);   // QImage在ui线程中转为QPixmap
+    emit GetUrlInterface::getInterface() -> updateTitle(info.x, info.y, info.z);
+    info.img = QImage();
+}
+
+/**
+ * @brief         瓦片中心到视图中心的距离（瓦片为单位，乘16取整），用作下载优先级
+ * @param centre  视图中心（瓦片坐标）
+ */
+static int distance(int x, int y, const QPointF& centre)
+{
+    return qRound(qSqrt(qPow(x + 0.5 - centre.x(), 2) + qPow(y + 0.5 - centre.y(), 2)) * 16);
 }
 
 /**
- * @brief       获取瓦片地图
+ * @brief       获取瓦片地图，视图中的瓦片从中心向外加载；空闲时预取视图周围一圈和上下两个层级的瓦片
  * @param rect  瓦片地图的像素范围
  * @param level 瓦片地图的级别
  */
@@ -111,14 +135,107 @@ void GetUrl::getImg(QRect rect, int level)
 
     if (m_future.isRunning())   // 判断是否在运行
     {
-        m_future.cancel();   // 取消下载
+        m_future.cancel();   // 取消加载
+        m_future.waitForFinished();
+    }
+    clear();   // 清空待加载列表
+
+    const QPointF centre = QPointF(rect.center()) / 256.0;   // 视图中心的瓦片坐标
+    QVector<ImageInfo> infos = getTitle(rect, level);       // 获取所有需要加载的瓦片编号
+    std::sort(infos.begin(), infos.end(), [&centre](const ImageInfo& a, const ImageInfo& b) {
+        return distance(a.x, a.y, centre) < distance(b.x, b.y, centre);
+    });
+    qInfo() << "获取瓦片数：" << infos.count();
+    getUrl(infos);   // 将瓦片编号转为url
+
+    // 缓存中存在的瓦片先显示，不存在或者已经过期的瓦片交给TileFetcher下载（过期的带ETag重新验证），
+    // 不存在的瓦片下载完成前显示占位图
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    QVector<TileFetcher::Request> requests;
+    TileFetcher::Request request;
+    for (const ImageInfo& info : infos)
+    {
+        TileMeta meta;
+        const bool stored = g_store && g_store->meta(info.z, info.x, info.y, &meta);
+        const bool exist = stored || m_cache.contains(info.z, info.x, info.y);
+        const quint64 key = TileCache::key(info.z, info.x, info.y);
+        if (exist || !m_placeholders.contains(key))   // 拖动时同一个瓦片的占位图只生成一次
+        {
+            m_infos.append(info);
+            m_infos.last().placeholder = !exist;
+        }
+        if (!exist)
+        {
+            m_placeholders.insert(key);
+        }
+        if (!exist || meta.isExpired(now))
+        {
+            request.x = info.x;
+            request.y = info.y;
+            request.z = info.z;
+            request.url = info.url;
+            request.etag = stored ? meta.etag : QByteArray();
+            request.priority = distance(info.x, info.y, centre);
+            requests.append(request);
+        }
+    }
+    prefetch(requests, rect, level);
+
+    m_future = QtConcurrent::map(m_infos, loadTile);   // 在线程池中按距离从近到远解码缓存的瓦片、生成占位图
+    m_fetcher->schedule(requests);   // 离开视图的瓦片单独取消，已经在下载的瓦片不重复下载
+}
+
+/**
+ * @brief          预取瓦片：视图周围一圈、放大一级时视图中心区域、缩小一级时的整个视图，
+ *                 优先级都低于视图中的瓦片，只在网络空闲时下载，下载后保存到瓦片库
+ * @param requests
+ * @param rect
+ * @param level
+ */
+void GetUrl::prefetch(QVector<TileFetcher::Request>& requests, const QRect& rect, int level)
+{
+    if (!g_store)
+        return;
+
+    const QRect visible(Bing::pixelXYToTileXY(rect.topLeft()), Bing::pixelXYToTileXY(rect.bottomRight()));
+    QVector<ImageInfo> infos;
+    for (const ImageInfo& info : getTitle(rect.adjusted(-256, -256, 256, 256), level))
+    {
+        if (!visible.contains(info.x, info.y))
+        {
+            infos.append(info);
+        }
+    }
+    const int visibleEnd = infos.count();
+    if (level < 22)
+    {
+        QRect zoomIn(QPoint(), rect.size());
+        zoomIn.moveCenter(rect.center() * 2);
+        infos += getTitle(zoomIn, level + 1);
     }
-    clear();   // 清空待下载列表
+    const int zoomInEnd = infos.count();
+    if (level > 0)
+    {
+        infos += getTitle(QRect(rect.topLeft() / 2, rect.size() / 2), level - 1);
+    }
+    getUrl(infos);
 
-    getTitle(rect, level);   // 获取所有需要加载的瓦片编号
-    qInfo() << "获取瓦片数：" << m_infos.count();
-    getUrl();                                         // 将瓦片编号转为url
-    m_future = QtConcurrent::map(m_infos, httpGet);   // 在线程池中下载瓦片图
+    TileFetcher::Request request;
+    for (int i = 0; i < infos.count(); i++)
+    {
+        const ImageInfo& info = infos.at(i);
+        if (g_store->contains(info.z, info.x, info.y))
+            continue;
+        // 按层级换算视图中心
+        const QPointF centre = QPointF(rect.center()) / 256.0 * qPow(2, info.z - level);
+        const int band = i < visibleEnd ? RingPriority : (i < zoomInEnd ? ZoomInPriority : ZoomOutPriority);
+        request.x = info.x;
+        request.y = info.y;
+        request.z = info.z;
+        request.url = info.url;
+        request.priority = band + distance(info.x, info.y, centre);
+        requests.append(request);
+    }
 }
 
 /**
@@ -145,21 +262,23 @@ void GetUrl::setLevel(int level)
     if (m_level != level)
     {
         m_exist.clear();   // 清空已下载列表
+        m_placeholders.clear();
     }
     m_level = level;
 }
 
 /**
- * @brief       获取瓦片编号
+ * @brief       获取瓦片编号（不包括已经显示的瓦片）
  * @param rect
  * @param level
  */
-void GetUrl::getTitle(QRect rect, int level)
+QVector<ImageInfo> GetUrl::getTitle(const QRect& rect, int level) const
 {
     QPoint tl = Bing::pixelXYToTileXY(rect.topLeft());
     QPoint br = Bing::pixelXYToTileXY(rect.bottomRight());
 
     quint64 value = 0;
+    QVector<ImageInfo> infos;
     ImageInfo info;
     info.z = level;
 
@@ -182,16 +301,17 @@ void GetUrl::getTitle(QRect rect, int level)
             if (!m_exist.contains(value))
             {
                 info.y = y;
-                m_infos.append(info);
+                infos.append(info);
             }
         }
     }
+    return infos;
 }
 
 /**
  * @brief 获取用于请求瓦片地图的信息
  */
-void GetUrl::getUrl()
+void GetUrl::getUrl(QVector<ImageInfo>& infos) const
 {
     if (m_url.contains("{x}"))   // XYZ格式
     {
@@ -199,9 +319,9 @@ void GetUrl::getUrl()
         url.replace("{x}", "%1");
         url.replace("{y}", "%2");
         url.replace("{z}", "%3");
-        for (int i = 0; i < m_infos.count(); i++)
+        for (int i = 0; i < infos.count(); i++)
         {
-            m_infos[i].url = url.arg(m_infos[i].x).arg(m_infos[i].y).arg(m_infos[i].z);
+            infos[i].url = url.arg(infos[i].x).arg(infos[i].y).arg(infos[i].z);
         }
     }
     else if (m_url.contains("{q}"))   // Bing的quadKey格式
@@ -209,12 +329,12 @@ void GetUrl::getUrl()
         QString url = m_url;
         url.replace("{q}", "%1");
         QPoint point;
-        for (int i = 0; i < m_infos.count(); i++)
+        for (int i = 0; i < infos.count(); i++)
         {
-            point.setX(m_infos[i].x);
-            point.setY(m_infos[i].y);
-            QString quadKey = Bing::tileXYToQuadKey(point, m_infos[i].z);   // 将xy转为quadkey
-            m_infos[i].url = url.arg(quadKey);
+            point.setX(infos[i].x);
+            point.setY(infos[i].y);
+            QString quadKey = Bing::tileXYToQuadKey(point, infos[i].z);   // 将xy转为quadkey
+            infos[i].url = url.arg(quadKey);
         }
     }
     else
@@ -242,6 +362,7 @@ void GetUrl::quit()
         m_future.cancel();            // 取消下载
         m_future.waitForFinished();   // 等待退出
     }
+    m_fetcher->cancel();
 }
 
 /**
@@ -255,3 +376,67 @@ void GetUrl::updateTitle(int x, int y, int z)
     quint64 value = (quint64(z) << 48) + (x << 24) + y;
     m_exist.insert(value);
 }
+
+/**
+ * @brief     视图移除了离开显示范围的瓦片图元，从已下载列表中删除，再次进入视图时从缓存重新加载
+ * @param x
+ * @param y
+ * @param z
+ */
+void GetUrl::removeTitle(int x, int y, int z)
+{
+    quint64 value = (quint64(z) << 48) + (x << 24) + y;
+    m_exist.remove(value);
+    m_placeholders.remove(TileCache::key(z, x, y));
+}
+
+/**
+ * @brief        下载完成，保存到瓦片库并显示
+ * @param result
+ */
+void GetUrl::on_fetched(const TileFetcher::Result& result)
+{
+    const TileFetcher::Request& request = result.request;
+    if (!result.isOk())
+    {
+        qWarning() << "下载失败：" << request.url << result.error;
+        return;
+    }
+
+    TileMeta meta;
+    meta.etag = result.etag;
+    meta.fetched = QDateTime::currentSecsSinceEpoch();
+    meta.expires = result.expires;
+    if (result.notModified)   // 缓存的瓦片已经显示，只更新过期时间
+    {
+        if (g_store)
+        {
+            if (meta.etag.isEmpty())
+            {
+                TileMeta old;
+                g_store->meta(request.z, request.x, request.y, &old);
+                meta.etag = old.etag;
+            }
+            g_store->updateMeta(request.z, request.x, request.y, meta);
+        }
+        return;
+    }
+    if (g_store)
+    {
+        g_store->insert(request.z, request.x, request.y, result.data, meta);
+    }
+    // 预取的低层级瓦片解码后也放入内存缓存，放大时可以马上生成占位图
+    m_cache.insert(request.z, request.x, request.y, result.data);
+    m_cache.insert(request.z, request.x, request.y, result.image);
+    if (request.z != m_level)   // 预取的其它层级只保存
+        return;
+
+    ImageInfo info;
+    info.x = request.x;
+    info.y = request.y;
+    info.z = request.z;
+    info.url = request.url;
+    info.img = result.image;   // 已经在解码线程池中解码
+    emit GetUrlInterface::getInterface() -> update(info);
+    emit GetUrlInterface::getInterface() -> updateTitle(info.x, info.y, info.z);
+}
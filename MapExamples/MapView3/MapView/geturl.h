@@ -2,6 +2,9 @@
 #define GETURL_H
 
 #include "mapStruct.h"
+#include "tilecache.h"
+#include "tilefetcher.h"
+#include "tilestore.h"
 #include <qfuture.h>
 #include <qset.h>
 #include <QObject>
@@ -19,6 +22,7 @@ public:
 signals:
     void update(ImageInfo info);             // 传出下载的瓦片图信息
     void updateTitle(int x, int y, int z);   // 传出下载的瓦片编号
+    void removeTitle(int x, int y, int z);   // 视图移除了瓦片图元，再次进入视图时重新加载
 
     void showRect(QRect rect);   // 设置显示像素范围
     void setLevel(int level);    // 设置瓦片层级
@@ -37,20 +41,35 @@ public:
     void setLevel(int level);   // 设置瓦片层级
 
 private:
-    void getTitle(QRect rect, int level);    // 获取所有需要下载的瓦片地图编号
-    void getUrl();                           // 获取用于请求瓦片地图的信息
+    QVector<ImageInfo> getTitle(const QRect& rect, int level) const;   // 获取所有需要下载的瓦片地图编号
+    void getUrl(QVector<ImageInfo>& infos) const;                      // 获取用于请求瓦片地图的信息
+    void prefetch(QVector<TileFetcher::Request>& requests, const QRect& rect, int level);   // 添加预取的瓦片
     void clear();                            // 清空内容
     void quit();                             // 退出下载
     void updateTitle(int x, int y, int z);   // 传出下载的瓦片编号
+    void removeTitle(int x, int y, int z);
+    void on_fetched(const TileFetcher::Result& result);
 
 private:
+    // 下载优先级，数值越小越先下载；同一段内按到视图中心的距离排序
+    enum Priority
+    {
+        RingPriority = 1 << 20,      // 视图周围一圈
+        ZoomInPriority = 2 << 20,    // 放大一级
+        ZoomOutPriority = 3 << 20    // 缩小一级
+    };
+
     QThread* m_thread = nullptr;
-    QFuture<void> m_future;
+    QFuture<void> m_future;       // 在线程池中解码缓存的瓦片
+    TileFetcher* m_fetcher = nullptr;
     QRect m_rect;      // 显示瓦片地图像素范围
     int m_level = 5;   // 瓦片地图层级
     QString m_url;
+    QSharedPointer<TileStore> m_store;   // 瓦片缓存，每个瓦片源一个瓦片库
+    TileCache m_cache;                   // 内存中最近使用的瓦片，限制占用的内存
     QSet<quint64> m_exist;        // 已经存在的瓦片地图编号
-    QVector<ImageInfo> m_infos;   // 需要下载的瓦片地图信息
+    QSet<quint64> m_placeholders; // 已经生成过占位图的瓦片编号
+    QVector<ImageInfo> m_infos;   // 需要从缓存加载的瓦片地图信息（包括占位图），按到视图中心的距离排序
 };
 
 #endif   // GETURL_H
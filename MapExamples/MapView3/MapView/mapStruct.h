@@ -8,7 +8,7 @@
  * 说明：   包含程序中使用到的结构体
  * ******************************************************************/
 
-#include <QPixmap>
+#include <QImage>
 #include <QPointF>
 #include <QString>
 
@@ -20,8 +20,9 @@ struct ImageInfo
     int z = 0;
     QString url;       // 下载瓦片的地址
     QString format;    // 图片格式
-    QPixmap img;       // 保存下载后的瓦片
+    QImage img;        // 保存下载后的瓦片（QImage可以在线程池中解码，显示时再转为QPixmap）
     short count = 0;   // 失败下载次数，初始为0，下载失败一次+1
+    bool placeholder = false;   // 低层级瓦片放大的占位图，真正的瓦片加载后替换
 };
 
 #endif   // MAPSTRUCT_H
@@ -18,6 +18,14 @@ MapGraphicsView::MapGraphicsView(QWidget* parent)
     this->setScene(m_scene);
     this->setDragMode(QGraphicsView::ScrollHandDrag);   // 鼠标拖拽
 
+    m_layer = new TileLayerItem();
+    m_layer->setLevel(m_level);
+    m_scene->addItem(m_layer);
+
+    m_points = new PointLayerItem();
+    m_points->setLevel(m_level);
+    m_scene->addItem(m_points);
+
     // 窗口左上角初始显示位置(中国)
     m_scenePos.setX(5700);
     m_scenePos.setY(2700);
@@ -45,18 +53,7 @@ void MapGraphicsView::setRect(int level)
  */
 void MapGraphicsView::drawImg(const ImageInfo& info)
 {
-    if (!m_itemGroup.contains(info.z))   // 如果图层不存在则添加
-    {
-        auto* item = new GraphicsItemGroup();
-        m_itemGroup.insert(info.z, item);
-        m_scene->addItem(item);
-    }
-
-    GraphicsItemGroup* itemGroup = m_itemGroup.value(info.z);
-    if (itemGroup)
-    {
-        itemGroup->addImage(info);
-    }
+    m_layer->addImage(info);   // 缩放前还没有处理的瓦片层级不同，不再显示
 }
 
 /**
@@ -64,15 +61,28 @@ void MapGraphicsView::drawImg(const ImageInfo& info)
  */
 void MapGraphicsView::clear()
 {
-    auto* itemGroup = m_itemGroup.value(m_level);
-    if (itemGroup)
+    // 范围为空时删除所有瓦片，通知GetUrl后再次移动视图时重新加载
+    for (const QPoint& tile : m_layer->prune(QRect()))
     {
-        delete itemGroup;
-        m_itemGroup.remove(m_level);
-        m_level = 0;
+        emit GetUrlInterface::getInterface() -> removeTitle(tile.x(), tile.y(), m_level);
     }
 }
 
+/**
+ * @brief      显示大量的点，所有点在一个图元中绘制
+ * @param lon  经度
+ * @param lat  纬度
+ */
+void MapGraphicsView::setPoints(const QVector<double>& lon, const QVector<double>& lat)
+{
+    m_points->setPoints(lon, lat);
+}
+
+void MapGraphicsView::clearPoints()
+{
+    m_points->clear();
+}
+
 void MapGraphicsView::mousePressEvent(QMouseEvent* event)
 {
     QGraphicsView::mousePressEvent(event);
@@ -80,6 +90,28 @@ void MapGraphicsView::mousePressEvent(QMouseEvent* event)
     if (event->buttons() & Qt::LeftButton)
     {
         m_moveView = true;
+        m_moveTimer.start();
+
+        int index = m_points->pointAt(this->mapToScene(event->pos()));   // 通过四叉树查找鼠标附近的点
+        if (index >= 0)
+        {
+            emit pointClicked(index);
+        }
+    }
+}
+
+/**
+ * @brief          拖动时每100ms更新一次显示范围，新进入视图的瓦片马上开始加载，离开视图的取消下载
+ * @param event
+ */
+void MapGraphicsView::mouseMoveEvent(QMouseEvent* event)
+{
+    QGraphicsView::mouseMoveEvent(event);
+
+    if (m_moveView && m_moveTimer.elapsed() >= 100)
+    {
+        getShowRect();
+        m_moveTimer.restart();
     }
 }
 
@@ -118,27 +150,12 @@ void MapGraphicsView::wheelEvent(QWheelEvent* event)
         m_level--;
     }
     m_level = qBound(0, m_level, 22);                            // 限制缩放层级
+    // 释放缩放前层级的瓦片图；再次缩放到这一层级时从内存缓存重新加载，加载前显示低层级瓦片放大的占位图
+    m_layer->setLevel(m_level);
+    m_points->setLevel(m_level);
     setRect(m_level);                                            // 设置缩放后的视图大小
     emit GetUrlInterface::getInterface() -> setLevel(m_level);   // 设置缩放级别
     getShowRect();
-
-    // 隐藏缩放前所有图层
-    for (auto itemG : m_itemGroup)
-    {
-        itemG->hide();
-    }
-
-    if (m_itemGroup.contains(m_level))   // 如果图层存在则显示
-    {
-        GraphicsItemGroup* itemGroup = m_itemGroup.value(m_level);
-        itemGroup->show();
-    }
-    else   // 如果不存在则添加
-    {
-        auto* item = new GraphicsItemGroup();
-        m_itemGroup.insert(m_level, item);
-        m_scene->addItem(item);
-    }
 }
 
 /**
@@ -175,4 +192,12 @@ void MapGraphicsView::getShowRect()
     rect.setRight(qMin(br.x(), w));
     rect.setBottom(qMin(br.y(), w));
     emit GetUrlInterface::getInterface() -> showRect(rect);
+
+    // 只保留显示范围和周围两圈的瓦片，离开的瓦片通知GetUrl，再次进入视图时重新加载
+    QRect tiles(Bing::pixelXYToTileXY(rect.topLeft()), Bing::pixelXYToTileXY(rect.bottomRight()));
+    tiles.adjust(-2, -2, 2, 2);
+    for (const QPoint& tile : m_layer->prune(tiles))
+    {
+        emit GetUrlInterface::getInterface() -> removeTitle(tile.x(), tile.y(), m_level);
+    }
 }
@@ -1,8 +1,10 @@
 ﻿#ifndef MAPGRAPHICSVIEW_H
 #define MAPGRAPHICSVIEW_H
 
-#include "graphicsitemgroup.h"
 #include "mapStruct.h"
+#include "pointlayeritem.h"
+#include "tilelayeritem.h"
+#include <QElapsedTimer>
 #include <QGraphicsView>
 
 class MapGraphicsView : public QGraphicsView
@@ -15,14 +17,18 @@ public:
     void setRect(int level);
     void drawImg(const ImageInfo& info);
     void clear();
+    void setPoints(const QVector<double>& lon, const QVector<double>& lat);   // 显示GPS轨迹点等大量的点
+    void clearPoints();
 
 signals:
     void updateImage(const ImageInfo& info);   // 添加瓦片图
     void showRect(QRect rect);
     void mousePos(QPoint pos);
+    void pointClicked(int index);   // 点击点图层中的点，index为setPoints()中的序号
 
 protected:
     void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
     void mouseReleaseEvent(QMouseEvent* event) override;
     void wheelEvent(QWheelEvent* event) override;
     void resizeEvent(QResizeEvent* event) override;
@@ -35,9 +41,11 @@ private:
     QGraphicsScene* m_scene = nullptr;
     int m_level = 5;           // 当前显示瓦片等级
     bool m_moveView = false;   // 鼠标移动显示视图
+    QElapsedTimer m_moveTimer;   // 拖动时限制更新显示范围的频率
     QPointF m_pos;
     QPointF m_scenePos;
-    QHash<quint16, GraphicsItemGroup*> m_itemGroup;   // 瓦片图元组
+    TileLayerItem* m_layer = nullptr;   // 瓦片图层，所有层级共用一个图元
+    PointLayerItem* m_points = nullptr;   // 点图层，显示在瓦片图层上面
 };
 
 #endif   // MAPGRAPHICSVIEW_H
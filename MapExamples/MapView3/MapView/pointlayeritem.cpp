@@ -0,0 +1,254 @@
+﻿/********************************************************************
+ * 文件名： pointlayeritem.cpp
+ * 时间：   2025-04-28 20:16:45
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   点图层
+ * ******************************************************************/
+#include "pointlayeritem.h"
+#include "bingbatch.h"
+#include <algorithm>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QtMath>
+
+namespace {
+const int MaxLevel = 22;       // 与MapGraphicsView的最大层级相同，点保存为这一层级的像素坐标
+const int MaxDepth = 30;       // 22级像素坐标为30位，四叉树最多30层
+const int ClusterDepth = 6;    // 层级 + 6层的节点在屏幕上为4像素，不再细分
+
+/**
+ * @brief    x的低32位二进制位之间插入0
+ */
+inline quint64 spread(quint64 x)
+{
+    x &= 0xFFFFFFFF;
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFF;
+    x = (x | (x << 8)) & 0x00FF00FF00FF00FF;
+    x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0F;
+    x = (x | (x << 2)) & 0x3333333333333333;
+    x = (x | (x << 1)) & 0x5555555555555555;
+    return x;
+}
+
+/**
+ * @brief    spread()的逆运算，取出偶数位
+ */
+inline quint32 compact(quint64 x)
+{
+    x &= 0x5555555555555555;
+    x = (x | (x >> 1)) & 0x3333333333333333;
+    x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0F;
+    x = (x | (x >> 4)) & 0x00FF00FF00FF00FF;
+    x = (x | (x >> 8)) & 0x0000FFFF0000FFFF;
+    x = (x | (x >> 16)) & 0x00000000FFFFFFFF;
+    return quint32(x);
+}
+
+/**
+ * @brief    Morton码，x在偶数位，y在奇数位
+ */
+inline quint64 mortonKey(qint64 x, qint64 y)
+{
+    return spread(quint64(x)) | (spread(quint64(y)) << 1);
+}
+}   // namespace
+
+PointLayerItem::PointLayerItem(QGraphicsItem* parent)
+    : QGraphicsItem(parent)
+{
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);   // 绘制时通过exposedRect获取需要重绘的区域
+    setZValue(1);                                           // 显示在瓦片图层上面
+}
+
+PointLayerItem::~PointLayerItem() {}
+
+/**
+ * @brief      设置所有点的经纬度，批量转换为22级像素坐标后按Morton码排序
+ * @param lon
+ * @param lat
+ */
+void PointLayerItem::setPoints(const QVector<double>& lon, const QVector<double>& lat)
+{
+    const int count = qMin(lon.count(), lat.count());
+    QVector<int> x(count);
+    QVector<int> y(count);
+    Bing::latLongToPixelXY(lon.constData(), lat.constData(), count, MaxLevel, x.data(), y.data());
+
+    QVector<QPair<quint64, int>> points(count);
+    for (int i = 0; i < count; i++)
+    {
+        points[i] = qMakePair(mortonKey(x[i], y[i]), i);
+    }
+    std::sort(points.begin(), points.end());
+
+    m_keys.resize(count);
+    m_ids.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        m_keys[i] = points[i].first;
+        m_ids[i] = points[i].second;
+    }
+    update();
+}
+
+void PointLayerItem::clear()
+{
+    m_keys.clear();
+    m_ids.clear();
+    update();
+}
+
+/**
+ * @brief       设置瓦片层级，图层大小为整个层级的像素范围
+ * @param level
+ */
+void PointLayerItem::setLevel(int level)
+{
+    if (m_level == level)
+        return;
+    prepareGeometryChange();
+    m_level = qBound(0, level, MaxLevel);
+    update();
+}
+
+void PointLayerItem::setColor(const QColor& color)
+{
+    m_color = color;
+    m_sprite = QPixmap();   // 绘制时重新生成
+    update();
+}
+
+/**
+ * @brief         通过四叉树查找场景坐标附近最近的点
+ * @param pos     场景坐标（当前层级的像素坐标）
+ * @param radius  查找半径（像素）
+ * @return        点在setPoints()中的序号，没有时返回-1
+ */
+int PointLayerItem::pointAt(const QPointF& pos, qreal radius) const
+{
+    const qreal scale = qint64(1) << (MaxLevel - m_level);
+    const QRectF rect(pos.x() - radius, pos.y() - radius, radius * 2, radius * 2);
+    qreal min = radius * radius;
+    int nearest = -1;
+    query(rect, MaxDepth, [&](int begin, int end) {
+        for (int i = begin; i < end; i++)
+        {
+            const qreal dx = compact(m_keys.at(i)) / scale - pos.x();
+            const qreal dy = compact(m_keys.at(i) >> 1) / scale - pos.y();
+            const qreal d = dx * dx + dy * dy;
+            if (d <= min)
+            {
+                min = d;
+                nearest = m_ids.at(i);
+            }
+        }
+    });
+    return nearest;
+}
+
+QRectF PointLayerItem::boundingRect() const
+{
+    const qreal size = qPow(2, m_level) * 256;
+    return QRectF(0, 0, size, size);
+}
+
+/**
+ * @brief          只遍历与需要重绘区域相交的四叉树节点，小于4像素的节点聚合为一个点，所有点一次绘制
+ * @param painter
+ * @param option
+ * @param widget
+ */
+void PointLayerItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+    Q_UNUSED(widget)
+
+    if (m_keys.isEmpty())
+        return;
+    const QRectF exposed = option->exposedRect.intersected(boundingRect());
+    if (exposed.isEmpty())
+        return;
+
+    if (m_sprite.isNull())
+    {
+        createSprite();
+    }
+
+    // 点的半径超出节点时也要绘制，范围向外扩大
+    const QRectF rect = exposed.adjusted(-6, -6, 6, 6);
+    const qreal scale = qint64(1) << (MaxLevel - m_level);
+    QVector<QPainter::PixmapFragment> fragments;
+    query(rect, qMin(m_level + ClusterDepth, MaxDepth), [&](int begin, int end) {
+        const quint64 key = m_keys.at((begin + end) / 2);   // 聚合的点显示在中间的一个点的位置
+        const QPointF pos(compact(key) / scale, compact(key >> 1) / scale);
+        const int n = end - begin;
+        const QRectF& source = n == 1 ? m_dotRects[0] : (n < 100 ? m_dotRects[1] : m_dotRects[2]);
+        fragments.append(QPainter::PixmapFragment::create(pos, source));
+    });
+    painter->drawPixmapFragments(fragments.constData(), fragments.count(), m_sprite);
+}
+
+/**
+ * @brief  预先绘制单个点（4像素）、聚合点（8像素）、100个点以上的聚合点（12像素）三种圆点
+ */
+void PointLayerItem::createSprite()
+{
+    m_sprite = QPixmap(26, 12);
+    m_sprite.fill(Qt::transparent);
+    m_dotRects[0] = QRectF(0, 0, 4, 4);
+    m_dotRects[1] = QRectF(5, 0, 8, 8);
+    m_dotRects[2] = QRectF(14, 0, 12, 12);
+
+    QPainter painter(&m_sprite);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(m_color);
+    painter.drawEllipse(m_dotRects[0]);
+    painter.setPen(QPen(Qt::white, 1));
+    painter.setBrush(m_color.darker(120));
+    painter.drawEllipse(m_dotRects[1].adjusted(0.5, 0.5, -0.5, -0.5));
+    painter.setBrush(m_color.darker(150));
+    painter.drawEllipse(m_dotRects[2].adjusted(0.5, 0.5, -0.5, -0.5));
+}
+
+/**
+ * @brief           遍历与范围相交的四叉树节点，func(begin, end)处理节点中的点在m_keys中的范围
+ * @param rect      场景坐标范围
+ * @param maxDepth  节点不再细分的层数
+ * @param func
+ */
+template <typename Func>
+void PointLayerItem::query(const QRectF& rect, int maxDepth, Func func) const
+{
+    const qreal scale = qint64(1) << (MaxLevel - m_level);
+    const qint64 box[4] = {qFloor(rect.left() * scale), qFloor(rect.top() * scale), qCeil(rect.right() * scale),
+                           qCeil(rect.bottom() * scale)};
+    query(0, 0, 0, 0, m_keys.count(), box, maxDepth, func);
+}
+
+/**
+ * @brief         四叉树节点左上角为(x, y)，边长为2^(30 - depth)，节点中的点为m_keys的[begin, end)；
+ *                子节点按Morton码顺序为左上、右上、左下、右下，用二分查找分割范围
+ */
+template <typename Func>
+void PointLayerItem::query(qint64 x, qint64 y, int depth, int begin, int end, const qint64 (&box)[4], int maxDepth, Func& func) const
+{
+    const qint64 side = qint64(1) << (MaxDepth - depth);
+    if (begin >= end || x > box[2] || y > box[3] || x + side <= box[0] || y + side <= box[1])
+        return;
+    if (depth >= maxDepth || end - begin == 1)
+    {
+        func(begin, end);
+        return;
+    }
+
+    const qint64 half = side / 2;
+    const quint64* keys = m_keys.constData();
+    const int b1 = int(std::lower_bound(keys + begin, keys + end, mortonKey(x + half, y)) - keys);
+    const int b2 = int(std::lower_bound(keys + b1, keys + end, mortonKey(x, y + half)) - keys);
+    const int b3 = int(std::lower_bound(keys + b2, keys + end, mortonKey(x + half, y + half)) - keys);
+    query(x, y, depth + 1, begin, b1, box, maxDepth, func);
+    query(x + half, y, depth + 1, b1, b2, box, maxDepth, func);
+    query(x, y + half, depth + 1, b2, b3, box, maxDepth, func);
+    query(x + half, y + half, depth + 1, b3, end, box, maxDepth, func);
+}
@@ -0,0 +1,54 @@
+﻿#ifndef POINTLAYERITEM_H
+#define POINTLAYERITEM_H
+/********************************************************************
+ * 文件名： pointlayeritem.h
+ * 时间：   2025-04-28 20:16:45
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   点图层，用于在瓦片地图上显示几百万个GPS轨迹点、传感器点
+ *          1、所有点只有这一个图元，不为每个点创建QGraphicsItem；
+ *          2、点转换为最大层级（22级）的像素坐标，按Morton码（x、y二进制位交错）排序，
+ *             排序后的数组就是一棵隐式四叉树：同一个四叉树节点中的点在数组中连续，用二分查找得到节点的范围；
+ *          3、绘制时只遍历与需要重绘区域相交的节点，节点在屏幕上小于4像素时不再细分，节点中的点聚合为一个点，
+ *             按点数选择预先绘制的圆点，整个图层调用一次drawPixmapFragments()；
+ *          4、鼠标点击时通过四叉树查找附近的点。
+ * ******************************************************************/
+
+#include <QColor>
+#include <QGraphicsItem>
+#include <QPixmap>
+#include <QVector>
+
+class PointLayerItem : public QGraphicsItem
+{
+public:
+    explicit PointLayerItem(QGraphicsItem* parent = nullptr);
+    ~PointLayerItem() override;
+
+    void setPoints(const QVector<double>& lon, const QVector<double>& lat);   // 设置所有点的经纬度，建立索引
+    void clear();
+    int count() const { return m_keys.count(); }
+    void setLevel(int level);   // 设置瓦片层级，与瓦片图层相同
+    void setColor(const QColor& color);
+    int pointAt(const QPointF& pos, qreal radius = 6) const;   // 返回场景坐标附近最近的点在setPoints()中的序号，没有时返回-1
+
+    QRectF boundingRect() const override;
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget = nullptr) override;
+
+private:
+    void createSprite();
+    template <typename Func>
+    void query(const QRectF& rect, int maxDepth, Func func) const;   // 遍历与范围相交的四叉树节点
+    template <typename Func>
+    void query(qint64 x, qint64 y, int depth, int begin, int end, const qint64 (&box)[4], int maxDepth, Func& func) const;
+
+private:
+    int m_level = 0;
+    QColor m_color = QColor(0, 120, 255);
+    QPixmap m_sprite;          // 三种圆点
+    QRectF m_dotRects[3];      // 单个点、聚合点、100个点以上的聚合点在m_sprite中的位置
+    QVector<quint64> m_keys;   // 按Morton码排序
+    QVector<int> m_ids;        // 与m_keys对应，点在setPoints()中的序号
+};
+
+#endif   // POINTLAYERITEM_H
@@ -0,0 +1,131 @@
+﻿/********************************************************************
+ * 文件名： tilecache.cpp
+ * 时间：   2025-04-24 20:16:05
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   瓦片内存缓存
+ * ******************************************************************/
+#include "tilecache.h"
+#include <QMutexLocker>
+
+TileCache::TileCache(qint64 dataBudget, qint64 imageBudget)
+{
+    setBudget(dataBudget, imageBudget);
+}
+
+/**
+ * @brief             设置两级缓存的容量，减小时马上淘汰超出的瓦片
+ * @param dataBudget  编码数据的字节数
+ * @param imageBudget 解码图片的字节数
+ */
+void TileCache::setBudget(qint64 dataBudget, qint64 imageBudget)
+{
+    QMutexLocker locker(&m_mutex);
+    m_data.setMaxCost(cost(dataBudget));
+    m_images.setMaxCost(cost(imageBudget));
+}
+
+/**
+ * @brief       保存编码后的图片数据
+ * @param data
+ */
+void TileCache::insert(int z, int x, int y, const QByteArray& data)
+{
+    if (data.isEmpty())
+        return;
+    QMutexLocker locker(&m_mutex);
+    m_data.insert(key(z, x, y), new QByteArray(data), cost(data.size()));   // 超过容量时QCache删除最久没有使用的瓦片
+}
+
+/**
+ * @brief       保存解码后的图片
+ * @param image
+ */
+void TileCache::insert(int z, int x, int y, const QImage& image)
+{
+    if (image.isNull())
+        return;
+    QMutexLocker locker(&m_mutex);
+    m_images.insert(key(z, x, y), new QImage(image), cost(image.sizeInBytes()));
+}
+
+bool TileCache::contains(int z, int x, int y) const
+{
+    QMutexLocker locker(&m_mutex);
+    const quint64 k = key(z, x, y);
+    return m_images.contains(k) || m_data.contains(k);
+}
+
+QByteArray TileCache::data(int z, int x, int y) const
+{
+    QMutexLocker locker(&m_mutex);
+    QByteArray* data = m_data.object(key(z, x, y));   // 查找时移到最近使用
+    return data ? *data : QByteArray();
+}
+
+QImage TileCache::image(int z, int x, int y) const
+{
+    QMutexLocker locker(&m_mutex);
+    QImage* image = m_images.object(key(z, x, y));
+    if (!image)
+    {
+        m_misses++;
+        return QImage();
+    }
+    m_hits++;
+    return *image;   // QImage隐式共享，不复制像素
+}
+
+/**
+ * @brief        占位图：瓦片在上一级中对应1/4，在上两级中对应1/16……，
+ *               从最近的已经解码的低层级瓦片中截取对应的区域放大到瓦片大小
+ * @param depth  最多向上查找的层级数
+ * @return
+ */
+QImage TileCache::placeholder(int z, int x, int y, int depth) const
+{
+    QImage parent;
+    int d = 1;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (; d <= depth && d <= z; d++)
+        {
+            QImage* image = m_images.object(key(z - d, x >> d, y >> d));
+            if (image)
+            {
+                parent = *image;
+                break;
+            }
+        }
+    }
+    if (parent.isNull())
+        return QImage();
+
+    // 截取、缩放不需要加锁
+    const int size = parent.width() >> d;
+    if (size < 1)
+        return QImage();
+    const int mask = (1 << d) - 1;
+    QImage part = parent.copy((x & mask) * size, (y & mask) * size, size, size);
+    return part.scaled(parent.size(), Qt::IgnoreAspectRatio, Qt::FastTransformation);
+}
+
+void TileCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_data.clear();
+    m_images.clear();
+}
+
+TileCache::Statistics TileCache::statistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    Statistics statistics;
+    statistics.dataBytes = qint64(m_data.totalCost()) << 10;
+    statistics.imageBytes = qint64(m_images.totalCost()) << 10;
+    statistics.dataCount = m_data.count();
+    statistics.imageCount = m_images.count();
+    statistics.hits = m_hits;
+    statistics.misses = m_misses;
+    return statistics;
+}
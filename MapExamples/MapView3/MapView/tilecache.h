@@ -0,0 +1,56 @@
+﻿#ifndef TILECACHE_H
+#define TILECACHE_H
+/********************************************************************
+ * 文件名： tilecache.h
+ * 时间：   2025-04-24 20:16:05
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   瓦片内存缓存，按字节数限制大小，超过时淘汰最久没有使用的瓦片（LRU）
+ *          1、两级缓存：编码后的图片数据（刚下载的瓦片）、解码后的QImage，分别设置容量；
+ *          2、只保存QImage，可以在任意线程中使用，显示时在ui线程中转为QPixmap；
+ *          3、瓦片没有加载时可以从低层级已经解码的瓦片中截取放大作为占位图。
+ * ******************************************************************/
+
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+
+class TileCache
+{
+public:
+    struct Statistics
+    {
+        qint64 dataBytes = 0;    // 编码数据占用的字节数
+        qint64 imageBytes = 0;   // 解码图片占用的字节数
+        int dataCount = 0;
+        int imageCount = 0;
+        quint64 hits = 0;        // image()命中次数
+        quint64 misses = 0;      // image()未命中次数
+    };
+
+    explicit TileCache(qint64 dataBudget = 32 << 20, qint64 imageBudget = 192 << 20);
+
+    static quint64 key(int z, int x, int y) { return (quint64(z) << 48) | (quint64(x) << 24) | quint64(y); }
+
+    void setBudget(qint64 dataBudget, qint64 imageBudget);   // 设置两级缓存的容量（字节）
+    void insert(int z, int x, int y, const QByteArray& data);
+    void insert(int z, int x, int y, const QImage& image);
+    bool contains(int z, int x, int y) const;     // 任意一级缓存中存在，不改变LRU顺序
+    QByteArray data(int z, int x, int y) const;   // 编码后的图片数据，不存在时返回空
+    QImage image(int z, int x, int y) const;      // 解码后的图片，不存在时返回空
+    QImage placeholder(int z, int x, int y, int depth = 4) const;   // 从低depth个层级内的瓦片截取放大，没有时返回空
+    void clear();
+    Statistics statistics() const;
+
+private:
+    static int cost(qint64 bytes) { return int(qMax<qint64>(1, bytes >> 10)); }   // QCache的容量为int，以KB为单位
+
+private:
+    mutable QMutex m_mutex;                       // QCache不是线程安全的，查找也会修改LRU顺序
+    mutable QCache<quint64, QByteArray> m_data;   // 编码后的图片数据
+    mutable QCache<quint64, QImage> m_images;     // 解码后的图片
+    mutable quint64 m_hits = 0;
+    mutable quint64 m_misses = 0;
+};
+
+#endif   // TILECACHE_H
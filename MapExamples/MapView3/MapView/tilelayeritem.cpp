@@ -0,0 +1,161 @@
+﻿/********************************************************************
+ * 文件名： tilelayeritem.cpp
+ * 时间：   2025-04-25 21:08:17
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   瓦片图层
+ * ******************************************************************/
+#include "tilelayeritem.h"
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QtMath>
+
+TileLayerItem::TileLayerItem(QGraphicsItem* parent)
+    : QGraphicsItem(parent)
+    , m_font("宋体", 14)
+{
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);   // 绘制时通过exposedRect获取需要重绘的区域
+}
+
+TileLayerItem::~TileLayerItem() {}
+
+/**
+ * @brief       设置瓦片层级，图层大小为整个层级的像素范围
+ * @param level
+ */
+void TileLayerItem::setLevel(int level)
+{
+    if (m_level == level)
+        return;
+    prepareGeometryChange();
+    m_level = level;
+    m_tiles.clear();   // 其它层级的瓦片一起释放
+    update();
+}
+
+void TileLayerItem::setShowGrid(bool show)
+{
+    if (m_showGrid == show)
+        return;
+    m_showGrid = show;
+    update();
+}
+
+/**
+ * @brief        添加瓦片图，只重绘这个瓦片的区域
+ * @param info
+ */
+void TileLayerItem::addImage(const ImageInfo& info)
+{
+    if (info.z != m_level || info.img.isNull())
+        return;
+
+    const quint64 k = key(info.x, info.y);
+    auto it = m_tiles.find(k);
+    if (info.placeholder && it != m_tiles.end() && !it->placeholder)   // 真正的瓦片已经显示，不用占位图覆盖
+        return;
+
+    Tile& tile = m_tiles[k];
+    tile.pixmap = QPixmap::fromImage(info.img);
+    tile.placeholder = info.placeholder;
+    update(QRectF(info.x * 256.0, info.y * 256.0, 256, 256));
+}
+
+/**
+ * @brief        删除范围外的瓦片，QPixmap一起释放，长时间浏览时内存不增长
+ * @param tiles  保留的瓦片编号范围
+ * @return       删除的瓦片编号
+ */
+QVector<QPoint> TileLayerItem::prune(const QRect& tiles)
+{
+    QVector<QPoint> removed;
+    for (auto it = m_tiles.begin(); it != m_tiles.end();)
+    {
+        const QPoint tile(int(it.key() >> 24), int(it.key() & 0xFFFFFF));
+        if (tiles.contains(tile))
+        {
+            ++it;
+            continue;
+        }
+        it = m_tiles.erase(it);
+        removed.append(tile);
+    }
+    if (!removed.isEmpty())
+    {
+        update();
+    }
+    return removed;
+}
+
+QRectF TileLayerItem::boundingRect() const
+{
+    const qreal size = qPow(2, m_level) * 256;
+    return QRectF(0, 0, size, size);
+}
+
+/**
+ * @brief          只绘制与需要重绘区域相交的瓦片，瓦片网格、编号在同一次绘制中完成
+ * @param painter
+ * @param option
+ * @param widget
+ */
+void TileLayerItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+    Q_UNUSED(widget)
+
+    const QRectF exposed = option->exposedRect.intersected(boundingRect());
+    if (exposed.isEmpty())
+        return;
+
+    // 需要重绘的瓦片编号范围
+    const int max = int(qPow(2, m_level)) - 1;
+    const int left = qBound(0, qFloor(exposed.left() / 256), max);
+    const int top = qBound(0, qFloor(exposed.top() / 256), max);
+    const int right = qBound(0, qFloor(exposed.right() / 256), max);
+    const int bottom = qBound(0, qFloor(exposed.bottom() / 256), max);
+
+    QVector<QPoint> visible;
+    if (qint64(right - left + 1) * (bottom - top + 1) <= m_tiles.count())   // 范围内查找
+    {
+        for (int x = left; x <= right; x++)
+        {
+            for (int y = top; y <= bottom; y++)
+            {
+                if (m_tiles.contains(key(x, y)))
+                {
+                    visible.append(QPoint(x, y));
+                }
+            }
+        }
+    }
+    else   // 范围比已加载的瓦片多时遍历瓦片
+    {
+        const QRect range(QPoint(left, top), QPoint(right, bottom));
+        for (auto it = m_tiles.cbegin(); it != m_tiles.cend(); ++it)
+        {
+            const QPoint tile(int(it.key() >> 24), int(it.key() & 0xFFFFFF));
+            if (range.contains(tile))
+            {
+                visible.append(tile);
+            }
+        }
+    }
+
+    for (const QPoint& tile : visible)
+    {
+        const QPixmap& pixmap = m_tiles.constFind(key(tile.x(), tile.y()))->pixmap;
+        painter->drawPixmap(QRectF(tile.x() * 256.0, tile.y() * 256.0, 256, 256), pixmap, QRectF(pixmap.rect()));
+    }
+
+    if (!m_showGrid)
+        return;
+    // 绘制瓦片边框、编号
+    painter->setPen(QPen(Qt::red));
+    painter->setFont(m_font);
+    for (const QPoint& tile : visible)
+    {
+        const QRectF rect(tile.x() * 256.0, tile.y() * 256.0, 255, 255);
+        painter->drawRect(rect);
+        painter->drawText(rect, Qt::AlignLeft | Qt::AlignTop, QString("%1，%2").arg(tile.x()).arg(tile.y()));
+    }
+}
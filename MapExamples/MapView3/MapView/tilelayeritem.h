@@ -0,0 +1,51 @@
+﻿#ifndef TILELAYERITEM_H
+#define TILELAYERITEM_H
+/********************************************************************
+ * 文件名： tilelayeritem.h
+ * 时间：   2025-04-25 21:08:17
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   瓦片图层，整个场景只有这一个图元，代替每个瓦片的图片、边框、编号三个图元；
+ *          绘制时只绘制与需要重绘区域相交的瓦片，瓦片网格、编号在同一次绘制中完成，
+ *          场景中的图元数量不随浏览过的瓦片数增加。
+ * ******************************************************************/
+
+#include "mapStruct.h"
+#include <QFont>
+#include <QGraphicsItem>
+#include <QHash>
+#include <QPixmap>
+
+class TileLayerItem : public QGraphicsItem
+{
+public:
+    explicit TileLayerItem(QGraphicsItem* parent = nullptr);
+    ~TileLayerItem() override;
+
+    void setLevel(int level);                    // 设置瓦片层级，清空所有瓦片
+    int level() const { return m_level; }
+    void setShowGrid(bool show);                 // 是否绘制瓦片网格、编号
+    void addImage(const ImageInfo& info);        // 添加瓦片图，在ui线程中转为QPixmap
+    QVector<QPoint> prune(const QRect& tiles);   // 删除范围外的瓦片，返回删除的瓦片编号
+    int count() const { return m_tiles.count(); }
+
+    QRectF boundingRect() const override;
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget = nullptr) override;
+
+private:
+    static quint64 key(int x, int y) { return (quint64(x) << 24) | quint64(y); }
+
+private:
+    struct Tile
+    {
+        QPixmap pixmap;
+        bool placeholder = false;   // 低层级瓦片放大的占位图
+    };
+
+    int m_level = 0;
+    bool m_showGrid = true;
+    QFont m_font;
+    QHash<quint64, Tile> m_tiles;   // 当前层级已经加载的瓦片
+};
+
+#endif   // TILELAYERITEM_H
@@ -24,6 +24,8 @@ CONFIG += c++17
 
 include($$PWD/MapView/MapView.pri)
 INCLUDEPATH += $$PWD/MapView/
+include($$PWD/../TileStore/TileStore.pri)   # 瓦片打包存储（共用）
+include($$PWD/../TileFetcher/TileFetcher.pri)   # 异步瓦片下载（共用）
 
 SOURCES += \
     main.cpp \
@@ -2,8 +2,13 @@
 #include "ui_widget.h"
 #include <QApplication>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QToolTip>
 #include <QtMath>
 
+static const int g_trackPoints = 5000;   // 随机轨迹每条的点数
+
 Widget::Widget(QWidget* parent)
     : QWidget(parent)
     , ui(new Ui::Widget)
@@ -36,6 +41,7 @@ Widget::Widget(QWidget* parent)
     m_geturl->setUrl(ui->com_url->currentText());
 
     connect(GetUrlInterface::getInterface(), &GetUrlInterface::showRect, this, &Widget::showRect);
+    connect(ui->graphicsView, &MapGraphicsView::pointClicked, this, &Widget::showPoint);
     connect(GetUrlInterface::getInterface(), &GetUrlInterface::setLevel, this,
             [&](int level)
             {
@@ -93,3 +99,57 @@ void Widget::on_but_clear_clicked()
 {
     ui->graphicsView->clear();
 }
+
+/**
+ * @brief 随机生成1000条轨迹、每条5000个点显示在点图层中，再次点击时清除
+ */
+void Widget::on_but_points_clicked()
+{
+    if (!m_lon.isEmpty())
+    {
+        m_lon.clear();
+        m_lat.clear();
+        ui->graphicsView->clearPoints();
+        ui->but_points->setText("显示500万个轨迹点");
+        return;
+    }
+
+    const int tracks = 1000;
+    QRandomGenerator* random = QRandomGenerator::global();
+    m_lon.reserve(tracks * g_trackPoints);
+    m_lat.reserve(tracks * g_trackPoints);
+    for (int i = 0; i < tracks; i++)
+    {
+        // 国内随机起点，每个点前进约30米，方向随机小幅变化
+        double lon = 75 + random->generateDouble() * 55;
+        double lat = 20 + random->generateDouble() * 30;
+        double heading = random->generateDouble() * 2 * M_PI;
+        for (int j = 0; j < g_trackPoints; j++)
+        {
+            heading += (random->generateDouble() - 0.5) * 0.2;
+            lon += qCos(heading) * 0.0003;
+            lat += qSin(heading) * 0.0003;
+            m_lon.append(lon);
+            m_lat.append(lat);
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    ui->graphicsView->setPoints(m_lon, m_lat);
+    qInfo() << QString("%1个点建立索引耗时：%2 ms").arg(m_lon.count()).arg(timer.elapsed());
+    ui->but_points->setText("清除轨迹点");
+}
+
+/**
+ * @brief        显示鼠标点击的轨迹点
+ * @param index
+ */
+void Widget::showPoint(int index)
+{
+    QToolTip::showText(QCursor::pos(), QString("第%1条轨迹第%2个点：%3，%4")
+                                           .arg(index / g_trackPoints + 1)
+                                           .arg(index % g_trackPoints + 1)
+                                           .arg(m_lon.at(index), 0, 'f', 6)
+                                           .arg(m_lat.at(index), 0, 'f', 6));
+}
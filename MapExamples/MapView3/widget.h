@@ -27,11 +27,16 @@ private slots:
 
     void on_but_clear_clicked();
 
+    void on_but_points_clicked();
+
 private:
     void showRect(QRect rect);
+    void showPoint(int index);
 
 private:
     Ui::Widget* ui;
     GetUrl* m_geturl = nullptr;
+    QVector<double> m_lon;   // 点图层中所有点的经纬度
+    QVector<double> m_lat;
 };
 #endif   // WIDGET_H
@@ -0,0 +1,21 @@
+#---------------------------------------------------------
+# 功能：       异步瓦片下载（长期使用的QNetworkAccessManager、连接复用、
+#             每个主机请求数限制、失败重试、单独的解码线程池），
+#             MapDownload、MapView3共用
+# 编译器：
+#
+# @开发者     mhf
+# @邮箱       1603291350@qq.com
+# @时间       2025/04/22
+# @备注
+#---------------------------------------------------------
+
+QT += network concurrent
+
+HEADERS += \
+    $$PWD/tilefetcher.h
+
+SOURCES += \
+    $$PWD/tilefetcher.cpp
+
+INCLUDEPATH += $$PWD
@@ -0,0 +1,479 @@
+﻿/********************************************************************
+ * 文件名： tilefetcher.cpp
+ * 时间：   2025-04-22 21:05:48
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   异步瓦片下载
+ * ******************************************************************/
+#include "tilefetcher.h"
+#include <QDateTime>
+#include <QHash>
+#include <QMap>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QRandomGenerator>
+#include <QSet>
+#include <QThread>
+#include <QTimer>
+#include <QtConcurrent>
+
+/**
+ * @brief       根据Cache-Control: max-age或Expires计算过期时间
+ * @return      服务器没有返回时为0
+ */
+static qint64 expiresTime(QNetworkReply* reply, qint64 now)
+{
+    const QByteArray cacheControl = reply->rawHeader("Cache-Control");
+    const int index = cacheControl.indexOf("max-age=");
+    if (index >= 0)
+    {
+        bool ok = false;
+        const qint64 maxAge = cacheControl.mid(index + 8).split(',').first().trimmed().toLongLong(&ok);
+        if (ok)
+            return now + maxAge;
+    }
+    const QDateTime expires = QDateTime::fromString(QString::fromLatin1(reply->rawHeader("Expires")), Qt::RFC2822Date);
+    return expires.isValid() ? expires.toSecsSinceEpoch() : 0;
+}
+
+/**
+ * @brief       是否是暂时的错误，可以重试
+ */
+static bool isRetryable(QNetworkReply::NetworkError error, int status)
+{
+    if (status == 429 || status >= 500)
+        return true;
+    switch (error)
+    {
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::OperationCanceledError:   // 超时中断
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::ProxyTimeoutError:
+    case QNetworkReply::UnknownNetworkError:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief 网络线程，管理一个QNetworkAccessManager和每个主机的请求队列，只在所在线程中访问；
+ *        同一个url在排队、下载、等待重试中只会有一个请求
+ */
+class TileFetcherWorker : public QObject
+{
+public:
+    struct Task
+    {
+        TileFetcher::Request request;
+        QString host;
+        int attempt = 0;
+        quint32 generation = 0;
+    };
+
+    explicit TileFetcherWorker(TileFetcher* fetcher)
+        : m_fetcher(fetcher)
+    {
+    }
+
+    /**
+     * @brief 添加请求，已经在排队、等待重试的只更新优先级，正在下载的不重复请求
+     */
+    void enqueue(const QVector<TileFetcher::Request>& requests, quint32 generation)
+    {
+        if (!m_manager)
+        {
+            m_manager = new QNetworkAccessManager(this);   // 在网络线程中创建
+        }
+        QSet<QString> hosts;
+        Task task;
+        task.generation = generation;
+        for (const TileFetcher::Request& request : requests)
+        {
+            const QString& url = request.url;
+            if (generation != m_fetcher->m_generation || m_activeUrls.contains(url))
+            {
+                m_fetcher->m_pending--;
+                continue;
+            }
+            auto waiting = m_waiting.find(url);
+            if (waiting != m_waiting.end())
+            {
+                waiting->request.priority = request.priority;
+                m_fetcher->m_pending--;
+                continue;
+            }
+            auto queued = m_queued.find(url);
+            if (queued != m_queued.end())   // 重新排序
+            {
+                Host& host = m_hosts[queued->task.host];
+                host.queue.remove(queued->order);
+                queued->order = Order(request.priority, m_sequence++);
+                queued->task.request.priority = request.priority;
+                host.queue.insert(queued->order, url);
+                m_fetcher->m_pending--;
+                continue;
+            }
+            task.request = request;
+            task.host = QUrl(url).host();
+            push(task);
+            hosts.insert(task.host);
+        }
+        for (const QString& host : hosts)
+        {
+            startNext(host);
+        }
+    }
+
+    /**
+     * @brief 只保留requests中的请求，其它排队、等待重试的请求取消，正在下载的中断
+     */
+    void schedule(const QVector<TileFetcher::Request>& requests, quint32 generation)
+    {
+        QSet<QString> wanted;
+        for (const TileFetcher::Request& request : requests)
+        {
+            wanted.insert(request.url);
+        }
+        for (auto it = m_queued.begin(); it != m_queued.end();)
+        {
+            if (wanted.contains(it.key()))
+            {
+                ++it;
+                continue;
+            }
+            m_hosts[it->task.host].queue.remove(it->order);
+            m_fetcher->m_pending--;
+            it = m_queued.erase(it);
+        }
+        for (auto it = m_waiting.begin(); it != m_waiting.end();)
+        {
+            if (wanted.contains(it.key()))
+            {
+                ++it;
+                continue;
+            }
+            m_fetcher->m_pending--;
+            it = m_waiting.erase(it);
+        }
+        QList<QNetworkReply*> replies;
+        for (auto it = m_active.constBegin(); it != m_active.constEnd(); ++it)
+        {
+            if (!wanted.contains(it->request.url))
+            {
+                replies.append(it.key());
+            }
+        }
+        abort(replies);
+        enqueue(requests, generation);
+    }
+
+    void abortAll()
+    {
+        for (auto it = m_hosts.begin(); it != m_hosts.end(); ++it)
+        {
+            it->queue.clear();
+        }
+        m_fetcher->m_pending -= m_queued.count() + m_waiting.count();
+        m_queued.clear();
+        m_waiting.clear();
+        abort(m_active.keys());
+    }
+
+private:
+    using Order = QPair<int, quint64>;   // 优先级 + 序号，同一优先级先进先出
+
+    struct Queued
+    {
+        Task task;
+        Order order;
+    };
+
+    struct Host
+    {
+        QMap<Order, QString> queue;   // 排队的url，按优先级排序
+        int active = 0;               // 正在进行的请求数
+    };
+
+    void push(const Task& task)
+    {
+        Queued queued;
+        queued.task = task;
+        queued.order = Order(task.request.priority, m_sequence++);
+        m_hosts[task.host].queue.insert(queued.order, task.request.url);
+        m_queued.insert(task.request.url, queued);
+    }
+
+    /**
+     * @brief 中断正在下载的请求，先从m_active中移除，abort()同步发出finished时不再处理
+     */
+    void abort(const QList<QNetworkReply*>& replies)
+    {
+        QSet<QString> hosts;
+        for (QNetworkReply* reply : replies)
+        {
+            const Task task = m_active.take(reply);
+            m_activeUrls.remove(task.request.url);
+            m_hosts[task.host].active--;
+            m_fetcher->m_pending--;
+            hosts.insert(task.host);
+            reply->abort();
+        }
+        for (const QString& host : hosts)
+        {
+            startNext(host);
+        }
+    }
+
+    void startNext(const QString& name)
+    {
+        Host& host = m_hosts[name];
+        while (host.active < m_fetcher->m_options.maxPerHost && !host.queue.isEmpty())
+        {
+            auto first = host.queue.begin();
+            const Task task = m_queued.take(first.value()).task;
+            host.queue.erase(first);
+
+            QNetworkRequest request(QUrl(task.request.url));
+            request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+            request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+            if (!task.request.etag.isEmpty())
+            {
+                request.setRawHeader("If-None-Match", task.request.etag);
+            }
+            QNetworkReply* reply = m_manager->get(request);
+            host.active++;
+            m_active.insert(reply, task);
+            m_activeUrls.insert(task.request.url, reply);
+            QTimer::singleShot(m_fetcher->m_options.timeout, reply, &QNetworkReply::abort);   // reply释放后定时器自动取消
+            connect(reply, &QNetworkReply::finished, this, [this, reply]() { on_finished(reply); });
+        }
+    }
+
+    void on_finished(QNetworkReply* reply)
+    {
+        reply->deleteLater();
+        auto it = m_active.find(reply);
+        if (it == m_active.end())   // 已经取消
+            return;
+        const Task task = it.value();
+        m_active.erase(it);
+        m_activeUrls.remove(task.request.url);
+        m_hosts[task.host].active--;
+
+        TileFetcher::Result result;
+        result.request = task.request;
+        result.attempts = task.attempt + 1;
+        result.status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        const QNetworkReply::NetworkError error = reply->error();
+        if (error == QNetworkReply::NoError)
+        {
+            const qint64 now = QDateTime::currentSecsSinceEpoch();
+            result.etag = reply->rawHeader("ETag");
+            result.expires = expiresTime(reply, now);
+            result.notModified = (result.status == 304);
+            result.data = reply->readAll();
+            if (result.data.isEmpty() && !result.notModified)
+            {
+                result.error = "返回数据为空";
+            }
+        }
+        else
+        {
+            result.error = reply->errorString();
+        }
+
+        if (!result.isOk() && result.attempts < m_fetcher->m_options.maxRetries && isRetryable(error, result.status))
+        {
+            // 等待时间每次加倍，并加上随机时间，避免大量请求同时重试
+            const int delay = m_fetcher->m_options.retryDelay << task.attempt;
+            Task retry = task;
+            retry.attempt++;
+            m_waiting.insert(task.request.url, retry);
+            m_fetcher->m_retries++;
+            const QString url = task.request.url;
+            QTimer::singleShot(delay + QRandomGenerator::global()->bounded(delay / 2 + 1), this, [this, url]() {
+                auto waiting = m_waiting.find(url);
+                if (waiting == m_waiting.end())   // 等待时已经取消
+                    return;
+                const Task retry = waiting.value();
+                m_waiting.erase(waiting);
+                push(retry);
+                startNext(retry.host);
+            });
+        }
+        else
+        {
+            m_fetcher->complete(result, task.generation);
+        }
+        startNext(task.host);
+    }
+
+private:
+    TileFetcher* m_fetcher = nullptr;
+    QNetworkAccessManager* m_manager = nullptr;
+    QHash<QString, Host> m_hosts;
+    QHash<QString, Queued> m_queued;                // url -> 排队的请求
+    QHash<QString, Task> m_waiting;                 // url -> 等待重试的请求
+    QHash<QNetworkReply*, Task> m_active;           // 正在下载的请求
+    QHash<QString, QNetworkReply*> m_activeUrls;
+    quint64 m_sequence = 0;
+};
+
+TileFetcher::TileFetcher(const Options& options, QObject* parent)
+    : QObject(parent)
+    , m_options(options)
+{
+    qRegisterMetaType<TileFetcher::Result>("TileFetcher::Result");
+
+    m_options.ioThreads = qMax(1, m_options.ioThreads);
+    m_options.maxPerHost = qMax(1, m_options.maxPerHost);
+    m_options.maxRetries = qMax(1, m_options.maxRetries);
+    m_decodePool.setMaxThreadCount(m_options.decodeThreads > 0 ? m_options.decodeThreads : QThread::idealThreadCount());
+
+    for (int i = 0; i < m_options.ioThreads; i++)
+    {
+        auto* thread = new QThread();
+        auto* worker = new TileFetcherWorker(this);
+        worker->moveToThread(thread);
+        thread->start();
+        m_threads.append(thread);
+        m_workers.append(worker);
+    }
+}
+
+TileFetcher::~TileFetcher()
+{
+    cancel();
+    for (int i = 0; i < m_threads.count(); i++)
+    {
+        m_workers.at(i)->deleteLater();   // 线程退出时释放，QNetworkAccessManager在所在线程中释放
+        m_threads.at(i)->quit();
+        m_threads.at(i)->wait();
+        delete m_threads.at(i);
+    }
+    m_decodePool.waitForDone();
+}
+
+/**
+ * @brief     同一个主机总是分配到同一个网络线程，连接可以复用，并且每个主机的请求数限制在一个线程中计算
+ */
+TileFetcherWorker* TileFetcher::worker(const QString& host) const
+{
+    return m_workers.at(int(qHash(host) % uint(m_workers.count())));
+}
+
+/**
+ * @brief          添加下载请求，可以在任意线程调用
+ * @param request
+ */
+void TileFetcher::fetch(const Request& request)
+{
+    fetch(QVector<Request>{request});
+}
+
+void TileFetcher::fetch(const QVector<Request>& requests)
+{
+    const quint32 generation = m_generation;
+    const auto groups = split(requests);
+    for (auto it = groups.begin(); it != groups.end(); ++it)
+    {
+        TileFetcherWorker* target = it.key();
+        const QVector<Request> list = it.value();
+        QMetaObject::invokeMethod(target, [target, list, generation]() { target->enqueue(list, generation); }, Qt::QueuedConnection);
+    }
+}
+
+/**
+ * @brief          设置需要下载的瓦片，可以在任意线程调用
+ *                 不在requests中的请求：排队、等待重试的取消，正在下载的中断；
+ *                 已经在排队、下载的请求不重复下载，只按新的优先级排序
+ * @param requests
+ */
+void TileFetcher::schedule(const QVector<Request>& requests)
+{
+    const quint32 generation = m_generation;
+    const auto groups = split(requests);
+    for (TileFetcherWorker* target : m_workers)   // 没有分配到请求的网络线程也需要取消之前的请求
+    {
+        const QVector<Request> list = groups.value(target);
+        QMetaObject::invokeMethod(target, [target, list, generation]() { target->schedule(list, generation); }, Qt::QueuedConnection);
+    }
+}
+
+/**
+ * @brief     按主机分配到网络线程，每个线程只投递一次事件
+ */
+QHash<TileFetcherWorker*, QVector<TileFetcher::Request>> TileFetcher::split(const QVector<Request>& requests)
+{
+    QHash<TileFetcherWorker*, QVector<Request>> groups;
+    for (const Request& request : requests)
+    {
+        groups[worker(QUrl(request.url).host())].append(request);
+    }
+    m_pending += requests.count();
+    return groups;
+}
+
+/**
+ * @brief 取消所有请求，可以在任意线程调用
+ */
+void TileFetcher::cancel()
+{
+    m_generation++;
+    for (TileFetcherWorker* target : m_workers)
+    {
+        QMetaObject::invokeMethod(target, [target]() { target->abortAll(); }, Qt::QueuedConnection);
+    }
+}
+
+TileFetcher::Statistics TileFetcher::statistics() const
+{
+    Statistics statistics;
+    statistics.finished = m_finished;
+    statistics.failed = m_failed;
+    statistics.retries = m_retries;
+    statistics.bytes = m_bytes;
+    statistics.pending = m_pending;
+    return statistics;
+}
+
+/**
+ * @brief 下载完成，需要解码时在解码线程池中解码
+ */
+void TileFetcher::complete(TileFetcher::Result result, quint32 generation)
+{
+    if (!result.isOk() || result.notModified || !m_options.decode)
+    {
+        finish(result, generation);
+        return;
+    }
+    QtConcurrent::run(&m_decodePool, [this, result, generation]() mutable {
+        if (!result.image.loadFromData(result.data))
+        {
+            result.error = "不是有效的图片";
+        }
+        finish(result, generation);
+    });
+}
+
+void TileFetcher::finish(const TileFetcher::Result& result, quint32 generation)
+{
+    m_pending--;
+    if (generation != m_generation)   // 解码时已经取消
+        return;
+
+    if (result.isOk())
+    {
+        m_finished++;
+        m_bytes += quint64(result.data.size());
+    }
+    else
+    {
+        m_failed++;
+    }
+    emit finished(result);
+}
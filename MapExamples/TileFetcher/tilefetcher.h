@@ -0,0 +1,112 @@
+﻿#ifndef TILEFETCHER_H
+#define TILEFETCHER_H
+/********************************************************************
+ * 文件名： tilefetcher.h
+ * 时间：   2025-04-22 21:05:48
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   异步瓦片下载，MapDownload、MapView3共用
+ *          1、少量网络线程，每个线程一个长期使用的QNetworkAccessManager，连接保持（keep-alive）复用，
+ *             https时允许HTTP/2多路复用；同一个主机的请求总是分配到同一个网络线程；
+ *          2、每个主机同时进行的请求数有上限，超过的请求排队；
+ *          3、超时、连接断开、5xx、429时等待后重试，等待时间每次加倍；
+ *          4、下载的数据在单独的解码线程池中解码为QImage，不占用网络线程和全局线程池；
+ *          5、同一个url在排队、下载中只有一个请求；schedule()只保留新的请求，视图移动时离开视图的瓦片单独取消；
+ *          6、fetch()、schedule()、cancel()可以在任意线程调用，finished信号在解码线程或网络线程中发出。
+ * ******************************************************************/
+
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QThreadPool>
+#include <QVector>
+#include <atomic>
+
+class QThread;
+class TileFetcherWorker;
+
+class TileFetcher : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options
+    {
+        int ioThreads = 2;        // 网络线程数
+        int maxPerHost = 6;       // 每个主机同时进行的请求数（与QNetworkAccessManager每个主机的连接数相同）
+        int maxRetries = 3;       // 最多请求次数
+        int retryDelay = 200;     // 第一次重试前等待的时间（毫秒），之后每次加倍
+        int timeout = 5000;       // 单个请求超时时间（毫秒）
+        int decodeThreads = 0;    // 解码线程数，0表示CPU核心数
+        bool decode = true;       // 是否解码为QImage，只保存数据时可以不解码
+    };
+
+    struct Request
+    {
+        int x = 0;
+        int y = 0;
+        int z = 0;
+        QString url;
+        QByteArray etag;   // 不为空时带If-None-Match重新验证
+        int priority = 0;  // 同一个主机的请求按优先级从小到大下载，相同时先进先出
+        int id = 0;        // 由调用者使用
+    };
+
+    struct Result
+    {
+        Request request;
+        int status = 0;             // HTTP状态码，网络错误时为0
+        bool notModified = false;   // 重新验证时未修改（304），没有数据
+        QByteArray data;            // 编码后的图片数据
+        QImage image;
+        QByteArray etag;
+        qint64 expires = 0;         // 根据Cache-Control、Expires计算的过期时间（UTC秒），0表示没有
+        int attempts = 0;           // 请求次数
+        QString error;              // 为空表示成功
+
+        bool isOk() const { return error.isEmpty(); }
+    };
+
+    struct Statistics
+    {
+        quint64 finished = 0;   // 成功的请求
+        quint64 failed = 0;     // 多次重试后失败的请求
+        quint64 retries = 0;
+        quint64 bytes = 0;      // 下载的字节数
+        int pending = 0;        // 排队、下载、解码中的请求
+    };
+
+    explicit TileFetcher(const Options& options = Options(), QObject* parent = nullptr);
+    ~TileFetcher() override;
+
+    void fetch(const Request& request);
+    void fetch(const QVector<Request>& requests);
+    void schedule(const QVector<Request>& requests);   // 只保留这些请求（视图移动时取消离开视图的瓦片）
+    void cancel();   // 取消所有请求，已经在解码的结果也不再发出
+    Statistics statistics() const;
+
+signals:
+    void finished(const TileFetcher::Result& result);
+
+private:
+    friend class TileFetcherWorker;
+    TileFetcherWorker* worker(const QString& host) const;
+    QHash<TileFetcherWorker*, QVector<Request>> split(const QVector<Request>& requests);   // 按主机分配到网络线程
+    void complete(TileFetcher::Result result, quint32 generation);
+    void finish(const TileFetcher::Result& result, quint32 generation);
+
+private:
+    Options m_options;
+    QVector<QThread*> m_threads;
+    QVector<TileFetcherWorker*> m_workers;
+    QThreadPool m_decodePool;
+    std::atomic<quint32> m_generation{0};   // 每次取消加1，丢弃之前的请求
+    std::atomic<int> m_pending{0};
+    std::atomic<quint64> m_finished{0};
+    std::atomic<quint64> m_failed{0};
+    std::atomic<quint64> m_retries{0};
+    std::atomic<quint64> m_bytes{0};
+};
+
+Q_DECLARE_METATYPE(TileFetcher::Result)
+
+#endif   // TILEFETCHER_H
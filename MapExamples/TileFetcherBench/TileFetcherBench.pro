@@ -0,0 +1,47 @@
+#---------------------------------------------------------------------------------------
+# @功能：      瓦片下载性能对比：每个瓦片一个QNetworkAccessManager 与 TileFetcher
+# @编译器：     Desktop Qt 5.14.2 MSVC2017 64bit（也支持其它编译器）
+# @Qt IDE：    D:/Qt/Qt5.14.2/Tools/QtCreator/share/qtcreator
+#
+# @开发者     mhf
+# @邮箱       1603291350@qq.com
+# @时间       2025-04-22 22:10:32
+# @备注       1、程序内启动一个本地瓦片服务（HTTP/1.1 keep-alive，可以设置模拟的网络延时）代替在线瓦片服务；
+#            2、分别用以前的方式（线程池 + 每个瓦片一个QNetworkAccessManager + QEventLoop）和TileFetcher下载相同的瓦片；
+#            3、输出耗时、每秒瓦片数和服务端收到的新连接数；
+#            4、命令行参数：TileFetcherBench [瓦片数 默认2000] [延时毫秒 默认20]。
+#---------------------------------------------------------------------------------------
+
+QT       += core gui network concurrent
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+SOURCES += \
+    main.cpp \
+    tileserver.cpp
+
+HEADERS += \
+    tileserver.h
+
+include($$PWD/../TileFetcher/TileFetcher.pri)   # 异步瓦片下载（共用）
+
+#  定义程序版本号
+VERSION = 1.0.0
+DEFINES += APP_VERSION=\\\"$$VERSION\\\"
+
+contains(QT_ARCH, i386){        # 使用32位编译器
+DESTDIR = $$PWD/../bin          # 程序输出路径
+}else{
+DESTDIR = $$PWD/../bin64        # 使用64位编译器
+}
+
+# msvc >= 2017  编译器使用utf-8编码
+msvc {
+    greaterThan(QMAKE_MSC_VER, 1900){       # msvc编译器版本大于2015
+        QMAKE_CFLAGS += /utf-8
+        QMAKE_CXXFLAGS += /utf-8
+    }else{
+#        message(msvc2015及以下版本在代码中使用【pragma execution_character_set("utf-8")】指定编码)
+    }
+}
@@ -0,0 +1,112 @@
+﻿/********************************************************************
+ * 文件名： main.cpp
+ * 时间：   2025-04-22 22:10:32
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   瓦片下载性能对比
+ * ******************************************************************/
+#include "tilefetcher.h"
+#include "tileserver.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QThread>
+#include <QTimer>
+#include <QtConcurrent>
+
+static std::atomic<int> g_failed{0};
+
+/**
+ * @brief       以前MapView3、MapDownload下载瓦片的方式：每个瓦片一个QNetworkAccessManager，在线程池中阻塞等待
+ * @param url
+ */
+static void oldGet(const QString& url)
+{
+    QNetworkAccessManager manager;
+    QScopedPointer<QNetworkReply> reply(manager.get(QNetworkRequest(QUrl(url))));
+    QEventLoop loop;
+    QObject::connect(reply.data(), &QNetworkReply::finished, &loop, &QEventLoop::quit);
+    QTimer::singleShot(5000, &loop, &QEventLoop::quit);
+    loop.exec();
+
+    QImage image;
+    if (reply->error() != QNetworkReply::NoError || !image.loadFromData(reply->readAll()))
+    {
+        g_failed++;
+    }
+}
+
+static void print(const QString& name, qint64 ms, int count, int failed, int connections)
+{
+    qInfo().noquote() << QString("%1：%2 ms，%3 瓦片/秒，失败 %4，新建连接 %5")
+                             .arg(name, -36)
+                             .arg(ms)
+                             .arg(ms > 0 ? count * 1000 / ms : count)
+                             .arg(failed)
+                             .arg(connections);
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication a(argc, argv);
+    const int count = argc > 1 ? QString(argv[1]).toInt() : 2000;
+    const int latency = argc > 2 ? QString(argv[2]).toInt() : 20;
+
+    // 瓦片服务在单独的线程中运行，不受下载端阻塞的影响
+    QThread serverThread;
+    auto* server = new TileServer(latency);
+    server->moveToThread(&serverThread);
+    serverThread.start();
+    QMetaObject::invokeMethod(server, [server]() { server->listen(QHostAddress::LocalHost); }, Qt::BlockingQueuedConnection);
+    const quint16 port = server->serverPort();
+    qInfo().noquote() << QString("本地瓦片服务端口：%1，瓦片数：%2，模拟延时：%3 ms").arg(port).arg(count).arg(latency);
+
+    QStringList urls;
+    QVector<TileFetcher::Request> requests;
+    TileFetcher::Request request;
+    request.z = 12;
+    for (int i = 0; i < count; i++)
+    {
+        request.x = i % 64;
+        request.y = i / 64;
+        request.url = QString("http://127.0.0.1:%1/%2/%3/%4.png").arg(port).arg(request.z).arg(request.x).arg(request.y);
+        urls.append(request.url);
+        requests.append(request);
+    }
+
+    // 1、线程池 + 每个瓦片一个QNetworkAccessManager
+    QElapsedTimer timer;
+    int connections = server->connections();
+    timer.start();
+    QtConcurrent::blockingMap(urls, oldGet);
+    print("每个瓦片一个QNetworkAccessManager", timer.elapsed(), count, g_failed, server->connections() - connections);
+
+    // 2、TileFetcher
+    {
+        TileFetcher fetcher;
+        QEventLoop loop;
+        int done = 0;
+        int failed = 0;
+        QObject::connect(&fetcher, &TileFetcher::finished, &loop, [&](const TileFetcher::Result& result) {
+            if (!result.isOk())
+                failed++;
+            if (++done == count)
+                loop.quit();
+        });
+        connections = server->connections();
+        timer.start();
+        fetcher.fetch(requests);
+        if (count > 0)
+            loop.exec();
+        print("TileFetcher", timer.elapsed(), count, failed, server->connections() - connections);
+        qInfo() << "重试次数：" << fetcher.statistics().retries;
+    }
+
+    QMetaObject::invokeMethod(server, [server]() { delete server; }, Qt::BlockingQueuedConnection);
+    serverThread.quit();
+    serverThread.wait();
+    return 0;
+}
@@ -0,0 +1,76 @@
+﻿/********************************************************************
+ * 文件名： tileserver.cpp
+ * 时间：   2025-04-22 22:10:32
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   本地瓦片服务
+ * ******************************************************************/
+#include "tileserver.h"
+#include <QBuffer>
+#include <QImage>
+#include <QTcpSocket>
+#include <QTimer>
+
+TileServer::TileServer(int latency, QObject* parent)
+    : QTcpServer(parent)
+    , m_latency(latency)
+{
+    // 生成一张带渐变的瓦片，大小和真实瓦片接近
+    QImage image(256, 256, QImage::Format_RGB32);
+    for (int y = 0; y < image.height(); y++)
+    {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < image.width(); x++)
+        {
+            line[x] = qRgb(x, y, (x * y) & 0xFF);
+        }
+    }
+    QByteArray png;
+    QBuffer buffer(&png);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+
+    m_response = "HTTP/1.1 200 OK\r\n"
+                 "Content-Type: image/png\r\n"
+                 "Cache-Control: max-age=86400\r\n"
+                 "ETag: \"bench\"\r\n"
+                 "Connection: keep-alive\r\n"
+                 "Content-Length: "
+                 + QByteArray::number(png.size()) + "\r\n\r\n" + png;
+}
+
+void TileServer::incomingConnection(qintptr socketDescriptor)
+{
+    auto* socket = new QTcpSocket(this);
+    if (!socket->setSocketDescriptor(socketDescriptor))
+    {
+        delete socket;
+        return;
+    }
+    m_connections++;
+    m_buffers.insert(socket, QByteArray());
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { on_readyRead(socket); });
+    connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+        m_buffers.remove(socket);
+        socket->deleteLater();
+    });
+}
+
+/**
+ * @brief        一个请求以空行结束（GET请求没有请求体），每个完整的请求延时后返回瓦片
+ * @param socket
+ */
+void TileServer::on_readyRead(QTcpSocket* socket)
+{
+    QByteArray& buffer = m_buffers[socket];
+    buffer += socket->readAll();
+    int end = buffer.indexOf("\r\n\r\n");
+    while (end >= 0)
+    {
+        buffer.remove(0, end + 4);
+        m_requests++;
+        // 延时相同，同一个连接上的应答顺序和请求顺序一致
+        QTimer::singleShot(m_latency, socket, [this, socket]() { socket->write(m_response); });
+        end = buffer.indexOf("\r\n\r\n");
+    }
+}
@@ -0,0 +1,40 @@
+﻿#ifndef TILESERVER_H
+#define TILESERVER_H
+/********************************************************************
+ * 文件名： tileserver.h
+ * 时间：   2025-04-22 22:10:32
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   本地瓦片服务，代替在线瓦片服务用于性能测试；
+ *          所有请求都返回同一张256*256的png，支持HTTP/1.1 keep-alive，每个请求延时指定时间后返回（模拟网络延时）
+ * ******************************************************************/
+
+#include <QHash>
+#include <QTcpServer>
+#include <atomic>
+
+class QTcpSocket;
+
+class TileServer : public QTcpServer
+{
+public:
+    explicit TileServer(int latency, QObject* parent = nullptr);
+
+    int connections() const { return m_connections; }   // 接受的连接数
+    int requests() const { return m_requests; }         // 收到的请求数
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+    void on_readyRead(QTcpSocket* socket);
+
+private:
+    int m_latency = 0;
+    QByteArray m_response;                    // 完整的HTTP应答
+    QHash<QTcpSocket*, QByteArray> m_buffers;   // 每个连接没有处理完的请求数据
+    std::atomic<int> m_connections{0};
+    std::atomic<int> m_requests{0};
+};
+
+#endif   // TILESERVER_H
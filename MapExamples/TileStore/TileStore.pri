@@ -0,0 +1,18 @@
+#---------------------------------------------------------
+# 功能：       瓦片打包存储（数据文件 + 内存哈希索引 + 内存映射读取），
+#             MapDownload、MapView、MapView2、MapView3共用
+# 编译器：
+#
+# @开发者     mhf
+# @邮箱       1603291350@qq.com
+# @时间       2025/04/20
+# @备注
+#---------------------------------------------------------
+
+HEADERS += \
+    $$PWD/tilestore.h
+
+SOURCES += \
+    $$PWD/tilestore.cpp
+
+INCLUDEPATH += $$PWD
@@ -0,0 +1,546 @@
+﻿/********************************************************************
+ * 文件名： tilestore.cpp
+ * 时间：   2025-04-20 10:12:36
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   瓦片打包存储
+ * ******************************************************************/
+#include "tilestore.h"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QSet>
+#include <QUrl>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+static const char* PackMagic = "QMTP";
+static const char* IndexMagic = "QMTI";
+static const quint32 Version = 1;
+
+/**
+ * @brief 写入文件头：魔数4字节 + 版本4字节 + 保留8字节
+ */
+static bool writeHeader(QFile& file, const char* magic)
+{
+    QByteArray header(16, '\0');
+    memcpy(header.data(), magic, 4);
+    qToLittleEndian<quint32>(Version, reinterpret_cast<uchar*>(header.data()) + 4);
+    return file.seek(0) && file.write(header) == header.size();
+}
+
+static bool checkHeader(QFile& file, const char* magic)
+{
+    if (!file.seek(0))
+        return false;
+    const QByteArray header = file.read(16);
+    return header.size() == 16 && header.startsWith(magic)
+           && qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(header.constData()) + 4) == Version;
+}
+
+static quint32 toSeconds(qint64 seconds)
+{
+    return quint32(qBound<qint64>(0, seconds, 0xFFFFFFFF));
+}
+
+/**
+ * @brief       获取瓦片库，同一个路径、同一种打开方式在进程内只打开一次
+ * @param path  瓦片库所在的文件夹，ReadWrite方式不存在时创建
+ * @param mode  ReadOnly时不获取写锁，进程内已经有ReadWrite方式打开的瓦片库时直接共用
+ * @return      打开失败时isOpen()为false，errorString()返回原因
+ */
+QSharedPointer<TileStore> TileStore::shared(const QString& path, OpenMode mode)
+{
+    static QMutex mutex;
+    static QHash<QString, QWeakPointer<TileStore>> stores[2];
+
+    const QString absolutePath = QDir::cleanPath(QDir(path).absolutePath());
+    QMutexLocker locker(&mutex);
+    QSharedPointer<TileStore> store = stores[ReadWrite].value(absolutePath).toStrongRef();
+    if (mode == ReadOnly && !(store && store->isOpen()))
+    {
+        store = stores[ReadOnly].value(absolutePath).toStrongRef();
+    }
+    if (!store)
+    {
+        store.reset(new TileStore(absolutePath, mode));
+        store->open();
+        stores[mode].insert(absolutePath, store);
+    }
+    return store;
+}
+
+/**
+ * @brief             在线瓦片的默认缓存路径，不同的瓦片源保存在不同的瓦片库中
+ * @param urlTemplate 带{x}{y}{z}或{q}的瓦片地址
+ * @return            程序路径/TileCache/主机名_地址哈希
+ */
+QString TileStore::defaultPath(const QString& urlTemplate)
+{
+    const QString host = QUrl(urlTemplate).host();
+    const QByteArray hash = QCryptographicHash::hash(urlTemplate.toUtf8(), QCryptographicHash::Md5).toHex().left(8);
+    return QString("%1/TileCache/%2_%3").arg(QCoreApplication::applicationDirPath(), host, QString::fromLatin1(hash));
+}
+
+TileStore::TileStore(const QString& path, OpenMode mode)
+    : m_path(path)
+    , m_mode(mode)
+    , m_lockFile(path + "/tiles.lock")
+{
+    for (auto& segment : m_segments)
+    {
+        segment.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+TileStore::~TileStore()
+{
+    close();
+}
+
+bool TileStore::open()
+{
+    if (m_mode == ReadWrite)
+    {
+        if (!QDir().mkpath(m_path))
+        {
+            m_error = QString("无法创建文件夹：%1").arg(m_path);
+            return false;
+        }
+        // 默认锁文件超过30秒就认为失效，这里只在写入进程已经退出时才认为失效
+        m_lockFile.setStaleLockTime(0);
+        m_writable = m_lockFile.tryLock(0);
+    }
+
+    const QString packName = m_path + "/tiles.pack";
+    m_indexFile.setFileName(m_path + "/tiles.idx");
+    if (m_writable)
+    {
+        // 不使用缓冲，写入后其它线程马上可以通过内存映射读取
+        m_packFile.setFileName(packName);
+        if (!m_packFile.open(QIODevice::ReadWrite | QIODevice::Unbuffered)
+            || !m_indexFile.open(QIODevice::ReadWrite | QIODevice::Unbuffered))
+        {
+            m_error = QString("打开瓦片库失败：%1").arg(m_packFile.isOpen() ? m_indexFile.errorString() : m_packFile.errorString());
+            close();
+            return false;
+        }
+        if (m_packFile.size() == 0)
+        {
+            writeHeader(m_packFile, PackMagic);
+        }
+        if (m_indexFile.size() == 0)
+        {
+            writeHeader(m_indexFile, IndexMagic);
+        }
+    }
+    else if (!m_indexFile.open(QIODevice::ReadOnly))
+    {
+        m_error = QString("瓦片库不存在或正在被其它程序创建：%1").arg(m_path);
+        return false;
+    }
+
+    m_mapFile.setFileName(packName);
+    if (!m_mapFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered) || !checkHeader(m_mapFile, PackMagic)
+        || !checkHeader(m_indexFile, IndexMagic))
+    {
+        m_error = QString("不是有效的瓦片库：%1").arg(m_path);
+        close();
+        return false;
+    }
+
+    m_indexPos = HeaderSize;
+    readIndex();
+    if (m_writable)
+    {
+        m_indexFile.resize(m_indexPos);   // 去掉异常退出时没有写完整的索引记录
+    }
+    m_open = true;
+    return true;
+}
+
+void TileStore::close()
+{
+    for (auto& segment : m_segments)
+    {
+        if (uchar* address = segment.exchange(nullptr))
+        {
+            m_mapFile.unmap(address);
+        }
+    }
+    m_mapFile.close();
+    m_packFile.close();
+    m_indexFile.close();
+    if (m_writable)
+    {
+        m_lockFile.unlock();
+        m_writable = false;
+    }
+    m_open = false;
+}
+
+/**
+ * @brief  从m_indexPos开始读取索引记录到内存
+ * @return 读取的条目数
+ */
+int TileStore::readIndex()
+{
+    const qint64 available = (m_indexFile.size() - m_indexPos) / IndexRecordSize * IndexRecordSize;   // 只读取完整的记录
+    if (available <= 0 || !m_indexFile.seek(m_indexPos))
+        return 0;
+
+    const QByteArray buffer = m_indexFile.read(available);
+    const quint64 packSize = quint64(m_mapFile.size());
+    const uchar* data = reinterpret_cast<const uchar*>(buffer.constData());
+    int count = 0;
+
+    QWriteLocker locker(&m_lock);
+    m_entries.reserve(m_entries.size() + int(buffer.size() / IndexRecordSize));
+    for (int i = 0; i + IndexRecordSize <= buffer.size(); i += IndexRecordSize)
+    {
+        const uchar* record = data + i;
+        Entry entry;
+        entry.offset = qFromLittleEndian<quint64>(record + 8);
+        entry.size = qFromLittleEndian<quint32>(record + 16);
+        entry.etagSize = qFromLittleEndian<quint16>(record + 20);
+        entry.fetched = qFromLittleEndian<quint32>(record + 24);
+        entry.expires = qFromLittleEndian<quint32>(record + 28);
+
+        const quint64 end = entry.offset + entry.etagSize + entry.size;
+        if (entry.offset < HeaderSize || end > packSize)   // 数据没有写入（写入程序异常退出）
+            continue;
+        m_entries.insert(qFromLittleEndian<quint64>(record), entry);   // 同一个瓦片以最后一条记录为准
+        m_end = qMax(m_end, end);
+        count++;
+    }
+    m_indexPos += buffer.size();
+    return count;
+}
+
+/**
+ * @brief        获取映射分段的地址，第一次访问时映射
+ * @param index
+ * @return       映射失败（例如32位程序地址空间不足）时返回nullptr
+ */
+const uchar* TileStore::segment(int index) const
+{
+    if (index < 0 || index >= MaxSegments)
+        return nullptr;
+
+    uchar* address = m_segments[index].load(std::memory_order_acquire);
+    if (address)
+        return address;
+
+    QMutexLocker locker(&m_mapMutex);
+    address = m_segments[index].load(std::memory_order_relaxed);
+    if (!address && m_mapFile.size() >= (index + 1) * SegmentSize)   // 写入前数据文件会扩展到完整的分段
+    {
+        address = m_mapFile.map(index * SegmentSize, SegmentSize);
+        m_segments[index].store(address, std::memory_order_release);
+    }
+    return address;
+}
+
+bool TileStore::readRecord(quint64 offset, int size, char* dest) const
+{
+    const int index = int(offset >> SegmentBits);
+    if (const uchar* address = segment(index))
+    {
+        memcpy(dest, address + (offset - (quint64(index) << SegmentBits)), size_t(size));
+        return true;
+    }
+
+    QMutexLocker locker(&m_mapMutex);
+    return m_mapFile.seek(qint64(offset)) && m_mapFile.read(dest, size) == size;
+}
+
+bool TileStore::contains(int z, int x, int y) const
+{
+    QReadLocker locker(&m_lock);
+    return m_entries.contains(key(z, x, y));
+}
+
+/**
+ * @brief       读取瓦片
+ * @param meta  不为空时返回瓦片的ETag、下载时间、过期时间
+ * @return      编码后的图片数据（jpg、png等），不存在时返回空
+ */
+QByteArray TileStore::tile(int z, int x, int y, TileMeta* meta) const
+{
+    Entry entry;
+    {
+        QReadLocker locker(&m_lock);
+        auto it = m_entries.constFind(key(z, x, y));
+        if (it == m_entries.constEnd())
+            return QByteArray();
+        entry = it.value();
+    }
+
+    QByteArray data(int(entry.size), Qt::Uninitialized);
+    if (!readRecord(entry.offset + entry.etagSize, data.size(), data.data()))
+        return QByteArray();
+    if (meta)
+    {
+        meta->etag.resize(entry.etagSize);
+        readRecord(entry.offset, entry.etagSize, meta->etag.data());
+        meta->fetched = entry.fetched;
+        meta->expires = entry.expires;
+    }
+    return data;
+}
+
+bool TileStore::meta(int z, int x, int y, TileMeta* meta) const
+{
+    Entry entry;
+    {
+        QReadLocker locker(&m_lock);
+        auto it = m_entries.constFind(key(z, x, y));
+        if (it == m_entries.constEnd())
+            return false;
+        entry = it.value();
+    }
+
+    meta->etag.resize(entry.etagSize);
+    meta->fetched = entry.fetched;
+    meta->expires = entry.expires;
+    return readRecord(entry.offset, entry.etagSize, meta->etag.data());
+}
+
+/**
+ * @brief       写入瓦片，已经存在时追加新的数据，索引指向新数据（旧数据不回收）
+ * @param data  编码后的图片数据
+ * @return      只读打开或写入失败时返回false
+ */
+bool TileStore::insert(int z, int x, int y, const QByteArray& data, const TileMeta& meta)
+{
+    if (data.isEmpty() || z < 0 || z > 30 || x < 0 || y < 0 || x >= (1 << 24) || y >= (1 << 24))
+        return false;
+
+    QMutexLocker locker(&m_writeMutex);
+    return append(key(z, x, y), meta.etag.left(0xFFFF), data, meta);
+}
+
+/**
+ * @brief       更新瓦片的过期时间，ETag没有变化时只追加一条索引记录
+ */
+bool TileStore::updateMeta(int z, int x, int y, const TileMeta& meta)
+{
+    QMutexLocker locker(&m_writeMutex);
+    if (!m_writable)
+        return false;
+
+    const quint64 tileKey = key(z, x, y);
+    Entry entry;
+    {
+        QReadLocker readLocker(&m_lock);
+        auto it = m_entries.constFind(tileKey);
+        if (it == m_entries.constEnd())
+            return false;
+        entry = it.value();
+    }
+
+    QByteArray etag(entry.etagSize, Qt::Uninitialized);
+    if (!readRecord(entry.offset, etag.size(), etag.data()))
+        return false;
+    if (etag != meta.etag)   // ETag变化时数据和ETag一起重新写入
+    {
+        QByteArray data(int(entry.size), Qt::Uninitialized);
+        return readRecord(entry.offset + entry.etagSize, data.size(), data.data())
+               && append(tileKey, meta.etag.left(0xFFFF), data, meta);
+    }
+
+    if (!writeIndex(tileKey, entry.offset, entry.size, entry.etagSize, meta))
+        return false;
+    entry.fetched = toSeconds(meta.fetched);
+    entry.expires = toSeconds(meta.expires);
+    QWriteLocker writeLocker(&m_lock);
+    m_entries.insert(tileKey, entry);
+    return true;
+}
+
+/**
+ * @brief  追加一条记录，调用前需要锁定m_writeMutex
+ */
+bool TileStore::append(quint64 key, const QByteArray& etag, const QByteArray& data, const TileMeta& meta)
+{
+    if (!m_writable)
+        return false;
+
+    const quint64 size = quint64(etag.size()) + quint64(data.size());
+    if (size > quint64(SegmentSize / 4))
+    {
+        m_error = "瓦片数据过大";
+        return false;
+    }
+
+    quint64 offset = m_end;
+    if ((offset >> SegmentBits) != ((offset + size - 1) >> SegmentBits))   // 一条记录不跨段，剩余的空间留空
+    {
+        offset = ((offset >> SegmentBits) + 1) << SegmentBits;
+    }
+    const qint64 segmentEnd = qint64(((offset >> SegmentBits) + 1) << SegmentBits);
+    if ((offset >> SegmentBits) >= quint64(MaxSegments) || (m_packFile.size() < segmentEnd && !m_packFile.resize(segmentEnd)))
+    {
+        m_error = QString("扩展数据文件失败：%1").arg(m_packFile.errorString());
+        return false;
+    }
+    if (!m_packFile.seek(qint64(offset)) || m_packFile.write(etag) != etag.size() || m_packFile.write(data) != data.size())
+    {
+        m_error = QString("写入数据文件失败：%1").arg(m_packFile.errorString());
+        return false;
+    }
+    // 先写数据再写索引，异常退出时索引不会指向没有写入的数据
+    if (!writeIndex(key, offset, quint32(data.size()), quint16(etag.size()), meta))
+        return false;
+    m_end = offset + size;
+
+    Entry entry;
+    entry.offset = offset;
+    entry.size = quint32(data.size());
+    entry.etagSize = quint16(etag.size());
+    entry.fetched = toSeconds(meta.fetched);
+    entry.expires = toSeconds(meta.expires);
+    QWriteLocker locker(&m_lock);
+    m_entries.insert(key, entry);
+    return true;
+}
+
+bool TileStore::writeIndex(quint64 key, quint64 offset, quint32 size, quint16 etagSize, const TileMeta& meta)
+{
+    uchar record[IndexRecordSize] = {};
+    qToLittleEndian<quint64>(key, record);
+    qToLittleEndian<quint64>(offset, record + 8);
+    qToLittleEndian<quint32>(size, record + 16);
+    qToLittleEndian<quint16>(etagSize, record + 20);
+    qToLittleEndian<quint32>(toSeconds(meta.fetched), record + 24);
+    qToLittleEndian<quint32>(toSeconds(meta.expires), record + 28);
+
+    if (!m_indexFile.seek(m_indexPos) || m_indexFile.write(reinterpret_cast<const char*>(record), IndexRecordSize) != IndexRecordSize)
+    {
+        m_error = QString("写入索引失败：%1").arg(m_indexFile.errorString());
+        return false;
+    }
+    m_indexPos += IndexRecordSize;
+    return true;
+}
+
+int TileStore::count() const
+{
+    QReadLocker locker(&m_lock);
+    return m_entries.count();
+}
+
+QVector<int> TileStore::levels() const
+{
+    QSet<int> set;
+    {
+        QReadLocker locker(&m_lock);
+        for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+        {
+            set.insert(int(it.key() >> 48));
+        }
+    }
+    QVector<int> levels;
+    levels.reserve(set.count());
+    for (int level : set)
+    {
+        levels.append(level);
+    }
+    std::sort(levels.begin(), levels.end());
+    return levels;
+}
+
+QVector<QPoint> TileStore::tiles(int z) const
+{
+    QVector<QPoint> tiles;
+    {
+        QReadLocker locker(&m_lock);
+        for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+        {
+            if (int(it.key() >> 48) == z)
+            {
+                tiles.append(QPoint(int((it.key() >> 24) & 0xFFFFFF), int(it.key() & 0xFFFFFF)));
+            }
+        }
+    }
+    std::sort(tiles.begin(), tiles.end(), [](const QPoint& a, const QPoint& b) {
+        return a.x() != b.x() ? a.x() < b.x() : a.y() < b.y();
+    });
+    return tiles;
+}
+
+/**
+ * @brief  只读打开时读取写入程序新追加的索引
+ * @return 新增的条目数
+ */
+int TileStore::refresh()
+{
+    if (!m_open || m_writable)
+        return 0;
+    QMutexLocker locker(&m_writeMutex);
+    return readIndex();
+}
+
+/**
+ * @brief       导入z/x/y.格式保存的瓦片文件夹（以前版本MapDownload的保存方式），已经存在的瓦片跳过
+ *              ReadOnly方式打开时临时获取写锁，导入完成后释放并重新只读打开，需要在没有其它线程读取时调用
+ * @param root
+ * @return      导入的瓦片数，其它程序正在写入时返回0
+ */
+int TileStore::importDirectory(const QString& root)
+{
+    const bool temporary = m_mode == ReadOnly;
+    if (temporary)
+    {
+        close();
+        m_mode = ReadWrite;
+        open();
+        m_mode = ReadOnly;
+    }
+    const int count = m_writable ? importTiles(root) : 0;
+    if (temporary)
+    {
+        close();   // 释放写锁
+        open();
+    }
+    return count;
+}
+
+int TileStore::importTiles(const QString& root)
+{
+    int count = 0;
+    bool ok = false;
+    const QDir dir(root);
+    for (const QString& zName : dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        const int z = zName.toInt(&ok);
+        if (!ok)
+            continue;
+        const QDir zDir(dir.filePath(zName));
+        for (const QString& xName : zDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+        {
+            const int x = xName.toInt(&ok);
+            if (!ok)
+                continue;
+            const QDir xDir(zDir.filePath(xName));
+            for (const QFileInfo& info : xDir.entryInfoList(QDir::Files))
+            {
+                const int y = info.completeBaseName().toInt(&ok);
+                if (!ok || contains(z, x, y))
+                    continue;
+                QFile file(info.filePath());
+                if (!file.open(QIODevice::ReadOnly))
+                    continue;
+                TileMeta meta;
+                meta.fetched = info.lastModified().toSecsSinceEpoch();
+                if (insert(z, x, y, file.readAll(), meta))
+                {
+                    count++;
+                }
+            }
+        }
+    }
+    return count;
+}
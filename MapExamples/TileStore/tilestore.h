@@ -0,0 +1,119 @@
+﻿#ifndef TILESTORE_H
+#define TILESTORE_H
+/********************************************************************
+ * 文件名： tilestore.h
+ * 时间：   2025-04-20 10:12:36
+ * 开发者：  mhf
+ * 邮箱：   1603291350@qq.com
+ * 说明：   瓦片打包存储，MapDownload、MapView、MapView2、MapView3共用
+ *          1、所有瓦片追加写入一个数据文件tiles.pack，不再是每个瓦片一个文件；
+ *          2、索引tiles.idx只追加固定长度的记录，打开时全部读入内存的哈希表，查找瓦片不访问文件系统；
+ *          3、数据文件按64MB分段内存映射读取，一条记录不会跨段；
+ *          4、同一进程内多线程并发读、单线程写（写锁）；多个进程之间用tiles.lock选出唯一的写入进程，
+ *             其它进程只读打开，调用refresh()读取新追加的索引；只显示瓦片的程序以ReadOnly方式打开，
+ *             不占用tiles.lock，不影响MapDownload写入；
+ *          5、保存HTTP的ETag、过期时间，过期后可以用If-None-Match重新验证。
+ * ******************************************************************/
+
+#include <QFile>
+#include <QHash>
+#include <QLockFile>
+#include <QMutex>
+#include <QPoint>
+#include <QReadWriteLock>
+#include <QSharedPointer>
+#include <QVector>
+#include <atomic>
+
+struct TileMeta
+{
+    QByteArray etag;      // HTTP ETag
+    qint64 fetched = 0;   // 下载时间（UTC秒）
+    qint64 expires = 0;   // 过期时间（UTC秒），0表示不过期
+
+    bool isExpired(qint64 now) const { return expires > 0 && now >= expires; }
+};
+
+class TileStore
+{
+public:
+    enum OpenMode
+    {
+        ReadWrite,   // 获取到tiles.lock时可以写入，否则只读
+        ReadOnly     // 只读，不获取tiles.lock
+    };
+
+    static QSharedPointer<TileStore> shared(const QString& path, OpenMode mode = ReadWrite);   // 同一个路径在进程内只打开一次，所有地图窗口共用
+    static QString defaultPath(const QString& urlTemplate);        // 在线瓦片的缓存路径：程序路径/TileCache/主机名_地址哈希
+    static quint64 key(int z, int x, int y) { return (quint64(z) << 48) | (quint64(x) << 24) | quint64(y); }
+
+    ~TileStore();
+
+    bool isOpen() const { return m_open; }
+    bool isWritable() const { return m_writable; }
+    QString path() const { return m_path; }
+    QString errorString() const { return m_error; }
+
+    bool contains(int z, int x, int y) const;
+    QByteArray tile(int z, int x, int y, TileMeta* meta = nullptr) const;   // 返回编码后的图片数据，不存在时返回空
+    bool meta(int z, int x, int y, TileMeta* meta) const;
+    bool insert(int z, int x, int y, const QByteArray& data, const TileMeta& meta = TileMeta());
+    bool updateMeta(int z, int x, int y, const TileMeta& meta);   // 重新验证未修改（304）时只追加索引，不重复写入数据
+
+    int count() const;
+    QVector<int> levels() const;         // 所有层级，从小到大
+    QVector<QPoint> tiles(int z) const;  // 一个层级的所有瓦片编号，按x、y排序
+    int refresh();                       // 只读打开时读取其它进程新追加的索引，返回新增的条目数
+    int importDirectory(const QString& root);   // 导入以前z/x/y.格式保存的瓦片文件夹，返回导入的瓦片数
+
+private:
+    TileStore(const QString& path, OpenMode mode);
+    bool open();
+    void close();
+    int readIndex();
+    int importTiles(const QString& root);
+    const uchar* segment(int index) const;
+    bool readRecord(quint64 offset, int size, char* dest) const;
+    bool append(quint64 key, const QByteArray& etag, const QByteArray& data, const TileMeta& meta);
+    bool writeIndex(quint64 key, quint64 offset, quint32 size, quint16 etagSize, const TileMeta& meta);
+
+private:
+    struct Entry
+    {
+        quint64 offset = 0;     // 记录在数据文件中的偏移，记录为 ETag + 图片数据
+        quint32 size = 0;       // 图片数据长度
+        quint16 etagSize = 0;
+        quint32 fetched = 0;
+        quint32 expires = 0;
+    };
+
+    enum
+    {
+        HeaderSize = 16,                 // 数据文件、索引文件头：魔数4字节 + 版本4字节 + 保留8字节
+        IndexRecordSize = 32,            // key 8 + offset 8 + size 4 + etagSize 2 + 保留 2 + fetched 4 + expires 4
+        SegmentBits = 26,                // 映射分段64MB
+        MaxSegments = 4096               // 最大256GB
+    };
+    static constexpr qint64 SegmentSize = qint64(1) << SegmentBits;
+
+    QString m_path;
+    QString m_error;
+    OpenMode m_mode = ReadWrite;
+    bool m_open = false;
+    bool m_writable = false;
+
+    QLockFile m_lockFile;
+    QFile m_packFile;            // 写入数据
+    QFile m_indexFile;           // 写入、读取索引
+    mutable QFile m_mapFile;     // 只读打开，用于内存映射和映射失败时的读取
+    qint64 m_indexPos = 0;       // 已读取的索引长度
+    quint64 m_end = HeaderSize;  // 数据文件中已使用的长度
+
+    mutable QReadWriteLock m_lock;     // 保护m_entries
+    QHash<quint64, Entry> m_entries;
+    QMutex m_writeMutex;               // 同一时间只有一个线程写入
+    mutable QMutex m_mapMutex;         // 保护映射分段和m_mapFile
+    mutable std::atomic<uchar*> m_segments[MaxSegments];
+};
+
+#endif   // TILESTORE_H
@@ -34,6 +34,9 @@ HEADERS += \
 
 FORMS += widget.ui
 
+include($$PWD/../../QMNetwork/FrameCodec/FrameCodec.pri)   # 数据分帧模块，设置了分帧规则时Tcp数据按帧拆分后再交给解析线程，默认原样传递
+INCLUDEPATH += $$PWD/../../QMNetwork/FrameCodec
+
 #  定义程序版本号
 VERSION = 1.0.2
 DEFINES += APP_VERSION=\\\"$$VERSION\\\"
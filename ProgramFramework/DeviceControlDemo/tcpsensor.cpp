@@ -2,15 +2,16 @@
 #include <QDebug>
 #include <QTcpSocket>
 #include <handletcpthread.h>
+#include "framecodec.h"
 
 TcpSensor::TcpSensor(QObject *parent) : AbstractSensor(parent)
 {
     m_type = TcpType;
 
     m_tcpClient = new QTcpSocket(this);
+    connect(m_tcpClient, &QTcpSocket::readyRead, this, &TcpSensor::on_readyRead);   // 默认不分帧，与设备的通信协议保持不变
     connect(m_tcpClient, &QTcpSocket::connected, this, &TcpSensor::on_connected);
     connect(m_tcpClient, &QTcpSocket::disconnected, this, &TcpSensor::on_disconnected);
-    connect(m_tcpClient, &QTcpSocket::readyRead, this, &TcpSensor::on_readyRead);
 
     m_handleThread = new handleTcpThread;
     connect(m_handleThread, &AbstractThread::outputData, this, &TcpSensor::outputData);    // 将线程中的数据传递给UI
@@ -34,6 +35,26 @@ void TcpSensor::setTarget(const QString &hostName, quint16 port)
     m_port = port;
 }
 
+/**
+ * @brief        设置分帧规则，例如按行通信的设备使用new DelimiterFramer("\n")，发送时会自动添加换行符
+ * @param framer 接管所有权
+ */
+void TcpSensor::setFramer(Framer* framer)
+{
+    if(m_codec)
+    {
+        m_codec->setFramer(framer);
+        return;
+    }
+    disconnect(m_tcpClient, &QTcpSocket::readyRead, this, &TcpSensor::on_readyRead);   // 之后由m_codec读取Tcp数据
+    m_codec = new FrameCodec(framer, this);
+    m_codec->setFrameHandler([this](const FrameView& frame) {
+        m_handleThread->inputData(frame.toByteArray());             // 将数据传入线程处理（FrameView只在回调中有效，需要复制）
+    });
+    connect(m_codec, &FrameCodec::errorOccurred, this, [](const QString& error) { qWarning() << error; });   // 每次重新同步只报告一次
+    m_codec->attach(m_tcpClient);
+}
+
 /**
  * @brief 开始连接Tcp服务器
  */
@@ -66,21 +87,26 @@ void TcpSensor::close()
  */
 void TcpSensor::write(const QByteArray &arr)
 {
-    qint64 len = m_tcpClient->write(arr);
-    if(len < 0)
+    bool ok = m_codec ? m_codec->writeFrame(arr)                          // 设置了分帧规则时自动添加帧头/帧尾
+                      : m_tcpClient->write(arr) == arr.size();
+    if(!ok)
     {
         qWarning() << "发送失败！";
     }
-    else if(len < arr.count())
-    {
-        qWarning() << "发送数据不完整！";
-    }
     else
     {
-        qInfo() << QString("发送数据长度：%1").arg(len);
+        qInfo() << QString("发送数据长度：%1").arg(arr.count());
     }
 }
 
+/**
+ * @brief 没有设置分帧规则时读取的数据直接传入线程处理，不经过接收缓冲区，避免多复制一次
+ */
+void TcpSensor::on_readyRead()
+{
+    m_handleThread->inputData(m_tcpClient->readAll());
+}
+
 /**
  * @brief TCP连接成功
  */
@@ -96,14 +122,9 @@ void TcpSensor::on_connected()
 void TcpSensor::on_disconnected()
 {
     m_open = false;
+    if(m_codec)
+    {
+        m_codec->clear();                       // 丢弃不完整的一帧，避免和下次连接的数据拼在一起
+    }
     emit openState(false);
 }
-
-/**
- * @brief TCP接收数据
- */
-void TcpSensor::on_readyRead()
-{
-    QByteArray arr = m_tcpClient->readAll();
-    m_handleThread->inputData(arr);         // 读取Tcp数据并传入线程处理
-}
@@ -13,6 +13,8 @@
 #include "abstractsensor.h"
 
 class QTcpSocket;
+class FrameCodec;
+class Framer;
 
 class TcpSensor : public AbstractSensor
 {
@@ -22,15 +24,16 @@ public:
     ~TcpSensor();
 
     void setTarget(const QString &hostName, quint16 port);  // 设置Tcp连接所需的IP和端口
+    void setFramer(Framer* framer);                         // 设置分帧规则（如DelimiterFramer），默认不分帧，收发数据原样传递
 
     void open() override;                           // 开始连接Tcp
     void close() override;                          // 关闭通信接口
     void write(const QByteArray& arr) override;     // 发送数据
 
 protected slots:
+    void on_readyRead();
     void on_connected();
     void on_disconnected();
-    void on_readyRead();
 
 signals:
 
@@ -38,6 +41,7 @@ private:
     QString m_ip    = "127.0.0.1";       // ip地址
     quint16 m_port  = 6666;              // 端口号
     QTcpSocket* m_tcpClient = nullptr;   // Tcp通信对象
+    FrameCodec* m_codec = nullptr;       // 设置了分帧规则时才创建，由它读取Tcp数据，每次传入线程的都是一帧完整数据
 };
 
 #endif // TCPSENSOR_H
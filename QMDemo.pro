@@ -19,6 +19,7 @@ SUBDIRS += OpenCVDemo                     # opencv常用功能Demo
 SUBDIRS += ProgramFramework               # 简单的一些程序架构
 SUBDIRS += QStyleDemo                     # Qt界面样式Demo
 SUBDIRS += QMNetwork                      # Qt网络通信程序Demo
+SUBDIRS += QMNetwork/NetLoadTool          # TCP/UDP网络压力测试工具（命令行）
 SUBDIRS += XlsxDemo                       # Qt使用QXlsx读写Excel Demo
 SUBDIRS += QtChartsDemo                   # Qt使用QtCharts绘制图表 Demo
 SUBDIRS += QSqlDemo                       # Qt使用数据库Demo
@@ -0,0 +1,20 @@
+#---------------------------------------------------------
+# 功能：       QIODevice数据分帧模块（长度前缀、固定帧头、分隔符），
+#             接收数据保存在环形缓冲区中，尽量不复制数据
+# 编译器：
+#
+# @开发者     mhf
+# @邮箱       1603291350@qq.com
+# @时间       2025/04/05
+# @备注
+#---------------------------------------------------------
+
+HEADERS += \
+    $$PWD/framecodec.h \
+    $$PWD/framer.h \
+    $$PWD/ringbuffer.h
+
+SOURCES += \
+    $$PWD/framecodec.cpp \
+    $$PWD/framer.cpp \
+    $$PWD/ringbuffer.cpp
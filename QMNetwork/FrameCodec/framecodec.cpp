@@ -0,0 +1,206 @@
+﻿#include "framecodec.h"
+#include <QIODevice>
+#include <QMetaMethod>
+
+FrameCodec::FrameCodec(Framer* framer, QObject* parent)
+    : QObject(parent)
+    , m_framer(framer)
+{
+    Q_ASSERT(framer);
+}
+
+FrameCodec::~FrameCodec()
+{
+    delete m_framer;
+}
+
+/**
+ * @brief         绑定设备，之后设备的readyRead会自动调用process()；设备中已有的数据会立即处理
+ * @param device  codec不接管device的所有权
+ */
+void FrameCodec::attach(QIODevice* device)
+{
+    detach();
+    m_device = device;
+    if (device)
+    {
+        connect(device, &QIODevice::readyRead, this, &FrameCodec::process);
+        if (device->bytesAvailable() > 0)
+        {
+            process();
+        }
+    }
+}
+
+void FrameCodec::detach()
+{
+    if (m_device)
+    {
+        m_device->disconnect(this);
+    }
+    m_device = nullptr;
+    clear();
+}
+
+void FrameCodec::setFramer(Framer* framer)
+{
+    Q_ASSERT(framer);
+    if (framer != m_framer)
+    {
+        delete m_framer;
+        m_framer = framer;
+    }
+    clear();
+}
+
+void FrameCodec::clear()
+{
+    m_buffer.clear();
+    m_framer->reset();
+}
+
+/**
+ * @brief 读取设备中的数据并依次处理缓冲区中所有完整的帧
+ */
+void FrameCodec::process()
+{
+    if (!m_device || m_processing)   // 在回调中调用了waitForReadyRead等函数时不重复进入
+    {
+        return;
+    }
+    m_processing = true;
+    const bool emitSignal = isSignalConnected(QMetaMethod::fromSignal(&FrameCodec::frameReceived));
+
+    while (m_device)
+    {
+        if (m_buffer.readFrom(m_device, m_maxBufferSize) < 0)
+        {
+            emit errorOccurred(m_device->errorString());
+            break;
+        }
+
+        bool full = m_buffer.size() >= m_maxBufferSize;
+        FrameInfo frame;
+        int skip = 0;
+        int dropped = 0;   // 一次重新同步丢弃的字节数，找到下一帧后只报告一次
+        Framer::Result result;
+        while ((result = m_framer->parse(m_buffer, frame, skip)) != Framer::NeedMore)
+        {
+            if (result == Framer::Invalid)
+            {
+                m_buffer.skip(qMax(skip, 1));
+                m_framer->reset();
+                dropped += qMax(skip, 1);
+                continue;
+            }
+            if (dropped > 0)
+            {
+                emit errorOccurred(QString("丢弃%1字节无法识别的数据").arg(dropped));
+                dropped = 0;
+            }
+
+            FrameView view;
+            view.data = m_buffer.contiguous(frame.payloadOffset, frame.payloadLength, m_scratch);
+            view.size = frame.payloadLength;
+            if (m_handler)
+            {
+                m_handler(view);
+            }
+            if (emitSignal)
+            {
+                emit frameReceived(view.toByteArray());
+            }
+            m_buffer.skip(frame.length);
+            m_framer->reset();
+            full = false;
+            if (!m_device)   // 回调中调用了detach()
+            {
+                break;
+            }
+        }
+        if (dropped > 0)
+        {
+            emit errorOccurred(QString("丢弃%1字节无法识别的数据").arg(dropped));
+        }
+
+        if (full)
+        {
+            // 缓冲区已满仍然没有一帧完整数据，说明分帧规则和数据不匹配，丢弃后继续读取
+            emit errorOccurred(QString("接收缓冲区已满（%1字节），丢弃所有数据").arg(m_buffer.size()));
+            clear();
+            continue;
+        }
+        if (!m_device || m_device->bytesAvailable() <= 0)
+        {
+            break;
+        }
+    }
+    m_processing = false;
+}
+
+bool FrameCodec::writeFrame(const QByteArray& payload)
+{
+    return writeFrame(payload.constData(), payload.size());
+}
+
+bool FrameCodec::writeFrame(const char* data, int size)
+{
+    return writeHeader(size) && writeRaw(data, size) && writeTrailer();
+}
+
+/**
+ * @brief        将多段数据作为一帧发送（例如固定的命令头 + 变长数据），各段依次写入设备，不拼接
+ * @param parts
+ */
+bool FrameCodec::writeFrame(const QVector<QByteArray>& parts)
+{
+    int payloadLength = 0;
+    for (const QByteArray& part : parts)
+    {
+        payloadLength += part.size();
+    }
+    if (!writeHeader(payloadLength))
+    {
+        return false;
+    }
+    for (const QByteArray& part : parts)
+    {
+        if (!writeRaw(part.constData(), part.size()))
+        {
+            return false;
+        }
+    }
+    return writeTrailer();
+}
+
+bool FrameCodec::writeHeader(int payloadLength)
+{
+    char header[Framer::MaxHeaderSize];
+    const int size = m_framer->header(header, payloadLength);
+    return writeRaw(header, size);
+}
+
+bool FrameCodec::writeTrailer()
+{
+    const QByteArray trailer = m_framer->trailer();
+    return writeRaw(trailer.constData(), trailer.size());
+}
+
+bool FrameCodec::writeRaw(const char* data, qint64 size)
+{
+    if (!m_device)
+    {
+        return false;
+    }
+    if (size <= 0)
+    {
+        return true;
+    }
+    const qint64 ret = m_device->write(data, size);
+    if (ret != size)
+    {
+        emit errorOccurred(m_device->errorString());
+        return false;
+    }
+    return true;
+}
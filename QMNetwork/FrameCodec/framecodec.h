@@ -0,0 +1,83 @@
+﻿/******************************************************************************
+ * @文件名     framecodec.h
+ * @功能       将QIODevice（QTcpSocket、QSerialPort、QLocalSocket等）的字节流按Framer的规则拆分成帧，
+ *            发送时自动添加帧头/帧尾
+ *
+ * @开发者     mhf
+ * @邮箱       1603291350@qq.com
+ * @时间       2025/04/05
+ * @备注       接收：数据直接读入RingBuffer，通过setFrameHandler()设置的回调以FrameView的形式交给使用者，
+ *                  只有一帧跨越缓冲区末尾时才复制；连接了frameReceived信号时才为每帧创建QByteArray
+ *            发送：帧头、各段数据、帧尾依次写入设备，不拼接成一个QByteArray
+ *****************************************************************************/
+#ifndef FRAMECODEC_H
+#define FRAMECODEC_H
+
+#include "framer.h"
+#include "ringbuffer.h"
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+#include <functional>
+
+class QIODevice;
+
+/**
+ * @brief 一帧数据（不包含帧头、帧尾），只在回调函数中有效，需要保存时调用toByteArray()
+ */
+struct FrameView
+{
+    const char* data = nullptr;
+    int size = 0;
+
+    QByteArray toByteArray() const { return QByteArray(data, size); }
+    QByteArray rawData() const { return QByteArray::fromRawData(data, size); }   // 不复制，只能在回调中使用
+};
+
+class FrameCodec : public QObject
+{
+    Q_OBJECT
+public:
+    using FrameHandler = std::function<void(const FrameView& frame)>;
+
+    explicit FrameCodec(Framer* framer, QObject* parent = nullptr);   // 接管framer的所有权
+    ~FrameCodec();
+
+    void attach(QIODevice* device);   // 绑定设备，自动读取readyRead的数据
+    void detach();
+    QIODevice* device() const { return m_device; }
+    Framer* framer() const { return m_framer; }
+    void setFramer(Framer* framer);   // 更换分帧规则，接管framer的所有权，并清空接收缓冲区
+
+    void setFrameHandler(const FrameHandler& handler) { m_handler = handler; }
+    void setMaxBufferSize(int size) { m_maxBufferSize = size; }   // 接收缓冲区上限，达到后暂停读取，数据留在设备中
+    int bufferedSize() const { return m_buffer.size(); }
+    void clear();                                                 // 清空接收缓冲区（如断开连接后）
+
+    bool writeFrame(const QByteArray& payload);
+    bool writeFrame(const char* data, int size);
+    bool writeFrame(const QVector<QByteArray>& parts);   // 多段数据组成一帧
+
+public slots:
+    void process();   // 读取设备中的数据并处理所有完整的帧
+
+signals:
+    void frameReceived(const QByteArray& frame);
+    void errorOccurred(const QString& error);
+
+private:
+    bool writeHeader(int payloadLength);
+    bool writeTrailer();
+    bool writeRaw(const char* data, qint64 size);
+
+private:
+    Framer* m_framer = nullptr;
+    QPointer<QIODevice> m_device;
+    RingBuffer m_buffer;
+    QByteArray m_scratch;   // 一帧跨越缓冲区末尾时使用
+    FrameHandler m_handler;
+    int m_maxBufferSize = 64 * 1024 * 1024;
+    bool m_processing = false;
+};
+
+#endif   // FRAMECODEC_H
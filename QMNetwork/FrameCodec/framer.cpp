@@ -0,0 +1,128 @@
+﻿#include "framer.h"
+#include "ringbuffer.h"
+#include <cstring>
+
+FixedHeaderFramer::FixedHeaderFramer(int headerSize, int lengthOffset, int lengthBytes, bool bigEndian, int lengthAdjustment,
+                                     const QByteArray& magic)
+    : m_headerSize(headerSize)
+    , m_lengthOffset(lengthOffset)
+    , m_lengthBytes(lengthBytes)
+    , m_bigEndian(bigEndian)
+    , m_lengthAdjustment(lengthAdjustment)
+    , m_magic(magic)
+{
+    Q_ASSERT(lengthBytes == 1 || lengthBytes == 2 || lengthBytes == 4);
+    Q_ASSERT(lengthOffset + lengthBytes <= headerSize);
+}
+
+Framer::Result FixedHeaderFramer::parse(const RingBuffer& buffer, FrameInfo& frame, int& skip)
+{
+    if (buffer.size() < qMax(m_headerSize, m_magic.size()))
+    {
+        return NeedMore;
+    }
+    for (int i = 0; i < m_magic.size(); ++i)
+    {
+        if (buffer.at(i) != m_magic.at(i))
+        {
+            skip = resync(buffer);   // 不是帧头，丢弃到下一个同步字
+            return Invalid;
+        }
+    }
+
+    quint32 value = 0;
+    for (int i = 0; i < m_lengthBytes; ++i)
+    {
+        const quint32 byte = quint8(buffer.at(m_lengthOffset + (m_bigEndian ? i : m_lengthBytes - 1 - i)));
+        value = (value << 8) | byte;
+    }
+    const qint64 payloadLength = qint64(value) + m_lengthAdjustment;
+    if (payloadLength < 0 || payloadLength > m_maxPayload)
+    {
+        skip = m_magic.isEmpty() ? buffer.size() : resync(buffer);   // 没有同步字时无法重新同步，丢弃所有数据
+        return Invalid;
+    }
+    if (buffer.size() < m_headerSize + payloadLength)
+    {
+        return NeedMore;
+    }
+    frame.length = m_headerSize + int(payloadLength);
+    frame.payloadOffset = m_headerSize;
+    frame.payloadLength = int(payloadLength);
+    return Ready;
+}
+
+/**
+ * @brief  从第2个字节开始查找同步字，没有找到时保留末尾可能是半个同步字的数据
+ */
+int FixedHeaderFramer::resync(const RingBuffer& buffer) const
+{
+    const int index = buffer.indexOf(m_magic, 1);
+    return index > 0 ? index : qMax(1, buffer.size() - m_magic.size() + 1);
+}
+
+int FixedHeaderFramer::header(char* dest, int payloadLength) const
+{
+    Q_ASSERT(m_headerSize <= MaxHeaderSize);
+    memset(dest, 0, size_t(m_headerSize));
+    memcpy(dest, m_magic.constData(), size_t(m_magic.size()));
+    const quint32 value = quint32(payloadLength - m_lengthAdjustment);
+    for (int i = 0; i < m_lengthBytes; ++i)
+    {
+        const int shift = 8 * (m_bigEndian ? m_lengthBytes - 1 - i : i);
+        dest[m_lengthOffset + i] = char((value >> shift) & 0xFF);
+    }
+    return m_headerSize;
+}
+
+DelimiterFramer::DelimiterFramer(const QByteArray& delimiter)
+    : m_delimiter(delimiter)
+{
+    Q_ASSERT(!delimiter.isEmpty());
+}
+
+Framer::Result DelimiterFramer::parse(const RingBuffer& buffer, FrameInfo& frame, int& skip)
+{
+    const int index = buffer.indexOf(m_delimiter, m_searched);
+    if (index < 0)
+    {
+        if (buffer.size() > m_maxPayload + m_delimiter.size())
+        {
+            skip = buffer.size();   // 一直没有分隔符，丢弃
+            return Invalid;
+        }
+        m_searched = qMax(0, buffer.size() - m_delimiter.size() + 1);   // 分隔符可能跨越两次接收
+        return NeedMore;
+    }
+    frame.length = index + m_delimiter.size();
+    frame.payloadOffset = 0;
+    frame.payloadLength = index;
+    return Ready;
+}
+
+int DelimiterFramer::header(char* dest, int payloadLength) const
+{
+    Q_UNUSED(dest)
+    Q_UNUSED(payloadLength)
+    return 0;
+}
+
+Framer::Result RawFramer::parse(const RingBuffer& buffer, FrameInfo& frame, int& skip)
+{
+    Q_UNUSED(skip)
+    if (buffer.size() == 0)
+    {
+        return NeedMore;
+    }
+    frame.length = buffer.size();
+    frame.payloadOffset = 0;
+    frame.payloadLength = buffer.size();
+    return Ready;
+}
+
+int RawFramer::header(char* dest, int payloadLength) const
+{
+    Q_UNUSED(dest)
+    Q_UNUSED(payloadLength)
+    return 0;
+}
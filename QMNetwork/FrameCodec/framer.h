@@ -0,0 +1,126 @@
+﻿/******************************************************************************
+ * @文件名     framer.h
+ * @功能       分帧规则：从接收缓冲区中识别一帧完整数据，以及生成发送时的帧头/帧尾
+ *
+ * @开发者     mhf
+ * @邮箱       1603291350@qq.com
+ * @时间       2025/04/05
+ * @备注       FixedHeaderFramer：固定长度帧头，帧头中某个位置保存数据长度（可带同步字）
+ *            LengthPrefixFramer：帧头只有长度字段（1/2/4字节）
+ *            DelimiterFramer：以分隔符结尾（如"\r\n"）
+ *            RawFramer：不分帧，每次收到的数据作为一帧（与直接readAll()相同）
+ *****************************************************************************/
+#ifndef FRAMER_H
+#define FRAMER_H
+
+#include <QByteArray>
+
+class RingBuffer;
+
+// 一帧在缓冲区中的位置（相对于缓冲区开头）
+struct FrameInfo
+{
+    int length = 0;          // 整帧长度（帧头 + 数据 + 帧尾），处理完后从缓冲区中丢弃
+    int payloadOffset = 0;   // 数据的起始位置
+    int payloadLength = 0;   // 数据长度
+};
+
+class Framer
+{
+public:
+    enum Result
+    {
+        NeedMore,   // 数据不足一帧
+        Ready,      // frame中为一帧完整数据
+        Invalid     // 开头的数据不是合法的帧，由FrameCodec丢弃skip个字节后重新查找
+    };
+
+    static const int MaxHeaderSize = 64;
+
+    virtual ~Framer() {}
+
+    virtual Result parse(const RingBuffer& buffer, FrameInfo& frame, int& skip) = 0;
+    virtual int header(char* dest, int payloadLength) const = 0;   // 发送时将帧头写入dest（MaxHeaderSize字节），返回帧头长度
+    virtual QByteArray trailer() const { return QByteArray(); }
+    virtual void reset() {}   // 丢弃一帧或清空缓冲区后调用
+
+    void setMaxPayload(int size) { m_maxPayload = size; }
+    int maxPayload() const { return m_maxPayload; }
+
+protected:
+    int m_maxPayload = 16 * 1024 * 1024;   // 超过该长度视为非法帧，避免错误的长度字段导致无限制地缓存数据
+};
+
+/**
+ * @brief 固定长度帧头：[同步字][...][长度字段][...] + 数据
+ */
+class FixedHeaderFramer : public Framer
+{
+public:
+    /**
+     * @param headerSize        帧头长度
+     * @param lengthOffset      长度字段在帧头中的位置
+     * @param lengthBytes       长度字段的字节数（1、2、4）
+     * @param bigEndian         长度字段是否为大端字节序
+     * @param lengthAdjustment  长度字段的值 + lengthAdjustment = 数据长度（例如长度字段包含帧头时为-headerSize）
+     * @param magic             帧头开头的同步字，为空表示没有；不匹配时直接查找下一个同步字
+     */
+    FixedHeaderFramer(int headerSize, int lengthOffset, int lengthBytes, bool bigEndian = true, int lengthAdjustment = 0,
+                      const QByteArray& magic = QByteArray());
+
+    Result parse(const RingBuffer& buffer, FrameInfo& frame, int& skip) override;
+    int header(char* dest, int payloadLength) const override;
+
+private:
+    int resync(const RingBuffer& buffer) const;   // 到下一个同步字之前需要丢弃的字节数
+
+private:
+    int m_headerSize;
+    int m_lengthOffset;
+    int m_lengthBytes;
+    bool m_bigEndian;
+    int m_lengthAdjustment;
+    QByteArray m_magic;
+};
+
+/**
+ * @brief 长度前缀：[长度] + 数据
+ */
+class LengthPrefixFramer : public FixedHeaderFramer
+{
+public:
+    explicit LengthPrefixFramer(int lengthBytes = 4, bool bigEndian = true)
+        : FixedHeaderFramer(lengthBytes, 0, lengthBytes, bigEndian)
+    {
+    }
+};
+
+/**
+ * @brief 分隔符：数据 + [分隔符]，交给使用者的数据不包含分隔符
+ */
+class DelimiterFramer : public Framer
+{
+public:
+    explicit DelimiterFramer(const QByteArray& delimiter = "\n");
+
+    Result parse(const RingBuffer& buffer, FrameInfo& frame, int& skip) override;
+    int header(char* dest, int payloadLength) const override;
+    QByteArray trailer() const override { return m_delimiter; }
+    void reset() override { m_searched = 0; }
+
+private:
+    QByteArray m_delimiter;
+    int m_searched = 0;   // 已经查找过的位置，数据分多次到达时不重复查找
+};
+
+/**
+ * @brief 不分帧：缓冲区中的所有数据作为一帧，发送时不添加帧头帧尾，用于没有固定格式的协议
+ */
+class RawFramer : public Framer
+{
+public:
+    Result parse(const RingBuffer& buffer, FrameInfo& frame, int& skip) override;
+    int header(char* dest, int payloadLength) const override;
+};
+
+#endif   // FRAMER_H
@@ -0,0 +1,162 @@
+﻿#include "ringbuffer.h"
+#include <QIODevice>
+#include <cstring>
+
+RingBuffer::RingBuffer(int capacity)
+{
+    int size = 64;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+    m_buffer.resize(size);
+    m_mask = size - 1;
+}
+
+void RingBuffer::clear()
+{
+    m_head = 0;
+    m_size = 0;
+}
+
+/**
+ * @brief       保证至少能再写入size个字节，容量不足时按2倍扩容并把数据整理到开头
+ */
+void RingBuffer::reserve(int size)
+{
+    if (m_size + size <= capacity())
+    {
+        return;
+    }
+    int newCapacity = capacity();
+    while (newCapacity < m_size + size)
+    {
+        newCapacity <<= 1;
+    }
+    QByteArray buffer(newCapacity, Qt::Uninitialized);
+    peek(buffer.data(), 0, m_size);
+    m_buffer = buffer;
+    m_mask = newCapacity - 1;
+    m_head = 0;
+}
+
+/**
+ * @brief          读取device中所有可读数据，直接写入缓冲区的空闲空间（最多两段），不产生临时QByteArray
+ * @param device
+ * @param maxSize  缓冲区最大字节数，达到后不再读取，剩余数据留在device中
+ * @return         读取的字节数，出错返回-1
+ */
+qint64 RingBuffer::readFrom(QIODevice* device, int maxSize)
+{
+    qint64 total = 0;
+    while (true)
+    {
+        const qint64 available = qMax<qint64>(device->bytesAvailable(), 1);   // 部分设备bytesAvailable不准确，至少尝试读取1个字节
+        const int want = int(qMin<qint64>(available, qint64(maxSize) - m_size));
+        if (want <= 0)
+        {
+            break;
+        }
+        reserve(want);
+        const int end = tail();
+        const int contiguousFree = qMin(capacity() - end, capacity() - m_size);
+        const qint64 ret = device->read(m_buffer.data() + end, qMin(want, contiguousFree));
+        if (ret < 0)
+        {
+            return total > 0 ? total : -1;
+        }
+        if (ret == 0)
+        {
+            break;
+        }
+        m_size += int(ret);
+        total += ret;
+    }
+    return total;
+}
+
+void RingBuffer::append(const char* data, int size)
+{
+    reserve(size);
+    const int end = tail();
+    const int first = qMin(size, capacity() - end);
+    memcpy(m_buffer.data() + end, data, size_t(first));
+    memcpy(m_buffer.data(), data + first, size_t(size - first));
+    m_size += size;
+}
+
+void RingBuffer::peek(char* dest, int offset, int size) const
+{
+    const int begin = (m_head + offset) & m_mask;
+    const int first = qMin(size, capacity() - begin);
+    memcpy(dest, m_buffer.constData() + begin, size_t(first));
+    memcpy(dest + first, m_buffer.constData(), size_t(size - first));
+}
+
+int RingBuffer::indexOf(const QByteArray& pattern, int from) const
+{
+    const int length = pattern.size();
+    if (length == 0)
+    {
+        return -1;
+    }
+    const char first = pattern.at(0);
+    int i = qMax(from, 0);
+    while (i + length <= m_size)
+    {
+        // 在当前连续的一段中用memchr查找第一个字节
+        const int begin = (m_head + i) & m_mask;
+        const int count = qMin(capacity() - begin, m_size - i);
+        const char* segment = m_buffer.constData() + begin;
+        const char* found = static_cast<const char*>(memchr(segment, first, size_t(count)));
+        if (!found)
+        {
+            i += count;
+            continue;
+        }
+        i += int(found - segment);
+        if (i + length > m_size)
+        {
+            break;
+        }
+        int j = 1;
+        while (j < length && at(i + j) == pattern.at(j))
+        {
+            ++j;
+        }
+        if (j == length)
+        {
+            return i;
+        }
+        ++i;
+    }
+    return -1;
+}
+
+/**
+ * @brief          返回[offset, offset + size)的连续数据，在缓冲区中本来就连续时直接返回内部指针（不复制）
+ * @param scratch  数据跨越缓冲区末尾时复制到这里
+ * @return         指针在下一次修改缓冲区之前有效
+ */
+const char* RingBuffer::contiguous(int offset, int size, QByteArray& scratch) const
+{
+    const int begin = (m_head + offset) & m_mask;
+    if (begin + size <= capacity())
+    {
+        return m_buffer.constData() + begin;
+    }
+    scratch.resize(size);
+    peek(scratch.data(), offset, size);
+    return scratch.constData();
+}
+
+void RingBuffer::skip(int size)
+{
+    size = qMin(size, m_size);
+    m_head = (m_head + size) & m_mask;
+    m_size -= size;
+    if (m_size == 0)
+    {
+        m_head = 0;   // 缓冲区为空时回到开头，下一帧尽量连续
+    }
+}
@@ -0,0 +1,47 @@
+﻿/******************************************************************************
+ * @文件名     ringbuffer.h
+ * @功能       可自动扩容的环形接收缓冲区，直接从QIODevice读取到缓冲区中，不为每次读取分配QByteArray
+ *
+ * @开发者     mhf
+ * @邮箱       1603291350@qq.com
+ * @时间       2025/04/05
+ * @备注       容量为2的幂；缓冲区为空时读写位置回到开头，因此一帧数据跨越缓冲区末尾的情况很少
+ *****************************************************************************/
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <QByteArray>
+
+class QIODevice;
+
+class RingBuffer
+{
+public:
+    explicit RingBuffer(int capacity = 4096);
+
+    int size() const { return m_size; }
+    int capacity() const { return m_buffer.size(); }
+    bool isEmpty() const { return m_size == 0; }
+    void clear();
+
+    qint64 readFrom(QIODevice* device, int maxSize);   // 读取device中所有可读数据，缓冲区最多增长到maxSize，返回读取的字节数，出错返回-1
+    void append(const char* data, int size);
+
+    char at(int offset) const { return m_buffer.constData()[(m_head + offset) & m_mask]; }
+    void peek(char* dest, int offset, int size) const;                   // 复制一段数据（用于读取帧头）
+    int indexOf(const QByteArray& pattern, int from = 0) const;           // 查找分隔符，没有找到返回-1
+    const char* contiguous(int offset, int size, QByteArray& scratch) const;   // 返回一段连续数据的指针，跨越末尾时才复制到scratch
+    void skip(int size);                                                  // 丢弃开头的size个字节
+
+private:
+    void reserve(int size);
+    int tail() const { return (m_head + m_size) & m_mask; }
+
+private:
+    QByteArray m_buffer;
+    int m_mask = 0;
+    int m_head = 0;   // 第一个字节的位置
+    int m_size = 0;
+};
+
+#endif   // RINGBUFFER_H
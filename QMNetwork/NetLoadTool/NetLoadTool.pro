@@ -0,0 +1,59 @@
+#---------------------------------------------------------------------------------------
+# @功能：       TCP/UDP网络压力测试工具（命令行）
+# @编译器：     Desktop Qt 5.12.5 MSVC2017 64bit（也支持其它编译器）
+# @Qt IDE：    D:/Qt/Qt5.12.5/Tools/QtCreator/share/qtcreator
+#
+# @开发者     mhf
+# @邮箱       1603291350@qq.com
+# @时间       2025-04-12 15:30:00
+# @备注       1、建立N个TCP连接或UDP流，按指定速率（或收到回显后立即发送）和大小发送消息；
+#            2、统计吞吐量、往返延时分布（p50/p99/p99.9...）、丢包和乱序，结果以json输出；
+#            3、-e在本进程中启动回显服务端（TCP使用NetWidget中的多线程TcpServerEngine），可以在一台电脑上通过回环地址测试。
+#            需要使用Release模式编译运行。
+#---------------------------------------------------------------------------------------
+QT -= gui
+QT += network
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+    latencyhistogram.cpp \
+    loadgenerator.cpp \
+    main.cpp \
+    udpechoserver.cpp
+
+HEADERS += \
+    latencyhistogram.h \
+    loadgenerator.h \
+    udpechoserver.h
+
+include($$PWD/../FrameCodec/FrameCodec.pri)   # TCP接收时按消息头分帧
+INCLUDEPATH += $$PWD/../FrameCodec
+
+# 本地回显服务端使用NetWidget中的多线程TCP服务端
+HEADERS += $$PWD/../NetWidget/tcpserverengine.h
+SOURCES += $$PWD/../NetWidget/tcpserverengine.cpp
+INCLUDEPATH += $$PWD/../NetWidget
+win32: LIBS += -lws2_32                            # TcpServerEngine接管连接失败时用closesocket关闭
+
+#  定义程序版本号
+VERSION = 1.0.0
+DEFINES += APP_VERSION=\\\"$$VERSION\\\"
+
+contains(QT_ARCH, i386){        # 使用32位编译器
+DESTDIR = $$PWD/../../bin       # 程序输出路径
+}else{
+DESTDIR = $$PWD/../../bin64     # 使用64位编译器
+}
+
+# msvc >= 2017  编译器使用utf-8编码
+msvc {
+    greaterThan(QMAKE_MSC_VER, 1900){       # msvc编译器版本大于2015
+        QMAKE_CFLAGS += /utf-8
+        QMAKE_CXXFLAGS += /utf-8
+    }else{
+    # msvc2015及以下版本在代码中使用【pragma execution_character_set("utf-8")】指定编码
+    }
+}
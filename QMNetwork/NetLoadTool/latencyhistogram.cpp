@@ -0,0 +1,171 @@
+﻿#include "latencyhistogram.h"
+#include <QtMath>
+
+static const int SubBucketHalfCountMagnitude = 10;                          // 2 * 10^3 向上取2的幂为2048，保留3位有效数字
+static const int SubBucketHalfCount = 1 << SubBucketHalfCountMagnitude;    // 1024
+static const qint64 SubBucketMask = (qint64(SubBucketHalfCount) << 1) - 1;   // 2047
+
+/**
+ * @brief 最高位的位置（value > 0）
+ */
+static int highestBit(quint64 value)
+{
+    int bit = 0;
+    while (value >>= 1)
+    {
+        ++bit;
+    }
+    return bit;
+}
+
+/**
+ * @brief 值所在的2的幂区间，小于2048的值都在第0个区间
+ */
+static int bucketIndexOf(qint64 value)
+{
+    return highestBit(quint64(value | SubBucketMask)) - SubBucketHalfCountMagnitude;
+}
+
+LatencyHistogram::LatencyHistogram(qint64 highestTrackableValue)
+    : m_highestTrackableValue(qMax<qint64>(highestTrackableValue, SubBucketMask))
+{
+    const int bucketCount = bucketIndexOf(m_highestTrackableValue) + 1;
+    m_counts.fill(0, (bucketCount + 1) * SubBucketHalfCount);
+}
+
+int LatencyHistogram::countsIndex(qint64 value) const
+{
+    const int bucketIndex = bucketIndexOf(value);
+    const int subBucketIndex = int(value >> bucketIndex);   // 1024 ~ 2047（第0个区间为0 ~ 2047）
+    return (bucketIndex << SubBucketHalfCountMagnitude) + subBucketIndex;
+}
+
+qint64 LatencyHistogram::valueFromIndex(int index) const
+{
+    int bucketIndex = (index >> SubBucketHalfCountMagnitude) - 1;
+    int subBucketIndex = (index & (SubBucketHalfCount - 1)) + SubBucketHalfCount;
+    if (bucketIndex < 0)
+    {
+        subBucketIndex -= SubBucketHalfCount;
+        bucketIndex = 0;
+    }
+    return qint64(subBucketIndex) << bucketIndex;
+}
+
+/**
+ * @brief 桶中能表示的最大值（同一个桶中的值视为相等）
+ */
+qint64 LatencyHistogram::highestEquivalentValue(int index) const
+{
+    const qint64 value = valueFromIndex(index);
+    return value + (qint64(1) << bucketIndexOf(value)) - 1;
+}
+
+void LatencyHistogram::record(qint64 value)
+{
+    value = qBound<qint64>(0, value, m_highestTrackableValue);
+    m_counts[countsIndex(value)]++;
+    if (m_count == 0 || value < m_min)
+    {
+        m_min = value;
+    }
+    m_max = qMax(m_max, value);
+    ++m_count;
+}
+
+void LatencyHistogram::add(const LatencyHistogram& other)
+{
+    Q_ASSERT(other.m_counts.size() == m_counts.size());
+    if (other.m_count == 0)
+    {
+        return;
+    }
+    for (int i = 0; i < m_counts.size(); ++i)
+    {
+        m_counts[i] += other.m_counts.at(i);
+    }
+    m_min = m_count == 0 ? other.m_min : qMin(m_min, other.m_min);
+    m_max = qMax(m_max, other.m_max);
+    m_count += other.m_count;
+}
+
+void LatencyHistogram::reset()
+{
+    m_counts.fill(0);
+    m_count = 0;
+    m_min = 0;
+    m_max = 0;
+}
+
+double LatencyHistogram::mean() const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+    double total = 0;
+    for (int i = 0; i < m_counts.size(); ++i)
+    {
+        if (m_counts.at(i) > 0)
+        {
+            const double middle = (valueFromIndex(i) + highestEquivalentValue(i)) / 2.0;
+            total += middle * double(m_counts.at(i));
+        }
+    }
+    return total / double(m_count);
+}
+
+double LatencyHistogram::stddev() const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+    const double average = mean();
+    double total = 0;
+    for (int i = 0; i < m_counts.size(); ++i)
+    {
+        if (m_counts.at(i) > 0)
+        {
+            const double deviation = (valueFromIndex(i) + highestEquivalentValue(i)) / 2.0 - average;
+            total += deviation * deviation * double(m_counts.at(i));
+        }
+    }
+    return qSqrt(total / double(m_count));
+}
+
+/**
+ * @brief             返回不小于percentile%记录值的最小值（桶内最大值，不超过记录的最大值）
+ */
+qint64 LatencyHistogram::valueAtPercentile(double percentile) const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+    percentile = qBound(0.0, percentile, 100.0);
+    const qint64 target = qMax<qint64>(qCeil(percentile / 100.0 * double(m_count)), 1);
+    qint64 total = 0;
+    for (int i = 0; i < m_counts.size(); ++i)
+    {
+        total += m_counts.at(i);
+        if (total >= target)
+        {
+            return qMin(highestEquivalentValue(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+QVector<QPair<qint64, qint64>> LatencyHistogram::buckets() const
+{
+    QVector<QPair<qint64, qint64>> buckets;
+    for (int i = 0; i < m_counts.size(); ++i)
+    {
+        if (m_counts.at(i) > 0)
+        {
+            buckets.append(qMakePair(highestEquivalentValue(i), m_counts.at(i)));
+        }
+    }
+    return buckets;
+}
@@ -0,0 +1,48 @@
+﻿/******************************************************************************
+ * @文件名     latencyhistogram.h
+ * @功能       记录延时分布的直方图，按HdrHistogram的方式分桶，可以精确地计算p99、p99.9等百分位
+ *
+ * @开发者     mhf
+ * @邮箱       1603291350@qq.com
+ * @时间       2025/04/12
+ * @备注       值的单位为纳秒，保留3位有效数字（相对误差 < 0.1%）；
+ *            每2的幂区间分成1024个桶，记录和合并都是O(1)/O(桶数)，每个线程各用一个，结束后合并，不需要加锁
+ *****************************************************************************/
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QPair>
+#include <QVector>
+
+class LatencyHistogram
+{
+public:
+    explicit LatencyHistogram(qint64 highestTrackableValue = 60LL * 1000 * 1000 * 1000);   // 默认最大60秒
+
+    void record(qint64 value);                 // 小于0按0记录，超过最大值按最大值记录
+    void add(const LatencyHistogram& other);   // 合并另一个直方图（最大值必须相同）
+    void reset();
+
+    qint64 count() const { return m_count; }
+    qint64 min() const { return m_count > 0 ? m_min : 0; }
+    qint64 max() const { return m_max; }
+    double mean() const;
+    double stddev() const;
+    qint64 valueAtPercentile(double percentile) const;   // percentile：0 ~ 100
+
+    QVector<QPair<qint64, qint64>> buckets() const;      // 所有非空的桶：<桶内最大值, 数量>
+
+private:
+    int countsIndex(qint64 value) const;
+    qint64 valueFromIndex(int index) const;
+    qint64 highestEquivalentValue(int index) const;
+
+private:
+    qint64 m_highestTrackableValue;
+    QVector<qint64> m_counts;
+    qint64 m_count = 0;
+    qint64 m_min = 0;
+    qint64 m_max = 0;
+};
+
+#endif   // LATENCYHISTOGRAM_H
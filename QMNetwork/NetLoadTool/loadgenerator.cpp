@@ -0,0 +1,595 @@
+﻿#include "loadgenerator.h"
+#include "framecodec.h"
+#include "latencyhistogram.h"
+#include <QJsonArray>
+#include <QScopedPointer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+#include <QUdpSocket>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+static const qint64 NsPerSecond = 1000 * 1000 * 1000;
+static const int MaxBurst = 1000;                   // 每次定时器触发时每个连接最多发送的消息数
+static const qint64 MaxPendingBytes = 4 * 1024 * 1024;   // TCP发送缓冲区中未写出的数据超过该值时暂停发送
+
+/**
+ * @brief 所有线程共用的单调时钟（纳秒）
+ */
+static qint64 nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 消息格式：["QL"][2字节保留][4字节长度（大端）] + [流id][序号][发送时间] + 填充
+ *        TCP接收时按帧头中的长度分帧，同步字不匹配时直接跳到下一个同步字处重新同步
+ */
+static Framer* createFramer(int size)
+{
+    Framer* framer = new FixedHeaderFramer(8, 4, 4, true, 0, QByteArray("QL"));
+    framer->setMaxPayload(size - 8);
+    return framer;
+}
+
+struct LoadCounters
+{
+    quint64 sent = 0;            // 统计时间内发送的消息数
+    quint64 sentBytes = 0;
+    quint64 received = 0;        // 统计时间内发送并收到回显的消息数
+    quint64 receivedBytes = 0;
+    quint64 reordered = 0;       // 序号小于已收到的最大序号
+    quint64 invalid = 0;         // 无法识别的数据（不是本工具发出的消息）
+    quint64 sendErrors = 0;      // 发送失败（UDP系统缓冲区满等）
+    quint64 errors = 0;          // socket错误次数
+    int connected = 0;
+    int failed = 0;              // 连接失败或统计期间断开的连接数
+};
+
+/**
+ * @brief 工作线程中的对象，负责分配给该线程的所有连接；除进度计数外只在所属线程中访问
+ */
+class LoadWorker : public QObject
+{
+public:
+    explicit LoadWorker(const LoadConfig& config)
+        : m_config(config)
+    {
+    }
+    ~LoadWorker() override { finish(); }
+
+    void addFlow(quint32 id) { m_ids.append(id); }   // start之前调用
+    void start(qint64 startNs);
+    void finish();   // 断开所有连接
+
+    LoadCounters counters;
+    LatencyHistogram rtt;         // 往返延时
+    LatencyHistogram sendDelay;   // 实际发送时间 - 计划发送时间（只有指定速率时统计）
+    QString lastError;
+
+    std::atomic<quint64> totalSent{0};       // 包括预热和等待回显阶段，用于显示进度
+    std::atomic<quint64> totalReceived{0};
+
+private:
+    struct Flow
+    {
+        quint32 id = 0;
+        QAbstractSocket* socket = nullptr;
+        FrameCodec* codec = nullptr;   // 只有TCP使用
+        QByteArray message;            // 预先生成的消息，发送时只修改序号和发送时间
+        bool connected = false;
+        bool failed = false;
+        qint64 startNs = 0;            // 第0条消息的计划发送时间
+        quint64 seq = 0;               // 下一条消息的序号
+        quint64 nextExpected = 0;      // 期望收到的下一个序号
+        quint64 inflight = 0;          // 闭环模式下未收到回显的消息数
+        qint64 lastProgressNs = 0;     // 最后一次收到回显的时间
+    };
+
+    bool isMeasured(qint64 time) const { return time >= m_measureStartNs && time < m_measureEndNs; }
+    void on_timeout();
+    void on_connected(Flow* flow);
+    void on_disconnected(Flow* flow);
+    void on_error(Flow* flow);
+    void on_udpReadyRead(Flow* flow);
+    void on_message(Flow* flow, const char* payload, int size);
+    void sendMessages(Flow* flow);
+    bool sendOne(Flow* flow, qint64 scheduledNs);
+
+private:
+    LoadConfig m_config;
+    QVector<quint32> m_ids;
+    QVector<Flow*> m_flows;
+    QTimer* m_timer = nullptr;
+    QByteArray m_buffer;   // UDP接收缓冲区
+    qint64 m_startNs = 0;
+    qint64 m_measureStartNs = 0;
+    qint64 m_measureEndNs = 0;
+    bool m_sending = false;
+};
+
+/**
+ * @brief 在工作线程中创建socket并开始连接
+ */
+void LoadWorker::start(qint64 startNs)
+{
+    m_startNs = startNs;
+    m_measureStartNs = startNs + qint64(m_config.warmup * NsPerSecond);
+    m_measureEndNs = m_measureStartNs + qint64(m_config.duration * NsPerSecond);
+    m_sending = true;
+    m_buffer.resize(65536);
+
+    QScopedPointer<Framer> framer(createFramer(m_config.size));
+    for (quint32 id : qAsConst(m_ids))
+    {
+        Flow* flow = new Flow();
+        flow->id = id;
+        flow->message = QByteArray(m_config.size, '\0');
+        framer->header(flow->message.data(), m_config.size - 8);
+        memcpy(flow->message.data() + 8, &id, sizeof(id));
+
+        if (m_config.protocol == LoadConfig::Tcp)
+        {
+            QTcpSocket* socket = new QTcpSocket(this);
+            socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);   // 关闭Nagle算法，否则小消息的延时被放大
+            flow->codec = new FrameCodec(createFramer(m_config.size), this);
+            flow->codec->attach(socket);
+            flow->codec->setFrameHandler([this, flow](const FrameView& frame) { on_message(flow, frame.data, frame.size); });
+            connect(flow->codec, &FrameCodec::errorOccurred, this, [this]() { counters.invalid++; });
+            flow->socket = socket;
+        }
+        else
+        {
+            QUdpSocket* socket = new QUdpSocket(this);
+            connect(socket, &QUdpSocket::readyRead, this, [this, flow]() { on_udpReadyRead(flow); });
+            flow->socket = socket;
+        }
+        if (m_config.socketBufferSize > 0)
+        {
+            flow->socket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, m_config.socketBufferSize);
+            flow->socket->setSocketOption(QAbstractSocket::SendBufferSizeSocketOption, m_config.socketBufferSize);
+        }
+        connect(flow->socket, &QAbstractSocket::connected, this, [this, flow]() { on_connected(flow); });
+        connect(flow->socket, &QAbstractSocket::disconnected, this, [this, flow]() { on_disconnected(flow); });
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+        connect(flow->socket, &QAbstractSocket::errorOccurred, this, [this, flow]() { on_error(flow); });
+#else
+        connect(flow->socket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::error), this, [this, flow]() { on_error(flow); });
+#endif
+        m_flows.append(flow);
+        flow->socket->connectToHost(m_config.host, m_config.port);   // UDP只是设置默认的目标地址
+    }
+
+    m_timer = new QTimer(this);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    m_timer->setInterval(m_config.rate > 0 ? 1 : 10);
+    connect(m_timer, &QTimer::timeout, this, &LoadWorker::on_timeout);
+    m_timer->start();
+}
+
+void LoadWorker::finish()
+{
+    m_sending = false;
+    if (m_timer)
+    {
+        m_timer->stop();
+    }
+    for (Flow* flow : qAsConst(m_flows))
+    {
+        flow->socket->disconnect(this);
+        if (flow->codec)
+        {
+            flow->codec->detach();
+            delete flow->codec;
+        }
+        flow->socket->abort();
+        delete flow->socket;
+    }
+    qDeleteAll(m_flows);
+    m_flows.clear();
+}
+
+void LoadWorker::on_timeout()
+{
+    if (m_sending && nowNs() >= m_measureEndNs)
+    {
+        m_sending = false;   // 统计时间结束，之后只接收回显
+        m_timer->stop();
+        return;
+    }
+    for (Flow* flow : qAsConst(m_flows))
+    {
+        sendMessages(flow);
+    }
+}
+
+void LoadWorker::on_connected(Flow* flow)
+{
+    flow->connected = true;
+    counters.connected++;
+    const qint64 now = nowNs();
+    flow->lastProgressNs = now;
+    if (m_config.rate > 0)
+    {
+        // 各连接的发送时间错开，避免所有连接在同一时刻发送
+        const double interval = NsPerSecond / m_config.rate;
+        flow->startNs = qMax(now, m_startNs) + qint64(interval * flow->id / m_config.connections);
+    }
+    sendMessages(flow);
+}
+
+void LoadWorker::on_disconnected(Flow* flow)
+{
+    if (flow->connected && m_sending && !flow->failed)
+    {
+        flow->failed = true;   // 统计期间被服务端断开
+        counters.failed++;
+    }
+    flow->connected = false;
+}
+
+void LoadWorker::on_error(Flow* flow)
+{
+    counters.errors++;
+    lastError = flow->socket->errorString();
+    if (m_config.protocol == LoadConfig::Tcp && !flow->connected && !flow->failed)
+    {
+        flow->failed = true;   // 连接失败
+        counters.failed++;
+    }
+}
+
+void LoadWorker::on_udpReadyRead(Flow* flow)
+{
+    QUdpSocket* socket = static_cast<QUdpSocket*>(flow->socket);
+    while (socket->hasPendingDatagrams())
+    {
+        const qint64 size = socket->readDatagram(m_buffer.data(), m_buffer.size());
+        if (size < LoadConfig::HeaderSize || m_buffer.at(0) != 'Q' || m_buffer.at(1) != 'L')
+        {
+            if (size >= 0)
+            {
+                counters.invalid++;
+            }
+            continue;
+        }
+        on_message(flow, m_buffer.constData() + 8, int(size) - 8);
+    }
+}
+
+/**
+ * @brief          收到一条回显的消息
+ * @param payload  不包含8字节的帧头
+ */
+void LoadWorker::on_message(Flow* flow, const char* payload, int size)
+{
+    const qint64 now = nowNs();
+    if (size < LoadConfig::HeaderSize - 8)
+    {
+        counters.invalid++;
+        return;
+    }
+    quint32 id = 0;
+    quint64 seq = 0;
+    qint64 sentNs = 0;
+    memcpy(&id, payload, sizeof(id));
+    memcpy(&seq, payload + 4, sizeof(seq));
+    memcpy(&sentNs, payload + 12, sizeof(sentNs));
+    if (id != flow->id)
+    {
+        counters.invalid++;
+        return;
+    }
+    totalReceived.fetch_add(1, std::memory_order_relaxed);
+
+    const bool measured = isMeasured(sentNs);
+    if (seq < flow->nextExpected)
+    {
+        if (measured)
+        {
+            counters.reordered++;
+        }
+    }
+    else
+    {
+        flow->nextExpected = seq + 1;
+    }
+    if (measured)
+    {
+        counters.received++;
+        counters.receivedBytes += quint64(size + 8);
+        rtt.record(now - sentNs);
+    }
+    if (flow->inflight > 0)
+    {
+        flow->inflight--;
+    }
+    flow->lastProgressNs = now;
+    if (m_config.rate <= 0)
+    {
+        sendMessages(flow);   // 闭环模式：收到回显后立即补充
+    }
+}
+
+void LoadWorker::sendMessages(Flow* flow)
+{
+    if (!flow->connected || !m_sending)
+    {
+        return;
+    }
+    const qint64 now = nowNs();
+    if (m_config.rate > 0)
+    {
+        if (now < flow->startNs)
+        {
+            return;
+        }
+        const quint64 due = quint64(double(now - flow->startNs) * m_config.rate / NsPerSecond) + 1;   // 到现在为止应该发送的消息数
+        for (int i = 0; i < MaxBurst && flow->seq < due; ++i)
+        {
+            if (flow->codec && flow->socket->bytesToWrite() > MaxPendingBytes)
+            {
+                break;   // 发送不过来时不再堆积，落后的时间会体现在sendDelay中
+            }
+            sendOne(flow, flow->startNs + qint64(double(flow->seq) * NsPerSecond / m_config.rate));
+        }
+    }
+    else
+    {
+        if (!flow->codec && flow->inflight >= quint64(m_config.window) && now - flow->lastProgressNs > NsPerSecond / 5)
+        {
+            flow->inflight = 0;   // UDP回显丢失，超过200ms没有收到时重新发送，避免一直等待
+            flow->lastProgressNs = now;
+        }
+        for (int i = 0; i < MaxBurst && flow->inflight < quint64(m_config.window); ++i)
+        {
+            if (!sendOne(flow, 0))
+            {
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief              在预先生成的消息中写入序号和发送时间后发送
+ * @param scheduledNs  计划发送时间，0表示闭环模式
+ */
+bool LoadWorker::sendOne(Flow* flow, qint64 scheduledNs)
+{
+    const qint64 now = nowNs();
+    char* data = flow->message.data();
+    memcpy(data + 12, &flow->seq, sizeof(flow->seq));
+    memcpy(data + 20, &now, sizeof(now));
+    flow->seq++;
+
+    const qint64 ret = flow->socket->write(data, m_config.size);
+    if (ret != m_config.size)
+    {
+        counters.sendErrors++;
+        return false;
+    }
+    totalSent.fetch_add(1, std::memory_order_relaxed);
+    flow->inflight++;
+    if (isMeasured(now))
+    {
+        counters.sent++;
+        counters.sentBytes += quint64(m_config.size);
+        if (scheduledNs > 0)
+        {
+            sendDelay.record(now - scheduledNs);
+        }
+    }
+    return true;
+}
+
+LoadGenerator::LoadGenerator(const LoadConfig& config, QObject* parent)
+    : QObject(parent)
+    , m_config(config)
+{
+    m_progressTimer = new QTimer(this);
+    m_progressTimer->setInterval(1000);
+    connect(m_progressTimer, &QTimer::timeout, this, &LoadGenerator::on_progress);
+}
+
+LoadGenerator::~LoadGenerator()
+{
+    for (int i = 0; i < m_workers.count(); i++)
+    {
+        m_threads.at(i)->quit();
+        m_threads.at(i)->wait();
+        delete m_workers.at(i);
+        delete m_threads.at(i);
+    }
+}
+
+/**
+ * @brief 创建工作线程，连接按id % 线程数分配，统计时间 + 等待回显的时间结束后汇总结果
+ */
+void LoadGenerator::start()
+{
+    int threads = m_config.threads < 1 ? QThread::idealThreadCount() : m_config.threads;
+    threads = qBound(1, threads, m_config.connections);
+    m_config.threads = threads;
+    for (int i = 0; i < threads; ++i)
+    {
+        QThread* thread = new QThread();
+        thread->setObjectName(QString("LoadWorker%1").arg(i));
+        LoadWorker* worker = new LoadWorker(m_config);
+        m_threads.append(thread);
+        m_workers.append(worker);
+    }
+    for (int id = 0; id < m_config.connections; ++id)
+    {
+        m_workers.at(id % threads)->addFlow(quint32(id));
+    }
+
+    m_startNs = nowNs();
+    for (int i = 0; i < threads; ++i)
+    {
+        LoadWorker* worker = m_workers.at(i);
+        worker->moveToThread(m_threads.at(i));
+        m_threads.at(i)->start();
+        const qint64 startNs = m_startNs;
+        QMetaObject::invokeMethod(
+            worker, [worker, startNs]() { worker->start(startNs); }, Qt::QueuedConnection);
+    }
+    m_progressTimer->start();
+    QTimer::singleShot(int((m_config.warmup + m_config.duration) * 1000) + m_config.drain, this, &LoadGenerator::collect);
+}
+
+void LoadGenerator::on_progress()
+{
+    quint64 sent = 0;
+    quint64 received = 0;
+    for (LoadWorker* worker : qAsConst(m_workers))
+    {
+        sent += worker->totalSent.load(std::memory_order_relaxed);
+        received += worker->totalReceived.load(std::memory_order_relaxed);
+    }
+    const double elapsed = double(nowNs() - m_startNs) / NsPerSecond;
+    QString phase = "统计";
+    if (elapsed < m_config.warmup)
+    {
+        phase = "预热";
+    }
+    else if (elapsed >= m_config.warmup + m_config.duration)
+    {
+        phase = "等待回显";
+    }
+    emit progress(QString("%1s [%2] 发送 %3 条/秒  接收 %4 条/秒")
+                      .arg(elapsed, 0, 'f', 0)
+                      .arg(phase)
+                      .arg(sent - m_lastSent)
+                      .arg(received - m_lastReceived));
+    m_lastSent = sent;
+    m_lastReceived = received;
+}
+
+/**
+ * @brief 直方图转换为json，单位为微秒
+ */
+static QJsonObject histogramToJson(const LatencyHistogram& histogram, bool buckets)
+{
+    QJsonObject object;
+    object["count"] = double(histogram.count());
+    object["min"] = histogram.min() / 1000.0;
+    object["mean"] = histogram.mean() / 1000.0;
+    object["stddev"] = histogram.stddev() / 1000.0;
+    object["max"] = histogram.max() / 1000.0;
+    QJsonObject percentiles;
+    for (double percentile : {50.0, 90.0, 99.0, 99.9, 99.99})
+    {
+        percentiles[QString::number(percentile)] = histogram.valueAtPercentile(percentile) / 1000.0;
+    }
+    object["percentiles"] = percentiles;
+    if (buckets)
+    {
+        QJsonArray array;   // [桶内最大值, 数量]
+        const QVector<QPair<qint64, qint64>> items = histogram.buckets();
+        for (const auto& item : items)
+        {
+            array.append(QJsonArray{item.first / 1000.0, double(item.second)});
+        }
+        object["buckets"] = array;
+    }
+    return object;
+}
+
+static QJsonObject rateToJson(quint64 messages, quint64 bytes, double seconds)
+{
+    QJsonObject object;
+    object["messages"] = double(messages);
+    object["bytes"] = double(bytes);
+    object["messagesPerSecond"] = double(messages) / seconds;
+    object["megabitsPerSecond"] = double(bytes) * 8 / seconds / 1000000.0;
+    return object;
+}
+
+/**
+ * @brief 断开所有连接，退出工作线程，合并各线程的统计结果
+ */
+void LoadGenerator::collect()
+{
+    m_progressTimer->stop();
+    LoadCounters total;
+    LatencyHistogram rtt;
+    LatencyHistogram sendDelay;
+    QString lastError;
+    for (int i = 0; i < m_workers.count(); i++)
+    {
+        LoadWorker* worker = m_workers.at(i);
+        QMetaObject::invokeMethod(
+            worker, [worker]() { worker->finish(); }, Qt::BlockingQueuedConnection);
+        m_threads.at(i)->quit();
+        m_threads.at(i)->wait();
+
+        const LoadCounters& counters = worker->counters;
+        total.sent += counters.sent;
+        total.sentBytes += counters.sentBytes;
+        total.received += counters.received;
+        total.receivedBytes += counters.receivedBytes;
+        total.reordered += counters.reordered;
+        total.invalid += counters.invalid;
+        total.sendErrors += counters.sendErrors;
+        total.errors += counters.errors;
+        total.connected += counters.connected;
+        total.failed += counters.failed;
+        rtt.add(worker->rtt);
+        sendDelay.add(worker->sendDelay);
+        if (!worker->lastError.isEmpty())
+        {
+            lastError = worker->lastError;
+        }
+        delete worker;
+        delete m_threads.at(i);
+    }
+    m_workers.clear();
+    m_threads.clear();
+
+    QJsonObject config;
+    config["protocol"] = m_config.protocol == LoadConfig::Tcp ? "tcp" : "udp";
+    config["host"] = m_config.host;
+    config["port"] = m_config.port;
+    config["connections"] = m_config.connections;
+    config["threads"] = m_config.threads;
+    config["rate"] = m_config.rate;
+    config["window"] = m_config.window;
+    config["size"] = m_config.size;
+    config["warmup"] = m_config.warmup;
+    config["duration"] = m_config.duration;
+    config["drain"] = m_config.drain;
+
+    QJsonObject connections;
+    connections["requested"] = m_config.connections;
+    connections["connected"] = total.connected;
+    connections["failed"] = total.failed;
+
+    const quint64 lost = total.sent > total.received ? total.sent - total.received : 0;
+    QJsonObject loss;
+    loss["messages"] = double(lost);   // TCP下为等待时间结束仍没有收到回显的消息
+    loss["ratio"] = total.sent > 0 ? double(lost) / double(total.sent) : 0.0;
+
+    m_result = QJsonObject();
+    m_result["config"] = config;
+    m_result["connections"] = connections;
+    m_result["sent"] = rateToJson(total.sent, total.sentBytes, m_config.duration);
+    m_result["received"] = rateToJson(total.received, total.receivedBytes, m_config.duration);
+    m_result["loss"] = loss;
+    m_result["reordered"] = double(total.reordered);
+    m_result["invalid"] = double(total.invalid);
+    m_result["sendErrors"] = double(total.sendErrors);
+    m_result["socketErrors"] = double(total.errors);
+    if (!lastError.isEmpty())
+    {
+        m_result["lastError"] = lastError;
+    }
+    m_result["rttUs"] = histogramToJson(rtt, m_config.histogram);
+    if (m_config.rate > 0)
+    {
+        m_result["sendDelayUs"] = histogramToJson(sendDelay, m_config.histogram);
+    }
+    emit finished();
+}
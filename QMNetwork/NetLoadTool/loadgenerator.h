@@ -0,0 +1,77 @@
+﻿/******************************************************************************
+ * @文件名     loadgenerator.h
+ * @功能       TCP/UDP压力测试：建立N个连接（UDP为N个流），按指定速率和大小发送数据，
+ *            统计吞吐量、往返延时分布、丢包和乱序
+ *
+ * @开发者     mhf
+ * @邮箱       1603291350@qq.com
+ * @时间       2025/04/12
+ * @备注       每条消息带有流id、序号和发送时间，需要服务端原样回显才能统计延时和丢包；
+ *            连接按id % 线程数分配给工作线程，每个线程有自己的事件循环和直方图，结束后再合并
+ *****************************************************************************/
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include <QJsonObject>
+#include <QObject>
+#include <QVector>
+
+class QThread;
+class QTimer;
+class LoadWorker;
+
+struct LoadConfig
+{
+    enum Protocol
+    {
+        Tcp,
+        Udp
+    };
+
+    Protocol protocol = Tcp;
+    QString host = "127.0.0.1";
+    quint16 port = 6666;
+    int connections = 1;        // TCP连接数 / UDP流数
+    int threads = 0;            // 工作线程数，小于1时使用CPU核心数（不超过连接数）
+    double rate = 1000;         // 每个连接每秒发送的消息数，0表示闭环模式：收到回显后再发送
+    int window = 1;             // 闭环模式下每个连接最多未收到回显的消息数
+    int size = 64;              // 每条消息的字节数（包括消息头）
+    double warmup = 1;          // 预热时间（秒），这段时间发送的消息不统计
+    double duration = 10;       // 统计时间（秒）
+    int drain = 1000;           // 停止发送后等待回显的时间（毫秒）
+    int socketBufferSize = 0;   // 系统socket缓冲区大小，0表示使用系统默认值
+    bool histogram = false;     // 结果中是否包含完整的延时直方图
+
+    static const int HeaderSize = 28;   // 帧头8字节 + 流id 4字节 + 序号8字节 + 发送时间8字节
+};
+
+class LoadGenerator : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LoadGenerator(const LoadConfig& config, QObject* parent = nullptr);
+    ~LoadGenerator() override;
+
+    void start();
+    QJsonObject result() const { return m_result; }   // finished之后有效
+
+signals:
+    void progress(const QString& text);   // 每秒一次：当前的发送、接收速率
+    void finished();
+
+private:
+    void on_progress();
+    void collect();
+
+private:
+    LoadConfig m_config;
+    QVector<QThread*> m_threads;
+    QVector<LoadWorker*> m_workers;
+    QTimer* m_progressTimer = nullptr;
+    quint64 m_lastSent = 0;
+    quint64 m_lastReceived = 0;
+    qint64 m_startNs = 0;
+    QJsonObject m_result;
+};
+
+#endif   // LOADGENERATOR_H
@@ -0,0 +1,143 @@
+﻿/**
+ * 网络压力测试工具：建立N个TCP连接或UDP流，按指定速率和大小发送消息，统计吞吐量、往返延时分布、丢包和乱序，结果以json输出。
+ *
+ * 用法：NetLoadTool [-u] [-a 127.0.0.1] [-p 6666] [-c 连接数] [-r 每个连接每秒消息数] [-s 消息大小] [-d 秒] [-e] [-o result.json]
+ * 服务端需要原样回显收到的数据（例如QMNetwork中TcpServer勾选【回显接收的数据】），-e在本进程中启动一个回显服务端。
+ */
+#include "loadgenerator.h"
+#include "tcpserverengine.h"
+#include "udpechoserver.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <cstdio>
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("NetLoadTool");
+    QCoreApplication::setApplicationVersion(APP_VERSION);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("TCP/UDP load generator: throughput, RTT histogram, loss and reordering against an echo server");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption udpOption({"u", "udp"}, "Use UDP flows instead of TCP connections");
+    QCommandLineOption hostOption({"a", "host"}, "Server address", "host", "127.0.0.1");
+    QCommandLineOption portOption({"p", "port"}, "Server port", "port", "6666");
+    QCommandLineOption connectionsOption({"c", "connections"}, "TCP connections / UDP flows", "count", "1");
+    QCommandLineOption threadsOption({"t", "threads"}, "Worker threads (default: CPU cores)", "count", "0");
+    QCommandLineOption rateOption({"r", "rate"}, "Messages per second per connection, 0 = closed loop (send on echo)", "rate", "1000");
+    QCommandLineOption windowOption({"w", "window"}, "Outstanding messages per connection in closed loop", "count", "1");
+    QCommandLineOption sizeOption({"s", "size"}, QString("Message size in bytes (>= %1)").arg(LoadConfig::HeaderSize), "bytes", "64");
+    QCommandLineOption durationOption({"d", "duration"}, "Measured seconds", "seconds", "10");
+    QCommandLineOption warmupOption("warmup", "Warmup seconds, not measured", "seconds", "1");
+    QCommandLineOption drainOption("drain", "Milliseconds to wait for echoes after sending stops", "ms", "1000");
+    QCommandLineOption bufferOption("socket-buffer", "Kernel socket send/receive buffer size in bytes", "bytes", "0");
+    QCommandLineOption histogramOption("histogram", "Include all non-empty histogram buckets in the result");
+    QCommandLineOption echoOption({"e", "echo"}, "Start a local echo server on the port (TCP: multi-threaded TcpServerEngine)");
+    QCommandLineOption echoThreadsOption("echo-threads", "Worker threads of the local TCP echo server", "count", "0");
+    QCommandLineOption outputOption({"o", "output"}, "Write the json result to a file instead of stdout", "file");
+    QCommandLineOption quietOption({"q", "quiet"}, "Do not print progress to stderr");
+    parser.addOptions({udpOption, hostOption, portOption, connectionsOption, threadsOption, rateOption, windowOption, sizeOption, durationOption,
+                       warmupOption, drainOption, bufferOption, histogramOption, echoOption, echoThreadsOption, outputOption, quietOption});
+    parser.process(a);
+
+    LoadConfig config;
+    config.protocol = parser.isSet(udpOption) ? LoadConfig::Udp : LoadConfig::Tcp;
+    config.host = parser.value(hostOption);
+    config.port = quint16(parser.value(portOption).toUInt());
+    config.connections = qMax(1, parser.value(connectionsOption).toInt());
+    config.threads = parser.value(threadsOption).toInt();
+    config.rate = qMax(0.0, parser.value(rateOption).toDouble());
+    config.window = qMax(1, parser.value(windowOption).toInt());
+    config.size = parser.value(sizeOption).toInt();
+    config.duration = parser.value(durationOption).toDouble();
+    config.warmup = qMax(0.0, parser.value(warmupOption).toDouble());
+    config.drain = qMax(0, parser.value(drainOption).toInt());
+    config.socketBufferSize = qMax(0, parser.value(bufferOption).toInt());
+    config.histogram = parser.isSet(histogramOption);
+
+    const int maxSize = config.protocol == LoadConfig::Udp ? 65507 : 16 * 1024 * 1024;
+    if (config.size < LoadConfig::HeaderSize || config.size > maxSize)
+    {
+        fprintf(stderr, "size must be between %d and %d\n", LoadConfig::HeaderSize, maxSize);
+        return 1;
+    }
+    if (config.duration <= 0)
+    {
+        fprintf(stderr, "duration must be greater than 0\n");
+        return 1;
+    }
+
+    // 本地回显服务端，用于测试工具本身或对比QMNetwork中的服务端
+    TcpServerEngine tcpEcho;
+    UdpEchoServer udpEcho;
+    if (parser.isSet(echoOption))
+    {
+        QHostAddress address(config.host);
+        if (address.isNull())
+        {
+            address = QHostAddress::Any;
+        }
+        bool ok = false;
+        QString error;
+        if (config.protocol == LoadConfig::Tcp)
+        {
+            tcpEcho.setEcho(true);
+            ok = tcpEcho.start(address, config.port, parser.value(echoThreadsOption).toInt());
+            error = tcpEcho.errorString();
+        }
+        else
+        {
+            ok = udpEcho.start(address, config.port, config.socketBufferSize);
+            error = udpEcho.errorString();
+        }
+        if (!ok)
+        {
+            fprintf(stderr, "cannot start echo server: %s\n", qPrintable(error));
+            return 1;
+        }
+    }
+
+    LoadGenerator generator(config);
+    if (!parser.isSet(quietOption))
+    {
+        QObject::connect(&generator, &LoadGenerator::progress, [](const QString& text) {
+            fprintf(stderr, "%s\n", text.toLocal8Bit().constData());
+            fflush(stderr);
+        });
+    }
+
+    int ret = 0;
+    QObject::connect(&generator, &LoadGenerator::finished, [&]() {
+        const QByteArray json = QJsonDocument(generator.result()).toJson(QJsonDocument::Indented);
+        if (parser.isSet(outputOption))
+        {
+            QFile file(parser.value(outputOption));
+            if (file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            {
+                file.write(json);
+            }
+            else
+            {
+                fprintf(stderr, "cannot open %s\n", qPrintable(file.fileName()));
+                ret = 1;
+            }
+        }
+        else
+        {
+            fwrite(json.constData(), 1, size_t(json.size()), stdout);
+            fflush(stdout);
+        }
+        QCoreApplication::quit();
+    });
+    generator.start();
+    a.exec();
+
+    tcpEcho.stop();
+    udpEcho.stop();
+    return ret;
+}
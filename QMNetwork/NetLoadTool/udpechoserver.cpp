@@ -0,0 +1,76 @@
+﻿#include "udpechoserver.h"
+#include <QThread>
+#include <QUdpSocket>
+
+UdpEchoServer::UdpEchoServer(QObject* parent)
+    : QObject(parent)
+{
+}
+
+UdpEchoServer::~UdpEchoServer()
+{
+    stop();
+}
+
+/**
+ * @brief                   绑定端口后将socket移入工作线程
+ * @param socketBufferSize  系统接收/发送缓冲区大小，0表示使用系统默认值（高速率时默认值太小容易丢包）
+ */
+bool UdpEchoServer::start(const QHostAddress& address, quint16 port, int socketBufferSize)
+{
+    stop();
+    m_socket = new QUdpSocket();
+    if (!m_socket->bind(address, port))
+    {
+        m_error = m_socket->errorString();
+        delete m_socket;
+        m_socket = nullptr;
+        return false;
+    }
+    if (socketBufferSize > 0)
+    {
+        m_socket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, socketBufferSize);
+        m_socket->setSocketOption(QAbstractSocket::SendBufferSizeSocketOption, socketBufferSize);
+    }
+    m_buffer.resize(65536);
+    connect(m_socket, &QUdpSocket::readyRead, m_socket, [this]() { on_readyRead(); });   // 在工作线程中执行
+
+    m_thread = new QThread();
+    m_thread->setObjectName("UdpEchoServer");
+    m_socket->moveToThread(m_thread);
+    m_thread->start();
+    return true;
+}
+
+void UdpEchoServer::stop()
+{
+    if (!m_thread)
+    {
+        return;
+    }
+    if (m_socket)
+    {
+        QUdpSocket* socket = m_socket;   // 在所属线程中释放
+        QMetaObject::invokeMethod(
+            socket, [socket]() { delete socket; }, Qt::BlockingQueuedConnection);
+        m_socket = nullptr;
+    }
+    m_thread->quit();
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+}
+
+void UdpEchoServer::on_readyRead()
+{
+    while (m_socket->hasPendingDatagrams())
+    {
+        QHostAddress address;
+        quint16 port = 0;
+        const qint64 size = m_socket->readDatagram(m_buffer.data(), m_buffer.size(), &address, &port);
+        if (size >= 0)
+        {
+            m_socket->writeDatagram(m_buffer.constData(), size, address, port);
+        }
+    }
+}
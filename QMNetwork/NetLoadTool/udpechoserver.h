@@ -0,0 +1,40 @@
+﻿/******************************************************************************
+ * @文件名     udpechoserver.h
+ * @功能       在独立线程中将收到的UDP数据报原样发回，作为压力测试的本地回显服务端
+ *
+ * @开发者     mhf
+ * @邮箱       1603291350@qq.com
+ * @时间       2025/04/12
+ * @备注
+ *****************************************************************************/
+#ifndef UDPECHOSERVER_H
+#define UDPECHOSERVER_H
+
+#include <QHostAddress>
+#include <QObject>
+
+class QThread;
+class QUdpSocket;
+
+class UdpEchoServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit UdpEchoServer(QObject* parent = nullptr);
+    ~UdpEchoServer() override;
+
+    bool start(const QHostAddress& address, quint16 port, int socketBufferSize = 0);
+    void stop();
+    QString errorString() const { return m_error; }
+
+private:
+    void on_readyRead();
+
+private:
+    QThread* m_thread = nullptr;
+    QUdpSocket* m_socket = nullptr;   // 在m_thread中创建和使用
+    QByteArray m_buffer;              // 接收缓冲区，只分配一次
+    QString m_error;
+};
+
+#endif   // UDPECHOSERVER_H
@@ -4,11 +4,24 @@ FORMS += \
     $$PWD/udpsocket.ui
 
 HEADERS += \
+    $$PWD/filetransfer.h \
     $$PWD/tcpclient.h \
     $$PWD/tcpserver.h \
+    $$PWD/tcpserverengine.h \
+    $$PWD/udpengine.h \
     $$PWD/udpsocket.h
 
 SOURCES += \
+    $$PWD/filetransfer.cpp \
     $$PWD/tcpclient.cpp \
     $$PWD/tcpserver.cpp \
+    $$PWD/tcpserverengine.cpp \
+    $$PWD/udpengine.cpp \
     $$PWD/udpsocket.cpp
+
+# TcpServerEngine在接管连接失败时直接关闭socket
+win32: LIBS += -lws2_32
+
+# UdpEngine使用ScanFile中的无锁队列（只有头文件），FileTransfer使用ScanFile中的XXH64实现校验文件
+INCLUDEPATH += $$PWD/../../FunctionalModule/ScanFile/include
+SOURCES += $$PWD/../../FunctionalModule/ScanFile/ScanFileLib/XXHash64.cpp
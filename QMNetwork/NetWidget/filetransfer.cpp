@@ -0,0 +1,695 @@
+﻿#include "filetransfer.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QPointer>
+#include <QSaveFile>
+#include <QTcpSocket>
+#include <QtEndian>
+#include <cstring>
+#include "XXHash64.h"
+
+#ifdef Q_OS_WIN
+#include <winsock2.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#endif
+
+namespace {
+const char Magic[4] = {'Q', 'M', 'F', 'T'};
+const quint8 Version = 1;
+const quint8 RequestType = 1;
+const quint8 ReplyType = 2;
+const quint8 ResultType = 3;
+const int RequestSize = 24;
+const int ReplySize = 16;
+const int ChunkSize = 1 << 20;                       // 读写文件的块大小
+const int BufferAlignment = 4096;                    // 接收缓冲区按页对齐
+const qint64 MaxSendfileSize = 64 * 1024 * 1024;     // 一次sendfile的最大长度，便于及时响应取消和更新进度
+const qint64 SaveInterval = 256 * 1024 * 1024;       // 接收端每接收这么多数据同步一次磁盘并保存进度
+const int SocketBufferSize = 4 * 1024 * 1024;
+const int ProgressInterval = 200;                    // 进度信号的最小间隔（毫秒）
+
+QString statusString(quint16 status)
+{
+    switch (status)
+    {
+    case FileTransfer::Ok: return "成功";
+    case FileTransfer::FileError: return "接收端无法写入文件";
+    case FileTransfer::HashMismatch: return "校验失败";
+    case FileTransfer::BadRequest: return "请求格式错误";
+    case FileTransfer::Incomplete: return "数据不完整";
+    default: return QString("未知状态%1").arg(status);
+    }
+}
+
+QByteArray makeReply(quint8 type, quint16 status, quint64 value)
+{
+    QByteArray reply(ReplySize, '\0');
+    uchar* p = reinterpret_cast<uchar*>(reply.data());
+    memcpy(p, Magic, 4);
+    p[4] = Version;
+    p[5] = type;
+    qToBigEndian(status, p + 6);
+    qToBigEndian(value, p + 8);
+    return reply;
+}
+
+bool parseReply(const char* data, quint8 type, quint16& status, quint64& value)
+{
+    const uchar* p = reinterpret_cast<const uchar*>(data);
+    if (memcmp(p, Magic, 4) != 0 || p[4] != Version || p[5] != type)
+    {
+        return false;
+    }
+    status = qFromBigEndian<quint16>(p + 6);
+    value = qFromBigEndian<quint64>(p + 8);
+    return true;
+}
+
+/**
+ * @brief          在没有事件循环的线程中读取固定长度的数据
+ * @param timeout  超时时间（毫秒），小于0表示一直等待到连接断开或取消
+ */
+bool readExactly(QTcpSocket& socket, char* data, int size, int timeout, const std::atomic<bool>& stop)
+{
+    QElapsedTimer timer;
+    timer.start();
+    int done = 0;
+    while (done < size)
+    {
+        if (stop)
+        {
+            return false;
+        }
+        if (socket.bytesAvailable() == 0 && !socket.waitForReadyRead(100))
+        {
+            if (socket.state() != QAbstractSocket::ConnectedState || (timeout >= 0 && timer.hasExpired(timeout)))
+            {
+                return false;
+            }
+            continue;
+        }
+        const qint64 ret = socket.read(data + done, size - done);
+        if (ret < 0)
+        {
+            return false;
+        }
+        done += int(ret);
+    }
+    return true;
+}
+
+/**
+ * @brief 写入并等待QTcpSocket的发送缓冲区清空（之后才能直接操作socket描述符）
+ */
+bool writeAll(QTcpSocket& socket, const QByteArray& data, const std::atomic<bool>& stop)
+{
+    if (socket.write(data) != data.size())
+    {
+        return false;
+    }
+    while (socket.bytesToWrite() > 0)
+    {
+        if (stop || socket.state() != QAbstractSocket::ConnectedState)
+        {
+            return false;
+        }
+        socket.waitForBytesWritten(100);
+    }
+    return true;
+}
+
+#ifdef Q_OS_LINUX
+void waitDescriptor(int fd, short events)
+{
+    pollfd item = {fd, events, 0};
+    poll(&item, 1, 100);   // 最多等待100ms，以便检查是否取消
+}
+#endif
+
+/**
+ * @brief     发送文件中从position开始的一段数据
+ * @return    实际发送的字节数，socket暂时不可写时返回0，出错返回-1
+ */
+qint64 sendChunk(QTcpSocket& socket, QFile& file, qint64 position, qint64 size)
+{
+#ifdef Q_OS_LINUX
+    // QTcpSocket的发送缓冲区已经清空，直接用sendfile，文件数据不经过用户态
+    const int fd = int(socket.socketDescriptor());
+    off_t offset = off_t(position);
+    const ssize_t ret = sendfile(fd, file.handle(), &offset, size_t(qMin(size, MaxSendfileSize)));
+    if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    {
+        waitDescriptor(fd, POLLOUT);
+        return 0;
+    }
+    return ret > 0 ? qint64(ret) : -1;
+#else
+    while (socket.bytesToWrite() > 4 * ChunkSize)   // 控制QTcpSocket发送缓冲区的大小
+    {
+        if (socket.state() != QAbstractSocket::ConnectedState)
+        {
+            return -1;
+        }
+        socket.waitForBytesWritten(100);
+    }
+    static thread_local QByteArray buffer(ChunkSize, Qt::Uninitialized);
+    const qint64 ret = file.seek(position) ? file.read(buffer.data(), qMin<qint64>(size, ChunkSize)) : -1;
+    if (ret <= 0 || socket.write(buffer.constData(), ret) != ret)
+    {
+        return -1;
+    }
+    return ret;
+#endif
+}
+
+/**
+ * @brief 断点续传进度："文件大小 校验值 已写入磁盘的字节数"，用QSaveFile保证不会写一半
+ */
+qint64 loadProgress(const QString& fileName, qint64 size, quint64 hash)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return 0;
+    }
+    const QList<QByteArray> values = file.readAll().trimmed().split(' ');
+    if (values.count() != 3 || values.at(0).toLongLong() != size || values.at(1).toULongLong() != hash)
+    {
+        return 0;
+    }
+    return qBound<qint64>(0, values.at(2).toLongLong(), size);
+}
+
+void saveProgress(const QString& fileName, qint64 size, quint64 hash, qint64 offset)
+{
+    QSaveFile file(fileName);
+    if (file.open(QIODevice::WriteOnly))
+    {
+        file.write(QString("%1 %2 %3").arg(size).arg(hash).arg(offset).toUtf8());
+        file.commit();
+    }
+}
+
+/**
+ * @brief 不续传时重新分配文件空间，先截断为0，丢弃之前残留的.part内容
+ *
+ * fallocate(mode=0)不会缩小文件，也不会清除已有数据，残留的较大文件会导致接收完成后校验失败。
+ */
+bool preallocate(QFile& file, qint64 size)
+{
+    if (!file.resize(0))
+    {
+        return false;
+    }
+    if (size <= 0)
+    {
+        return true;
+    }
+#ifdef Q_OS_LINUX
+    const int ret = fallocate(file.handle(), 0, 0, off_t(size));   // 一次分配所有磁盘空间，写入时不再分配，文件也不容易产生碎片
+    if (ret == 0)
+    {
+        return true;
+    }
+    if (errno != EOPNOTSUPP)   // 部分文件系统不支持fallocate
+    {
+        return false;
+    }
+#endif
+    return file.resize(size);
+}
+
+bool writeAt(QFile& file, qint64 position, const char* data, int size)
+{
+#ifdef Q_OS_LINUX
+    while (size > 0)
+    {
+        const ssize_t ret = pwrite(file.handle(), data, size_t(size), off_t(position));
+        if (ret < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (ret <= 0)
+        {
+            return false;
+        }
+        data += ret;
+        size -= int(ret);
+        position += ret;
+    }
+    return true;
+#else
+    return file.seek(position) && file.write(data, size) == size;
+#endif
+}
+
+void syncFile(QFile& file)
+{
+#ifdef Q_OS_LINUX
+    fdatasync(file.handle());
+#else
+    file.flush();
+#endif
+}
+
+/**
+ * @brief 一个文件接收连接，在自己的线程中阻塞读写；不是Q_OBJECT，通过FileReceiver的信号通知界面
+ */
+class FileReceiveThread : public QThread
+{
+public:
+    FileReceiveThread(FileReceiver* receiver, qintptr socketDescriptor, const QString& directory, const std::atomic<bool>& stop)
+        : m_receiver(receiver)
+        , m_socketDescriptor(socketDescriptor)
+        , m_directory(directory)
+        , m_stop(stop)
+    {
+    }
+
+protected:
+    void run() override;
+
+private:
+    bool receive(QTcpSocket& socket, QFile& file, const QString& name, qint64 size, quint64 hash, qint64& position);
+
+private:
+    FileReceiver* m_receiver;
+    qintptr m_socketDescriptor;
+    QString m_directory;
+    QString m_progressFile;
+    const std::atomic<bool>& m_stop;
+};
+
+void FileReceiveThread::run()
+{
+    QTcpSocket socket;
+    if (!socket.setSocketDescriptor(m_socketDescriptor))
+    {
+        // 设置失败时socket没有接管描述符，需要自己关闭，否则发送端一直等待应答并泄漏描述符
+#ifdef Q_OS_WIN
+        closesocket(SOCKET(m_socketDescriptor));
+#else
+        ::close(int(m_socketDescriptor));
+#endif
+        return;
+    }
+    socket.setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, SocketBufferSize);
+
+    char request[RequestSize];
+    if (!readExactly(socket, request, RequestSize, 10000, m_stop))
+    {
+        return;
+    }
+    const uchar* p = reinterpret_cast<const uchar*>(request);
+    const quint16 nameLength = qFromBigEndian<quint16>(p + 6);
+    const qint64 size = qint64(qFromBigEndian<quint64>(p + 8));
+    const quint64 hash = qFromBigEndian<quint64>(p + 16);
+    QByteArray nameBytes(nameLength, '\0');
+    if (memcmp(p, Magic, 4) != 0 || p[4] != Version || p[5] != RequestType || size < 0
+        || !readExactly(socket, nameBytes.data(), nameLength, 10000, m_stop))
+    {
+        writeAll(socket, makeReply(ReplyType, FileTransfer::BadRequest, 0), m_stop);
+        return;
+    }
+    const QString name = QFileInfo(QString::fromUtf8(nameBytes)).fileName();   // 只保留文件名，防止"../"写到接收目录之外
+    if (name.isEmpty() || name == "." || name == "..")
+    {
+        writeAll(socket, makeReply(ReplyType, FileTransfer::BadRequest, 0), m_stop);
+        return;
+    }
+
+    QDir dir(m_directory);
+    dir.mkpath(".");
+    const QString target = dir.filePath(name);
+    const QString part = target + ".part";
+    m_progressFile = target + ".qmft";
+
+    QFile file(part);
+    qint64 offset = QFile::exists(part) ? loadProgress(m_progressFile, size, hash) : 0;
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Unbuffered))
+    {
+        writeAll(socket, makeReply(ReplyType, FileTransfer::FileError, 0), m_stop);
+        emit m_receiver->finished(name, false, file.errorString());
+        return;
+    }
+    if (offset == 0 || file.size() != size)
+    {
+        offset = 0;
+        if (!preallocate(file, size))
+        {
+            writeAll(socket, makeReply(ReplyType, FileTransfer::FileError, 0), m_stop);
+            emit m_receiver->finished(name, false, "预分配文件空间失败，磁盘空间不足？");
+            return;
+        }
+    }
+    saveProgress(m_progressFile, size, hash, offset);
+    if (!writeAll(socket, makeReply(ReplyType, FileTransfer::Ok, quint64(offset)), m_stop))
+    {
+        return;
+    }
+    emit m_receiver->started(name, size, offset);
+
+    qint64 position = offset;
+    const bool complete = receive(socket, file, name, size, hash, position);
+    syncFile(file);
+    saveProgress(m_progressFile, size, hash, position);
+    if (!complete)
+    {
+        emit m_receiver->finished(name, false, m_stop ? "已停止，进度已保存" : QString("连接断开，已接收%1字节，进度已保存").arg(position));
+        return;
+    }
+    file.close();
+
+    if (hash != 0)
+    {
+        bool ok = false;
+        const quint64 value = FileTransfer::xxh64(part, &m_stop, &ok);
+        if (!ok)
+        {
+            emit m_receiver->finished(name, false, "校验时读取文件失败");
+            return;
+        }
+        if (value != hash)
+        {
+            QFile::remove(part);   // 数据有误，下次从头传输
+            QFile::remove(m_progressFile);
+            writeAll(socket, makeReply(ResultType, FileTransfer::HashMismatch, quint64(position)), m_stop);
+            emit m_receiver->finished(name, false, "校验失败");
+            return;
+        }
+    }
+    QFile::remove(target);
+    if (!QFile::rename(part, target))
+    {
+        writeAll(socket, makeReply(ResultType, FileTransfer::FileError, quint64(position)), m_stop);
+        emit m_receiver->finished(name, false, QString("重命名为%1失败").arg(target));
+        return;
+    }
+    QFile::remove(m_progressFile);
+    writeAll(socket, makeReply(ResultType, FileTransfer::Ok, quint64(position)), m_stop);
+    emit m_receiver->finished(name, true, target);
+}
+
+/**
+ * @brief           接收数据到按页对齐的1MB缓冲区，满一块才用pwrite写入文件
+ * @param position  已写入文件的位置，返回时缓冲区中的数据也已经写入
+ * @return          是否接收完整
+ */
+bool FileReceiveThread::receive(QTcpSocket& socket, QFile& file, const QString& name, qint64 size, quint64 hash, qint64& position)
+{
+    QByteArray memory(ChunkSize + BufferAlignment, Qt::Uninitialized);
+    char* buffer = reinterpret_cast<char*>((quintptr(memory.data()) + BufferAlignment - 1) & ~quintptr(BufferAlignment - 1));
+    int used = 0;
+    qint64 received = position;
+    qint64 lastSave = position;
+    const qint64 offset = position;
+    QElapsedTimer timer;
+    timer.start();
+    qint64 lastProgress = 0;
+
+    while (received < size && !m_stop)
+    {
+        const int want = int(qMin<qint64>(ChunkSize - used, size - received));
+        qint64 ret = 0;
+        if (socket.bytesAvailable() > 0)   // 先取出QTcpSocket中已经缓存的数据
+        {
+            ret = socket.read(buffer + used, want);
+        }
+        else
+        {
+#ifdef Q_OS_LINUX
+            ret = ::read(int(socket.socketDescriptor()), buffer + used, size_t(want));   // 线程中没有事件循环，QTcpSocket不会再读取socket
+            if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            {
+                waitDescriptor(int(socket.socketDescriptor()), POLLIN);
+                continue;
+            }
+#else
+            if (!socket.waitForReadyRead(100))
+            {
+                if (socket.state() != QAbstractSocket::ConnectedState)
+                {
+                    break;
+                }
+                continue;
+            }
+            ret = socket.read(buffer + used, want);
+#endif
+        }
+        if (ret <= 0)
+        {
+            break;   // 连接断开或出错
+        }
+        used += int(ret);
+        received += ret;
+
+        if (used == ChunkSize || received == size)
+        {
+            if (!writeAt(file, position, buffer, used))
+            {
+                return false;
+            }
+            position += used;
+            used = 0;
+        }
+        if (position - lastSave >= SaveInterval)
+        {
+            syncFile(file);   // 先保证数据写入磁盘再保存进度，断电后续传的数据也是正确的
+            saveProgress(m_progressFile, size, hash, position);
+            lastSave = position;
+        }
+        if (timer.elapsed() - lastProgress >= ProgressInterval || received == size)
+        {
+            lastProgress = timer.elapsed();
+            emit m_receiver->progress(name, received, size, double(received - offset) * 1000.0 / qMax<qint64>(lastProgress, 1));
+        }
+    }
+
+    if (used > 0 && writeAt(file, position, buffer, used))
+    {
+        position += used;
+    }
+    return position == size;
+}
+}   // namespace
+
+quint64 FileTransfer::xxh64(const QString& fileName, const std::atomic<bool>* stop, bool* ok)
+{
+    if (ok)
+    {
+        *ok = false;
+    }
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return 0;
+    }
+    XXHash64 hash;
+    QByteArray buffer(ChunkSize, Qt::Uninitialized);
+    while (true)
+    {
+        if (stop && *stop)
+        {
+            return 0;
+        }
+        const qint64 ret = file.read(buffer.data(), ChunkSize);
+        if (ret < 0)
+        {
+            return 0;
+        }
+        if (ret == 0)
+        {
+            break;
+        }
+        hash.update(buffer.constData(), size_t(ret));
+    }
+    if (ok)
+    {
+        *ok = true;
+    }
+    return hash.digest();
+}
+
+QString FileTransfer::speedString(double bytesPerSecond)
+{
+    return QString("%1 MB/s").arg(bytesPerSecond / (1024 * 1024), 0, 'f', 1);
+}
+
+FileSender::FileSender(QObject* parent)
+    : QThread(parent)
+{
+}
+
+FileSender::~FileSender()
+{
+    cancel();
+    wait();
+}
+
+/**
+ * @brief          开始发送文件，正在发送时忽略
+ * @param port     接收端的文件传输端口
+ */
+void FileSender::send(const QString& host, quint16 port, const QString& fileName, bool verify)
+{
+    if (isRunning())
+    {
+        return;
+    }
+    m_host = host;
+    m_port = port;
+    m_fileName = fileName;
+    m_verify = verify;
+    m_stop = false;
+    start();
+}
+
+void FileSender::cancel()
+{
+    m_stop = true;
+}
+
+void FileSender::run()
+{
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        emit completed(false, file.errorString());
+        return;
+    }
+    const qint64 total = file.size();
+    const QByteArray name = QFileInfo(m_fileName).fileName().toUtf8().left(0xFFFF);
+
+    quint64 hash = 0;
+    if (m_verify)
+    {
+        emit stateChanged("计算校验值");
+        bool ok = false;
+        hash = FileTransfer::xxh64(m_fileName, &m_stop, &ok);
+        if (!ok)
+        {
+            emit completed(false, m_stop ? "已取消" : "读取文件失败");
+            return;
+        }
+    }
+
+    emit stateChanged("连接中");
+    QTcpSocket socket;
+    socket.connectToHost(m_host, m_port);
+    if (!socket.waitForConnected(5000))
+    {
+        emit completed(false, QString("连接%1 %2失败：%3").arg(m_host).arg(m_port).arg(socket.errorString()));
+        return;
+    }
+    socket.setSocketOption(QAbstractSocket::SendBufferSizeSocketOption, SocketBufferSize);
+
+    QByteArray request(RequestSize, '\0');
+    uchar* p = reinterpret_cast<uchar*>(request.data());
+    memcpy(p, Magic, 4);
+    p[4] = Version;
+    p[5] = RequestType;
+    qToBigEndian(quint16(name.size()), p + 6);
+    qToBigEndian(quint64(total), p + 8);
+    qToBigEndian(hash, p + 16);
+    char reply[ReplySize];
+    quint16 status = 0;
+    quint64 value = 0;
+    if (!writeAll(socket, request + name, m_stop) || !readExactly(socket, reply, ReplySize, 30000, m_stop)
+        || !parseReply(reply, ReplyType, status, value))
+    {
+        emit completed(false, m_stop ? "已取消" : "握手失败");
+        return;
+    }
+    if (status != FileTransfer::Ok || value > quint64(total))
+    {
+        emit completed(false, statusString(status));
+        return;
+    }
+
+    const qint64 offset = qint64(value);
+    emit stateChanged(offset > 0 ? QString("从%1字节处继续发送").arg(offset) : QString("发送中"));
+    QElapsedTimer timer;
+    timer.start();
+    qint64 lastProgress = 0;
+    qint64 position = offset;
+    while (position < total && !m_stop)
+    {
+        const qint64 ret = sendChunk(socket, file, position, total - position);
+        if (ret < 0)
+        {
+            break;   // 连接断开，或者文件被截断
+        }
+        position += ret;
+        if (timer.elapsed() - lastProgress >= ProgressInterval || position == total)
+        {
+            lastProgress = timer.elapsed();
+            emit progress(position, total, double(position - offset) * 1000.0 / qMax<qint64>(lastProgress, 1));
+        }
+    }
+    if (position < total || !writeAll(socket, QByteArray(), m_stop))
+    {
+        emit completed(false, m_stop ? QString("已取消，已发送%1字节").arg(position) : QString("连接断开，已发送%1字节").arg(position));
+        return;
+    }
+
+    emit stateChanged(m_verify ? "等待接收端校验" : "等待接收端确认");
+    if (!readExactly(socket, reply, ReplySize, -1, m_stop) || !parseReply(reply, ResultType, status, value))
+    {
+        emit completed(false, m_stop ? "已取消" : "没有收到接收端的确认");
+        return;
+    }
+    const double seconds = qMax<qint64>(timer.elapsed(), 1) / 1000.0;
+    emit completed(status == FileTransfer::Ok,
+                  status == FileTransfer::Ok ? QString("发送完成，%1字节，平均%2").arg(total).arg(FileTransfer::speedString((total - offset) / seconds))
+                                             : statusString(status));
+}
+
+FileReceiver::FileReceiver(QObject* parent)
+    : QTcpServer(parent)
+{
+    m_directory = QDir(QCoreApplication::applicationDirPath()).filePath("RecvFiles");
+}
+
+FileReceiver::~FileReceiver()
+{
+    stop();
+}
+
+void FileReceiver::stop()
+{
+    close();
+    m_stop = true;
+    for (QThread* thread : qAsConst(m_threads))
+    {
+        thread->wait();   // 线程中最多阻塞100ms就会检查m_stop
+        delete thread;
+    }
+    m_threads.clear();
+    m_stop = false;
+}
+
+void FileReceiver::incomingConnection(qintptr socketDescriptor)
+{
+    FileReceiveThread* thread = new FileReceiveThread(this, socketDescriptor, m_directory, m_stop);
+    QPointer<QThread> pointer(thread);
+    connect(thread, &QThread::finished, this, [this, pointer]() {
+        if (pointer)   // 在stop()中释放的线程不再处理
+        {
+            m_threads.removeOne(pointer);
+            pointer->deleteLater();
+        }
+    });
+    m_threads.append(thread);
+    thread->start();
+}
@@ -0,0 +1,91 @@
+﻿#ifndef FILETRANSFER_H
+#define FILETRANSFER_H
+
+#include <QString>
+#include <QTcpServer>
+#include <QThread>
+#include <atomic>
+
+/**
+ * @brief 大文件传输协议（大端字节序），使用单独的TCP连接，不影响文本收发
+ *
+ * 请求（发送端 -> 接收端）：["QMFT"][版本1][类型1][文件名长度 2字节][文件大小 8字节][XXH64校验值 8字节] + UTF-8文件名
+ * 应答（接收端 -> 发送端）：["QMFT"][版本1][类型2][状态 2字节][起始偏移 8字节]，发送端从起始偏移开始发送文件数据（断点续传）
+ * 结果（接收端 -> 发送端）：["QMFT"][版本1][类型3][状态 2字节][已接收字节数 8字节]，接收完成并校验后发送
+ *
+ * 接收端把进度保存在"文件名.qmft"中，同名、同大小、同校验值的文件再次发送时从保存的位置继续；
+ * Linux下发送端用sendfile直接从文件发送到socket（数据不经过用户态），接收端预分配文件空间（fallocate），
+ * 读取到按页对齐的大缓冲区中再用pwrite整块写入；其它系统使用QFile + QTcpSocket。
+ */
+namespace FileTransfer {
+enum Status : quint16
+{
+    Ok = 0,
+    FileError = 1,       // 接收端无法创建或写入文件
+    HashMismatch = 2,    // 校验失败，接收端删除进度，下次从头传输
+    BadRequest = 3,
+    Incomplete = 4       // 数据没有接收完整
+};
+
+quint64 xxh64(const QString& fileName, const std::atomic<bool>* stop = nullptr, bool* ok = nullptr);   // 计算文件的XXH64校验值
+QString speedString(double bytesPerSecond);
+}   // namespace FileTransfer
+
+/**
+ * @brief 发送文件，在线程中完成计算校验值、握手、发送、等待结果
+ */
+class FileSender : public QThread
+{
+    Q_OBJECT
+public:
+    explicit FileSender(QObject* parent = nullptr);
+    ~FileSender() override;
+
+    void send(const QString& host, quint16 port, const QString& fileName, bool verify = true);   // verify为false时不计算校验值，断点续传只比较文件名和大小
+    void cancel();
+
+signals:
+    void stateChanged(const QString& state);
+    void progress(qint64 done, qint64 total, double bytesPerSecond);
+    void completed(bool ok, const QString& message);   // 不使用finished，避免隐藏QThread::finished
+
+protected:
+    void run() override;
+
+private:
+    QString m_host;
+    quint16 m_port = 0;
+    QString m_fileName;
+    bool m_verify = true;
+    std::atomic<bool> m_stop{false};
+};
+
+/**
+ * @brief 接收文件的服务端，每个连接一个线程（文件传输连接数很少，线程中使用阻塞读写最简单高效）
+ */
+class FileReceiver : public QTcpServer
+{
+    Q_OBJECT
+public:
+    explicit FileReceiver(QObject* parent = nullptr);
+    ~FileReceiver() override;
+
+    void setDirectory(const QString& directory) { m_directory = directory; }
+    QString directory() const { return m_directory; }
+    void stop();   // 停止监听并中断所有传输（已接收的进度会保存）
+
+signals:
+    void started(const QString& name, qint64 size, qint64 offset);
+    void progress(const QString& name, qint64 done, qint64 total, double bytesPerSecond);
+    void finished(const QString& name, bool ok, const QString& message);
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+    QString m_directory;
+    QList<QThread*> m_threads;
+    std::atomic<bool> m_stop{false};
+};
+
+#endif   // FILETRANSFER_H
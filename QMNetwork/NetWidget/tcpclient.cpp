@@ -1,9 +1,11 @@
 #include "tcpclient.h"
 #include "ui_tcpclient.h"
+#include "filetransfer.h"
 #include <QHostAddress>
 #include <QDebug>
 #include <QByteArray>
 #include <QHostInfo>
+#include <QFileDialog>
 
 TCPClient::TCPClient(QWidget *parent) :
     QWidget(parent),
@@ -32,6 +34,7 @@ TCPClient::~TCPClient()
 void TCPClient::init()
 {
     m_tcpClient = new QTcpSocket(this);
+    m_fileSender = new FileSender(this);
     ui->line_localAddress->setText("127.0.0.1");
 }
 
@@ -41,6 +44,9 @@ void TCPClient::connectSlots()
     connect(m_tcpClient, &QTcpSocket::disconnected, this, &TCPClient::on_disconnected);
     connect(m_tcpClient, &QTcpSocket::stateChanged, this, &TCPClient::on_stateChanged);
     connect(m_tcpClient, &QTcpSocket::readyRead, this, &TCPClient::on_readyRead);
+    connect(m_fileSender, &FileSender::stateChanged, ui->label_file, &QLabel::setText);
+    connect(m_fileSender, &FileSender::progress, this, &TCPClient::on_fileProgress);
+    connect(m_fileSender, &FileSender::completed, this, &TCPClient::on_fileFinished);
 
 #if (QT_VERSION <= QT_VERSION_CHECK(5,15,0))        // qt5.15 后error已经弃用，这里改用errorOccurred
     connect(m_tcpClient, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::error),
@@ -262,4 +268,49 @@ void TCPClient::on_check_hexRecv_clicked(bool checked)
     ui->text_recv->setText(value);
 }
 
+/**
+ * @brief 选择文件发送到对端端口+1的文件接收服务（TCPServer中勾选【接收文件】），发送中再次点击取消
+ */
+void TCPClient::on_but_sendFile_clicked()
+{
+    if(m_fileSender->isRunning())
+    {
+        m_fileSender->cancel();
+        return;
+    }
+    if(ui->spin_peerPort->value() >= 65535)
+    {
+        qWarning() << QString("对端端口为65535时没有可用的文件接收端口（端口+1）");
+        return;
+    }
+    QString fileName = QFileDialog::getOpenFileName(this, "选择发送的文件");
+    if(fileName.isEmpty()) return;
 
+    ui->progress_file->setValue(0);
+    ui->but_sendFile->setText("取消发送");
+    m_fileSender->send(ui->line_peerAddress->text(), quint16(ui->spin_peerPort->value() + 1), fileName);
+}
+
+/**
+ * @brief 显示文件发送进度和速度
+ */
+void TCPClient::on_fileProgress(qint64 done, qint64 total, double bytesPerSecond)
+{
+    ui->progress_file->setValue(total > 0 ? int(done * 100 / total) : 100);
+    ui->label_file->setText(QString("%1/%2 MB  %3").arg(done >> 20).arg(total >> 20).arg(FileTransfer::speedString(bytesPerSecond)));
+}
+
+void TCPClient::on_fileFinished(bool ok, const QString &message)
+{
+    ui->but_sendFile->setText("发送文件");
+    ui->label_file->setText(message);
+    if(ok)
+    {
+        ui->progress_file->setValue(100);
+        qInfo() << message;
+    }
+    else
+    {
+        qWarning() << "发送文件失败：" << message;
+    }
+}
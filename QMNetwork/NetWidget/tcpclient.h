@@ -4,6 +4,8 @@
 #include <QWidget>
 #include <QTcpSocket>
 
+class FileSender;
+
 namespace Ui {
 class TCPClient;
 }
@@ -38,10 +40,15 @@ private slots:
 
     void on_but_clearRecv_clicked();
 
+    void on_but_sendFile_clicked();
+    void on_fileProgress(qint64 done, qint64 total, double bytesPerSecond);
+    void on_fileFinished(bool ok, const QString& message);
+
 private:
     Ui::TCPClient *ui;
 
     QTcpSocket* m_tcpClient = nullptr;
+    FileSender* m_fileSender = nullptr;      // 文件传输使用单独的连接（对端端口+1）
 };
 
 #endif // TCPCLIENT_H
@@ -1,9 +1,9 @@
 ﻿#include "tcpserver.h"
 #include "ui_tcpserver.h"
+#include "filetransfer.h"
 #include <QAbstractSocket>
 #include <QDebug>
-#include <QListWidgetItem>
-#include <qhostinfo.h>
+#include <QThread>
 
 
 TCPServer::TCPServer(QWidget *parent) :
@@ -28,34 +28,19 @@ TCPServer::~TCPServer()
 
 void TCPServer::init()
 {
-    m_tcpServer = new QTcpServer(this);
-    m_tcpServer->setMaxPendingConnections(30);     // 设置最大允许连接数，不设置的话默认为30(如果设置过大就需要考虑内存泄漏问题)
+    m_tcpServer = new TcpServerEngine(this);      // 重写了incomingConnection，连接不进入等待队列，不再受setMaxPendingConnections(30)限制
+    m_fileReceiver = new FileReceiver(this);      // 每个文件传输连接一个线程
     ui->line_localAddress->setText("127.0.0.1");
+    ui->spin_threads->setValue(QThread::idealThreadCount());
 }
 
 void TCPServer::connectSlots()
 {
-    connect(m_tcpServer, &QTcpServer::newConnection, this, &TCPServer::on_newConnection);    // 监听新的客户端连接
     connect(m_tcpServer, &QTcpServer::acceptError, this, &TCPServer::on_acceptError);        // 当接受新连接导致错误时，会发出此信号
-}
-
-
-void TCPServer::on_newConnection()
-{
-    while (m_tcpServer->hasPendingConnections())
-    {
-        QTcpSocket* tcpSocket = m_tcpServer->nextPendingConnection();      // 存在内存泄漏，最好使用时通过hasPendingConnections判断是否有未返回的连接
-        if(tcpSocket)
-        {
-            m_tcpClients.append(tcpSocket);
-        }
-        connect(tcpSocket, &QTcpSocket::disconnected, this, &TCPServer::on_disconnected);        // 断开连接
-        connect(tcpSocket, &QTcpSocket::readyRead, this, &TCPServer::on_readyRead);
-
-        QString strPeer = QString("%1 %2").arg(tcpSocket->peerAddress().toString()).arg(tcpSocket->peerPort());
-        strPeer.remove("::ffff:");
-        addPeer(strPeer);
-    }
+    connect(m_tcpServer, &TcpServerEngine::statistics, this, &TCPServer::on_statistics);     // 定时汇总的统计信息
+    connect(m_fileReceiver, &FileReceiver::started, this, &TCPServer::on_fileStarted);
+    connect(m_fileReceiver, &FileReceiver::progress, this, &TCPServer::on_fileProgress);
+    connect(m_fileReceiver, &FileReceiver::finished, this, &TCPServer::on_fileFinished);
 }
 
 /**
@@ -68,18 +53,36 @@ void TCPServer::on_acceptError(QAbstractSocket::SocketError socketError)
 }
 
 /**
- * @brief       添加已连接的目标信息
- * @param peer  IP + 端口
+ * @brief             显示统计信息和采样的接收数据（每500ms一次，与客户端数量和数据量无关）
+ * @param statistics
  */
-void TCPServer::addPeer(const QString &peer)
+void TCPServer::on_statistics(const TcpServerEngine::Statistics &statistics)
 {
-    QListWidgetItem *item = new QListWidgetItem(ui->listWidget);
-    QCheckBox* checkbox = new QCheckBox();          // 添加复选框
-    checkbox->setText(peer);
-    //设置item的高度
-    item->setSizeHint(QSize(0,20));
-    ui->listWidget->addItem(item);
-    ui->listWidget->setItemWidget(item, checkbox);
+    QStringList lines;
+    lines << QString("连接数：%1").arg(statistics.clients)
+          << QString("累计连接：%1").arg(statistics.accepted)
+          << QString("接收：%1 KB/s").arg(statistics.receiveRate / 1024, 0, 'f', 1)
+          << QString("发送：%1 KB/s").arg(statistics.sendRate / 1024, 0, 'f', 1);
+    for(int i = 0; i < statistics.workers.count(); i++)
+    {
+        lines << QString("线程%1：%2个连接").arg(i).arg(statistics.workers.at(i).clients);
+    }
+    ui->listWidget->clear();
+    ui->listWidget->addItems(lines);
+
+    m_bytesReceived = statistics.bytesReceived;
+    ui->spin_recv->setValue(int(qMin<quint64>(m_bytesReceived - m_recvBase, quint64(ui->spin_recv->maximum()))));  // 统计接收的数据总大小（从上次清空开始）
+    for(const TcpServerEngine::Sample& sample : statistics.samples)
+    {
+        if(ui->check_hexRecv->isChecked())
+        {
+            ui->text_recv->append(QString("[%1] ").arg(sample.peer) + sample.data.toHex(' '));
+        }
+        else
+        {
+            ui->text_recv->append(QString("[%1] ").arg(sample.peer) + sample.data);
+        }
+    }
 }
 
 /**
@@ -93,10 +96,17 @@ void TCPServer::on_but_connect_clicked()
     {
         // 告诉服务器侦听地址和端口上的传入连接。如果端口为0，则会自动选择一个端口。
         // 如果地址是QHostAddress:：Any，服务器将监听所有网络接口。
-        bool ret = m_tcpServer->listen(QHostAddress::Any, ui->spin_localPort->value());
+        bool ret = m_tcpServer->start(QHostAddress::Any, ui->spin_localPort->value(), ui->spin_threads->value());
         if(ret)
         {
+            m_bytesReceived = 0;             // 重新开始监听时工作线程的统计从0开始
+            m_recvBase = 0;
             ui->but_connect->setText("停止");
+            ui->spin_threads->setEnabled(false);
+            if(ui->check_recvFile->isChecked())
+            {
+                startFileReceiver();
+            }
         }
         else
         {
@@ -105,64 +115,21 @@ void TCPServer::on_but_connect_clicked()
     }
     else
     {
-        m_tcpServer->close();
+        m_tcpServer->stop();                 // 停止监听，关闭所有连接的TCP Client，退出工作线程
+        m_fileReceiver->stop();              // 中断正在进行的文件传输，进度保存在接收目录中，下次可以续传
         ui->but_connect->setText("开始监听");
-        for(int i = m_tcpClients.count() - 1; i >= 0 ; i--)          // 关闭所有连接的TCP Client
-        {
-            m_tcpClients.at(i)->abort();
-        }
-    }
-}
-
-/**
- * @brief Socket  已断开连接
- */
-void TCPServer::on_disconnected()
-{
-    for(int i = 0; i < m_tcpClients.count(); i++)
-    {
-        if(m_tcpClients.at(i)->state() != QAbstractSocket::ConnectedState)       // 未连接
-        {
-            disconnect(m_tcpClients.at(i), &QTcpSocket::disconnected, this, &TCPServer::on_disconnected);
-            disconnect(m_tcpClients.at(i), &QTcpSocket::readyRead, this, &TCPServer::on_readyRead);
-            m_tcpClients.takeAt(i)->deleteLater();       // 移除已经断开连接的Client（注意这里不能使用delete，否则在vs中会报错）
-            QListWidgetItem * item = ui->listWidget->item(i);
-            ui->listWidget->removeItemWidget(item);
-            delete item;                    // 不加这一行 listwidget的count不会变化
-            item = nullptr;
-        }
+        ui->spin_threads->setEnabled(true);
+        ui->listWidget->clear();
     }
 }
 
 /**
- * @brief 接收数据
+ * @brief          是否将接收的数据原样发回（用于压力测试）
+ * @param checked
  */
-void TCPServer::on_readyRead()
+void TCPServer::on_check_echo_clicked(bool checked)
 {
-    for(int i = 0; i < ui->listWidget->count(); i++)
-    {
-        if(m_tcpClients.at(i)->bytesAvailable() <= 0) continue;;       // 如果无可读数据则返回
-
-        QByteArray arr = m_tcpClients.at(i)->readAll();                // 读取数据
-        QCheckBox* checkBox = (QCheckBox*)ui->listWidget->itemWidget(ui->listWidget->item(i));
-        if(checkBox->isChecked())                                      // 勾选的已连接Client则显示接收的信息
-        {
-            if(arr.count() <= 0)
-            {
-                continue;
-            }
-            ui->spin_recv->setValue(ui->spin_recv->value() + arr.count());  // 统计接收的数据总大小
-            QString strPeer = checkBox->text();
-            if(ui->check_hexRecv->isChecked())
-            {
-                ui->text_recv->append(QString("[%1] ").arg(strPeer) + arr.toHex(' '));
-            }
-            else
-            {
-                ui->text_recv->append(QString("[%1] ").arg(strPeer) + arr);
-            }
-        }
-    }
+    m_tcpServer->setEcho(checked);
 }
 
 /**
@@ -172,6 +139,7 @@ void TCPServer::on_but_clearRecv_clicked()
 {
     ui->text_recv->clear();
     ui->spin_recv->setValue(0);
+    m_recvBase = m_bytesReceived;   // 累计值由工作线程统计，清空时记下当前值
 }
 
 /**
@@ -244,24 +212,77 @@ void TCPServer::on_but_send_clicked()
 }
 
 /**
- * @brief       向所有已连接并且勾选的Client发送数据
+ * @brief       向所有已连接的Client发送数据（在各个工作线程中发送）
  * @param data
- * @return      返回发送数据的最大长度
+ * @return      返回发送数据的长度，没有连接时返回0
  */
 qint64 TCPServer::sendData(const QByteArray &data)
 {
-    qint64 len = 0;
-    for(int i = 0; i < ui->listWidget->count(); i++)
+    int clients = m_tcpServer->broadcast(data);
+    return clients > 0 ? data.count() : 0;
+}
+
+/**
+ * @brief          是否在监听端口+1上接收文件
+ * @param checked
+ */
+void TCPServer::on_check_recvFile_clicked(bool checked)
+{
+    if(!m_tcpServer->isListening()) return;   // 开始监听时再启动
+
+    if(checked)
     {
-        QCheckBox* checkBox = (QCheckBox*)ui->listWidget->itemWidget(ui->listWidget->item(i));
-        if(checkBox->isChecked())                                      // 勾选的已连接Client则显示接收的信息
-        {
-             qint64 ret = m_tcpClients.at(i)->write(data);
-             if(ret > len)
-             {
-                 len = ret;
-             }
-        }
+        startFileReceiver();
+    }
+    else
+    {
+        m_fileReceiver->stop();
+        ui->label_file->clear();
+    }
+}
+
+bool TCPServer::startFileReceiver()
+{
+    if(ui->spin_localPort->value() >= 65535)
+    {
+        qWarning() << QString("监听端口为65535时没有可用的文件接收端口（端口+1）");
+        return false;
+    }
+    quint16 port = quint16(ui->spin_localPort->value() + 1);
+    if(!m_fileReceiver->listen(QHostAddress::Any, port))
+    {
+        qWarning() << QString("文件接收端口%1监听失败：%2").arg(port).arg(m_fileReceiver->errorString());
+        return false;
+    }
+    ui->label_file->setText(QString("文件接收端口：%1\n保存到：%2").arg(port).arg(m_fileReceiver->directory()));
+    return true;
+}
+
+void TCPServer::on_fileStarted(const QString &name, qint64 size, qint64 offset)
+{
+    ui->progress_file->setValue(size > 0 ? int(offset * 100 / size) : 0);
+    qInfo() << QString("开始接收文件：%1，大小%2字节，从%3字节处开始").arg(name).arg(size).arg(offset);
+}
+
+/**
+ * @brief 显示文件接收进度和速度
+ */
+void TCPServer::on_fileProgress(const QString &name, qint64 done, qint64 total, double bytesPerSecond)
+{
+    ui->progress_file->setValue(total > 0 ? int(done * 100 / total) : 100);
+    ui->label_file->setText(QString("%1\n%2/%3 MB  %4").arg(name).arg(done >> 20).arg(total >> 20).arg(FileTransfer::speedString(bytesPerSecond)));
+}
+
+void TCPServer::on_fileFinished(const QString &name, bool ok, const QString &message)
+{
+    ui->label_file->setText(QString("%1\n%2").arg(name, ok ? "接收完成" : message));
+    if(ok)
+    {
+        ui->progress_file->setValue(100);
+        qInfo() << QString("文件接收完成：%1").arg(message);
+    }
+    else
+    {
+        qWarning() << QString("文件接收失败：%1 %2").arg(name, message);
     }
-    return len;
 }
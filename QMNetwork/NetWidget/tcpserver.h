@@ -2,8 +2,9 @@
 #define TCPSERVER_H
 
 #include <QWidget>
-#include <QTcpServer>
-#include <QTcpSocket>
+#include "tcpserverengine.h"
+
+class FileReceiver;
 namespace Ui {
 class TCPServer;
 }
@@ -17,11 +18,10 @@ public:
     ~TCPServer();
 
 private slots:
-    void on_newConnection();
     void on_acceptError(QAbstractSocket::SocketError socketError);
+    void on_statistics(const TcpServerEngine::Statistics& statistics);
     void on_but_connect_clicked();
-    void on_disconnected();
-    void on_readyRead();
+    void on_check_echo_clicked(bool checked);
 
     void on_but_clearRecv_clicked();
 
@@ -33,17 +33,24 @@ private slots:
 
     void on_but_send_clicked();
 
+    void on_check_recvFile_clicked(bool checked);
+    void on_fileStarted(const QString& name, qint64 size, qint64 offset);
+    void on_fileProgress(const QString& name, qint64 done, qint64 total, double bytesPerSecond);
+    void on_fileFinished(const QString& name, bool ok, const QString& message);
+
 private:
     void init();
+    bool startFileReceiver();
     void connectSlots();
-    void addPeer(const QString& peer);
     qint64 sendData(const QByteArray& data);
 
 private:
     Ui::TCPServer *ui;
 
-    QTcpServer* m_tcpServer = nullptr;
-    QList<QTcpSocket*> m_tcpClients;        // 保存所有连接的客户端
+    TcpServerEngine* m_tcpServer = nullptr;  // 多线程服务端，客户端在工作线程中管理，界面只显示统计信息
+    FileReceiver* m_fileReceiver = nullptr;  // 在监听端口+1上接收文件
+    quint64 m_bytesReceived = 0;             // 服务端累计接收的字节数
+    quint64 m_recvBase = 0;                  // 清空接收区时的累计接收字节数，界面显示与它的差值
 };
 
 #endif // TCPSERVER_H
@@ -0,0 +1,331 @@
+﻿#include "tcpserverengine.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QHash>
+#include <QMutex>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+#include <atomic>
+
+#ifdef Q_OS_WIN
+#include <winsock2.h>
+#else
+#include <unistd.h>
+#endif
+
+/**
+ * @brief 工作线程中的对象，管理分配给该线程的所有客户端；除统计和采样外只在所属线程中访问
+ */
+class TcpServerWorker : public QObject
+{
+public:
+    void addClient(qintptr socketDescriptor, quint64 id);
+    void send(quint64 id, const QByteArray& data);
+    void broadcast(const QByteArray& data);
+    void closeClient(quint64 id);
+    void closeAll();
+
+    TcpServerEngine::WorkerStatistics statistics() const;
+    bool takeSample(TcpServerEngine::Sample& sample);   // 取出采样数据，并请求下一次采样
+
+    std::atomic<bool> echo{false};
+
+private:
+    void on_readyRead(QTcpSocket* socket);
+    void on_disconnected(quint64 id, QTcpSocket* socket);
+    void write(QTcpSocket* socket, const QByteArray& data);
+
+private:
+    QHash<quint64, QTcpSocket*> m_clients;   // 客户端id -> socket
+    std::atomic<int> m_clientCount{0};
+    std::atomic<quint64> m_bytesReceived{0};
+    std::atomic<quint64> m_bytesSent{0};
+
+    std::atomic<bool> m_wantSample{true};    // 界面取走采样后才再次采样，接收数据时基本没有额外开销
+    QMutex m_sampleMutex;
+    TcpServerEngine::Sample m_sample;
+    bool m_hasSample = false;
+};
+
+/**
+ * @brief 在工作线程中用描述符创建socket
+ */
+void TcpServerWorker::addClient(qintptr socketDescriptor, quint64 id)
+{
+    QTcpSocket* socket = new QTcpSocket();
+    if (!socket->setSocketDescriptor(socketDescriptor))
+    {
+        qWarning() << QString("TcpServer设置socket描述符失败：%1").arg(socket->errorString());
+        delete socket;
+        // 设置失败时socket没有接管描述符，需要自己关闭，否则客户端一直处于连接状态并泄漏描述符
+#ifdef Q_OS_WIN
+        closesocket(SOCKET(socketDescriptor));
+#else
+        ::close(int(socketDescriptor));
+#endif
+        return;
+    }
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { on_readyRead(socket); });
+    connect(socket, &QTcpSocket::disconnected, this, [this, id, socket]() { on_disconnected(id, socket); });
+    m_clients.insert(id, socket);
+    m_clientCount = m_clients.size();
+}
+
+void TcpServerWorker::send(quint64 id, const QByteArray& data)
+{
+    QTcpSocket* socket = m_clients.value(id, nullptr);
+    if (socket)
+    {
+        write(socket, data);
+    }
+}
+
+void TcpServerWorker::broadcast(const QByteArray& data)
+{
+    for (QTcpSocket* socket : qAsConst(m_clients))
+    {
+        write(socket, data);
+    }
+}
+
+void TcpServerWorker::closeClient(quint64 id)
+{
+    QTcpSocket* socket = m_clients.value(id, nullptr);
+    if (socket)
+    {
+        socket->abort();   // 触发disconnected，在on_disconnected中移除
+    }
+}
+
+/**
+ * @brief 断开并释放所有客户端，工作线程退出前调用
+ */
+void TcpServerWorker::closeAll()
+{
+    const QHash<quint64, QTcpSocket*> clients = m_clients;
+    m_clients.clear();
+    m_clientCount = 0;
+    for (QTcpSocket* socket : clients)
+    {
+        socket->disconnect(this);
+        socket->abort();
+        delete socket;   // 不在socket的信号中，可以直接释放
+    }
+}
+
+TcpServerEngine::WorkerStatistics TcpServerWorker::statistics() const
+{
+    TcpServerEngine::WorkerStatistics statistics;
+    statistics.clients = m_clientCount.load(std::memory_order_relaxed);
+    statistics.bytesReceived = m_bytesReceived.load(std::memory_order_relaxed);
+    statistics.bytesSent = m_bytesSent.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+bool TcpServerWorker::takeSample(TcpServerEngine::Sample& sample)
+{
+    QMutexLocker locker(&m_sampleMutex);
+    const bool hasSample = m_hasSample;
+    if (hasSample)
+    {
+        sample = m_sample;
+        m_hasSample = false;
+    }
+    m_wantSample = true;
+    return hasSample;
+}
+
+void TcpServerWorker::on_readyRead(QTcpSocket* socket)
+{
+    const QByteArray data = socket->readAll();
+    m_bytesReceived.fetch_add(quint64(data.size()), std::memory_order_relaxed);
+    if (m_wantSample.load(std::memory_order_relaxed) && m_wantSample.exchange(false))
+    {
+        QString peer = QString("%1 %2").arg(socket->peerAddress().toString()).arg(socket->peerPort());
+        peer.remove("::ffff:");
+        QMutexLocker locker(&m_sampleMutex);
+        m_sample.peer = peer;
+        m_sample.data = data.left(256);
+        m_hasSample = true;
+    }
+    if (echo.load(std::memory_order_relaxed))
+    {
+        write(socket, data);
+    }
+}
+
+void TcpServerWorker::on_disconnected(quint64 id, QTcpSocket* socket)
+{
+    m_clients.remove(id);
+    m_clientCount = m_clients.size();
+    socket->deleteLater();   // 正处于socket的信号中，不能直接delete
+}
+
+void TcpServerWorker::write(QTcpSocket* socket, const QByteArray& data)
+{
+    const qint64 ret = socket->write(data);
+    if (ret > 0)
+    {
+        m_bytesSent.fetch_add(quint64(ret), std::memory_order_relaxed);
+    }
+}
+
+TcpServerEngine::TcpServerEngine(QObject* parent)
+    : QTcpServer(parent)
+{
+    m_timer = new QTimer(this);
+    m_timer->setInterval(500);
+    connect(m_timer, &QTimer::timeout, this, &TcpServerEngine::on_timeout);
+}
+
+TcpServerEngine::~TcpServerEngine()
+{
+    stop();
+}
+
+/**
+ * @brief          创建工作线程并开始监听
+ * @param threads  工作线程数，小于1时使用CPU核心数
+ */
+bool TcpServerEngine::start(const QHostAddress& address, quint16 port, int threads)
+{
+    stop();
+    if (threads < 1)
+    {
+        threads = QThread::idealThreadCount();
+    }
+    for (int i = 0; i < threads; ++i)
+    {
+        QThread* thread = new QThread();
+        thread->setObjectName(QString("TcpServerWorker%1").arg(i));
+        TcpServerWorker* worker = new TcpServerWorker();
+        worker->echo = m_echo;
+        worker->moveToThread(thread);
+        thread->start();
+        m_threads.append(thread);
+        m_workers.append(worker);
+    }
+
+    if (!listen(address, port))
+    {
+        stop();
+        return false;
+    }
+    m_nextId = 0;
+    m_last = Statistics();
+    m_lastTime = QDateTime::currentMSecsSinceEpoch();
+    m_timer->start();
+    return true;
+}
+
+void TcpServerEngine::stop()
+{
+    close();
+    m_timer->stop();
+    for (int i = 0; i < m_workers.count(); i++)
+    {
+        TcpServerWorker* worker = m_workers.at(i);
+        QMetaObject::invokeMethod(
+            worker, [worker]() { worker->closeAll(); }, Qt::BlockingQueuedConnection);   // 在工作线程中释放socket
+        m_threads.at(i)->quit();
+        m_threads.at(i)->wait();
+        delete worker;   // 线程已经退出，可以在当前线程中释放
+        delete m_threads.at(i);
+    }
+    m_workers.clear();
+    m_threads.clear();
+}
+
+void TcpServerEngine::setEcho(bool echo)
+{
+    m_echo = echo;
+    for (TcpServerWorker* worker : qAsConst(m_workers))
+    {
+        worker->echo = echo;
+    }
+}
+
+int TcpServerEngine::broadcast(const QByteArray& data)
+{
+    int clients = 0;
+    for (TcpServerWorker* worker : qAsConst(m_workers))
+    {
+        clients += worker->statistics().clients;
+        QMetaObject::invokeMethod(
+            worker, [worker, data]() { worker->broadcast(data); }, Qt::QueuedConnection);   // QByteArray隐式共享，不复制数据
+    }
+    return clients;
+}
+
+void TcpServerEngine::send(quint64 id, const QByteArray& data)
+{
+    TcpServerWorker* worker = workerOf(id);
+    if (worker)
+    {
+        QMetaObject::invokeMethod(
+            worker, [worker, id, data]() { worker->send(id, data); }, Qt::QueuedConnection);
+    }
+}
+
+void TcpServerEngine::closeClient(quint64 id)
+{
+    TcpServerWorker* worker = workerOf(id);
+    if (worker)
+    {
+        QMetaObject::invokeMethod(
+            worker, [worker, id]() { worker->closeClient(id); }, Qt::QueuedConnection);
+    }
+}
+
+/**
+ * @brief 新连接：不创建QTcpSocket，将描述符轮流交给工作线程（不会进入QTcpServer的等待队列，不受setMaxPendingConnections限制）
+ */
+void TcpServerEngine::incomingConnection(qintptr socketDescriptor)
+{
+    const quint64 id = m_nextId++;
+    TcpServerWorker* worker = workerOf(id);
+    QMetaObject::invokeMethod(
+        worker, [worker, socketDescriptor, id]() { worker->addClient(socketDescriptor, id); }, Qt::QueuedConnection);
+}
+
+TcpServerWorker* TcpServerEngine::workerOf(quint64 id) const
+{
+    if (m_workers.isEmpty())
+    {
+        return nullptr;
+    }
+    return m_workers.at(int(id % quint64(m_workers.count())));
+}
+
+/**
+ * @brief 汇总各工作线程的统计信息和采样数据，计算速率
+ */
+void TcpServerEngine::on_timeout()
+{
+    Statistics statistics;
+    statistics.accepted = m_nextId;
+    for (TcpServerWorker* worker : qAsConst(m_workers))
+    {
+        const WorkerStatistics workerStatistics = worker->statistics();
+        statistics.clients += workerStatistics.clients;
+        statistics.bytesReceived += workerStatistics.bytesReceived;
+        statistics.bytesSent += workerStatistics.bytesSent;
+        statistics.workers.append(workerStatistics);
+
+        Sample sample;
+        if (worker->takeSample(sample))
+        {
+            statistics.samples.append(sample);
+        }
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const double seconds = qMax<qint64>(now - m_lastTime, 1) / 1000.0;
+    statistics.receiveRate = double(statistics.bytesReceived - m_last.bytesReceived) / seconds;
+    statistics.sendRate = double(statistics.bytesSent - m_last.bytesSent) / seconds;
+    m_last = statistics;
+    m_lastTime = now;
+
+    emit this->statistics(statistics);
+}
@@ -0,0 +1,81 @@
+﻿#ifndef TCPSERVERENGINE_H
+#define TCPSERVERENGINE_H
+
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QVector>
+
+class QThread;
+class QTimer;
+class TcpServerWorker;
+
+/**
+ * @brief 多线程TCP服务端
+ *
+ * 重写incomingConnection，不在GUI线程中创建QTcpSocket，而是将socket描述符轮流交给N个工作线程，
+ * 每个工作线程有自己的事件循环，在线程中创建、读写、释放自己的socket。
+ * 客户端id按连接顺序分配，id % 线程数就是所在的工作线程，线程内用QHash按id保存客户端，发送、断开都是O(1)。
+ * 界面只定时收到汇总的统计信息和少量数据采样，不会因为客户端数量或数据量大而卡死。
+ */
+class TcpServerEngine : public QTcpServer
+{
+    Q_OBJECT
+public:
+    struct WorkerStatistics
+    {
+        int clients = 0;
+        quint64 bytesReceived = 0;
+        quint64 bytesSent = 0;
+    };
+
+    struct Sample
+    {
+        QString peer;       // IP 端口
+        QByteArray data;    // 最多256字节
+    };
+
+    struct Statistics
+    {
+        int clients = 0;              // 当前连接数
+        quint64 accepted = 0;         // 累计接受的连接数
+        quint64 bytesReceived = 0;
+        quint64 bytesSent = 0;
+        double receiveRate = 0;       // 接收速率（字节/秒）
+        double sendRate = 0;
+        QVector<WorkerStatistics> workers;
+        QVector<Sample> samples;      // 每个工作线程在这段时间内收到的一段数据
+    };
+
+    explicit TcpServerEngine(QObject* parent = nullptr);
+    ~TcpServerEngine() override;
+
+    bool start(const QHostAddress& address, quint16 port, int threads);   // 创建工作线程并开始监听
+    void stop();                                                          // 停止监听，断开所有客户端，退出工作线程
+    bool isRunning() const { return !m_workers.isEmpty(); }
+
+    void setEcho(bool echo);                          // 是否将收到的数据原样发回（压力测试）
+    int broadcast(const QByteArray& data);            // 向所有客户端发送，返回发送时的连接数
+    void send(quint64 id, const QByteArray& data);    // 向一个客户端发送
+    void closeClient(quint64 id);
+
+signals:
+    void statistics(const TcpServerEngine::Statistics& statistics);   // 每500ms触发一次
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+    void on_timeout();
+    TcpServerWorker* workerOf(quint64 id) const;
+
+private:
+    QVector<QThread*> m_threads;
+    QVector<TcpServerWorker*> m_workers;
+    QTimer* m_timer = nullptr;
+    quint64 m_nextId = 0;        // 只在GUI线程中访问
+    bool m_echo = false;
+    Statistics m_last;           // 上一次的统计，用于计算速率
+    qint64 m_lastTime = 0;
+};
+
+#endif   // TCPSERVERENGINE_H
@@ -0,0 +1,582 @@
+﻿#include "udpengine.h"
+#include "MPMCQueue.h"
+#include <QThread>
+#include <QtEndian>
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <QSocketNotifier>
+#include <cerrno>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#ifndef SO_RXQ_OVFL
+#define SO_RXQ_OVFL 40
+#endif
+#else
+#include <QUdpSocket>
+#endif
+
+QHostAddress UdpDatagram::sender() const
+{
+    if (ipv6)
+    {
+        return QHostAddress(senderAddress);
+    }
+    return QHostAddress(qFromBigEndian<quint32>(senderAddress));
+}
+
+/**
+ * @brief 接收线程中的对象，负责socket的创建、收发和释放；统计信息使用原子变量，其它线程可以读取
+ */
+class UdpEngineWorker : public QObject
+{
+public:
+    UdpEngineWorker(UdpEngine* engine, int slotSize);
+
+    bool open(const QHostAddress& address, quint16 port, const UdpEngine::Options& options, QString& error);
+    void close();
+    void send(const QVector<QByteArray>& datagrams, const QHostAddress& address, quint16 port);
+    UdpEngine::Statistics statistics() const;
+
+private:
+    void on_readable();
+    void deliver(UdpBatch* batch, int count, quint64 bytes);
+
+private:
+    UdpEngine* m_engine = nullptr;
+    QByteArray m_scratchBuffer;
+    UdpBatch m_scratch;   // 没有空闲批次时接收到这里并丢弃，避免数据堆积在内核中
+
+    std::atomic<quint64> m_packetsReceived{0};
+    std::atomic<quint64> m_bytesReceived{0};
+    std::atomic<quint64> m_packetsSent{0};
+    std::atomic<quint64> m_bytesSent{0};
+    std::atomic<quint64> m_batches{0};
+    std::atomic<quint64> m_kernelDrops{0};
+    std::atomic<quint64> m_queueDrops{0};
+    std::atomic<quint64> m_truncated{0};
+    std::atomic<quint64> m_sendErrors{0};
+    std::atomic<int> m_receiveBufferSize{0};
+
+#ifdef Q_OS_LINUX
+    int m_fd = -1;
+    bool m_ipv6 = false;
+    QSocketNotifier* m_notifier = nullptr;
+    mmsghdr m_messages[UdpBatch::Capacity];
+    iovec m_iovecs[UdpBatch::Capacity];
+    sockaddr_storage m_addresses[UdpBatch::Capacity];
+    char m_control[UdpBatch::Capacity][CMSG_SPACE(sizeof(quint32))];   // SO_RXQ_OVFL的丢包计数
+#else
+    QUdpSocket* m_socket = nullptr;
+#endif
+};
+
+UdpEngineWorker::UdpEngineWorker(UdpEngine* engine, int slotSize)
+    : m_engine(engine)
+{
+    m_scratchBuffer.resize(UdpBatch::Capacity * slotSize);
+    m_scratch.buffer = m_scratchBuffer.data();
+    m_scratch.slotSize = slotSize;
+}
+
+UdpEngine::Statistics UdpEngineWorker::statistics() const
+{
+    UdpEngine::Statistics statistics;
+    statistics.packetsReceived = m_packetsReceived.load(std::memory_order_relaxed);
+    statistics.bytesReceived = m_bytesReceived.load(std::memory_order_relaxed);
+    statistics.packetsSent = m_packetsSent.load(std::memory_order_relaxed);
+    statistics.bytesSent = m_bytesSent.load(std::memory_order_relaxed);
+    statistics.batches = m_batches.load(std::memory_order_relaxed);
+    statistics.kernelDrops = m_kernelDrops.load(std::memory_order_relaxed);
+    statistics.queueDrops = m_queueDrops.load(std::memory_order_relaxed);
+    statistics.truncated = m_truncated.load(std::memory_order_relaxed);
+    statistics.sendErrors = m_sendErrors.load(std::memory_order_relaxed);
+    statistics.receiveBufferSize = m_receiveBufferSize.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+/**
+ * @brief       将接收完的一批交给使用者；使用者取空队列之前只通知一次
+ * @param batch 为m_scratch时说明没有空闲批次，直接丢弃
+ */
+void UdpEngineWorker::deliver(UdpBatch* batch, int count, quint64 bytes)
+{
+    m_packetsReceived.fetch_add(quint64(count), std::memory_order_relaxed);
+    m_bytesReceived.fetch_add(bytes, std::memory_order_relaxed);
+    m_batches.fetch_add(1, std::memory_order_relaxed);
+    if (batch == &m_scratch)
+    {
+        m_queueDrops.fetch_add(quint64(count), std::memory_order_relaxed);
+        return;
+    }
+    batch->count = count;
+    m_engine->m_fullBatches->tryPush(batch);   // 批次总数等于队列容量，不会失败
+    if (!m_engine->m_notified.exchange(true))
+    {
+        UdpEngine* engine = m_engine;
+        QMetaObject::invokeMethod(
+            engine, [engine]() { emit engine->readyRead(); }, Qt::QueuedConnection);
+    }
+}
+
+#ifdef Q_OS_LINUX
+/**
+ * @brief 将QHostAddress转换为sockaddr，IPv6 socket发送到IPv4地址时使用IPv4映射地址
+ */
+static socklen_t toSockaddr(const QHostAddress& address, quint16 port, bool ipv6Socket, sockaddr_storage& storage)
+{
+    memset(&storage, 0, sizeof(storage));
+    if (ipv6Socket)
+    {
+        sockaddr_in6* in6 = reinterpret_cast<sockaddr_in6*>(&storage);
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons(port);
+        bool isIPv4 = false;
+        const quint32 ipv4 = address.toIPv4Address(&isIPv4);
+        if (isIPv4 && address != QHostAddress::Any && address != QHostAddress::AnyIPv6)
+        {
+            in6->sin6_addr.s6_addr[10] = 0xFF;
+            in6->sin6_addr.s6_addr[11] = 0xFF;
+            qToBigEndian(ipv4, in6->sin6_addr.s6_addr + 12);
+        }
+        else if (address != QHostAddress::Any)
+        {
+            const Q_IPV6ADDR ipv6 = address.toIPv6Address();
+            memcpy(in6->sin6_addr.s6_addr, ipv6.c, 16);
+        }
+        return sizeof(sockaddr_in6);
+    }
+    sockaddr_in* in4 = reinterpret_cast<sockaddr_in*>(&storage);
+    in4->sin_family = AF_INET;
+    in4->sin_port = htons(port);
+    in4->sin_addr.s_addr = htonl(address.toIPv4Address());
+    return sizeof(sockaddr_in);
+}
+
+bool UdpEngineWorker::open(const QHostAddress& address, quint16 port, const UdpEngine::Options& options, QString& error)
+{
+    m_ipv6 = address.protocol() != QAbstractSocket::IPv4Protocol;   // Any使用IPv6双栈socket，同时接收IPv4数据
+    m_fd = ::socket(m_ipv6 ? AF_INET6 : AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0)
+    {
+        error = QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+    const int on = 1;
+    const int off = 0;
+    setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    setsockopt(m_fd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+    setsockopt(m_fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on));   // 每个数据报附带内核丢包计数
+    if (m_ipv6)
+    {
+        setsockopt(m_fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+    }
+    if (options.receiveBufferSize > 0)
+    {
+        setsockopt(m_fd, SOL_SOCKET, SO_RCVBUF, &options.receiveBufferSize, sizeof(options.receiveBufferSize));   // 受net.core.rmem_max限制
+    }
+    int receiveBufferSize = 0;
+    socklen_t length = sizeof(receiveBufferSize);
+    getsockopt(m_fd, SOL_SOCKET, SO_RCVBUF, &receiveBufferSize, &length);
+    m_receiveBufferSize = receiveBufferSize;
+
+    sockaddr_storage storage;
+    const socklen_t size = toSockaddr(address, port, m_ipv6, storage);
+    if (::bind(m_fd, reinterpret_cast<sockaddr*>(&storage), size) < 0)
+    {
+        error = QString::fromLocal8Bit(strerror(errno));
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+    connect(m_notifier, QOverload<QSocketDescriptor, QSocketNotifier::Type>::of(&QSocketNotifier::activated), this, [this]() { on_readable(); });
+#else
+    connect(m_notifier, &QSocketNotifier::activated, this, [this]() { on_readable(); });
+#endif
+    return true;
+}
+
+void UdpEngineWorker::close()
+{
+    delete m_notifier;
+    m_notifier = nullptr;
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+/**
+ * @brief 一次recvmmsg接收一批；一直读到内核缓冲区为空（最多16批，避免长时间不处理发送请求）
+ */
+void UdpEngineWorker::on_readable()
+{
+    for (int round = 0; round < 16; ++round)
+    {
+        UdpBatch* batch = nullptr;
+        if (!m_engine->m_freeBatches->tryPop(batch))
+        {
+            batch = &m_scratch;
+        }
+        for (int i = 0; i < UdpBatch::Capacity; ++i)
+        {
+            m_iovecs[i].iov_base = batch->slot(i);
+            m_iovecs[i].iov_len = size_t(batch->slotSize);
+            msghdr& header = m_messages[i].msg_hdr;
+            header.msg_name = &m_addresses[i];
+            header.msg_namelen = sizeof(m_addresses[i]);
+            header.msg_iov = &m_iovecs[i];
+            header.msg_iovlen = 1;
+            header.msg_control = m_control[i];
+            header.msg_controllen = sizeof(m_control[i]);
+            header.msg_flags = 0;
+        }
+
+        const int count = recvmmsg(m_fd, m_messages, UdpBatch::Capacity, MSG_DONTWAIT, nullptr);
+        if (count <= 0)   // EAGAIN：已经读完
+        {
+            if (batch != &m_scratch)
+            {
+                m_engine->m_freeBatches->tryPush(batch);
+            }
+            break;
+        }
+
+        quint64 bytes = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            UdpDatagram& datagram = batch->datagrams[i];
+            msghdr& header = m_messages[i].msg_hdr;
+            datagram.data = batch->slot(i);
+            datagram.size = int(m_messages[i].msg_len);
+            datagram.truncated = header.msg_flags & MSG_TRUNC;
+            if (datagram.truncated)
+            {
+                m_truncated.fetch_add(1, std::memory_order_relaxed);
+            }
+            bytes += m_messages[i].msg_len;
+
+            const sockaddr_storage& storage = m_addresses[i];
+            if (storage.ss_family == AF_INET6)
+            {
+                const sockaddr_in6* in6 = reinterpret_cast<const sockaddr_in6*>(&storage);
+                datagram.senderPort = ntohs(in6->sin6_port);
+                datagram.ipv6 = !IN6_IS_ADDR_V4MAPPED(&in6->sin6_addr);
+                if (datagram.ipv6)
+                {
+                    memcpy(datagram.senderAddress, in6->sin6_addr.s6_addr, 16);
+                }
+                else
+                {
+                    memcpy(datagram.senderAddress, in6->sin6_addr.s6_addr + 12, 4);
+                }
+            }
+            else
+            {
+                const sockaddr_in* in4 = reinterpret_cast<const sockaddr_in*>(&storage);
+                datagram.senderPort = ntohs(in4->sin_port);
+                datagram.ipv6 = false;
+                memcpy(datagram.senderAddress, &in4->sin_addr.s_addr, 4);
+            }
+
+            for (cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(&header, cmsg))
+            {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+                {
+                    quint32 drops = 0;
+                    memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));   // socket创建以来累计丢弃的数量
+                    m_kernelDrops.store(drops, std::memory_order_relaxed);
+                }
+            }
+        }
+        deliver(batch, count, bytes);
+        if (count < UdpBatch::Capacity)
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 一次sendmmsg最多发送64个数据报；内核发送缓冲区满时最多等待10ms
+ */
+void UdpEngineWorker::send(const QVector<QByteArray>& datagrams, const QHostAddress& address, quint16 port)
+{
+    if (m_fd < 0)
+    {
+        return;
+    }
+    sockaddr_storage storage;
+    const socklen_t size = toSockaddr(address, port, m_ipv6, storage);
+    mmsghdr messages[UdpBatch::Capacity];
+    iovec iovecs[UdpBatch::Capacity];
+
+    int offset = 0;
+    while (offset < datagrams.count())
+    {
+        const int count = qMin(UdpBatch::Capacity, datagrams.count() - offset);
+        memset(messages, 0, sizeof(mmsghdr) * size_t(count));
+        for (int i = 0; i < count; ++i)
+        {
+            const QByteArray& datagram = datagrams.at(offset + i);
+            iovecs[i].iov_base = const_cast<char*>(datagram.constData());
+            iovecs[i].iov_len = size_t(datagram.size());
+            messages[i].msg_hdr.msg_name = &storage;
+            messages[i].msg_hdr.msg_namelen = size;
+            messages[i].msg_hdr.msg_iov = &iovecs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        const int sent = sendmmsg(m_fd, messages, unsigned(count), 0);
+        if (sent < 0)
+        {
+            pollfd fd = {m_fd, POLLOUT, 0};
+            if ((errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) && poll(&fd, 1, 10) > 0)
+            {
+                continue;
+            }
+            m_sendErrors.fetch_add(quint64(datagrams.count() - offset), std::memory_order_relaxed);
+            return;
+        }
+        for (int i = 0; i < sent; ++i)
+        {
+            m_bytesSent.fetch_add(messages[i].msg_len, std::memory_order_relaxed);
+        }
+        m_packetsSent.fetch_add(quint64(sent), std::memory_order_relaxed);
+        offset += sent;
+    }
+}
+
+#else
+
+bool UdpEngineWorker::open(const QHostAddress& address, quint16 port, const UdpEngine::Options& options, QString& error)
+{
+    m_socket = new QUdpSocket(this);
+    if (!m_socket->bind(address, port, QAbstractSocket::ShareAddress | QAbstractSocket::ReuseAddressHint))
+    {
+        error = m_socket->errorString();
+        delete m_socket;
+        m_socket = nullptr;
+        return false;
+    }
+    if (options.receiveBufferSize > 0)
+    {
+        m_socket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, options.receiveBufferSize);
+    }
+    m_receiveBufferSize = m_socket->socketOption(QAbstractSocket::ReceiveBufferSizeSocketOption).toInt();
+    connect(m_socket, &QUdpSocket::readyRead, this, &UdpEngineWorker::on_readable);
+    return true;
+}
+
+void UdpEngineWorker::close()
+{
+    delete m_socket;
+    m_socket = nullptr;
+}
+
+/**
+ * @brief 没有recvmmsg的平台逐个读取，但仍然按批交给使用者（不支持统计内核丢包）
+ */
+void UdpEngineWorker::on_readable()
+{
+    while (m_socket->hasPendingDatagrams())
+    {
+        UdpBatch* batch = nullptr;
+        if (!m_engine->m_freeBatches->tryPop(batch))
+        {
+            batch = &m_scratch;
+        }
+        int count = 0;
+        quint64 bytes = 0;
+        while (count < UdpBatch::Capacity && m_socket->hasPendingDatagrams())
+        {
+            QHostAddress address;
+            quint16 port = 0;
+            const qint64 pending = m_socket->pendingDatagramSize();
+            const qint64 size = m_socket->readDatagram(batch->slot(count), batch->slotSize, &address, &port);
+            if (size < 0)
+            {
+                break;
+            }
+            UdpDatagram& datagram = batch->datagrams[count];
+            datagram.data = batch->slot(count);
+            datagram.size = int(size);
+            datagram.truncated = pending > batch->slotSize;
+            if (datagram.truncated)
+            {
+                m_truncated.fetch_add(1, std::memory_order_relaxed);
+            }
+            datagram.senderPort = port;
+            bool isIPv4 = false;
+            const quint32 ipv4 = address.toIPv4Address(&isIPv4);
+            datagram.ipv6 = !isIPv4;
+            if (isIPv4)
+            {
+                qToBigEndian(ipv4, datagram.senderAddress);
+            }
+            else
+            {
+                const Q_IPV6ADDR ipv6 = address.toIPv6Address();
+                memcpy(datagram.senderAddress, ipv6.c, 16);
+            }
+            bytes += quint64(size);
+            ++count;
+        }
+        if (count == 0)
+        {
+            if (batch != &m_scratch)
+            {
+                m_engine->m_freeBatches->tryPush(batch);
+            }
+            break;
+        }
+        deliver(batch, count, bytes);
+    }
+}
+
+void UdpEngineWorker::send(const QVector<QByteArray>& datagrams, const QHostAddress& address, quint16 port)
+{
+    if (!m_socket)
+    {
+        return;
+    }
+    for (const QByteArray& datagram : datagrams)
+    {
+        const qint64 ret = m_socket->writeDatagram(datagram, address, port);
+        if (ret < 0)
+        {
+            m_sendErrors.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        m_packetsSent.fetch_add(1, std::memory_order_relaxed);
+        m_bytesSent.fetch_add(quint64(ret), std::memory_order_relaxed);
+    }
+}
+#endif
+
+UdpEngine::UdpEngine(QObject* parent)
+    : QObject(parent)
+{
+}
+
+UdpEngine::~UdpEngine()
+{
+    stop();
+}
+
+/**
+ * @brief          分配所有批次的内存，创建接收线程并在线程中绑定端口
+ * @param address  QHostAddress::Any时同时接收IPv4和IPv6
+ */
+bool UdpEngine::start(const QHostAddress& address, quint16 port, const Options& options)
+{
+    stop();
+    const int slotSize = qBound(64, options.maxDatagramSize, 65536);
+    const int batchCount = qBound(2, options.batchCount, 512 * 1024 * 1024 / (UdpBatch::Capacity * slotSize));   // 最多512MB
+    m_slab = QByteArray(batchCount * UdpBatch::Capacity * slotSize, Qt::Uninitialized);
+    m_batches.resize(batchCount);
+    m_freeBatches = new MPMCQueue<UdpBatch*>(size_t(batchCount));
+    m_fullBatches = new MPMCQueue<UdpBatch*>(size_t(batchCount));
+    for (int i = 0; i < batchCount; ++i)
+    {
+        UdpBatch& batch = m_batches[i];
+        batch.buffer = m_slab.data() + qint64(i) * UdpBatch::Capacity * slotSize;
+        batch.slotSize = slotSize;
+        m_freeBatches->tryPush(&batch);
+    }
+    m_notified = false;
+
+    m_thread = new QThread();
+    m_thread->setObjectName("UdpEngine");
+    m_worker = new UdpEngineWorker(this, slotSize);
+    m_worker->moveToThread(m_thread);
+    m_thread->start();
+
+    bool ok = false;
+    UdpEngineWorker* worker = m_worker;
+    QMetaObject::invokeMethod(
+        worker, [&]() { ok = worker->open(address, port, options, m_error); }, Qt::BlockingQueuedConnection);
+    if (!ok)
+    {
+        QString error = m_error;
+        stop();
+        m_error = error;
+    }
+    return ok;
+}
+
+/**
+ * @brief 关闭socket并退出线程，调用前必须归还所有取出的批次
+ */
+void UdpEngine::stop()
+{
+    if (m_worker)
+    {
+        UdpEngineWorker* worker = m_worker;
+        QMetaObject::invokeMethod(
+            worker, [worker]() { worker->close(); }, Qt::BlockingQueuedConnection);
+        m_thread->quit();
+        m_thread->wait();
+        delete m_worker;
+        delete m_thread;
+        m_worker = nullptr;
+        m_thread = nullptr;
+    }
+    delete m_freeBatches;
+    delete m_fullBatches;
+    m_freeBatches = nullptr;
+    m_fullBatches = nullptr;
+    m_batches.clear();
+    m_slab.clear();
+    m_error.clear();
+}
+
+void UdpEngine::send(const QByteArray& datagram, const QHostAddress& address, quint16 port)
+{
+    send(QVector<QByteArray>{datagram}, address, port);
+}
+
+void UdpEngine::send(const QVector<QByteArray>& datagrams, const QHostAddress& address, quint16 port)
+{
+    UdpEngineWorker* worker = m_worker;
+    if (worker)
+    {
+        QMetaObject::invokeMethod(
+            worker, [worker, datagrams, address, port]() { worker->send(datagrams, address, port); }, Qt::QueuedConnection);
+    }
+}
+
+UdpBatch* UdpEngine::takeBatch()
+{
+    if (!m_fullBatches)
+    {
+        return nullptr;
+    }
+    UdpBatch* batch = nullptr;
+    if (m_fullBatches->tryPop(batch))
+    {
+        return batch;
+    }
+    m_notified = false;   // 先清除标志再检查一次，避免接收线程在两次检查之间放入的批次没有通知
+    return m_fullBatches->tryPop(batch) ? batch : nullptr;
+}
+
+void UdpEngine::releaseBatch(UdpBatch* batch)
+{
+    if (batch && m_freeBatches)
+    {
+        batch->count = 0;
+        m_freeBatches->tryPush(batch);
+    }
+}
+
+UdpEngine::Statistics UdpEngine::statistics() const
+{
+    return m_worker ? m_worker->statistics() : Statistics();
+}
@@ -0,0 +1,107 @@
+﻿#ifndef UDPENGINE_H
+#define UDPENGINE_H
+
+#include <QHostAddress>
+#include <QObject>
+#include <QVector>
+#include <atomic>
+
+class QThread;
+class UdpEngineWorker;
+template<typename T>
+class MPMCQueue;
+
+/**
+ * @brief 一个数据报，data指向预先分配的内存，只在所属的UdpBatch归还之前有效
+ */
+struct UdpDatagram
+{
+    const char* data = nullptr;
+    int size = 0;
+    bool truncated = false;   // 数据报比槽位大，只保存了前maxDatagramSize个字节
+    bool ipv6 = false;
+    quint16 senderPort = 0;
+    quint8 senderAddress[16] = {};   // IPv4只使用前4个字节（网络字节序），需要时再转换为QHostAddress，避免每个数据报都分配内存
+
+    QHostAddress sender() const;
+};
+
+/**
+ * @brief 一批数据报，所有批次在启动时一次性分配，接收线程填满后交给使用者，使用者处理完后归还
+ */
+struct UdpBatch
+{
+    static const int Capacity = 64;   // 每次recvmmsg最多接收的数据报数量
+
+    int count = 0;
+    char* buffer = nullptr;           // Capacity个槽位，每个槽位slotSize字节
+    int slotSize = 0;
+    UdpDatagram datagrams[Capacity];
+
+    char* slot(int index) const { return buffer + index * slotSize; }
+};
+
+/**
+ * @brief 高速率UDP收发
+ *
+ * 在独立线程中接收，Linux下使用recvmmsg一次系统调用接收一批数据报、sendmmsg一次发送一批，
+ * 可设置SO_RCVBUF，并通过SO_RXQ_OVFL获取内核因接收缓冲区满而丢弃的数据报数量；其它平台使用QUdpSocket逐个读取。
+ * 数据报直接接收到预先分配的内存中，以批为单位通过无锁队列交给使用者，使用者不需要每个数据报都处理一次信号。
+ */
+class UdpEngine : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options
+    {
+        int receiveBufferSize = 4 * 1024 * 1024;   // SO_RCVBUF，0表示使用系统默认值
+        int maxDatagramSize = 2048;                // 每个槽位的大小，超过的数据报被截断
+        int batchCount = 64;                       // 预先分配的批数，使用者来不及处理时最多缓存batchCount * 64个数据报
+    };
+
+    struct Statistics
+    {
+        quint64 packetsReceived = 0;
+        quint64 bytesReceived = 0;
+        quint64 packetsSent = 0;
+        quint64 bytesSent = 0;
+        quint64 batches = 0;         // 接收的批数，packetsReceived / batches为平均每次系统调用接收的数据报数量
+        quint64 kernelDrops = 0;     // 内核接收缓冲区满丢弃的数据报（SO_RXQ_OVFL，只有Linux支持）
+        quint64 queueDrops = 0;      // 使用者来不及处理，没有空闲批次而丢弃的数据报
+        quint64 truncated = 0;
+        quint64 sendErrors = 0;
+        int receiveBufferSize = 0;   // 实际的接收缓冲区大小
+    };
+
+    explicit UdpEngine(QObject* parent = nullptr);
+    ~UdpEngine() override;
+
+    bool start(const QHostAddress& address, quint16 port, const Options& options = Options());
+    void stop();
+    bool isRunning() const { return m_worker != nullptr; }
+    QString errorString() const { return m_error; }
+
+    void send(const QByteArray& datagram, const QHostAddress& address, quint16 port);
+    void send(const QVector<QByteArray>& datagrams, const QHostAddress& address, quint16 port);   // 在接收线程中批量发送
+
+    UdpBatch* takeBatch();               // 取出一批数据，没有时返回nullptr；处理完后必须调用releaseBatch
+    void releaseBatch(UdpBatch* batch);
+    Statistics statistics() const;
+
+signals:
+    void readyRead();   // 有新的批次；使用者把数据取完之前不会再次发出，不会堆积大量信号
+
+private:
+    QThread* m_thread = nullptr;
+    UdpEngineWorker* m_worker = nullptr;
+    QByteArray m_slab;                     // 所有批次的数据报内存
+    QVector<UdpBatch> m_batches;
+    MPMCQueue<UdpBatch*>* m_freeBatches = nullptr;
+    MPMCQueue<UdpBatch*>* m_fullBatches = nullptr;
+    std::atomic<bool> m_notified{false};   // 已经发出readyRead，使用者还没有取完
+    QString m_error;
+
+    friend class UdpEngineWorker;
+};
+
+#endif   // UDPENGINE_H
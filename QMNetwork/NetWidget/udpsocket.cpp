@@ -1,7 +1,8 @@
 ﻿#include "udpsocket.h"
 #include "ui_udpsocket.h"
 
-#include <QNetworkDatagram>
+#include <QDebug>
+#include <QTimer>
 
 UdpSocket::UdpSocket(QWidget *parent) :
     QWidget(parent),
@@ -15,22 +16,22 @@ UdpSocket::UdpSocket(QWidget *parent) :
 
 UdpSocket::~UdpSocket()
 {
+    m_udpEngine->stop();
     delete ui;
 }
 
 void UdpSocket::init()
 {
-    m_udpSocket = new QUdpSocket(this);
+    m_udpEngine = new UdpEngine(this);
+    m_timer = new QTimer(this);
+    m_timer->setInterval(200);                                 // 每秒最多刷新5次界面，与接收速率无关
     ui->line_localAddress->setText("127.0.0.1");
+    ui->text_recv->document()->setMaximumBlockCount(1000);     // 只保留最近的1000行
 }
 
 void UdpSocket::connectSlots()
 {
-    connect(m_udpSocket, &QUdpSocket::readyRead, this, &UdpSocket::on_readyRead);
-
-#if TEST1
-    connect(m_udpSocket, &QUdpSocket::connected, this, &UdpSocket::on_connected);
-#endif
+    connect(m_timer, &QTimer::timeout, this, &UdpSocket::on_timeout);
 }
 
 /**
@@ -56,76 +57,107 @@ void UdpSocket::on_but_connect_clicked()
 {
     if(ui->but_connect->text() == "打开")
     {
-//            m_udpSocket->bind(ui->line_localAddress->text(), ui->spin_localPort->value());         // 绑定本地地址和端口号
-//            m_udpSocket->bind(QHostAddress::AnyIPv4, 8888);
-            bool ret = m_udpSocket->bind(ui->spin_localPort->value());         // 绑定本地地址和端口号
+            UdpEngine::Options options;
+            options.receiveBufferSize = ui->spin_rcvbuf->value() * 1024;   // 高速率时系统默认的接收缓冲区太小，容易丢包
+            bool ret = m_udpEngine->start(QHostAddress::Any, quint16(ui->spin_localPort->value()), options);         // 绑定本地地址和端口号
             if(ret)
             {
                 qInfo() << "绑定本地地址成功！";
                 ui->but_connect->setText("关闭");
-#if TEST1
-                m_udpSocket->connectToHost("127.0.0.1", ui->spin_peerPort->value());        // 使用和TCP类似的方法目标绑定IP、端口，在发送的时候就不需要指定IP、端口了
-#endif
+                ui->spin_rcvbuf->setEnabled(false);
+                m_lastStatistics = UdpEngine::Statistics();
+                m_lastTime.start();
+                m_timer->start();
             }
             else
             {
-                qWarning() << "绑定本地地址失败！";
+                qWarning() << QString("绑定本地地址失败：%1").arg(m_udpEngine->errorString());
             }
     }
     else
     {
-        m_udpSocket->close();
+        m_timer->stop();
+        on_timeout();                      // 显示最后的数据并归还所有批次
+        m_udpEngine->stop();
         ui->but_connect->setText("打开");
+        ui->spin_rcvbuf->setEnabled(true);
     }
 }
 
 /**
- * @brief 接收数据
+ * @brief 定时取出接收线程中的所有数据，只显示每次最多10个数据报和汇总的统计信息，
+ *        每秒十万个数据报时界面也不会卡死
  */
-void UdpSocket::on_readyRead()
+void UdpSocket::on_timeout()
 {
-    while (m_udpSocket->hasPendingDatagrams())                       // 判断是否有可读数据
+    const int maxDisplay = 10;
+    int displayed = 0;
+    quint64 skipped = 0;
+    const UdpDatagram* last = nullptr;
+    QString lastIP;
+    quint16 lastPort = 0;
+    while (UdpBatch* batch = m_udpEngine->takeBatch())
+    {
+        for(int i = 0; i < batch->count; i++)
+        {
+            const UdpDatagram& datagram = batch->datagrams[i];
+            last = &datagram;
+            if(displayed >= maxDisplay)
+            {
+                skipped++;
+                continue;
+            }
+            displayed++;
+            QString strIP = datagram.sender().toString().remove("::ffff:");
+            QByteArray replyData = QByteArray::fromRawData(datagram.data, datagram.size);   // 不复制，批次归还前有效
+            if(ui->check_hexRecv->isChecked())
+            {
+                ui->text_recv->append(QString("[%1 %2] ").arg(strIP).arg(datagram.senderPort) + replyData.toHex(' '));
+            }
+            else
+            {
+                ui->text_recv->append(QString("[%1 %2] ").arg(strIP).arg(datagram.senderPort) + QString::fromUtf8(replyData));
+            }
+        }
+        if(last)
+        {
+            lastIP = last->sender().toString().remove("::ffff:");
+            lastPort = last->senderPort;
+            last = nullptr;
+        }
+        m_udpEngine->releaseBatch(batch);
+    }
+    if(skipped > 0)
     {
-         QNetworkDatagram datagram = m_udpSocket->receiveDatagram(); // 读取数据
-         QByteArray replyData = datagram.data();
-
-         if(replyData.count())
-         {
-             QString strIP = datagram.senderAddress().toString().remove("::ffff:");
-             int port = datagram.senderPort();
-
-             if(ui->check_peerPort->isChecked())
-             {
-                 ui->line_peerAddress->setText(strIP);
-                 ui->spin_peerPort->setValue(port);
-             }
-             ui->spin_recv->setValue(ui->spin_recv->value() + replyData.count());  // 统计接收的数据总大小
-             if(ui->check_hexRecv->isChecked())
-             {
-                 ui->text_recv->append(QString("[%1 %2] ").arg(strIP).arg(port) + replyData.toHex(' ') );
-             }
-             else
-             {
-                 ui->text_recv->append(QString("[%1 %2] ").arg(strIP).arg(port)  + replyData);
-             }
-         }
+        ui->text_recv->append(QString("... 省略%1个数据报").arg(skipped));
+    }
+    if(!lastIP.isEmpty() && ui->check_peerPort->isChecked())
+    {
+        ui->line_peerAddress->setText(lastIP);
+        ui->spin_peerPort->setValue(lastPort);
     }
-}
-
 
-#if TEST1
-void UdpSocket::on_connected()
-{
-    qDebug() << "连接成功！";
+    const UdpEngine::Statistics statistics = m_udpEngine->statistics();
+    const double seconds = qMax<qint64>(m_lastTime.restart(), 1) / 1000.0;
+    const quint64 packets = statistics.packetsReceived - m_lastStatistics.packetsReceived;
+    const quint64 batches = statistics.batches - m_lastStatistics.batches;
+    ui->label_statistics->setText(QString("接收：%1 包/秒  %2 KB/s  每批平均%3个  内核丢包：%4  队列丢包：%5  截断：%6  接收缓冲区：%7 KB")
+                                  .arg(packets / seconds, 0, 'f', 0)
+                                  .arg((statistics.bytesReceived - m_lastStatistics.bytesReceived) / seconds / 1024, 0, 'f', 1)
+                                  .arg(batches > 0 ? double(packets) / batches : 0.0, 0, 'f', 1)
+                                  .arg(statistics.kernelDrops)
+                                  .arg(statistics.queueDrops)
+                                  .arg(statistics.truncated)
+                                  .arg(statistics.receiveBufferSize / 1024));
+    ui->spin_recv->setValue(int(qMin<quint64>(statistics.bytesReceived, quint64(ui->spin_recv->maximum()))));  // 统计接收的数据总大小
+    m_lastStatistics = statistics;
 }
-#endif
 
 /**
  * @brief 发送数据
  */
 void UdpSocket::on_but_send_clicked()
 {
-//    m_udpSocket->writeDatagram()
     QString str = ui->text_send->toPlainText();
 #if 0
     QByteArray arr = str.toLocal8Bit();              // 根据编译器编码或者 QTextCodec::setCodecForLocale(codec);指定的编码方式将QString转换为QBytearray，一般为utf-8或者GBK，支持中文
@@ -137,16 +169,13 @@ void UdpSocket::on_but_send_clicked()
         arr = QByteArray::fromHex(arr);
     }
 
-#if TEST1
-    qint64 len = m_udpSocket->write(arr);
-#else
-    qint64 len = m_udpSocket->writeDatagram(arr, QHostAddress(ui->line_peerAddress->text()), ui->spin_peerPort->value());
-#endif
-    if(len < 0)
+    if(!m_udpEngine->isRunning())
     {
-        qWarning() <<"发送失败！";
+        qWarning() <<"发送失败，请先打开！";
+        return;
     }
-    ui->spin_send->setValue(ui->spin_send->value() + len);
+    m_udpEngine->send(arr, QHostAddress(ui->line_peerAddress->text()), quint16(ui->spin_peerPort->value()));   // 在接收线程中发送，失败次数在统计信息中
+    ui->spin_send->setValue(ui->spin_send->value() + arr.count());
 }
 
 
@@ -2,9 +2,10 @@
 #define UDPSOCKET_H
 
 #include <QWidget>
-#include <QUdpSocket>
+#include <QElapsedTimer>
+#include "udpengine.h"
 
-#define TEST1  0    // 使用第一种方式实现UDP通信
+class QTimer;
 
 namespace Ui {
 class UdpSocket;
@@ -23,10 +24,7 @@ private:
     void connectSlots();
 
 private slots:
-    void on_readyRead();
-#if TEST1
-    void on_connected();
-#endif
+    void on_timeout();
     void on_but_connect_clicked();
 
     void on_com_type_activated(int index);
@@ -44,7 +42,10 @@ private slots:
 private:
     Ui::UdpSocket *ui;
 
-    QUdpSocket* m_udpSocket = nullptr;
+    UdpEngine* m_udpEngine = nullptr;      // 在独立线程中批量收发，界面只定时显示汇总信息
+    QTimer* m_timer = nullptr;
+    UdpEngine::Statistics m_lastStatistics; // 上一次的统计，用于计算速率
+    QElapsedTimer m_lastTime;
 };
 
 #endif // UDPSOCKET_H
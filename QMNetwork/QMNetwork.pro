@@ -26,6 +26,10 @@ include($$PWD/NetWidget/NetWidget.pri)                # 较为复杂的Qt网络
 INCLUDEPATH += $$PWD/NetWidget
 include($$PWD/NetInterface/NetInterface.pri)          # 网络接口管理模块（查询所有网卡信息和IP地址信息）
 INCLUDEPATH += $$PWD/NetInterface
+include($$PWD/FrameCodec/FrameCodec.pri)              # 数据分帧模块（长度前缀、固定帧头、分隔符）
+INCLUDEPATH += $$PWD/FrameCodec
+include($$PWD/ReliableMulticast/ReliableMulticast.pri)  # 可靠UDP组播模块（序号、NACK重传、速率限制）
+INCLUDEPATH += $$PWD/ReliableMulticast
 
 #  定义程序版本号
 VERSION = 1.0.2
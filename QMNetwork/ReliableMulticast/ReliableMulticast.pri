@@ -0,0 +1,16 @@
+#---------------------------------------------------------
+# 功能：       轻量的可靠UDP组播模块（序号、丢包检测、NACK重传、速率限制），
+#             用于向大量接收端分发数据，避免为每个接收端建立TCP连接
+# 编译器：
+#
+# @开发者     mhf
+# @邮箱       1603291350@qq.com
+# @时间       2025/04/18
+# @备注
+#---------------------------------------------------------
+
+HEADERS += \
+    $$PWD/reliablemulticast.h
+
+SOURCES += \
+    $$PWD/reliablemulticast.cpp
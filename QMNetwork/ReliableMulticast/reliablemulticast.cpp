@@ -0,0 +1,574 @@
+﻿#include "reliablemulticast.h"
+#include <QRandomGenerator>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QtEndian>
+#include <cstring>
+
+/*
+ * 数据包格式（大端字节序）：
+ *   公共头   ["RM"][版本1][类型][会话id 4字节]
+ *   Data     公共头 + [序号 8字节] + 数据
+ *   Heartbeat公共头 + [最大序号 8字节] + [重传窗口中最小的序号 8字节]
+ *   Nack     公共头 + [目标会话id 4字节] + [区间数 2字节] + 区间数 * ([起始序号 8字节] + [数量 2字节])
+ */
+enum PacketType : quint8
+{
+    DataPacket = 1,
+    HeartbeatPacket = 2,
+    NackPacket = 3
+};
+
+static const int HeaderSize = 8;
+static const int DataHeaderSize = HeaderSize + 8;
+static const int HeartbeatSize = HeaderSize + 16;
+static const int NackHeaderSize = HeaderSize + 6;
+static const int NackRangeSize = 10;
+static const int MaxNackRanges = 64;
+static const qint64 SourceTimeout = 30000;   // 发送端30秒没有任何数据包时删除其接收状态
+
+static QByteArray makePacket(PacketType type, quint32 session, int size)
+{
+    QByteArray packet(size, '\0');
+    uchar* data = reinterpret_cast<uchar*>(packet.data());
+    data[0] = 'R';
+    data[1] = 'M';
+    data[2] = 1;
+    data[3] = type;
+    qToBigEndian(session, data + 4);
+    return packet;
+}
+
+struct Delivery   // 按序号交付的一项：收到的数据，或者一段放弃修复的序号
+{
+    quint64 seq = 0;
+    quint64 count = 0;   // 为0时是数据包，否则为跳过的序号数
+    QByteArray data;
+};
+
+ReliableMulticast::ReliableMulticast(QObject* parent)
+    : QObject(parent)
+{
+    m_timer = new QTimer(this);
+    m_timer->setInterval(10);
+    connect(m_timer, &QTimer::timeout, this, &ReliableMulticast::on_timeout);
+}
+
+ReliableMulticast::~ReliableMulticast()
+{
+    close();
+}
+
+/**
+ * @brief        绑定组播端口并加入组播组，开启组播回环（同一台电脑上的多个程序也能收到）
+ * @param group  组播地址，例如239.255.0.1
+ */
+bool ReliableMulticast::open(const QHostAddress& group, quint16 port, const Options& options)
+{
+    close();
+    m_socket = new QUdpSocket(this);
+    if (!m_socket->bind(QHostAddress::AnyIPv4, port, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint)   // 使用组播时必须指定AnyIPv4
+        || !m_socket->joinMulticastGroup(group))
+    {
+        m_error = m_socket->errorString();
+        delete m_socket;
+        m_socket = nullptr;
+        return false;
+    }
+    m_socket->setSocketOption(QAbstractSocket::MulticastTtlOption, options.ttl);
+    m_socket->setSocketOption(QAbstractSocket::MulticastLoopbackOption, 1);
+    connect(m_socket, &QUdpSocket::readyRead, this, &ReliableMulticast::on_readyRead);
+
+    m_group = group;
+    m_port = port;
+    m_options = options;
+    m_options.windowSize = qMax(16, options.windowSize);
+    m_options.maxPayload = qBound(1, options.maxPayload, 65507 - DataHeaderSize);
+    m_session = QRandomGenerator::global()->generate();
+    if (m_session == 0)
+    {
+        m_session = 1;
+    }
+    m_error.clear();
+    m_buffer.resize(65536);
+    m_lastSeq = 0;
+    m_window = QVector<QByteArray>(m_options.windowSize);
+    m_lastRepair = QVector<qint64>(m_options.windowSize, -1);
+    m_statistics = Statistics();
+    m_clock.start();
+    m_tokens = 0;
+    m_lastRefill = 0;
+    m_lastSend = 0;
+    m_timer->start();
+    return true;
+}
+
+void ReliableMulticast::close()
+{
+    m_timer->stop();
+    if (m_socket)
+    {
+        m_socket->disconnect(this);
+        m_socket->leaveMulticastGroup(m_group);
+        m_socket->abort();
+        m_socket->deleteLater();   // 可能在socket的readyRead中调用close
+        m_socket = nullptr;
+    }
+    m_window.clear();
+    m_lastRepair.clear();
+    m_sendQueue.clear();
+    m_repairQueue.clear();
+    m_sources.clear();
+}
+
+/**
+ * @brief       将数据加入发送队列，令牌足够时立即发送
+ * @return      数据太长、没有打开或者发送队列已满（发送速度超过速率限制太多）时返回false
+ */
+bool ReliableMulticast::send(const QByteArray& data)
+{
+    if (!m_socket || data.size() > m_options.maxPayload || m_sendQueue.size() >= m_options.windowSize)
+    {
+        return false;
+    }
+    QByteArray packet = makePacket(DataPacket, m_session, DataHeaderSize + data.size());   // 序号在真正发送时填写
+    memcpy(packet.data() + DataHeaderSize, data.constData(), size_t(data.size()));
+    m_sendQueue.enqueue(packet);
+    flushSendQueue();
+    return true;
+}
+
+ReliableMulticast::Statistics ReliableMulticast::statistics() const
+{
+    Statistics statistics = m_statistics;
+    statistics.queued = m_sendQueue.size();
+    statistics.sources = m_sources.size();
+    return statistics;
+}
+
+bool ReliableMulticast::writePacket(const QByteArray& packet)
+{
+    const qint64 ret = m_socket->writeDatagram(packet, m_group, m_port);
+    if (ret < 0)
+    {
+        return false;
+    }
+    m_statistics.bytesSent += quint64(ret);
+    m_lastSend = m_clock.elapsed();
+    return true;
+}
+
+/**
+ * @brief 令牌桶限速：重传优先，然后发送新数据；令牌最多积累50ms的量，避免空闲后突发
+ */
+void ReliableMulticast::flushSendQueue()
+{
+    const qint64 now = m_clock.elapsed();
+    const qint64 rate = m_options.rateLimit;
+    if (rate > 0)
+    {
+        const double burst = qMax(double(rate) / 20, double(2 * (DataHeaderSize + m_options.maxPayload)));
+        m_tokens = qMin(burst, m_tokens + double(rate) * double(now - m_lastRefill) / 1000.0);
+    }
+    m_lastRefill = now;
+
+    while (!m_repairQueue.isEmpty())
+    {
+        const quint64 seq = m_repairQueue.head();
+        const QByteArray& packet = m_window.at(int(seq % quint64(m_options.windowSize)));
+        if (packet.size() < DataHeaderSize || qFromBigEndian<quint64>(packet.constData() + HeaderSize) != seq)
+        {
+            m_repairQueue.dequeue();   // 在排队期间被新数据覆盖
+            continue;
+        }
+        if (rate > 0 && m_tokens < packet.size())
+        {
+            return;
+        }
+        m_repairQueue.dequeue();
+        writePacket(packet);
+        m_tokens -= packet.size();
+        m_statistics.repairsSent++;
+    }
+
+    while (!m_sendQueue.isEmpty())
+    {
+        if (rate > 0 && m_tokens < m_sendQueue.head().size())
+        {
+            return;
+        }
+        QByteArray packet = m_sendQueue.dequeue();
+        const quint64 seq = ++m_lastSeq;
+        qToBigEndian(seq, packet.data() + HeaderSize);
+        const int index = int(seq % quint64(m_options.windowSize));
+        m_window[index] = packet;
+        m_lastRepair[index] = -1;
+        writePacket(packet);
+        m_tokens -= packet.size();
+        m_statistics.packetsSent++;
+    }
+}
+
+/**
+ * @brief 心跳：接收端据此发现末尾的丢包，以及哪些丢包已经不在重传窗口中
+ */
+void ReliableMulticast::sendHeartbeat()
+{
+    QByteArray packet = makePacket(HeartbeatPacket, m_session, HeartbeatSize);
+    const quint64 windowSize = quint64(m_options.windowSize);
+    const quint64 lowest = m_lastSeq >= windowSize ? m_lastSeq - windowSize + 1 : 1;
+    qToBigEndian(m_lastSeq, packet.data() + HeaderSize);
+    qToBigEndian(lowest, packet.data() + HeaderSize + 8);
+    writePacket(packet);
+}
+
+void ReliableMulticast::on_timeout()
+{
+    flushSendQueue();
+    const qint64 now = m_clock.elapsed();
+    if (m_lastSeq > 0 && now - m_lastSend >= m_options.heartbeatInterval)
+    {
+        sendHeartbeat();
+    }
+
+    const QList<quint32> sessions = m_sources.keys();
+    for (quint32 session : sessions)
+    {
+        auto it = m_sources.find(session);
+        if (it == m_sources.end())   // 在信号中调用了close
+        {
+            return;
+        }
+        if (now - it->lastActive > SourceTimeout)
+        {
+            m_sources.erase(it);
+            continue;
+        }
+        sendNacks(session, *it);
+        deliver(session, *it);
+    }
+}
+
+void ReliableMulticast::on_readyRead()
+{
+    while (m_socket && m_socket->hasPendingDatagrams())
+    {
+        QHostAddress sender;
+        const qint64 size = m_socket->readDatagram(m_buffer.data(), m_buffer.size(), &sender);
+        const uchar* data = reinterpret_cast<const uchar*>(m_buffer.constData());
+        if (size < HeaderSize || data[0] != 'R' || data[1] != 'M' || data[2] != 1)
+        {
+            continue;   // 不是本协议的数据包
+        }
+        const quint32 session = qFromBigEndian<quint32>(data + 4);
+        if (session == m_session)
+        {
+            continue;   // 组播回环收到的自己的数据包
+        }
+        switch (data[3])
+        {
+        case DataPacket:
+            if (size >= DataHeaderSize)
+            {
+                const quint64 seq = qFromBigEndian<quint64>(data + HeaderSize);
+                handleData(session, sender, seq, QByteArray(m_buffer.constData() + DataHeaderSize, int(size) - DataHeaderSize));
+            }
+            break;
+        case HeartbeatPacket:
+            if (size >= HeartbeatSize)
+            {
+                handleHeartbeat(session, sender, qFromBigEndian<quint64>(data + HeaderSize), qFromBigEndian<quint64>(data + HeaderSize + 8));
+            }
+            break;
+        case NackPacket:
+            handleNack(session, m_buffer.constData(), int(size));
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 将[first, last]标记为丢失，随机等待一段时间后发送NACK（等待期间可能收到其它接收端的NACK或者重传）
+ */
+void ReliableMulticast::markMissing(Source& source, quint64 first, quint64 last)
+{
+    const qint64 now = m_clock.elapsed();
+    for (quint64 seq = first; seq <= last; ++seq)
+    {
+        Missing missing;
+        missing.nextNack = now + QRandomGenerator::global()->bounded(m_options.nackDelay + 1);
+        source.missing.insert(seq, missing);
+    }
+    m_statistics.gaps += last - first + 1;
+}
+
+void ReliableMulticast::handleData(quint32 session, const QHostAddress& sender, quint64 seq, const QByteArray& payload)
+{
+    m_statistics.packetsReceived++;
+    if (seq == 0)
+    {
+        return;
+    }
+    auto it = m_sources.find(session);
+    if (it == m_sources.end())
+    {
+        Source source;   // 中途加入：从收到的第一个数据包开始接收，不请求之前的数据
+        source.nextDeliver = seq;
+        source.highest = seq - 1;
+        it = m_sources.insert(session, source);
+    }
+    Source& source = *it;
+    source.address = sender;
+    source.lastActive = m_clock.elapsed();
+
+    if (seq < source.nextDeliver || source.buffer.contains(seq))
+    {
+        m_statistics.duplicates++;
+        return;
+    }
+    if (seq > source.highest)
+    {
+        if (seq - source.highest > quint64(m_options.windowSize))
+        {
+            // 丢失的数据超过发送端的重传窗口（例如长时间断网），已经无法修复：放弃所有丢失的序号，
+            // 已经收到的数据仍然按序号交付，与跳过的序号交替发出，然后从当前数据包继续
+            m_statistics.lost += quint64(source.missing.size()) + (seq - source.highest - 1);
+            source.missing.clear();
+        }
+        else if (seq > source.highest + 1)
+        {
+            markMissing(source, source.highest + 1, seq - 1);
+        }
+        source.highest = seq;
+    }
+    else if (source.missing.remove(seq) > 0)
+    {
+        m_statistics.repaired++;
+    }
+    source.buffer.insert(seq, payload);
+    deliver(session, source);
+}
+
+void ReliableMulticast::handleHeartbeat(quint32 session, const QHostAddress& sender, quint64 highest, quint64 lowest)
+{
+    auto it = m_sources.find(session);
+    if (it == m_sources.end())
+    {
+        Source source;   // 中途加入：只接收之后的数据
+        source.nextDeliver = highest + 1;
+        source.highest = highest;
+        it = m_sources.insert(session, source);
+    }
+    Source& source = *it;
+    source.address = sender;
+    source.lastActive = m_clock.elapsed();
+
+    if (highest > source.highest && highest - source.highest <= quint64(m_options.windowSize))
+    {
+        markMissing(source, source.highest + 1, highest);   // 末尾的数据包丢失，只有心跳能发现
+        source.highest = highest;
+    }
+    for (auto missing = source.missing.begin(); missing != source.missing.end() && missing.key() < lowest;)
+    {
+        missing = source.missing.erase(missing);   // 已经不在发送端的重传窗口中
+        m_statistics.lost++;
+    }
+    deliver(session, source);
+}
+
+/**
+ * @brief 发给本端的NACK：将窗口中的数据加入重传队列；发给其它发送端的NACK：推迟自己对相同数据包的NACK
+ */
+void ReliableMulticast::handleNack(quint32 session, const char* data, int size)
+{
+    Q_UNUSED(session)
+    if (size < NackHeaderSize)
+    {
+        return;
+    }
+    const uchar* p = reinterpret_cast<const uchar*>(data);
+    const quint32 target = qFromBigEndian<quint32>(p + HeaderSize);
+    const int count = qMin<int>(qFromBigEndian<quint16>(p + HeaderSize + 4), (size - NackHeaderSize) / NackRangeSize);
+    const qint64 now = m_clock.elapsed();
+
+    if (target == m_session)
+    {
+        m_statistics.nacksReceived++;
+        const quint64 windowSize = quint64(m_options.windowSize);
+        const quint64 lowest = m_lastSeq >= windowSize ? m_lastSeq - windowSize + 1 : 1;
+        bool unrecoverable = false;
+        for (int i = 0; i < count; ++i)
+        {
+            const uchar* range = p + NackHeaderSize + i * NackRangeSize;
+            const quint64 first = qFromBigEndian<quint64>(range);
+            const quint64 last = first + qFromBigEndian<quint16>(range + 8);
+            for (quint64 seq = qMax<quint64>(first, 1); seq < last && seq <= m_lastSeq; ++seq)
+            {
+                if (seq < lowest)
+                {
+                    m_statistics.unrecoverable++;
+                    unrecoverable = true;
+                    continue;
+                }
+                const int index = int(seq % windowSize);
+                if (m_lastRepair.at(index) >= 0 && now - m_lastRepair.at(index) < m_options.nackInterval / 2)
+                {
+                    continue;   // 刚刚重传过，其它接收端的NACK
+                }
+                m_lastRepair[index] = now;
+                m_repairQueue.enqueue(seq);
+            }
+        }
+        if (unrecoverable)
+        {
+            sendHeartbeat();   // 告诉接收端窗口的起始位置，让其放弃修复
+        }
+        flushSendQueue();
+        return;
+    }
+
+    auto it = m_sources.find(target);
+    if (it == m_sources.end())
+    {
+        return;
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        const uchar* range = p + NackHeaderSize + i * NackRangeSize;
+        const quint64 first = qFromBigEndian<quint64>(range);
+        const quint64 last = first + qFromBigEndian<quint16>(range + 8);
+        for (auto missing = it->missing.lowerBound(first); missing != it->missing.end() && missing.key() < last; ++missing)
+        {
+            if (missing->nextNack < now + m_options.nackInterval)
+            {
+                missing->nextNack = now + m_options.nackInterval;   // 其它接收端已经请求，等待重传
+                m_statistics.nacksSuppressed++;
+            }
+        }
+    }
+}
+
+/**
+ * @brief 将到期的丢失序号合并成区间后发送一个NACK，重试次数用完的序号放弃修复
+ */
+void ReliableMulticast::sendNacks(quint32 session, Source& source)
+{
+    const qint64 now = m_clock.elapsed();
+    QVector<QPair<quint64, quint16>> ranges;
+    for (auto it = source.missing.begin(); it != source.missing.end();)
+    {
+        if (it->nextNack > now)
+        {
+            ++it;
+            continue;
+        }
+        if (it->retries >= m_options.maxNackRetries)
+        {
+            it = source.missing.erase(it);   // 在deliver中跳过
+            m_statistics.lost++;
+            continue;
+        }
+        const quint64 seq = it.key();
+        if (!ranges.isEmpty() && ranges.last().first + ranges.last().second == seq && ranges.last().second < 0xFFFF)
+        {
+            ranges.last().second++;
+        }
+        else if (ranges.size() < MaxNackRanges)
+        {
+            ranges.append(qMakePair(seq, quint16(1)));
+        }
+        else
+        {
+            ++it;   // 一个NACK放不下，下次再发
+            continue;
+        }
+        it->retries++;
+        it->nextNack = now + m_options.nackInterval;
+        ++it;
+    }
+    if (ranges.isEmpty())
+    {
+        return;
+    }
+
+    QByteArray packet = makePacket(NackPacket, m_session, NackHeaderSize + ranges.size() * NackRangeSize);
+    uchar* data = reinterpret_cast<uchar*>(packet.data());
+    qToBigEndian(session, data + HeaderSize);
+    qToBigEndian(quint16(ranges.size()), data + HeaderSize + 4);
+    for (int i = 0; i < ranges.size(); ++i)
+    {
+        uchar* range = data + NackHeaderSize + i * NackRangeSize;
+        qToBigEndian(ranges.at(i).first, range);
+        qToBigEndian(ranges.at(i).second, range + 8);
+    }
+    writePacket(packet);   // 发送到组播组，其它接收端可以据此抑制重复的NACK
+    m_statistics.nacksSent++;
+}
+
+/**
+ * @brief 按序号交付连续的数据，跳过已经放弃修复的序号，received和lost按序号交替发出；
+ *        先更新状态再发出信号（槽函数中可能调用close）
+ */
+void ReliableMulticast::deliver(quint32 session, Source& source)
+{
+    QVector<Delivery> ready;
+    while (source.nextDeliver <= source.highest)
+    {
+        auto it = source.buffer.find(source.nextDeliver);
+        if (it != source.buffer.end())
+        {
+            Delivery delivery;
+            delivery.seq = source.nextDeliver;
+            delivery.data = it.value();
+            ready.append(delivery);
+            source.buffer.erase(it);
+        }
+        else if (source.missing.contains(source.nextDeliver))
+        {
+            break;   // 等待重传
+        }
+        else
+        {
+            // 放弃修复的序号一直跳到下一个收到或等待重传的序号（窗口跳跃时可能有很多）
+            quint64 end = source.highest + 1;
+            auto next = source.buffer.lowerBound(source.nextDeliver);
+            if (next != source.buffer.end())
+            {
+                end = qMin(end, next.key());
+            }
+            auto missing = source.missing.lowerBound(source.nextDeliver);
+            if (missing != source.missing.end())
+            {
+                end = qMin(end, missing.key());
+            }
+            Delivery delivery;
+            delivery.seq = source.nextDeliver;
+            delivery.count = end - source.nextDeliver;
+            ready.append(delivery);
+            source.nextDeliver = end;
+            continue;
+        }
+        source.nextDeliver++;
+    }
+
+    const QHostAddress address = source.address;
+    for (const Delivery& delivery : qAsConst(ready))
+    {
+        if (delivery.count > 0)
+        {
+            emit lost(session, delivery.seq, delivery.count);
+        }
+        else
+        {
+            m_statistics.packetsDelivered++;
+            m_statistics.bytesDelivered += quint64(delivery.data.size());
+            emit received(session, address, delivery.data);
+        }
+        if (!m_socket)
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,134 @@
+﻿/******************************************************************************
+ * @文件名     reliablemulticast.h
+ * @功能       轻量的可靠UDP组播：序号 + 丢包检测 + 接收端NACK + 发送端重传窗口 + 发送速率限制
+ *
+ * @开发者     mhf
+ * @邮箱       1603291350@qq.com
+ * @时间       2025/04/18
+ * @备注       每个端点既可以发送也可以接收，用随机的会话id区分不同的发送端；
+ *            NACK也发送到组播组，其它同样丢包的接收端收到后推迟自己的NACK，避免大量接收端同时请求重传；
+ *            发送端定时发送心跳（最大序号、重传窗口中最小的序号），接收端据此发现末尾丢包和已经无法修复的数据
+ *****************************************************************************/
+#ifndef RELIABLEMULTICAST_H
+#define RELIABLEMULTICAST_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QHostAddress>
+#include <QMap>
+#include <QObject>
+#include <QQueue>
+#include <QVector>
+
+class QTimer;
+class QUdpSocket;
+
+class ReliableMulticast : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options
+    {
+        int windowSize = 4096;              // 发送端保留最近多少个数据包用于重传
+        qint64 rateLimit = 10 * 1024 * 1024;   // 发送速率上限（字节/秒，包括重传），0表示不限制
+        int maxPayload = 1400;              // 一个数据包的最大数据长度，避免IP分片
+        int nackDelay = 10;                 // 发现丢包后随机等待0 ~ nackDelay毫秒再发送NACK
+        int nackInterval = 50;              // 没有修复时重新发送NACK的间隔（毫秒）
+        int maxNackRetries = 10;            // 超过后放弃，报告丢失
+        int heartbeatInterval = 200;        // 心跳间隔（毫秒）
+        int ttl = 1;                        // 组播TTL，1表示只在本网段
+    };
+
+    struct Statistics
+    {
+        // 发送端
+        quint64 packetsSent = 0;         // 新数据包
+        quint64 bytesSent = 0;           // 所有发出的字节（包括重传、心跳、NACK）
+        quint64 repairsSent = 0;         // 重传的数据包
+        quint64 nacksReceived = 0;       // 收到的针对本端的NACK
+        quint64 unrecoverable = 0;       // 请求的数据已经不在重传窗口中
+        int queued = 0;                  // 等待发送的数据包（受速率限制）
+        // 接收端
+        quint64 packetsReceived = 0;     // 收到的数据包（包括重复）
+        quint64 packetsDelivered = 0;    // 按顺序交付的数据包
+        quint64 bytesDelivered = 0;
+        quint64 duplicates = 0;
+        quint64 gaps = 0;                // 检测到的丢包数
+        quint64 repaired = 0;            // 通过重传修复的丢包数
+        quint64 lost = 0;                // 放弃修复的丢包数
+        quint64 nacksSent = 0;
+        quint64 nacksSuppressed = 0;     // 其它接收端已经请求过，推迟发送的NACK
+        int sources = 0;                 // 当前的发送端数量
+    };
+
+    explicit ReliableMulticast(QObject* parent = nullptr);
+    ~ReliableMulticast() override;
+
+    bool open(const QHostAddress& group, quint16 port, const Options& options = Options());
+    void close();
+    bool isOpen() const { return m_socket != nullptr; }
+    QString errorString() const { return m_error; }
+    quint32 sessionId() const { return m_session; }
+
+    bool send(const QByteArray& data);   // 加入发送队列，按速率限制发送；超过maxPayload或队列已满时返回false
+    Statistics statistics() const;
+
+signals:
+    void received(quint32 session, const QHostAddress& sender, const QByteArray& data);   // 同一个发送端的数据按发送顺序交付
+    void lost(quint32 session, quint64 seq, quint64 count);                               // 多次NACK仍然没有修复，跳过这些数据
+
+private:
+    struct Missing
+    {
+        qint64 nextNack = 0;   // 下一次发送NACK的时间
+        int retries = 0;
+    };
+
+    struct Source   // 一个发送端的接收状态
+    {
+        QHostAddress address;
+        quint64 nextDeliver = 0;           // 下一个交付的序号
+        quint64 highest = 0;               // 收到或从心跳中得知的最大序号
+        QMap<quint64, QByteArray> buffer;  // 已收到但前面还有丢包，等待交付的数据
+        QMap<quint64, Missing> missing;    // 丢失的序号
+        qint64 lastActive = 0;
+    };
+
+    void on_readyRead();
+    void on_timeout();
+    void handleData(quint32 session, const QHostAddress& sender, quint64 seq, const QByteArray& payload);
+    void handleHeartbeat(quint32 session, const QHostAddress& sender, quint64 highest, quint64 lowest);
+    void handleNack(quint32 session, const char* data, int size);
+    void markMissing(Source& source, quint64 first, quint64 last);
+    void deliver(quint32 session, Source& source);
+    void sendNacks(quint32 session, Source& source);
+    void flushSendQueue();
+    void sendHeartbeat();
+    bool writePacket(const QByteArray& packet);
+
+private:
+    QUdpSocket* m_socket = nullptr;
+    QTimer* m_timer = nullptr;
+    QHostAddress m_group;
+    quint16 m_port = 0;
+    Options m_options;
+    QString m_error;
+    quint32 m_session = 0;
+    QElapsedTimer m_clock;
+    QByteArray m_buffer;   // 接收缓冲区
+
+    // 发送端
+    quint64 m_lastSeq = 0;                 // 最后一个已发送的序号，从1开始
+    QVector<QByteArray> m_window;          // 重传窗口，下标为序号 % windowSize
+    QVector<qint64> m_lastRepair;          // 每个数据包上一次重传的时间，避免多个NACK导致重复重传
+    QQueue<QByteArray> m_sendQueue;        // 新数据
+    QQueue<quint64> m_repairQueue;         // 需要重传的序号，优先发送
+    double m_tokens = 0;                   // 令牌桶：当前可发送的字节数
+    qint64 m_lastRefill = 0;
+    qint64 m_lastSend = 0;
+
+    QHash<quint32, Source> m_sources;      // 会话id -> 接收状态
+    Statistics m_statistics;
+};
+
+#endif   // RELIABLEMULTICAST_H
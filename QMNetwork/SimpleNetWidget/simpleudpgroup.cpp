@@ -1,8 +1,10 @@
 ﻿#include "simpleudpgroup.h"
 #include "ui_simpleudpgroup.h"
+#include "reliablemulticast.h"
 
 #include <qnetworkdatagram.h>
 #include <QNetworkInterface>
+#include <QTimer>
 
 SimpleUdpGroup::SimpleUdpGroup(QWidget* parent)
     : QWidget(parent)
@@ -15,6 +17,12 @@ SimpleUdpGroup::SimpleUdpGroup(QWidget* parent)
     m_udpSocket = new QUdpSocket(this);
     connect(m_udpSocket, &QUdpSocket::readyRead, this,
             &SimpleUdpGroup::on_readyRead);   // 当有可读数据时发出readyRead信号
+
+    m_reliable = new ReliableMulticast(this);
+    connect(m_reliable, &ReliableMulticast::received, this, &SimpleUdpGroup::on_reliableReceived);
+    connect(m_reliable, &ReliableMulticast::lost, this, &SimpleUdpGroup::on_reliableLost);
+    m_timer = new QTimer(this);
+    connect(m_timer, &QTimer::timeout, this, &SimpleUdpGroup::on_timeout);
 }
 
 SimpleUdpGroup::~SimpleUdpGroup()
@@ -36,6 +44,30 @@ void SimpleUdpGroup::on_readyRead()
  */
 void SimpleUdpGroup::on_but_connect_clicked()
 {
+    if (m_reliable->isOpen())
+    {
+        m_reliable->close();
+        m_timer->stop();
+        ui->check_reliable->setEnabled(true);
+        ui->but_connect->setText("打开");
+        return;
+    }
+    if (ui->check_reliable->isChecked())
+    {
+        if (m_reliable->open(QHostAddress(ui->line_groupAddress->text()), quint16(ui->spin_groupPort->value())))
+        {
+            qInfo() << QString("打开可靠组播成功，会话id：%1").arg(m_reliable->sessionId(), 8, 16, QChar('0'));
+            m_timer->start(1000);
+            ui->check_reliable->setEnabled(false);
+            ui->but_connect->setText("关闭");
+        }
+        else
+        {
+            qWarning() << QString("打开可靠组播失败：%1").arg(m_reliable->errorString());
+        }
+        return;
+    }
+
     if (m_udpSocket->state() != QAbstractSocket::BoundState)   // 判断是否绑定绑定端口
     {
         bool ret = m_udpSocket->bind(
@@ -54,6 +86,7 @@ void SimpleUdpGroup::on_but_connect_clicked()
             if (ret)
             {
                 qInfo() << "加入组播组成功！";
+                ui->check_reliable->setEnabled(false);
                 ui->but_connect->setText("关闭");
             }
             else
@@ -73,6 +106,7 @@ void SimpleUdpGroup::on_but_connect_clicked()
         {
             qInfo() << "移除组播组成功！";
             m_udpSocket->abort();
+            ui->check_reliable->setEnabled(true);
             ui->but_connect->setText("打开");
         }
         else
@@ -88,7 +122,49 @@ void SimpleUdpGroup::on_but_connect_clicked()
 void SimpleUdpGroup::on_but_send_clicked()
 {
     QString str = ui->text_send->toPlainText();
+    if (m_reliable->isOpen())
+    {
+        if (!m_reliable->send(str.toUtf8()))   // 加入发送队列，由ReliableMulticast按速率限制发送
+        {
+            qWarning() << "可靠组播发送失败，数据太长或发送队列已满！";
+        }
+        return;
+    }
     qint64 len = m_udpSocket->writeDatagram(str.toUtf8(), QHostAddress(ui->line_groupAddress->text()),
                                             ui->spin_groupPort->value());
     qInfo() << QString("发送数据长度：%1").arg(len);
 }
+
+/**
+ * @brief 可靠组播收到的数据，同一个发送端的数据按发送顺序交付
+ */
+void SimpleUdpGroup::on_reliableReceived(quint32 session, const QHostAddress& sender, const QByteArray& data)
+{
+    ui->text_recv->append(QString("[%1 %2] %3").arg(sender.toString()).arg(session, 8, 16, QChar('0')).arg(QString(data)));
+}
+
+void SimpleUdpGroup::on_reliableLost(quint32 session, quint64 seq, quint64 count)
+{
+    ui->text_recv->append(QString("[%1] 丢失数据包 %2 ~ %3，无法修复").arg(session, 8, 16, QChar('0')).arg(seq).arg(seq + count - 1));
+}
+
+/**
+ * @brief 显示可靠组播的统计信息
+ */
+void SimpleUdpGroup::on_timeout()
+{
+    const ReliableMulticast::Statistics s = m_reliable->statistics();
+    ui->label_statistics->setText(QString("发送：%1包 重传%2 队列%3 | 接收：%4包 交付%5 重复%6 丢包%7 修复%8 丢失%9 NACK%10/抑制%11 发送端%12")
+                                      .arg(s.packetsSent)
+                                      .arg(s.repairsSent)
+                                      .arg(s.queued)
+                                      .arg(s.packetsReceived)
+                                      .arg(s.packetsDelivered)
+                                      .arg(s.duplicates)
+                                      .arg(s.gaps)
+                                      .arg(s.repaired)
+                                      .arg(s.lost)
+                                      .arg(s.nacksSent)
+                                      .arg(s.nacksSuppressed)
+                                      .arg(s.sources));
+}
@@ -5,7 +5,7 @@
  * @开发者     mhf
  * @邮箱       1603291350@qq.com
  * @时间       2022/04/19
- * @备注
+ * @备注       勾选【可靠组播】时使用ReliableMulticast（序号 + NACK重传 + 速率限制）
  *****************************************************************************/
 #ifndef SIMPLEUDPGROUP_H
 #define SIMPLEUDPGROUP_H
@@ -13,6 +13,9 @@
 #include <QWidget>
 #include <QUdpSocket>
 
+class ReliableMulticast;
+class QTimer;
+
 namespace Ui {
 class SimpleUdpGroup;
 }
@@ -30,10 +33,15 @@ private slots:
     void on_but_connect_clicked();
 
     void on_but_send_clicked();
+    void on_reliableReceived(quint32 session, const QHostAddress& sender, const QByteArray& data);
+    void on_reliableLost(quint32 session, quint64 seq, quint64 count);
+    void on_timeout();
 
 private:
     Ui::SimpleUdpGroup *ui;
     QUdpSocket* m_udpSocket = nullptr;         // UDP通信对象
+    ReliableMulticast* m_reliable = nullptr;   // 可靠组播
+    QTimer* m_timer = nullptr;                 // 定时显示可靠组播的统计信息
 };
 
 #endif // SIMPLEUDPGROUP_H